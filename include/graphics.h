@@ -391,6 +391,9 @@ void pa_title(FILE* f, char* ts);
 void pa_eventover(pa_evtcod e, pa_pevthan eh,  pa_pevthan* oeh);
 void pa_eventsover(pa_pevthan eh,  pa_pevthan* oeh);
 void pa_sendevent(FILE* f, pa_evtrec* er);
+void pa_pushstate(FILE* f);
+void pa_popstate(FILE* f);
+int pa_winid(FILE* f);
 
 /* graphical */
 
@@ -590,6 +593,11 @@ void pa_queryfindrep(char* s, int sl, char* r, int rl, pa_qfropts* opt);
 void pa_queryfont(FILE* f, int* fc, int* s, int* fr, int* fg, int* fb, int* br,
                   int* bg, int* bb, pa_qfteffects* effect);
 
+/* statistics */
+
+unsigned long long pa_getstat(FILE* f, const char* n);
+void pa_prtstats(FILE* fp);
+
 /*
  * Override vector types
  *
@@ -644,6 +652,9 @@ typedef void (*pa_bcolorc_t)(FILE* f, int r, int g, int b);
 typedef void (*pa_eventover_t)(pa_evtcod e, pa_pevthan eh,  pa_pevthan* oeh);
 typedef void (*pa_eventsover_t)(pa_pevthan eh,  pa_pevthan* oeh);
 typedef void (*pa_sendevent_t)(FILE* f, pa_evtrec* er);
+typedef void (*pa_pushstate_t)(FILE* f);
+typedef void (*pa_popstate_t)(FILE* f);
+typedef int (*pa_winid_t)(FILE* f);
 typedef int (*pa_maxxg_t)(FILE* f);
 typedef int (*pa_maxyg_t)(FILE* f);
 typedef int (*pa_curxg_t)(FILE* f);
@@ -926,6 +937,9 @@ void _pa_pictsizy_ovr(pa_pictsizy_t nfp, pa_pictsizy_t* ofp);
 void _pa_picture_ovr(pa_picture_t nfp, pa_picture_t* ofp);
 void _pa_event_ovr(pa_event_t nfp, pa_event_t* ofp);
 void _pa_sendevent_ovr(pa_sendevent_t nfp, pa_sendevent_t* ofp);
+void _pa_pushstate_ovr(pa_pushstate_t nfp, pa_pushstate_t* ofp);
+void _pa_popstate_ovr(pa_popstate_t nfp, pa_popstate_t* ofp);
+void _pa_winid_ovr(pa_winid_t nfp, pa_winid_t* ofp);
 void _pa_eventover_ovr(pa_eventover_t nfp, pa_eventover_t* ofp);
 void _pa_eventsover_ovr(pa_eventsover_t nfp, pa_eventsover_t* ofp);
 void _pa_timer_ovr(pa_timer_t nfp, pa_timer_t* ofp);
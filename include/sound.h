@@ -398,6 +398,7 @@ void pa_playsynth(int p, int t, int s);
 void pa_delsynth(int s);
 void pa_waitsynth(int p);
 void pa_wrsynth(int p, pa_seqptr sp);
+void pa_wrsynthlst(int p, pa_seqptr sp);
 void pa_rdsynth(int p, pa_seqptr sp);
 int pa_waveout(void);
 int pa_wavein(void);
@@ -477,6 +478,9 @@ void _pa_waveinplug(int addend, string name,
 /* execute sequencer entry in main code */
 void _pa_excseq(int p, pa_seqptr sp);
 
+/* get event from loaded synth file */
+int _pa_synthevt(int s, int i, pa_seqptr sp);
+
 #ifdef __cplusplus
 }
 #endif
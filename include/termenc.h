@@ -0,0 +1,80 @@
+/**//***************************************************************************
+
+Terminal damage tracking and output encoder
+
+Common support for the character screen modules, the terminal module and the
+character window manager. Two things are provided:
+
+1. A damage list. This keeps the changed span of each line of a character
+surface, so that only what has changed needs to be sent out.
+
+2. An output encoder. This collects output for a terminal in a buffer, and
+writes it out in one call to the next write() in the override chain. It also
+contains the ANSI encoding rules that can be shared, which are the joining of
+SGR (set graphic rendition) sequences and a cost model for cursor motion that
+picks the shortest sequence to get from one position to another.
+
+Cell storage is not shared. The terminal module keeps the screen as the
+terminal holds it, with UTF-8 characters and optional 24 bit color, while the
+window manager keeps a buffer per window, including the parts covered by other
+windows, and composes the root from them through the terminal API. So a window
+manager running over the terminal module still has the visible cells in both.
+
+*******************************************************************************/
+
+#ifndef __TERMENC_H__
+#define __TERMENC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <sys/types.h>
+
+#define PA_ENCBUF 4096 /* size of encoder buffer */
+#define PA_ENCSGR 16   /* maximum parameters in a joined SGR sequence */
+
+/* write function to send encoded output to */
+typedef ssize_t (*pa_encwrt_t)(int fd, const void* buff, size_t count);
+
+/* output encoder */
+typedef struct {
+
+    pa_encwrt_t   wrt;            /* write function */
+    int           fd;             /* file to write to */
+    int           len;            /* number of characters in buffer */
+    int           sgr;            /* end of last SGR sequence in buffer, or -1 */
+    int           sgrn;           /* number of parameters in that sequence */
+    unsigned char buf[PA_ENCBUF]; /* output buffer */
+
+} pa_encrec, *pa_encptr;
+
+/* damage list */
+typedef struct {
+
+    int  rows;   /* number of lines */
+    int* x1;     /* start of damage on each line */
+    int* x2;     /* end of damage on each line, empty if less than start */
+    int  y1, y2; /* first and last lines with damage, empty if y1 > y2 */
+
+} pa_dmgrec, *pa_dmgptr;
+
+int pa_dmgini(pa_dmgptr d, int rows);
+void pa_dmgfre(pa_dmgptr d);
+void pa_dmgclr(pa_dmgptr d);
+void pa_dmgadd(pa_dmgptr d, int x1, int y1, int x2, int y2);
+int pa_dmgact(pa_dmgptr d);
+
+void pa_encini(pa_encptr e, pa_encwrt_t wrt, int fd);
+int pa_encflush(pa_encptr e);
+int pa_encchr(pa_encptr e, unsigned char c);
+int pa_encstr(pa_encptr e, char* s);
+int pa_encint(pa_encptr e, int i);
+int pa_encsgr(pa_encptr e, int n, int p[]);
+int pa_enccur(pa_encptr e, int ox, int oy, int nx, int ny);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __TERMENC_H__ */
@@ -5,18 +5,35 @@ Fluidsynth Plug-In for Petit_Ami sound module
 Allows Fluidsynth to serve as a plug-in for MIDI command stream devices under
 Petit_ami sound system.
 
+The instances are registered as devices at startup, but the synthesizers are
+not created until their ports are opened, so programs that don't play MIDI
+don't pay for them. The SoundFont is loaded by the first instance created, and
+the others share it. The number of instances and the SoundFont are set by the
+"fluidsynth" block in the "sound" block of the configuration.
+
+Loaded synth files can also be rendered offline to wave files, as fast as the
+CPU allows, with the "render" parameter. See setparamfluid().
+
 *******************************************************************************/
 
 #include <sys/types.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <string.h>
 
 #include <fluidsynth.h>
 #include <stdlib.h>
 #include <localdefs.h>
+#include <config.h>
 #include <sound.h>
 
 #define MAXINST 10 /* maximum number of fluidsynth instances */
-#define INST 4 /* number of fluidsynth plug instances to create */
+#define INST 4 /* default number of fluidsynth plug instances to create */
+#define SFONT "/usr/share/sounds/sf2/FluidR3_GM.sf2" /* default SoundFont */
+#define MAXRND 16 /* maximum number of files rendered at once */
+#define RNDBUF 1024 /* frames rendered at a time */
+#define RNDTAIL 5 /* maximum seconds rendered after the last event */
+#define WAVHDR 44 /* size of wave file header */
 
 /* fluidsynth device record */
 typedef struct {
@@ -25,12 +42,28 @@ typedef struct {
     fluid_synth_t*        synth;
     fluid_audio_driver_t* adriver;
     int                   sfont_id;
+    int                   sfshr; /* SoundFont is shared from another */
 
 } fluiddev;
 
 typedef fluiddev* fluidptr; /* pointer to fludsynth device */
 
+/* offline render of a synth file */
+typedef struct {
+
+    pthread_t thread; /* thread rendering the file */
+    int       s;      /* logical synth file */
+    string    fn;     /* wave file to write */
+    int       r;      /* result, 0 for success */
+
+} fluidrnd;
+
 static fluidptr devtbl[MAXINST]; /* fluidsynth instance table */
+static int numinst; /* number of instances */
+static string sfpath; /* SoundFont file */
+static fluid_sfont_t* sfont; /* shared SoundFont, NULL if not loaded */
+static fluidptr sfown; /* instance that loaded the SoundFont */
+static pthread_mutex_t fluidlck; /* instance creation lock */
 
 /*******************************************************************************
 
@@ -52,10 +85,96 @@ static void error(string es)
 
 /*******************************************************************************
 
+Create Fluidsynth instance
+
+Creates a synthesizer and, if drv is TRUE, its audio driver. The first
+instance created with a driver loads the SoundFont, and the rest add that same
+SoundFont to their synthesizers, so the samples are only in memory once. If the
+SoundFont can't be loaded, the instance has no instruments, and the next
+instance created tries again.
+
+An instance without a driver, used for offline rendering, shares the SoundFont
+if it is loaded, but otherwise loads its own copy, since it does not live as
+long as the ports do.
+
+Must be called with the instance lock held.
+
+*******************************************************************************/
+
+static fluidptr newfluid(int drv)
+
+{
+
+    fluidptr fp; /* pointer to fluidsynth device */
+    int      id; /* SoundFont id */
+
+    fp = malloc(sizeof(fluiddev));
+    if (!fp) error("Cannot allocate device");
+    /* create the settings */
+    fp->settings = new_fluid_settings();
+    /* fluidsynth default volume is very low. Turn up to reasonable value */
+    fluid_settings_setnum(fp->settings, "synth.gain", 1.0);
+    /* set the audio driver as alsa type */
+    fluid_settings_setstr(fp->settings, "audio.driver", "alsa");
+    /* create the synthesizer */
+    fp->synth = new_fluid_synth(fp->settings);
+    fp->sfont_id = FLUID_FAILED; /* set no SoundFont */
+    fp->sfshr = FALSE;
+    if (sfont) { /* SoundFont is loaded, share it */
+
+        fp->sfont_id = fluid_synth_add_sfont(fp->synth, sfont);
+        fp->sfshr = fp->sfont_id != FLUID_FAILED;
+        fluid_synth_program_reset(fp->synth); /* reset presets */
+
+    } else if (!drv) /* load a private SoundFont */
+        fp->sfont_id = fluid_synth_sfload(fp->synth, sfpath, 1);
+    else { /* load a SoundFont and reset presets */
+
+        id = fluid_synth_sfload(fp->synth, sfpath, 1);
+        if (id != FLUID_FAILED) {
+
+            fp->sfont_id = id;
+            sfont = fluid_synth_get_sfont_by_id(fp->synth, id);
+            sfown = fp; /* this instance owns it */
+
+        }
+
+    }
+    fp->adriver = NULL; /* set no driver */
+    if (drv) fp->adriver = new_fluid_audio_driver(fp->settings, fp->synth);
+
+    return (fp);
+
+}
+
+/*******************************************************************************
+
+Delete Fluidsynth instance
+
+Deletes a synthesizer and its audio driver. An instance that shares the
+SoundFont takes it off its synthesizer first, since deleting a synthesizer
+deletes its SoundFonts. The owner of the SoundFont must be deleted last.
+
+*******************************************************************************/
+
+static void delfluid(fluidptr fp)
+
+{
+
+    if (fp->adriver) delete_fluid_audio_driver(fp->adriver);
+    if (fp->sfshr) fluid_synth_remove_sfont(fp->synth, sfont);
+    delete_fluid_synth(fp->synth);
+    delete_fluid_settings(fp->settings);
+    free(fp);
+
+}
+
+/*******************************************************************************
+
 Open Liquidsynth MIDI device
 
-Opens a Liquidsynth MIDI port for use. Does nothing at present, since we open
-one MIDI out device at init time.
+Opens a Liquidsynth MIDI port for use. The instance is created on the first
+open, and kept until the program ends.
 
 *******************************************************************************/
 
@@ -63,8 +182,11 @@ static void openfluid(int p)
 
 {
 
-    if (p < 1 || p > MAXINST) error("Invalid synth handle");
-    if (!devtbl[p-1]) error("No Fluidsynth output port at logical handle");
+    if (p < 1 || p > numinst) error("Invalid synth handle");
+
+    pthread_mutex_lock(&fluidlck);
+    if (!devtbl[p-1]) devtbl[p-1] = newfluid(TRUE); /* create instance */
+    pthread_mutex_unlock(&fluidlck);
 
 }
 
@@ -80,16 +202,17 @@ static void closefluid(int p)
 
 {
 
-    if (p < 1 || p > MAXINST) error("Invalid synth handle");
+    if (p < 1 || p > numinst) error("Invalid synth handle");
     if (!devtbl[p-1]) error("No Fluidsynth output port at logical handle");
 
 }
 
 /*******************************************************************************
 
-Write liquidsynth MIDI message
+Execute liquidsynth MIDI message
 
-Accepts a MIDI message in PA sequencer format and outputs that.
+Accepts a MIDI message in PA sequencer format and performs it on the given
+instance.
 
 Many functions don't have equivalents in Fluidsynth. This is not serious, I
 found that many of these functions do nothing on most synthesizers.
@@ -99,16 +222,10 @@ midi codes are fed directly to Fluidsynth (source code analysis?).
 
 *******************************************************************************/
 
-static void writefluid(int p, pa_seqptr sp)
+static void excfluid(fluidptr fp, int p, pa_seqptr sp)
 
 {
 
-    fluidptr fp; /* pointer to fluidsynth device */
-
-    if (p < 1 || p > MAXINST) error("Invalid synth handle");
-    if (!devtbl[p-1]) error("No Fluidsynth output port at logical handle");
-
-    fp = devtbl[p-1]; /* point to device */
     switch (sp->st) { /* sequencer message type */
 
         case st_noteon:
@@ -174,102 +291,381 @@ static void writefluid(int p, pa_seqptr sp)
 
 /*******************************************************************************
 
-Set parameter
+Write liquidsynth MIDI message
 
-Set plug in parameter from the given name and value. Not implemented at present.
-Always returns error.
+Accepts a MIDI message in PA sequencer format and outputs that.
 
 *******************************************************************************/
 
-int setparamfluid(int p, string name, string value)
+static void writefluid(int p, pa_seqptr sp)
 
 {
 
-    return (1); /* always return error */
+    if (p < 1 || p > numinst) error("Invalid synth handle");
+    if (!devtbl[p-1]) error("No Fluidsynth output port at logical handle");
+
+    excfluid(devtbl[p-1], p, sp); /* execute on device */
 
 }
 
 /*******************************************************************************
 
-Get parameter
+Write little endian value
 
-Get plug in parameter from the given name and value. Not implemented at present.
-Always returns empty string.
+Places a value of the given number of bytes, least significant first.
 
 *******************************************************************************/
 
-void getparamfluid(int p, string name, string value, int len)
+static byte* putle(byte* bp, unsigned int v, int n)
 
 {
 
-    *value = 0; /* clear output string */
+    while (n--) { *bp++ = v & 0xff; v >>= 8; }
+
+    return (bp);
 
 }
 
 /*******************************************************************************
 
-Initialize Fluidsynth plug-in.
+Write wave file header
 
-Registers Fluidsynth as a plug-in device with PA sound module.
+Writes the header for a wave file of 16 bit stereo samples at the given rate,
+with the given number of frames, to the start of the file. Returns 0 on
+success.
 
 *******************************************************************************/
 
-static int stderr_file;
+static int wrwavhdr(FILE* f, int rate, unsigned int frames)
+
+{
+
+    byte  hdr[WAVHDR]; /* header */
+    byte* bp;
+
+    bp = hdr;
+    memcpy(bp, "RIFF", 4); bp += 4;
+    bp = putle(bp, WAVHDR-8+frames*4, 4); /* size of rest of file */
+    memcpy(bp, "WAVEfmt ", 8); bp += 8;
+    bp = putle(bp, 16, 4); /* size of format */
+    bp = putle(bp, 1, 2); /* PCM */
+    bp = putle(bp, 2, 2); /* channels */
+    bp = putle(bp, rate, 4); /* sample rate */
+    bp = putle(bp, rate*4, 4); /* bytes per second */
+    bp = putle(bp, 4, 2); /* bytes per frame */
+    bp = putle(bp, 16, 2); /* bits per sample */
+    memcpy(bp, "data", 4); bp += 4;
+    bp = putle(bp, frames*4, 4); /* size of data */
+
+    return (fseek(f, 0, SEEK_SET) || fwrite(hdr, WAVHDR, 1, f) != 1);
+
+}
+
+/*******************************************************************************
 
-static void quiet(void)
+Render frames
+
+Renders the given number of frames, up to RNDBUF, from the synthesizer and
+writes them to the wave file. Returns 0 on success. The silent flag is set
+TRUE if all of the frames were zero.
+
+*******************************************************************************/
+
+static int rndfrm(fluidptr fp, FILE* f, int n, int* silent)
 
 {
 
-    /* run alsa open in quiet */
-    fflush(stderr);
-    stderr_file = dup(fileno(stderr));
-    freopen("/dev/null", "w", stderr);
+    short smp[RNDBUF*2]; /* samples, interleaved */
+    byte  buf[RNDBUF*4]; /* samples in file order */
+    byte* bp;
+    int   i;
+
+    fluid_synth_write_s16(fp->synth, n, smp, 0, 2, smp, 1, 2);
+    *silent = TRUE;
+    bp = buf;
+    for (i = 0; i < n*2; i++) {
+
+        if (smp[i]) *silent = FALSE;
+        bp = putle(bp, (unsigned short)smp[i], 2);
+
+    }
+
+    return (fwrite(buf, 4, n, f) != n);
 
 }
 
-static void unquiet(void)
+/*******************************************************************************
+
+Render synth file
+
+Renders a loaded synth file to a wave file, on its own synthesizer that is not
+connected to an audio driver. The synthesizer is run in a loop against the
+times of the events in the file, so the render runs as fast as the CPU allows,
+not in real time. After the last event, the render goes on until the sound
+dies away, up to RNDTAIL seconds. Returns 0 on success.
+
+*******************************************************************************/
+
+static int rndfluid(int s, string fn)
 
 {
 
-    fflush(stderr);
-    dup2(stderr_file, fileno(stderr));
-    close(stderr_file);
-    clearerr(stderr);
+    fluidptr     fp;     /* render instance */
+    FILE*        f;      /* wave file */
+    pa_seqmsg    msg;    /* event from file */
+    double       rate;   /* sample rate */
+    long long    end;    /* frame of next event */
+    unsigned int frm;    /* frames rendered */
+    unsigned int tail;   /* frames rendered after the last event */
+    int          n;      /* frames to render */
+    int          silent; /* last frames were silent */
+    int          i;
+    int          r;      /* result */
+
+    f = fopen(fn, "wb");
+    if (!f) return (1);
+    pthread_mutex_lock(&fluidlck);
+    fp = newfluid(FALSE); /* create render instance */
+    pthread_mutex_unlock(&fluidlck);
+    fluid_settings_getnum(fp->settings, "synth.sample-rate", &rate);
+
+    r = wrwavhdr(f, rate, 0); /* hold space for header */
+    frm = 0;
+    i = 0;
+    while (!r && _pa_synthevt(s, i++, &msg)) {
+
+        /* render up to the event, then perform it */
+        end = (long long)msg.time*(long long)rate/10000;
+        while (!r && frm < end) {
+
+            n = end-frm;
+            if (n > RNDBUF) n = RNDBUF;
+            r = rndfrm(fp, f, n, &silent);
+            frm += n;
+
+        }
+        excfluid(fp, 0, &msg);
+
+    }
+    /* render the tail until silent */
+    tail = 0;
+    silent = FALSE;
+    while (!r && !silent && tail < rate*RNDTAIL) {
+
+        r = rndfrm(fp, f, RNDBUF, &silent);
+        frm += RNDBUF;
+        tail += RNDBUF;
+
+    }
+    if (!r) r = wrwavhdr(f, rate, frm); /* place final sizes */
+    if (fclose(f)) r = 1;
+
+    pthread_mutex_lock(&fluidlck);
+    delfluid(fp); /* remove render instance */
+    pthread_mutex_unlock(&fluidlck);
+
+    return (r);
 
 }
 
+/*******************************************************************************
+
+Render thread
+
+Runs the render of one synth file.
+
+*******************************************************************************/
+
+static void* rndthrd(void* data)
+
+{
+
+    fluidrnd* rp = data;
+
+    rp->r = rndfluid(rp->s, rp->fn);
+
+    return (NULL);
+
+}
+
+/*******************************************************************************
+
+Set parameter
+
+Set plug in parameter from the given name and value. Returns 0 on success,
+otherwise 1. The parameters are:
+
+render - Renders loaded synth files offline to wave files. The value is a list
+         of logical synth file numbers, each followed by the name of the wave
+         file to write, separated by spaces, as "1 one.wav 2 two.wav". Each
+         file is rendered on its own thread, and the call returns when all are
+         written. The port does not need to be open.
+
+*******************************************************************************/
+
+int setparamfluid(int p, string name, string value)
+
+{
+
+    fluidrnd rt[MAXRND]; /* render table */
+    int      n;          /* number of renders */
+    int      i;
+    char*    cp;
+    char*    ep;
+    int      r;          /* result */
+
+    if (strcmp(name, "render")) return (1); /* not a parameter */
+
+    /* parse the list of files */
+    n = 0;
+    r = 0;
+    cp = value;
+    while (*cp == ' ') cp++;
+    while (*cp && !r) {
+
+        if (n >= MAXRND) r = 1; /* too many */
+        else {
+
+            rt[n].s = strtol(cp, &ep, 10);
+            if (ep == cp || *ep != ' ') r = 1; /* no number */
+            else {
+
+                cp = ep;
+                while (*cp == ' ') cp++;
+                ep = cp;
+                while (*ep && *ep != ' ') ep++;
+                if (ep == cp) r = 1; /* no file name */
+                else {
+
+                    rt[n].fn = malloc(ep-cp+1);
+                    if (!rt[n].fn) error("Cannot allocate file name");
+                    memcpy(rt[n].fn, cp, ep-cp);
+                    rt[n].fn[ep-cp] = 0;
+                    n++;
+                    cp = ep;
+                    while (*cp == ' ') cp++;
+
+                }
+
+            }
+
+        }
+
+    }
+    if (!n) r = 1; /* nothing to render */
+
+    /* start the renders, then wait for all */
+    if (!r) {
+
+        for (i = 0; i < n; i++)
+            if (pthread_create(&rt[i].thread, NULL, rndthrd, &rt[i]))
+                error("Cannot start render thread");
+        for (i = 0; i < n; i++) {
+
+            pthread_join(rt[i].thread, NULL);
+            if (rt[i].r) r = 1; /* render failed */
+
+        }
+
+    }
+    for (i = 0; i < n; i++) free(rt[i].fn);
+
+    return (r);
+
+}
+
+/*******************************************************************************
+
+Get parameter
+
+Get plug in parameter from the given name and value. Not implemented at present.
+Always returns empty string.
+
+*******************************************************************************/
+
+void getparamfluid(int p, string name, string value, int len)
+
+{
+
+    *value = 0; /* clear output string */
+
+}
+
+/*******************************************************************************
+
+Initialize Fluidsynth plug-in.
+
+Registers Fluidsynth as a plug-in device with PA sound module. The instances
+are only registered here, they are created when opened.
+
+*******************************************************************************/
+
 static void fluidsynth_plug_init (void) __attribute__((constructor (103)));
 static void fluidsynth_plug_init()
 
 {
 
-    char buff[200];
-    int i;
-    int r;
+    char      buff[200];
+    int       i;
+    pa_valptr config_root; /* root for config block */
+    pa_valptr snd_root;    /* root for sound block */
+    pa_valptr fs_root;     /* root for fluidsynth block */
+    pa_valptr vp;
+    char*     errstr;
 
     /* clear instance table */
     for (i = 0; i < MAXINST; i++) devtbl[i] = NULL;
+    sfont = NULL; /* set no SoundFont loaded */
+    sfown = NULL;
+    pthread_mutex_init(&fluidlck, NULL);
+
+    /* Fluidsynth prints diagnostics to stderr when instances are created,
+       which happens when ports are opened. Turn those off in fluidsynth's own
+       log, rather than taking over stderr for the whole process. Panics are
+       still printed, since fluidsynth stops after them. */
+    fluid_set_log_function(FLUID_ERR, NULL, NULL);
+    fluid_set_log_function(FLUID_WARN, NULL, NULL);
+    fluid_set_log_function(FLUID_INFO, NULL, NULL);
+    fluid_set_log_function(FLUID_DBG, NULL, NULL);
+
+    /* set defaults */
+    numinst = INST;
+    sfpath = SFONT;
+
+    /* get setup configuration */
+    config_root = NULL;
+    pa_config(&config_root);
+
+    /* find "sound" block, then "fluidsynth" block within that */
+    snd_root = pa_schlst("sound", config_root);
+    fs_root = NULL;
+    if (snd_root && snd_root->sublist)
+        fs_root = pa_schlst("fluidsynth", snd_root->sublist);
+    if (fs_root && fs_root->sublist) {
+
+        /* find number of instances */
+        vp = pa_schlst("instances", fs_root->sublist);
+        if (vp) {
+
+            numinst = strtol(vp->value, &errstr, 10);
+            if (*errstr || numinst < 0 || numinst > MAXINST)
+                error("Invalid configuration value");
+
+        }
+        /* find SoundFont file */
+        vp = pa_schlst("soundfont", fs_root->sublist);
+        if (vp) {
+
+            sfpath = malloc(strlen(vp->value)+1);
+            if (!sfpath) error("Cannot allocate SoundFont name");
+            strcpy(sfpath, vp->value);
+
+        }
+
+    }
 
-    /* turn off liquidsynth error messages */
-    quiet();
-
-    /* create number of desired instances */
-    for (i = 0; i < INST; i++) {
-
-        /* create table entry */
-        devtbl[i] = malloc(sizeof(fluiddev));
-        if (!devtbl[i]) error("Cannot allocate device");
-        /* create the settings */
-        devtbl[i]->settings = new_fluid_settings();
-        /* create the synthesizer */
-        devtbl[i]->synth = new_fluid_synth(devtbl[i]->settings);
-        /* create the audio driver as alsa type */
-        fluid_settings_setstr(devtbl[i]->settings, "audio.driver", "alsa");
-        devtbl[i]->adriver = new_fluid_audio_driver(devtbl[i]->settings, devtbl[i]->synth);
-        /* load a SoundFont and reset presets */
-        devtbl[i]->sfont_id = fluid_synth_sfload(devtbl[i]->synth, "/usr/share/sounds/sf2/FluidR3_GM.sf2", 1);
-        /* fluidsynth default volume is very low. Turn up to reasonable value */
-        fluid_settings_setnum(devtbl[i]->settings, "synth.gain", 1.0);
+    /* register number of desired instances */
+    for (i = 0; i < numinst; i++) {
 
         /* show the device fluidsynth connects to (usually "default") */
         /*
@@ -283,10 +679,6 @@ static void fluidsynth_plug_init()
                          setparamfluid, getparamfluid);
 
     }
-    /* re-enable error messages */
-    unquiet();
-
-
 
 }
 
@@ -305,13 +697,9 @@ static void fluidsynth_plug_deinit()
 
     int i;
 
-    /* Clean up */
-    for (i = 0; i < MAXINST; i++) if (devtbl[i]) {
-
-        delete_fluid_audio_driver(devtbl[i]->adriver);
-        delete_fluid_synth(devtbl[i]->synth);
-        delete_fluid_settings(devtbl[i]->settings);
-
-    }
+    /* Clean up, the owner of the SoundFont goes last */
+    for (i = 0; i < MAXINST; i++)
+        if (devtbl[i] && devtbl[i] != sfown) delfluid(devtbl[i]);
+    if (sfown) delfluid(sfown);
 
 }
@@ -144,6 +144,7 @@ static enum { /* debug levels */
 //#define NOWDELAY /* don't delay window presentation until drawn */
 //#define NOFAKEFOCUS /* don't fake focus for child windows */
 #define WAITWMR     /* wait on window manager replies for window configures */
+//#define NOEVTCMP /* don't compress expose/motion/configure XEvents */
 
 #if !defined(__MACH__) && !defined(__FreeBSD__) /* Mac OS X */
 #define NOCANCEL /* include nocancel overrides */
@@ -232,14 +233,48 @@ static enum { /* debug levels */
 #define CONPNT    11    /* height of console font in points */
 #endif
 
+#ifndef STSENB
+#define STSENB    FALSE /* collect and print API statistics (diagnostic) */
+#endif
+
 /* file handle numbers at the system interface level */
 #define INPFIL 0 /* handle to standard input */
 #define OUTFIL 1 /* handle to standard output */
 #define ERRFIL 2 /* handle to standard error */
 
-/* XWindows call lock/unlock */
-#define XWLOCK() pthread_mutex_lock(&xwlock)
-#define XWUNLOCK() pthread_mutex_unlock(&xwlock)
+/* XWindows call lock/unlock. This is held only around the Xlib calls
+   themselves, never across window state work, so that a thread drawing to one
+   window holds up others only for the time of the calls. It is recursive so
+   a helper that locks can be called from a locked section. With statistics
+   on, these also measure contention and hold time. */
+#define XWLOCK() xwlck()
+#define XWUNLOCK() xwunlck()
+
+/* API statistics. STSBGN opens a measurement at the top of a call, STSEND
+   closes it and charges the time and Xlib requests to the statistics point
+   and the window. Both do nothing unless statistics are enabled. */
+#define STSBGN(st) stsrec st; stsbgn(&st)
+#define STSEND(st, p, f) stsend(&st, p, NULL, f)
+#define STSENDW(st, p, w) stsend(&st, p, w, NULL)
+#define STSADD(v, n) __atomic_fetch_add(&(v), n, __ATOMIC_RELAXED)
+
+/* count calls that wait on a reply from the server */
+#define RNDTRP(n) STSADD(stsrtp, (n)*stsenb)
+
+/* count image bytes sent to the server */
+#define IMGSNT(n) STSADD(stsimg, (n)*stsenb)
+
+/* flush output to the server, and count it */
+#define XFLUSH() do { STSADD(stsflsh, stsenb); XFlush(padisplay); } while (0)
+
+/* Window state lock/unlock. Each window has its own lock on its state
+   (screens, cursor, modes, damage), taken by every call that works on the
+   window from entry to exit, and by the event handler while it processes an
+   event for the window. So threads using different windows don't serialize on
+   anything but the Xlib calls themselves. The lock order is always window
+   lock, then XWindows call lock. */
+#define WINLOCK(w) pthread_mutex_lock(&(w)->wlock)
+#define WINUNLOCK(w) pthread_mutex_unlock(&(w)->wlock)
 
 /* motif window manager decoration bits, used to enable or disable windows
    decorations. These are no longer defined in XLIB, but are operative. */
@@ -362,6 +397,34 @@ typedef struct fontrec {
 
 typedef enum { mdnorm, mdinvis, mdxor, mdand, mdor } mode; /* color mix modes */
 
+/* statistics points, in the order of stsnam[] */
+typedef enum {
+
+    stwrite, stdrwchr, strestore, stflip, stevent, stselect, stscroll,
+    stscrollg, stline, strect, stfrect, strrect, stfrrect, stellipse,
+    stfellipse, starc, stfarc, stfchord, stftriangle, stsetpixel, stwrtstr,
+    stwrtstrn, stwritejust, stloadpict, stpicture, stsizbuf, stsizbufg,
+    stmax
+
+} stspnt;
+
+/* statistics for a single point */
+typedef struct {
+
+    unsigned long      calls; /* number of calls */
+    unsigned long long time;  /* total time in calls, ns */
+    unsigned long      xreqs; /* Xlib requests issued in calls */
+
+} stsent;
+
+/* statistics measurement in progress */
+typedef struct {
+
+    unsigned long long time; /* start time, ns */
+    unsigned long      rqs;  /* Xlib request sequence at start */
+
+} stsrec;
+
 /* Menu tracking. This is a mirror image of the menu we were given by the
    user. However, we can do with less information than is in the original
    tree as passed. The menu items are a linear list, since they contain
@@ -429,12 +492,46 @@ typedef struct scncon { /* screen context */
     int     vextx;       /* viewpor extent x */
     int     vexty;       /* viewport extent y */
 
+    /* damage, the bounding box of where this buffer may differ from what is
+       on the window, in pixels. Used to flip screens by copying only what
+       changed. */
+    int     dmg;         /* there is damage */
+    int     dmgx1;       /* damage rectangle */
+    int     dmgy1;
+    int     dmgx2;
+    int     dmgy2;
+
     /* fields used by graphics subsystem */
     GC      xcxt;        /* graphics context */
     Pixmap  xbuf;        /* pixmap for screen backing buffer */
 
 } scncon;
 
+/* saved drawing state, a stack of these is kept for each window */
+typedef struct dstrec* dstptr;
+typedef struct dstrec {
+
+    dstptr  next;    /* next (older) entry */
+    int     curx;    /* cursor location in characters */
+    int     cury;
+    int     curxg;   /* cursor location in pixels */
+    int     curyg;
+    int     fcrgb;   /* foreground color in rgb */
+    int     bcrgb;   /* background color in rgb */
+    mode    fmod;    /* foreground mix mode */
+    mode    bmod;    /* background mix mode */
+    int     lwidth;  /* width of lines */
+    fontptr cfont;   /* active font entry */
+    int     fhigh;   /* font height */
+    int     attr;    /* set of active attributes */
+    int     autof;   /* status of scroll and wrap */
+    int     curv;    /* cursor visible */
+    int     chrspcx; /* extra space between characters */
+    int     chrspcy; /* extra space between lines */
+    int     scn;     /* update screen the state was saved from */
+
+} dstrec;
+
 typedef struct pict* picptr;
 typedef struct pict { /* picture tracking record */
 
@@ -458,6 +555,9 @@ typedef struct winrec* winptr;
 typedef struct winrec {
 
     winptr       next;              /* next entry (for free list) */
+    pthread_mutex_t wlock;          /* window draw state lock */
+    unsigned long xreqs;            /* Xlib requests for window (statistics) */
+    dstptr       dstlst;            /* saved drawing states stack */
     /* fields used by graph module */
     int          parlfn;            /* logical parent */
     winptr       parwin;            /* link to parent (or NULL for parentless) */
@@ -671,6 +771,8 @@ typedef enum {
     evecaxe,  /* cannot vector auxillary event */
     eangato,  /* cannot set character drawing angle in auto mode */
     eatoang,  /* Cannot reenable auto with non-90 degree text */
+    einvsts,  /* Invalid statistic name */
+    enodst,   /* No saved drawing state */
 
     /* unimplemented override errors */
     egetwigid_unimp,        /* getwigid unimplemented */
@@ -911,6 +1013,9 @@ static pa_wrtstrn_t         wrtstrn_vect;
 static pa_eventover_t       eventover_vect;
 static pa_eventsover_t      eventsover_vect;
 static pa_sendevent_t       sendevent_vect;
+static pa_pushstate_t       pushstate_vect;
+static pa_popstate_t        popstate_vect;
+static pa_winid_t           winid_vect;
 static pa_maxxg_t           maxxg_vect;;
 static pa_maxyg_t           maxyg_vect;
 static pa_curxg_t           curxg_vect;
@@ -1101,6 +1206,28 @@ static pa_queryfont_t       queryfont_vect;
 static int fend;      /* end of program ordered flag */
 static int fautohold; /* automatic hold on exit flag */
 static pthread_mutex_t xwlock; /* XWindow call lock */
+static int xwldep; /* XWindow call lock nesting depth (statistics) */
+static unsigned long long xwlhld; /* time XWindow call lock was taken */
+
+/* statistics, collected when stsenb is set */
+static stsent             stsapi[stmax]; /* per point statistics */
+static unsigned long      stsflsh;       /* flushes to server */
+static unsigned long      stsrtp;        /* round trips to server */
+static unsigned long      stslck;        /* XWindow lock acquisitions */
+static unsigned long      stslckc;       /* XWindow lock contentions */
+static unsigned long long stslckw;       /* XWindow lock wait time, ns */
+static unsigned long long stslckh;       /* XWindow lock hold time, ns */
+static unsigned long long stsimg;        /* image bytes sent to server */
+
+/* names of statistics points */
+static const char* stsnam[stmax] = {
+
+    "write", "drwchr", "restore", "flip", "event", "select", "scroll",
+    "scrollg", "line", "rect", "frect", "rrect", "frrect", "ellipse",
+    "fellipse", "arc", "farc", "fchord", "ftriangle", "setpixel", "wrtstr",
+    "wrtstrn", "writejust", "loadpict", "picture", "sizbuf", "sizbufg"
+
+};
 
 /* X windows display characteristics.
  *
@@ -1183,12 +1310,116 @@ static int dmpmsg;    /* enable dump messages (diagnostic, windows only) */
 static int dmpevt;    /* enable dump Petit-Ami messages */
 static int prtftm;    /* print font metrics (diagnostic) */
 static int conpnt;    /* size of console font in points */
+static int stsenb;    /* collect and print API statistics (diagnostic) */
 
 static void iopenwin(FILE** infile, FILE** outfile, FILE* parent, int wid,
                      int subclient);
 
 /** ****************************************************************************
 
+Get statistics clock
+
+Returns monotonic time in nanoseconds.
+
+*******************************************************************************/
+
+static unsigned long long stsclk(void)
+
+{
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long)ts.tv_sec*1000000000ULL+ts.tv_nsec;
+
+}
+
+/** ****************************************************************************
+
+Lock and unlock XWindow calls
+
+With statistics on, an acquisition that can't be had immediately is counted
+as contended, and the time spent waiting for it is totaled. The hold time is
+measured from the outermost lock to the outermost unlock. The nesting depth and
+hold start are only touched with the lock held.
+
+*******************************************************************************/
+
+static void xwlck(void)
+
+{
+
+    unsigned long long t;
+
+    if (!stsenb) { pthread_mutex_lock(&xwlock); return; }
+    if (pthread_mutex_trylock(&xwlock)) { /* contended */
+
+        t = stsclk();
+        pthread_mutex_lock(&xwlock);
+        STSADD(stslckw, stsclk()-t);
+        STSADD(stslckc, 1);
+
+    }
+    stslck++;
+    if (!xwldep++) xwlhld = stsclk();
+
+}
+
+static void xwunlck(void)
+
+{
+
+    if (stsenb && !--xwldep) stslckh += stsclk()-xwlhld;
+    pthread_mutex_unlock(&xwlock);
+
+}
+
+/** ****************************************************************************
+
+Begin and end statistics measurement
+
+Begins a measurement by noting the time and Xlib request sequence. Ending it
+charges the call, elapsed time and requests issued to the statistics point,
+and the requests to the window, which is given directly or found from a file.
+Calls nested in the measured call are included in its totals.
+
+*******************************************************************************/
+
+static void stsbgn(stsrec* st)
+
+{
+
+    if (!stsenb || !padisplay) return;
+    st->time = stsclk();
+    st->rqs = NextRequest(padisplay);
+
+}
+
+static void stsend(stsrec* st, stspnt p, winptr win, FILE* f)
+
+{
+
+    unsigned long rqs;
+    int fn;
+
+    if (!stsenb || !padisplay) return;
+    rqs = NextRequest(padisplay)-st->rqs;
+    STSADD(stsapi[p].calls, 1);
+    STSADD(stsapi[p].time, stsclk()-st->time);
+    STSADD(stsapi[p].xreqs, rqs);
+    if (!win && f) { /* find window from file, quietly */
+
+        fn = fileno(f);
+        if (fn >= 0 && fn < MAXFIL && opnfil[fn]) win = opnfil[fn]->win;
+
+    }
+    if (win) STSADD(win->xreqs, rqs);
+
+}
+
+/** ****************************************************************************
+
 Present error dialog
 
 Presents the given text in a dialog. Used for graphical errors. Tries to be
@@ -1245,6 +1476,7 @@ static int errdlg(
 
     /* find screen placement */
     XGetWindowAttributes(padisplay, RootWindow(padisplay, pascreen), &xwa);
+    RNDTRP(1);
 
     ww = mw+40; /* set dialog width and height */
     wh = 200;
@@ -1406,6 +1638,8 @@ static char* errstr(errcod e)
         case evecaxe:  s = "Cannot vector auxillary event"; break;
         case eangato:  s = "Cannot set character drawing angle in auto mode"; break;
         case eatoang:  s = "Cannot reenable auto with non-90 degree text"; break;
+        case einvsts:  s = "Invalid statistic name"; break;
+        case enodst:   s = "No saved drawing state"; break;
         case egetwigid_unimp:        s = "getwigid unimplemented"; break;
         case ekillwidget_unimp:      s = "killwidget unimplemented"; break;
         case eselectwidget_unimp:    s = "selectwidget unimplemented"; break;
@@ -2015,6 +2249,7 @@ void enbxfrm(Window xwh, int e)
 
     XWLOCK();
     mwmHintsProperty = XInternAtom(padisplay, "_MOTIF_WM_HINTS", 0);
+    RNDTRP(1);
     hints.flags = MWM_HINTS_DECORATIONS;
     if (e) hints.decorations = MWM_DECOR_ALL;
     else hints.decorations = 0; /* everything off */
@@ -2046,6 +2281,7 @@ void enbxsiz(Window xwh, int e)
 
     XWLOCK();
     mwmHintsProperty = XInternAtom(padisplay, "_MOTIF_WM_HINTS", 0);
+    RNDTRP(1);
     hints.flags = MWM_HINTS_DECORATIONS;
     if (e) hints.decorations = MWM_DECOR_ALL;
     else hints.decorations = MWM_DECOR_TITLE|MWM_DECOR_MENU|MWM_DECOR_MINIMIZE|
@@ -2074,6 +2310,7 @@ void enbxsys(Window xwh, int e)
 
     XWLOCK();
     mwmHintsProperty = XInternAtom(padisplay, "_MOTIF_WM_HINTS", 0);
+    RNDTRP(1);
     hints.flags = MWM_HINTS_DECORATIONS;
     if (e) hints.decorations = MWM_DECOR_ALL;
     else hints.decorations = MWM_DECOR_BORDER;
@@ -2106,6 +2343,7 @@ void fndfrmdif(Window xw, int* ew, int* eh, int* ox, int* oy)
     XQueryTree(padisplay, xw, &rw, &pw, &cwl, &ncw);
     XGetWindowAttributes(padisplay, pw, &xpwga);
     XGetWindowAttributes(padisplay, xw, &xwga);
+    RNDTRP(3);
     XWUNLOCK();
 
     /* find net extra width of frame from client area */
@@ -2157,7 +2395,7 @@ void fndfrm(void)
                  ButtonReleaseMask|StructureNotifyMask|FocusChangeMask|
                  EnterWindowMask|LeaveWindowMask|PropertyChangeMask);
     XMapWindow(padisplay, wh);
-    XFlush(padisplay);
+    XFLUSH();
     XWUNLOCK();
 
     /* wait window present */
@@ -2629,6 +2867,7 @@ void getfonts(void)
     /* load the fonts list */
     XWLOCK();
     fl = XListFonts(padisplay, "-*-*-*-*-*--0-0-0-0-?-0-*", INT_MAX, &fc);
+    RNDTRP(1);
     XWUNLOCK();
 
 #if 0
@@ -2651,6 +2890,7 @@ void getfonts(void)
         XWLOCK();
         xerrbyp = TRUE; /* bypass xerror */
         font = XLoadQueryFont(padisplay, *fp);
+        RNDTRP(1);
         xerrbyp = FALSE; /* reset bypass */
         XWUNLOCK();
         /* reject character spaced fonts. I haven't seen reasonable metrics for
@@ -3075,6 +3315,7 @@ void setfnt(winptr win)
 //dbg_printf(dlinfo, "try font size: %d font string: %s\n", ht, buf);
         XWLOCK();
         win->xfont = XLoadQueryFont(padisplay, buf);
+        RNDTRP(1);
         XWUNLOCK();
         if (!win->xfont) error(esystem); /* should have found it */
         aht = win->xfont->ascent+win->xfont->descent; /* find resulting height */
@@ -3196,6 +3437,98 @@ static int indisp(winptr win)
 
 /*******************************************************************************
 
+Add screen damage
+
+Adds the given rectangle, in 0 based pixels, to the damage of the screen. The
+rectangle can be in any order, and is clipped to the screen.
+
+*******************************************************************************/
+
+static void adddmg(scnptr sc, int x1, int y1, int x2, int y2)
+
+{
+
+    int t;
+
+    if (x1 > x2) { t = x1; x1 = x2; x2 = t; }
+    if (y1 > y2) { t = y1; y1 = y2; y2 = t; }
+    if (x1 < 0) x1 = 0;
+    if (y1 < 0) y1 = 0;
+    if (x2 > sc->maxxg-1) x2 = sc->maxxg-1;
+    if (y2 > sc->maxyg-1) y2 = sc->maxyg-1;
+    if (x1 > x2 || y1 > y2) return; /* clipped out */
+    if (sc->dmg) { /* expand existing */
+
+        if (x1 < sc->dmgx1) sc->dmgx1 = x1;
+        if (y1 < sc->dmgy1) sc->dmgy1 = y1;
+        if (x2 > sc->dmgx2) sc->dmgx2 = x2;
+        if (y2 > sc->dmgy2) sc->dmgy2 = y2;
+
+    } else { /* set new */
+
+        sc->dmgx1 = x1;
+        sc->dmgy1 = y1;
+        sc->dmgx2 = x2;
+        sc->dmgy2 = y2;
+        sc->dmg = TRUE;
+
+    }
+
+}
+
+/*******************************************************************************
+
+Add damage to all but the display screen
+
+When the display screen is changed, it is drawn to both its buffer and the
+window, so they stay the same, but every other screen then differs from the
+window in that area.
+
+*******************************************************************************/
+
+static void othdmg(winptr win, int x1, int y1, int x2, int y2)
+
+{
+
+    int si;
+
+    for (si = 0; si < MAXCON; si++)
+        if (win->screens[si] && si != win->curdsp-1)
+            adddmg(win->screens[si], x1, y1, x2, y2);
+
+}
+
+/*******************************************************************************
+
+Note drawing damage
+
+Called by the drawing routines with the rectangle, in 0 based pixels, that was
+drawn to the current update screen. The rectangle is widened by the line width.
+
+*******************************************************************************/
+
+static void drwdmg(winptr win, int x1, int y1, int x2, int y2)
+
+{
+
+    scnptr sc;
+    int    t;
+
+    sc = win->screens[win->curupd-1]; /* index update screen */
+    if (x1 > x2) { t = x1; x1 = x2; x2 = t; }
+    if (y1 > y2) { t = y1; y1 = y2; y2 = t; }
+    t = sc->lwidth+1; /* pad by line width */
+    x1 -= t;
+    y1 -= t;
+    x2 += t;
+    y2 += t;
+    if (indisp(win)) othdmg(win, x1, y1, x2, y2);
+    else adddmg(sc, x1, y1, x2, y2);
+
+}
+
+/*******************************************************************************
+
 Clear screen buffer
 
 Clears the entire screen buffer to spaces with the current colors and
@@ -3565,6 +3898,7 @@ static winptr getwin(void)
 {
 
     winptr p;
+    pthread_mutexattr_t att; /* lock attributes */
 
     if (winfre) { /* there is a freed entry */
 
@@ -3576,8 +3910,16 @@ static winptr getwin(void)
         p = imalloc(sizeof(winrec));
         wincnt++; /* count entries */
         wintot += sizeof(winrec); /* add to total memory used */
+        /* the lock stays with the entry across free and reuse. It is
+           recursive, since drawing can call back into the same window */
+        pthread_mutexattr_init(&att);
+        pthread_mutexattr_settype(&att, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&p->wlock, &att);
+        pthread_mutexattr_destroy(&att);
 
     }
+    p->xreqs = 0; /* clear statistics */
+    p->dstlst = NULL; /* clear saved drawing states */
 
     return (p);
 
@@ -3677,6 +4019,127 @@ static void enquexevt(XEvent* e)
 
 /** ****************************************************************************
 
+Compress XEvent into input queue
+
+Tries to fold the given XEvent into an event already waiting in the input
+queue. Returns TRUE if the event was absorbed, in which case it should not be
+queued.
+
+Three kinds of events are folded:
+
+Expose: an expose is merged into the newest expose queued on the same window,
+whose rectangle becomes the bounding box of both. This turns the stream of
+exposes produced by dragging a window over ours into a single restore. A
+configure or resize on the window queued after that expose stops the search,
+so that damage is never moved ahead of a change in the window geometry.
+
+MotionNotify: motion replaces the position of the nearest queued event on the
+same window if that is also a motion with the same button state. Any other
+event on that window, including button presses and releases, stops the search,
+so that button transitions are seen at the position they occurred.
+
+ConfigureNotify: a queued configure on the same window is superseded by the
+new one, and is overwritten with the latest geometry.
+
+*******************************************************************************/
+
+static int cmpxevt(XEvent* e)
+
+{
+
+    xevtque* p;
+    int      x1, y1, x2, y2;
+
+#ifdef NOEVTCMP
+    return (FALSE); /* don't compress */
+#endif
+    if (!evtque) return (FALSE); /* queue empty, nothing to fold into */
+    if (e->type == Expose) {
+
+        /* search for another expose on this window, newest first */
+        p = evtque;
+        do {
+
+            if (p->evt.xany.window == e->xany.window &&
+                (p->evt.type == ConfigureNotify ||
+                 p->evt.type == ResizeRequest))
+                return (FALSE); /* geometry changed since, can't fold */
+            if (p->evt.type == Expose && p->evt.xany.window == e->xany.window) {
+
+                /* form bounding box of both rectangles */
+                x1 = p->evt.xexpose.x;
+                y1 = p->evt.xexpose.y;
+                x2 = p->evt.xexpose.x+p->evt.xexpose.width;
+                y2 = p->evt.xexpose.y+p->evt.xexpose.height;
+                if (e->xexpose.x < x1) x1 = e->xexpose.x;
+                if (e->xexpose.y < y1) y1 = e->xexpose.y;
+                if (e->xexpose.x+e->xexpose.width > x2)
+                    x2 = e->xexpose.x+e->xexpose.width;
+                if (e->xexpose.y+e->xexpose.height > y2)
+                    y2 = e->xexpose.y+e->xexpose.height;
+                p->evt.xexpose.x = x1;
+                p->evt.xexpose.y = y1;
+                p->evt.xexpose.width = x2-x1;
+                p->evt.xexpose.height = y2-y1;
+                p->evt.xexpose.count = e->xexpose.count;
+
+                return (TRUE); /* absorbed */
+
+            }
+            p = p->next; /* next older entry */
+
+        } while (p != evtque);
+
+    } else if (e->type == MotionNotify) {
+
+        /* search for the newest event on this window */
+        p = evtque;
+        do {
+
+            if (p->evt.xany.window == e->xany.window) {
+
+                if (p->evt.type == MotionNotify &&
+                    p->evt.xmotion.state == e->xmotion.state) {
+
+                    /* same button state, replace with newest position */
+                    memcpy(&p->evt, e, sizeof(XEvent));
+
+                    return (TRUE); /* absorbed */
+
+                }
+                return (FALSE); /* intervening event, can't fold */
+
+            }
+            p = p->next; /* next older entry */
+
+        } while (p != evtque);
+
+    } else if (e->type == ConfigureNotify) {
+
+        /* search for superseded configure on this window */
+        p = evtque;
+        do {
+
+            if (p->evt.type == ConfigureNotify &&
+                p->evt.xany.window == e->xany.window) {
+
+                memcpy(&p->evt, e, sizeof(XEvent)); /* replace */
+
+                return (TRUE); /* absorbed */
+
+            }
+            p = p->next; /* next older entry */
+
+        } while (p != evtque);
+
+    }
+
+    return (FALSE); /* not absorbed */
+
+}
+
+/** ****************************************************************************
+
 Remove XEvent from input queue
 
 *******************************************************************************/
@@ -3755,7 +4218,7 @@ static void peekxevt(XEvent* e)
     XWLOCK();
     XNextEvent(padisplay, e); /* get next event */
     XWUNLOCK();
-    enquexevt(e); /* place in input queue */
+    if (!cmpxevt(e)) enquexevt(e); /* place in input queue */
     /* there is another diagnostic in pa_event(), but you might want to see
        these events immediately */
     //dbg_printf(dlinfo, ""); prtxevt(e); fprintf(stderr, "\n"); fflush(stderr);
@@ -4130,6 +4593,7 @@ static void restore(winptr win) /* window to restore */
     int rgb;
     scnptr sc;
 
+    STSBGN(st);
     sc = win->screens[win->curdsp-1]; /* index screen */
     if (win->bufmod && win->visible)  { /* buffered mode is on, and visible */
 
@@ -4155,9 +4619,59 @@ static void restore(winptr win) /* window to restore */
         XCopyArea(padisplay, sc->xbuf, win->xwhan, sc->xcxt, 0, 0,
                   sc->maxxg, sc->maxyg, 0, 0);
         XWUNLOCK();
+        /* window now matches this screen, and nothing can be said about the
+           others */
+        sc->dmg = FALSE;
+        othdmg(win, 0, 0, sc->maxxg-1, sc->maxyg-1);
+        curon(win); /* show the cursor */
+
+    }
+    STSENDW(st, strestore, win);
+
+}
+
+/** ****************************************************************************
+
+Flip screen
+
+Presents the display screen after a change of display screen. The window
+matches the last display screen, except where the new screen has damage, so
+only the damaged rectangle is copied. The area copied is then damage for every
+other screen, since the window has changed there.
+
+The cursor of the last display screen must already be removed.
+
+*******************************************************************************/
+
+static void flip(winptr win)
+
+{
+
+    scnptr sc;
+    int    x1, y1, x2, y2;
+
+    STSBGN(st);
+    sc = win->screens[win->curdsp-1]; /* index screen */
+    if (win->bufmod && win->visible) { /* buffered mode is on, and visible */
+
+        if (sc->dmg) { /* there is a difference to copy */
+
+            x1 = sc->dmgx1;
+            y1 = sc->dmgy1;
+            x2 = sc->dmgx2;
+            y2 = sc->dmgy2;
+            XWLOCK();
+            XCopyArea(padisplay, sc->xbuf, win->xwhan, sc->xcxt, x1, y1,
+                      x2-x1+1, y2-y1+1, x1, y1);
+            XWUNLOCK();
+            sc->dmg = FALSE;
+            othdmg(win, x1, y1, x2, y2);
+
+        }
         curon(win); /* show the cursor */
 
     }
+    STSENDW(st, stflip, win);
 
 }
 
@@ -4194,7 +4708,7 @@ static Window createwindow(Window parent, int x, int y, int w, int h)
     /* present the window onscreen */
     XWLOCK();
     XMapWindow(padisplay, wh);
-    XFlush(padisplay);
+    XFLUSH();
     XWUNLOCK();
 
     /* wait for the window to be displayed */
@@ -4231,7 +4745,7 @@ static void winvis(winptr win)
         XMapWindow(padisplay, win->xmwhan);
         /* place */
         XMoveWindow(padisplay, win->xmwhan, win->xmwr.x, win->xmwr.y);
-        XFlush(padisplay);
+        XFLUSH();
         XWUNLOCK();
 
         /* wait for the window to be displayed */
@@ -4241,7 +4755,7 @@ static void winvis(winptr win)
         /* present the subclient window onscreen */
         XWLOCK();
         XMapWindow(padisplay, win->xwhan);
-        XFlush(padisplay);
+        XFLUSH();
         XWUNLOCK();
 
         /* wait for the window to be displayed */
@@ -4348,6 +4862,9 @@ static void iniscn(winptr win, scnptr sc)
 
     /* clear it */
     clrbuf(sc);
+    /* the window could hold anything relative to a new screen */
+    sc->dmg = FALSE;
+    adddmg(sc, 0, 0, sc->maxxg-1, sc->maxyg-1);
 
 #if 0
     /* draw grid for character cell diagnosis */
@@ -4577,6 +5094,7 @@ static void opnwin(int fn, int pfn, int wid, int subclient)
     /* hook close event from windows manager */
     XWLOCK();
     win->delmsg = XInternAtom(padisplay, "WM_DELETE_WINDOW", FALSE);
+    RNDTRP(1);
     XSetWMProtocols(padisplay, win->xmwhan, &win->delmsg, 1);
     XWUNLOCK();
 
@@ -5321,6 +5839,7 @@ static void iclear(winptr win)
     sc->curxg = 1;
     sc->curyg = 1;
     clrbuf(sc); /* clear screen buffer */
+    drwdmg(win, 0, 0, sc->maxxg-1, sc->maxyg-1); /* note damage */
     if (indisp(win)) { /* also process to display */
 
         curoff(win); /* hide the cursor */
@@ -5456,6 +5975,8 @@ static void iscrollg(winptr win, int x, int y)
         }
 
     }
+    if (win->bufmod) /* note damage */
+        drwdmg(win, 0, 0, sc->maxxg-1, sc->maxyg-1);
     if (indisp(win) && win->bufmod)
         restore(win); /* move buffer to screen */
 
@@ -5882,9 +6403,9 @@ static void drwchr90(winptr win, scnptr sc, int cs, int ce, Drawable d, char c)
 
 {
 
+    XWLOCK(); /* one lock for background and foreground */
     if (sc->bmod != mdinvis) { /* background is visible */
 
-        XWLOCK();
         /* set background function */
         XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->bmod]);
         /* set background to foreground to draw character background */
@@ -5913,12 +6434,10 @@ static void drwchr90(winptr win, scnptr sc, int cs, int ce, Drawable d, char c)
         else XSetForeground(padisplay, sc->xcxt, sc->fcrgb);
         /* reset background function */
         XSetFunction(padisplay, sc->xcxt, mod2fnc[mdnorm]);
-        XWUNLOCK();
 
     }
     if (sc->fmod != mdinvis) {
 
-        XWLOCK();
         /* set foreground function */
         XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
         if (ce) /* character exists */
@@ -5956,9 +6475,9 @@ static void drwchr90(winptr win, scnptr sc, int cs, int ce, Drawable d, char c)
         }
         /* reset foreground function */
         XSetFunction(padisplay, sc->xcxt, mod2fnc[mdnorm]);
-        XWUNLOCK();
 
     }
+    XWUNLOCK();
 
 }
 
@@ -6076,6 +6595,7 @@ static void drwchr(winptr win, scnptr sc, int cs, int ce, Drawable d, char c)
 
     int  xsol, ysol, xsor, ysor; /* underline 1 */
 
+    STSBGN(st);
     /* find rotated character baseline */
     xb = sc->curxg-1;
     yb = sc->curyg-1;
@@ -6101,9 +6621,9 @@ static void drwchr(winptr win, scnptr sc, int cs, int ce, Drawable d, char c)
 
     cb[0] = c; /* place character in string form */
     cb[1] = 0;
+    XWLOCK(); /* one lock for background and foreground */
     if (sc->bmod != mdinvis) { /* background is visible */
 
-        XWLOCK();
         /* set background function */
         XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->bmod]);
         /* set background to foreground to draw character background */
@@ -6129,12 +6649,10 @@ static void drwchr(winptr win, scnptr sc, int cs, int ce, Drawable d, char c)
         else XSetForeground(padisplay, sc->xcxt, sc->fcrgb);
         /* reset background function */
         XSetFunction(padisplay, sc->xcxt, mod2fnc[mdnorm]);
-        XWUNLOCK();
 
     }
     if (sc->fmod != mdinvis) {
 
-        XWLOCK();
         /* set foreground function */
         XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
         if (ce) /* character exists */
@@ -6167,9 +6685,10 @@ static void drwchr(winptr win, scnptr sc, int cs, int ce, Drawable d, char c)
         }
         /* reset foreground function */
         XSetFunction(padisplay, sc->xcxt, mod2fnc[mdnorm]);
-        XWUNLOCK();
 
     }
+    XWUNLOCK();
+    STSENDW(st, stdrwchr, win);
 
 }
 
@@ -6247,6 +6766,11 @@ static void plcchr(winptr win, char c)
             curon(win); /* show the cursor */
 
         }
+        /* note damage for screen flips, off angle is too hard to bound */
+        if (sc->angle == INT_MAX/4)
+            drwdmg(win, sc->curxg-1, sc->curyg-1, sc->curxg-1+cs-1,
+                   sc->curyg-1+win->linespace-1);
+        else drwdmg(win, 0, 0, sc->maxxg-1, sc->maxyg-1);
         /* advance to next character */
         if (sc->angle == INT_MAX/4) {
 
@@ -6673,8 +7197,12 @@ static ssize_t ivwrite(pwrite_t writedc, int fd, const void* buff, size_t count)
     if (opnfil[fd] && opnfil[fd]->win) { /* process window output file */
 
         win = opnfil[fd]->win; /* index window */
-        /* send data to terminal */
+        /* send data to terminal, holding the window for the whole buffer */
+        STSBGN(st);
+        WINLOCK(win);
         while (cnt--) plcchr(win, *p++);
+        WINUNLOCK(win);
+        STSENDW(st, stwrite, win);
         rc = count; /* set return same as count */
 
     } else rc = (*writedc)(fd, buff, count);
@@ -6825,7 +7353,8 @@ to the window.
 
 void _pa_scrollg_ovr(pa_scrollg_t nfp, pa_scrollg_t* ofp)
     { *ofp = scrollg_vect; scrollg_vect = nfp; }
-void pa_scrollg(FILE* f, int x, int y) { (*scrollg_vect)(f, x, y); }
+void pa_scrollg(FILE* f, int x, int y)
+    { STSBGN(st); (*scrollg_vect)(f, x, y); STSEND(st, stscrollg, f); }
 
 static void scrollg_ivf(FILE* f, int x, int y)
 
@@ -6834,13 +7363,16 @@ static void scrollg_ivf(FILE* f, int x, int y)
     winptr win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     iscrollg(win, x, y); /* process */
+    WINUNLOCK(win);
 
 }
 
 void _pa_scroll_ovr(pa_scroll_t nfp, pa_scroll_t* ofp)
     { *ofp = scroll_vect; scroll_vect = nfp; }
-void pa_scroll(FILE* f, int x, int y) { (*scroll_vect)(f, x, y); }
+void pa_scroll(FILE* f, int x, int y)
+    { STSBGN(st); (*scroll_vect)(f, x, y); STSEND(st, stscroll, f); }
 
 static void scroll_ivf(FILE* f, int x, int y)
 
@@ -6849,8 +7381,10 @@ static void scroll_ivf(FILE* f, int x, int y)
     winptr win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
 
     iscrollg(win, x*win->charspace, y*win->linespace); /* process scroll */
+    WINUNLOCK(win);
 
 }
 
@@ -6873,7 +7407,9 @@ static void cursor_ivf(FILE* f, int x, int y)
     winptr win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     icursor(win, x, y); /* process */
+    WINUNLOCK(win);
 
 }
 
@@ -6896,7 +7432,9 @@ static void cursorg_ivf(FILE* f, int x, int y)
     winptr win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     icursorg(win, x, y); /* process */
+    WINUNLOCK(win);
 
 }
 
@@ -6921,7 +7459,9 @@ static int baseline_ivf(FILE* f)
     int    r;
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     r = win->baseoff; /* return current line spacing */
+    WINUNLOCK(win);
 
     return (r);
 
@@ -6945,10 +7485,14 @@ static int maxx_ivf(FILE* f)
 {
 
     winptr win; /* windows record pointer */
+    int    rv; /* return value */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
+    rv = win->gmaxx;
+    WINUNLOCK(win);
 
-    return (win->gmaxx);
+    return (rv);
 
 }
 
@@ -6970,10 +7514,14 @@ static int maxy_ivf(FILE* f)
 {
 
     winptr win; /* windows record pointer */
+    int    rv; /* return value */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
+    rv = win->gmaxy;
+    WINUNLOCK(win);
 
-    return (win->gmaxy);
+    return (rv);
 
 }
 
@@ -6995,10 +7543,14 @@ static int maxxg_ivf(FILE* f)
 {
 
     winptr win; /* windows record pointer */
+    int    rv; /* return value */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
+    rv = win->gmaxxg;
+    WINUNLOCK(win);
 
-    return (win->gmaxxg);
+    return (rv);
 
 }
 
@@ -7020,10 +7572,14 @@ static int maxyg_ivf(FILE* f)
 {
 
     winptr win; /* windows record pointer */
+    int    rv; /* return value */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
+    rv = win->gmaxyg;
+    WINUNLOCK(win);
 
-    return (win->gmaxyg);
+    return (rv);
 
 }
 
@@ -7046,7 +7602,9 @@ static void home_ivf(FILE* f)
     winptr win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     ihome(win); /* process */
+    WINUNLOCK(win);
 
 }
 
@@ -7069,7 +7627,9 @@ static void up_ivf(FILE* f)
     winptr win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     iup(win); /* process */
+    WINUNLOCK(win);
 
 }
 
@@ -7092,7 +7652,9 @@ static void down_ivf(FILE* f)
     winptr win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     idown(win); /* process */
+    WINUNLOCK(win);
 
 }
 
@@ -7117,7 +7679,9 @@ static void left_ivf(FILE* f)
     winptr win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     ileft(win); /* process */
+    WINUNLOCK(win);
 
 }
 
@@ -7140,7 +7704,9 @@ static void right_ivf(FILE* f)
     winptr win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     iright(win); /* process */
+    WINUNLOCK(win);
 
 }
 
@@ -7189,6 +7755,7 @@ static void reverse_ivf(FILE* f, int e)
     scnptr sc; /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (e) { /* reverse on */
 
@@ -7205,6 +7772,7 @@ static void reverse_ivf(FILE* f, int e)
         XSetForeground(padisplay, sc->xcxt, sc->fcrgb);
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -7229,6 +7797,7 @@ static void underline_ivf(FILE* f, int e)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (e) { /* underline on */
 
@@ -7241,6 +7810,7 @@ static void underline_ivf(FILE* f, int e)
         win->gattr &= ~BIT(saundl);
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -7267,6 +7837,7 @@ static void superscript_ivf(FILE* f, int e)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (e) { /* strikeout on */
 
@@ -7279,6 +7850,7 @@ static void superscript_ivf(FILE* f, int e)
        win->gattr &= ~BIT(sasuper);
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -7305,6 +7877,7 @@ static void subscript_ivf(FILE* f, int e)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (e) { /* strikeout on */
 
@@ -7317,6 +7890,7 @@ static void subscript_ivf(FILE* f, int e)
        win->gattr &= ~BIT(sasubs);
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -7341,6 +7915,7 @@ static void italic_ivf(FILE* f, int e)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (e) { /* strikeout on */
 
@@ -7362,6 +7937,7 @@ static void italic_ivf(FILE* f, int e)
     XSetFont(padisplay, sc->xcxt, win->xfont->fid);
     XWUNLOCK();
     curon(win); /* replace cursor with new font characteristics */
+    WINUNLOCK(win);
 
 }
 
@@ -7386,6 +7962,7 @@ static void bold_ivf(FILE* f, int e)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (e) { /* strikeout on */
 
@@ -7407,6 +7984,7 @@ static void bold_ivf(FILE* f, int e)
     XSetFont(padisplay, sc->xcxt, win->xfont->fid);
     XWUNLOCK();
     curon(win); /* replace cursor with new font characteristics */
+    WINUNLOCK(win);
 
 }
 
@@ -7433,6 +8011,7 @@ static void strikeout_ivf(FILE* f, int e)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (e) { /* strikeout on */
 
@@ -7445,6 +8024,7 @@ static void strikeout_ivf(FILE* f, int e)
        win->gattr &= ~BIT(sastkout);
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -7489,6 +8069,7 @@ static void fcolor_ivf(FILE* f, pa_color c)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1]; /* index update screen */
     sc->fcrgb = colnum(c); /* set color status */
     win->gfcrgb = sc->fcrgb;
@@ -7497,6 +8078,7 @@ static void fcolor_ivf(FILE* f, pa_color c)
     if (BIT(sarev) & sc->attr) XSetBackground(padisplay, sc->xcxt, sc->fcrgb);
     else XSetForeground(padisplay, sc->xcxt, sc->fcrgb);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -7520,6 +8102,7 @@ static void fcolorc_ivf(FILE* f, int r, int g, int b)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1]; /* index update screen */
     sc->fcrgb = rgb2xwin(r, g, b); /* set color status */
     win->gfcrgb = sc->fcrgb;
@@ -7528,6 +8111,7 @@ static void fcolorc_ivf(FILE* f, int r, int g, int b)
     if (BIT(sarev) & sc->attr) XSetBackground(padisplay, sc->xcxt, sc->fcrgb);
     else XSetForeground(padisplay, sc->xcxt, sc->fcrgb);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -7556,6 +8140,7 @@ static void fcolorg_ivf(FILE* f, int r, int g, int b)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1]; /* index update screen */
     sc->fcrgb = rgb2xwin(r, g, b); /* set color status */
     win->gfcrgb = sc->fcrgb;
@@ -7564,6 +8149,7 @@ static void fcolorg_ivf(FILE* f, int r, int g, int b)
     if (BIT(sarev) & sc->attr) XSetBackground(padisplay, sc->xcxt, sc->fcrgb);
     else XSetForeground(padisplay, sc->xcxt, sc->fcrgb);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -7587,6 +8173,7 @@ static void bcolor_ivf(FILE* f, pa_color c)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1]; /* index update screen */
     sc->bcrgb = colnum(c); /* set color status */
     win->gbcrgb = sc->bcrgb;
@@ -7595,6 +8182,7 @@ static void bcolor_ivf(FILE* f, pa_color c)
     if (BIT(sarev) & sc->attr) XSetForeground(padisplay, sc->xcxt, sc->bcrgb);
     else XSetBackground(padisplay, sc->xcxt, sc->bcrgb);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -7618,6 +8206,7 @@ static void bcolorc_ivf(FILE* f, int r, int g, int b)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1]; /* index update screen */
     sc->bcrgb = rgb2xwin(r, g, b); /* set color status */
     win->gbcrgb = sc->bcrgb;
@@ -7626,6 +8215,7 @@ static void bcolorc_ivf(FILE* f, int r, int g, int b)
     if (BIT(sarev) & sc->attr) XSetBackground(padisplay, sc->xcxt, sc->bcrgb);
     else XSetBackground(padisplay, sc->xcxt, sc->bcrgb);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -7651,6 +8241,7 @@ static void bcolorg_ivf(FILE* f, int r, int g, int b)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1]; /* index update screen */
     sc->bcrgb = rgb2xwin(r, g, b); /* set color status */
     win->gbcrgb = sc->bcrgb; /* copy to master */
@@ -7659,6 +8250,7 @@ static void bcolorg_ivf(FILE* f, int r, int g, int b)
     if (BIT(sarev) & sc->attr) XSetBackground(padisplay, sc->xcxt, sc->bcrgb);
     else XSetBackground(padisplay, sc->xcxt, sc->bcrgb);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -7679,10 +8271,14 @@ static int curbnd_ivf(FILE* f)
 {
 
     winptr win; /* windows record pointer */
+    int    rv; /* return value */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
+    rv = icurbnd(win->screens[win->curupd-1]);
+    WINUNLOCK(win);
 
-    return (icurbnd(win->screens[win->curupd-1]));
+    return (rv);
 
 }
 
@@ -7722,7 +8318,9 @@ static void auto_ivf(FILE* f, int e)
     winptr win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     iauto(win, e); /* execute */
+    WINUNLOCK(win);
 
 }
 
@@ -7745,9 +8343,11 @@ static void curvis_ivf(FILE* f, int e)
     winptr win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     win->screens[win->curupd-1]->curv = e; /* set cursor visible status */
     win->gcurv = e;
     cursts(win); /* process any cursor status change */
+    WINUNLOCK(win);
 
 }
 
@@ -7768,10 +8368,14 @@ static int curx_ivf(FILE* f)
 {
 
     winptr win; /* window record pointer */
+    int    rv; /* return value */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
+    rv = win->screens[win->curupd-1]->curx; /* process */
+    WINUNLOCK(win);
 
-    return (win->screens[win->curupd-1]->curx); /* process */
+    return (rv);
 
 }
 
@@ -7792,10 +8396,14 @@ static int cury_ivf(FILE* f)
 {
 
     winptr win; /* window record pointer */
+    int    rv; /* return value */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
+    rv = win->screens[win->curupd-1]->cury; /* process */
+    WINUNLOCK(win);
 
-    return (win->screens[win->curupd-1]->cury); /* process */
+    return (rv);
 
 }
 
@@ -7816,10 +8424,14 @@ static int curxg_ivf(FILE* f)
 {
 
     winptr win; /* window record pointer */
+    int    rv; /* return value */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
+    rv = win->screens[win->curupd-1]->curxg; /* process */
+    WINUNLOCK(win);
 
-    return (win->screens[win->curupd-1]->curxg); /* process */
+    return (rv);
 
 }
 
@@ -7840,10 +8452,14 @@ static int curyg_ivf(FILE* f)
 {
 
     winptr win; /* window record pointer */
+    int    rv; /* return value */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
+    rv = win->screens[win->curupd-1]->curyg; /* return yg */
+    WINUNLOCK(win);
 
-    return (win->screens[win->curupd-1]->curyg); /* return yg */
+    return (rv);
 
 }
 
@@ -7863,7 +8479,8 @@ forces a screen refresh, which can be important when working on terminals.
 
 void _pa_select_ovr(pa_select_t nfp, pa_select_t* ofp)
     { *ofp = select_vect; select_vect = nfp; }
-void pa_select(FILE* f, int u, int d) { (*select_vect)(f, u, d); }
+void pa_select(FILE* f, int u, int d)
+    { STSBGN(st); (*select_vect)(f, u, d); STSEND(st, stselect, f); }
 
 static void select_ivf(FILE* f, int u, int d)
 
@@ -7873,10 +8490,13 @@ static void select_ivf(FILE* f, int u, int d)
     winptr win; /* window record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     if (!win->bufmod) error(ebufoff); /* error */
     if (u < 1 || u > MAXCON || d < 1 || d > MAXCON)
         error(einvscn); /* invalid screen number */
     ld = win->curdsp; /* save the current display screen number */
+    /* take the cursor of the last display screen off the window */
+    if (d != ld && win->visible) curoff(win);
     win->curupd = u; /* set the current update screen */
     if (!win->screens[win->curupd-1]) { /* no screen, create one */
 
@@ -7901,9 +8521,10 @@ static void select_ivf(FILE* f, int u, int d)
     if (win->curdsp != ld) {
 
         if (!win->visible) winvis(win); /* make sure we are displayed */
-        else restore(win);
+        else flip(win);
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -8021,7 +8642,8 @@ advantage.
 
 void _pa_wrtstrn_ovr(pa_wrtstrn_t nfp, pa_wrtstrn_t* ofp)
     { *ofp = wrtstrn_vect; wrtstrn_vect = nfp; }
-void pa_wrtstrn(FILE* f, char* s, int l) { (*wrtstrn_vect)(f, s, l); }
+void pa_wrtstrn(FILE* f, char* s, int l)
+    { STSBGN(st); (*wrtstrn_vect)(f, s, l); STSEND(st, stwrtstrn, f); }
 
 static void wrtstrn_ivf(FILE* f, char* s, int l)
 
@@ -8033,12 +8655,16 @@ static void wrtstrn_ivf(FILE* f, char* s, int l)
     char*  p;
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (sc->autof) error(estrato); /* autowrap is on */
     if (!win->visible) winvis(win); /* make sure we are displayed */
     if (sc->angle == INT_MAX/4) { /* text is normal (90 degrees) */
 
         tw = XTextWidth(win->xfont, s, l); /* find text width in pixels */
+        /* note damage for screen flips */
+        drwdmg(win, sc->curxg-1, sc->curyg-1, sc->curxg-1+tw-1,
+               sc->curyg-1+win->linespace-1);
         if (win->bufmod) { /* buffer is active */
 
             /* draw string */
@@ -8057,6 +8683,7 @@ static void wrtstrn_ivf(FILE* f, char* s, int l)
     } else /* off angle */
         /* just pass each character on */
         for (p = s; *p && l; p++, l--) plcchr(win, *p);
+    WINUNLOCK(win);
 
 }
 
@@ -8090,7 +8717,8 @@ advantage.
 
 void _pa_wrtstr_ovr(pa_wrtstr_t nfp, pa_wrtstr_t* ofp)
     { *ofp = wrtstr_vect; wrtstr_vect = nfp; }
-void pa_wrtstr(FILE* f, char* s) { (*wrtstr_vect)(f, s); }
+void pa_wrtstr(FILE* f, char* s)
+    { STSBGN(st); (*wrtstr_vect)(f, s); STSEND(st, stwrtstr, f); }
 
 static void wrtstr_ivf(FILE* f, char* s)
 
@@ -8122,9 +8750,11 @@ static void del_ivf(FILE* f)
     winptr win; /* window record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     ileft(win); /* back up cursor */
     plcchr(win, ' '); /* blank out */
     ileft(win); /* back up again */
+    WINUNLOCK(win);
 
 }
 
@@ -8139,7 +8769,7 @@ Draws a single line in the foreground color.
 void _pa_line_ovr(pa_line_t nfp, pa_line_t* ofp)
     { *ofp = line_vect; line_vect = nfp; }
 void pa_line(FILE* f, int x1, int y1, int x2, int y2)
-    { (*line_vect)(f, x1, y1, x2, y2); }
+    { STSBGN(st); (*line_vect)(f, x1, y1, x2, y2); STSEND(st, stline, f); }
 
 static void line_ivf(FILE* f, int x1, int y1, int x2, int y2)
 
@@ -8150,6 +8780,7 @@ static void line_ivf(FILE* f, int x1, int y1, int x2, int y2)
     int tx, ty; /* temps */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     /* rationalize the line to right/down */
     if (x1 > x2 || (x1 == x2 && y1 > y2)) { /* swap */
@@ -8162,6 +8793,8 @@ static void line_ivf(FILE* f, int x1, int y1, int x2, int y2)
        y2 = ty;
 
     }
+    /* note damage for screen flips */
+    drwdmg(win, x1-1, y1-1, x2-1, y2-1);
     /* set foreground function */
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
@@ -8178,8 +8811,8 @@ static void line_ivf(FILE* f, int x1, int y1, int x2, int y2)
 
         if (!win->visible) winvis(win); /* make sure we are displayed */
         curoff(win); /* hide the cursor */
-        XWLOCK();
         /* draw the line */
+        XWLOCK();
         XDrawLine(padisplay, win->xwhan, sc->xcxt, x1-1, y1-1, x2-1, y2-1);
         XWUNLOCK();
         curon(win); /* show the cursor */
@@ -8189,6 +8822,7 @@ static void line_ivf(FILE* f, int x1, int y1, int x2, int y2)
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[mdnorm]);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -8203,7 +8837,7 @@ Draws a rectangle in foreground color.
 void _pa_rect_ovr(pa_rect_t nfp, pa_rect_t* ofp)
     { *ofp = rect_vect; rect_vect = nfp; }
 void pa_rect(FILE* f, int x1, int y1, int x2, int y2)
-    { (*rect_vect)(f, x1, y1, x2, y2); }
+    { STSBGN(st); (*rect_vect)(f, x1, y1, x2, y2); STSEND(st, strect, f); }
 
 static void rect_ivf(FILE* f, int x1, int y1, int x2, int y2)
 
@@ -8214,6 +8848,7 @@ static void rect_ivf(FILE* f, int x1, int y1, int x2, int y2)
     int tx, ty; /* temps */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     /* rationalize the rectangle to right/down */
     if (x1 > x2 || (x1 == x2 && y1 > y2)) { /* swap */
@@ -8226,6 +8861,8 @@ static void rect_ivf(FILE* f, int x1, int y1, int x2, int y2)
        y2 = ty;
 
     }
+    /* note damage for screen flips */
+    drwdmg(win, x1-1, y1-1, x2-1, y2-1);
     /* set foreground function */
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
@@ -8253,6 +8890,7 @@ static void rect_ivf(FILE* f, int x1, int y1, int x2, int y2)
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[mdnorm]);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -8267,7 +8905,7 @@ Draws a filled rectangle in foreground color.
 void _pa_frect_ovr(pa_frect_t nfp, pa_frect_t* ofp)
     { *ofp = frect_vect; frect_vect = nfp; }
 void pa_frect(FILE* f, int x1, int y1, int x2, int y2)
-    { (*frect_vect)(f, x1, y1, x2, y2); }
+    { STSBGN(st); (*frect_vect)(f, x1, y1, x2, y2); STSEND(st, stfrect, f); }
 
 static void frect_ivf(FILE* f, int x1, int y1, int x2, int y2)
 
@@ -8278,6 +8916,7 @@ static void frect_ivf(FILE* f, int x1, int y1, int x2, int y2)
     int tx, ty; /* temps */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     /* rationalize the rectangle to right/down */
     if (x1 > x2 || (x1 == x2 && y1 > y2)) { /* swap */
@@ -8290,6 +8929,8 @@ static void frect_ivf(FILE* f, int x1, int y1, int x2, int y2)
        y2 = ty;
 
     }
+    /* note damage for screen flips */
+    drwdmg(win, x1-1, y1-1, x2-1, y2-1);
     /* set foreground function */
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
@@ -8317,6 +8958,7 @@ static void frect_ivf(FILE* f, int x1, int y1, int x2, int y2)
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[mdnorm]);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -8333,7 +8975,8 @@ In XWindow, this has to be constructed, since there is no equivalent function.
 void _pa_rrect_ovr(pa_rrect_t nfp, pa_rrect_t* ofp)
     { *ofp = rrect_vect; rrect_vect = nfp; }
 void pa_rrect(FILE* f, int x1, int y1, int x2, int y2, int xs, int ys)
-    { (*rrect_vect)(f, x1, y1, x2, y2, xs, ys); }
+    { STSBGN(st); (*rrect_vect)(f, x1, y1, x2, y2, xs, ys);
+      STSEND(st, strrect, f); }
 
 static void rrect_ivf(FILE* f, int x1, int y1, int x2, int y2, int xs, int ys)
 
@@ -8344,6 +8987,7 @@ static void rrect_ivf(FILE* f, int x1, int y1, int x2, int y2, int xs, int ys)
     int tx, ty; /* temps */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     /* rationalize the rectangle to right/down */
     if (x1 > x2 || (x1 == x2 && y1 > y2)) { /* swap */
@@ -8365,6 +9009,8 @@ static void rrect_ivf(FILE* f, int x1, int y1, int x2, int y2, int xs, int ys)
         width */
     if (xs > x2-x1+1) xs = x2-x1+1; /* limit rounding elipse */
     if (ys > y2-y1+1) ys = y2-y1+1;
+    /* note damage for screen flips */
+    drwdmg(win, x1, y1, x2, y2);
     /* set foreground function */
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
@@ -8415,6 +9061,7 @@ static void rrect_ivf(FILE* f, int x1, int y1, int x2, int y2, int xs, int ys)
     }
     /* reset foreground function */
     XSetFunction(padisplay, sc->xcxt, mod2fnc[mdnorm]);
+    WINUNLOCK(win);
 
 }
 
@@ -8434,7 +9081,8 @@ x or y sizes.
 void _pa_frrect_ovr(pa_frrect_t nfp, pa_frrect_t* ofp)
     { *ofp = frrect_vect; frrect_vect = nfp; }
 void pa_frrect(FILE* f, int x1, int y1, int x2, int y2, int xs, int ys)
-    { (*frrect_vect)(f, x1, y1, x2, y2, xs, ys); }
+    { STSBGN(st); (*frrect_vect)(f, x1, y1, x2, y2, xs, ys);
+      STSEND(st, stfrrect, f); }
 
 static void frrect_ivf(FILE* f, int x1, int y1, int x2, int y2, int xs, int ys)
 
@@ -8451,6 +9099,7 @@ static void frrect_ivf(FILE* f, int x1, int y1, int x2, int y2, int xs, int ys)
     int hlr;    /* height of left/right rectangle */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     /* rationalize the rectangle to right/down */
     if (x1 > x2 || (x1 == x2 && y1 > y2)) { /* swap */
@@ -8468,6 +9117,8 @@ static void frrect_ivf(FILE* f, int x1, int y1, int x2, int y2, int xs, int ys)
     y1--;
     x2--;
     y2--;
+    /* note damage for screen flips */
+    drwdmg(win, x1, y1, x2, y2);
     /* set foreground function */
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
@@ -8609,6 +9260,7 @@ static void frrect_ivf(FILE* f, int x1, int y1, int x2, int y2, int xs, int ys)
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[mdnorm]);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -8623,7 +9275,8 @@ Draws an ellipse with the current foreground color and line width.
 void _pa_ellipse_ovr(pa_ellipse_t nfp, pa_ellipse_t* ofp)
     { *ofp = ellipse_vect; ellipse_vect = nfp; }
 void pa_ellipse(FILE* f, int x1, int y1, int x2, int y2)
-    { (*ellipse_vect)(f, x1, y1, x2, y2); }
+    { STSBGN(st); (*ellipse_vect)(f, x1, y1, x2, y2);
+      STSEND(st, stellipse, f); }
 
 static void ellipse_ivf(FILE* f, int x1, int y1, int x2, int y2)
 
@@ -8634,6 +9287,7 @@ static void ellipse_ivf(FILE* f, int x1, int y1, int x2, int y2)
     int tx, ty; /* temps */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     /* rationalize the line to right/down */
     if (x1 > x2 || (x1 == x2 && y1 > y2)) { /* swap */
@@ -8646,6 +9300,8 @@ static void ellipse_ivf(FILE* f, int x1, int y1, int x2, int y2)
        y2 = ty;
 
     }
+    /* note damage for screen flips */
+    drwdmg(win, x1-1, y1-1, x2-1, y2-1);
     /* set foreground function */
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
@@ -8675,6 +9331,7 @@ static void ellipse_ivf(FILE* f, int x1, int y1, int x2, int y2)
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[mdnorm]);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -8689,7 +9346,8 @@ Draws a filled ellipse with the current foreground color.
 void _pa_fellipse_ovr(pa_fellipse_t nfp, pa_fellipse_t* ofp)
     { *ofp = fellipse_vect; fellipse_vect = nfp; }
 void pa_fellipse(FILE* f, int x1, int y1, int x2, int y2)
-    { (*fellipse_vect)(f, x1, y1, x2, y2); }
+    { STSBGN(st); (*fellipse_vect)(f, x1, y1, x2, y2);
+      STSEND(st, stfellipse, f); }
 
 static void fellipse_ivf(FILE* f, int x1, int y1, int x2, int y2)
 
@@ -8700,6 +9358,7 @@ static void fellipse_ivf(FILE* f, int x1, int y1, int x2, int y2)
     int tx, ty; /* temps */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     /* rationalize the line to right/down */
     if (x1 > x2 || (x1 == x2 && y1 > y2)) { /* swap */
@@ -8712,6 +9371,8 @@ static void fellipse_ivf(FILE* f, int x1, int y1, int x2, int y2)
        y2 = ty;
 
     }
+    /* note damage for screen flips */
+    drwdmg(win, x1-1, y1-1, x2-1, y2-1);
     /* set foreground function */
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
@@ -8741,6 +9402,7 @@ static void fellipse_ivf(FILE* f, int x1, int y1, int x2, int y2)
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[mdnorm]);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -8775,7 +9437,8 @@ Negative angles are allowed.
 void _pa_arc_ovr(pa_arc_t nfp, pa_arc_t* ofp)
     { *ofp = arc_vect; arc_vect = nfp; }
 void pa_arc(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
-    { (*arc_vect)(f, x1, y1, x2, y2, sa, ea); }
+    { STSBGN(st); (*arc_vect)(f, x1, y1, x2, y2, sa, ea);
+      STSEND(st, starc, f); }
 
 static void arc_ivf(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
 
@@ -8787,6 +9450,7 @@ static void arc_ivf(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
     int a1, a2; /* XWindow angles */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     /* rationalize the line to right/down */
     if (x1 > x2 || (x1 == x2 && y1 > y2)) { /* swap */
@@ -8807,6 +9471,8 @@ static void arc_ivf(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
         if (a1 >= a2) a2 = 360*64-a1+a2;
         else a2 = a2-a1;
 
+        /* note damage for screen flips */
+        drwdmg(win, x1-1, y1-1, x2-1, y2-1);
         /* set foreground function */
         XWLOCK();
         XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
@@ -8838,6 +9504,7 @@ static void arc_ivf(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
         XWUNLOCK();
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -8856,7 +9523,8 @@ this.
 void _pa_farc_ovr(pa_farc_t nfp, pa_farc_t* ofp)
     { *ofp = farc_vect; farc_vect = nfp; }
 void pa_farc(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
-    { (*farc_vect)(f, x1, y1, x2, y2, sa, ea); }
+    { STSBGN(st); (*farc_vect)(f, x1, y1, x2, y2, sa, ea);
+      STSEND(st, stfarc, f); }
 
 static void farc_ivf(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
 
@@ -8868,6 +9536,7 @@ static void farc_ivf(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
     int a1, a2; /* XWindow angles */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     /* rationalize the line to right/down */
     if (x1 > x2 || (x1 == x2 && y1 > y2)) { /* swap */
@@ -8888,6 +9557,8 @@ static void farc_ivf(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
         if (a1 >= a2) a2 = 360*64-a1+a2;
         else a2 = a2-a1;
 
+        /* note damage for screen flips */
+        drwdmg(win, x1-1, y1-1, x2-1, y2-1);
         /* set foreground function */
         XWLOCK();
         XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
@@ -8919,6 +9590,7 @@ static void farc_ivf(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
         XWUNLOCK();
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -8934,7 +9606,8 @@ as for the arc function above.
 void _pa_fchord_ovr(pa_fchord_t nfp, pa_fchord_t* ofp)
     { *ofp = fchord_vect; fchord_vect = nfp; }
 void pa_fchord(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
-    { (*fchord_vect)(f, x1, y1, x2, y2, sa, ea); }
+    { STSBGN(st); (*fchord_vect)(f, x1, y1, x2, y2, sa, ea);
+      STSEND(st, stfchord, f); }
 
 static void fchord_ivf(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
 
@@ -8946,6 +9619,7 @@ static void fchord_ivf(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
     int a1, a2; /* XWindow angles */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     /* rationalize the line to right/down */
     if (x1 > x2 || (x1 == x2 && y1 > y2)) { /* swap */
@@ -8966,6 +9640,8 @@ static void fchord_ivf(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
         if (a1 >= a2) a2 = 360*64-a1+a2;
         else a2 = a2-a1;
 
+        /* note damage for screen flips */
+        drwdmg(win, x1-1, y1-1, x2-1, y2-1);
         /* set foreground function */
         XWLOCK();
         XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
@@ -8999,6 +9675,7 @@ static void fchord_ivf(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
         XWUNLOCK();
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -9013,7 +9690,8 @@ Draws a filled triangle in the current foreground color.
 void _pa_ftriangle_ovr(pa_ftriangle_t nfp, pa_ftriangle_t* ofp)
     { *ofp = ftriangle_vect; ftriangle_vect = nfp; }
 void pa_ftriangle(FILE* f, int x1, int y1, int x2, int y2, int x3, int y3)
-    { (*ftriangle_vect)(f, x1, y1, x2, y2, x3, y3); }
+    { STSBGN(st); (*ftriangle_vect)(f, x1, y1, x2, y2, x3, y3);
+      STSEND(st, stftriangle, f); }
 
 static void ftriangle_ivf(FILE* f, int x1, int y1, int x2, int y2, int x3, int y3)
 
@@ -9024,6 +9702,7 @@ static void ftriangle_ivf(FILE* f, int x1, int y1, int x2, int y2, int x3, int y
     XPoint pa[3]; /* XWindow points array */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     /* place the triangle points in the X array */
     pa[0].x = x1;
@@ -9033,6 +9712,9 @@ static void ftriangle_ivf(FILE* f, int x1, int y1, int x2, int y2, int x3, int y
     pa[2].x = x3;
     pa[2].y = y3;
 
+    /* note damage for screen flips */
+    drwdmg(win, x1, y1, x2, y2);
+    drwdmg(win, x3, y3, x3, y3);
     /* set foreground function */
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
@@ -9062,6 +9744,7 @@ static void ftriangle_ivf(FILE* f, int x1, int y1, int x2, int y2, int x3, int y
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[mdnorm]);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -9075,7 +9758,8 @@ Sets a single logical pixel to the foreground color.
 
 void _pa_setpixel_ovr(pa_setpixel_t nfp, pa_setpixel_t* ofp)
     { *ofp = setpixel_vect; setpixel_vect = nfp; }
-void pa_setpixel(FILE* f, int x, int y) { (*setpixel_vect)(f, x, y); }
+void pa_setpixel(FILE* f, int x, int y)
+    { STSBGN(st); (*setpixel_vect)(f, x, y); STSEND(st, stsetpixel, f); }
 
 static void setpixel_ivf(FILE* f, int x, int y)
 
@@ -9085,7 +9769,10 @@ static void setpixel_ivf(FILE* f, int x, int y)
     scnptr sc;  /* screen buffer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
+    /* note damage for screen flips */
+    drwdmg(win, x-1, y-1, x-1, y-1);
     /* set foreground function */
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
@@ -9115,6 +9802,7 @@ static void setpixel_ivf(FILE* f, int x, int y)
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[mdnorm]);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -9138,9 +9826,11 @@ static void fover_ivf(FILE* f)
     scnptr sc;  /* screen buffer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     win->gfmod = mdnorm; /* set foreground mode overwrite */
     sc->fmod = mdnorm;
+    WINUNLOCK(win);
 
 }
 
@@ -9164,9 +9854,11 @@ static void bover_ivf(FILE* f)
     scnptr sc;  /* screen buffer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     win->gbmod = mdnorm; /* set background mode overwrite */
     sc->bmod = mdnorm;
+    WINUNLOCK(win);
 
 }
 
@@ -9190,9 +9882,11 @@ static void finvis_ivf(FILE* f)
     scnptr sc;  /* screen buffer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     win->gfmod = mdinvis; /* set foreground mode invisible */
     sc->fmod = mdinvis;
+    WINUNLOCK(win);
 
 }
 
@@ -9216,9 +9910,11 @@ static void binvis_ivf(FILE* f)
     scnptr sc;  /* screen buffer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     win->gbmod = mdinvis; /* set background mode invisible */
     sc->bmod = mdinvis;
+    WINUNLOCK(win);
 
 }
 
@@ -9242,9 +9938,11 @@ static void fxor_ivf(FILE* f)
     scnptr sc;  /* screen buffer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     win->gfmod = mdxor; /* set foreground mode xor */
     sc->fmod = mdxor;
+    WINUNLOCK(win);
 
 }
 
@@ -9268,9 +9966,11 @@ static void bxor_ivf(FILE* f)
     scnptr sc;  /* screen buffer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     win->gbmod = mdxor; /* set background mode xor */
     sc->bmod = mdxor;
+    WINUNLOCK(win);
 
 }
 
@@ -9294,9 +9994,11 @@ static void fand_ivf(FILE* f)
     scnptr sc;  /* screen buffer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     win->gfmod = mdand; /* set foreground mode and */
     sc->fmod = mdand;
+    WINUNLOCK(win);
 
 }
 
@@ -9320,9 +10022,11 @@ static void band_ivf(FILE* f)
     scnptr sc;  /* screen buffer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     win->gbmod = mdand; /* set background mode and */
     sc->bmod = mdand;
+    WINUNLOCK(win);
 
 }
 
@@ -9346,9 +10050,11 @@ static void for_ivf(FILE* f)
     scnptr sc;  /* screen buffer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     win->gfmod = mdor; /* set foreground mode or */
     sc->fmod = mdor;
+    WINUNLOCK(win);
 
 }
 
@@ -9372,9 +10078,11 @@ static void bor_ivf(FILE* f)
     scnptr sc;  /* screen buffer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     win->gbmod = mdor; /* set background mode or */
     sc->bmod = mdor;
+    WINUNLOCK(win);
 
 }
 
@@ -9398,12 +10106,14 @@ static void linewidth_ivf(FILE* f, int w)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1]; /* index update screen */
     sc->lwidth = w; /* set the line width */
     XWLOCK();
     /* copy to X */
     XSetLineAttributes(padisplay, sc->xcxt, w, LineSolid, CapButt, JoinMiter);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -9426,12 +10136,16 @@ static int chrsizx_ivf(FILE* f)
 {
 
     winptr win; /* windows record pointer */
+    int    rv; /* return value */
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1]; /* index update screen */
+    rv = win->charspace; /* return character spacing */
+    WINUNLOCK(win);
 
-    return (win->charspace); /* return character spacing */
+    return (rv);
 
 }
 
@@ -9452,12 +10166,16 @@ static int chrsizy_ivf(FILE* f)
 {
 
     winptr win; /* windows record pointer */
+    int    rv; /* return value */
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1]; /* index update screen */
+    rv = win->linespace; /* return line spacing */
+    WINUNLOCK(win);
 
-    return (win->linespace); /* return line spacing */
+    return (rv);
 
 }
 
@@ -9502,6 +10220,7 @@ static void font_ivf(FILE* f, int fc)
     scnptr  sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1]; /* index update screen */
     if (win->screens[win->curupd-1]->autof)
         error(eatoftc); /* cannot perform with auto on */
@@ -9525,6 +10244,7 @@ static void font_ivf(FILE* f, int fc)
     XSetFont(padisplay, sc->xcxt, win->xfont->fid);
     XWUNLOCK();
     curon(win); /* replace cursor with new font characteristics */
+    WINUNLOCK(win);
 
 }
 
@@ -9584,6 +10304,7 @@ static void fontsiz_ivf(FILE* f, int s)
     scnptr  sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1]; /* index update screen */
     if (win->screens[win->curupd-1]->autof)
         error(eatoftc); /* cannot perform with auto on */
@@ -9600,6 +10321,7 @@ static void fontsiz_ivf(FILE* f, int s)
     XSetFont(padisplay, sc->xcxt, win->xfont->fid);
     XWUNLOCK();
     curon(win); /* replace cursor with new font characteristics */
+    WINUNLOCK(win);
 
 }
 
@@ -9623,7 +10345,9 @@ static void chrspcy_ivf(FILE* f, int s)
     winptr  win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     win->chrspcy = s; /* set leading */
+    WINUNLOCK(win);
 
 }
 
@@ -9647,7 +10371,9 @@ static void chrspcx_ivf(FILE* f, int s)
     winptr  win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     win->chrspcx = s; /* set ledding */
+    WINUNLOCK(win);
 
 }
 
@@ -9668,10 +10394,14 @@ static int dpmx_ivf(FILE* f)
 {
 
     winptr win; /* window pointer */
+    int    rv; /* return value */
 
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
+    rv = win->sdpmx; /* return value */
+    WINUNLOCK(win);
 
-    return (win->sdpmx); /* return value */
+    return (rv);
 
 }
 
@@ -9692,10 +10422,14 @@ static int dpmy_ivf(FILE* f)
 {
 
     winptr win; /* window pointer */
+    int    rv; /* return value */
 
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
+    rv = win->sdpmy; /* return value */
+    WINUNLOCK(win);
 
-    return (win->sdpmy); /* return value */
+    return (rv);
 
 }
 
@@ -9720,9 +10454,11 @@ static int strsiz_ivf(FILE* f, const char* s)
     int    rv;
 
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
     XWLOCK();
     rv = XTextWidth(win->xfont, s, strlen(s)); /* return value */
     XWUNLOCK();
+    WINUNLOCK(win);
 
     return (rv);
 
@@ -9750,9 +10486,11 @@ static int chrpos_ivf(FILE* f, const char* s, int p)
 
     if (p < 0 || p > strlen(s)) error(estrinx); /* out of range */
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
     XWLOCK();
     rv = XTextWidth(win->xfont, s, p); /* return value */
     XWUNLOCK();
+    WINUNLOCK(win);
 
     return (rv);
 
@@ -9772,7 +10510,8 @@ distributes the space amoung the spaces present in the string.
 
 void _pa_writejust_ovr(pa_writejust_t nfp, pa_writejust_t* ofp)
     { *ofp = writejust_vect; writejust_vect = nfp; }
-void pa_writejust(FILE* f, const char* s, int n) { (*writejust_vect)(f, s, n); }
+void pa_writejust(FILE* f, const char* s, int n)
+    { STSBGN(st); (*writejust_vect)(f, s, n); STSEND(st, stwritejust, f); }
 
 static void writejust_ivf(FILE* f, const char* s, int n)
 
@@ -9790,6 +10529,7 @@ static void writejust_ivf(FILE* f, const char* s, int n)
     int    l;
 
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1]; /* index update screen */
     if (sc->autof) error(eatopos); /* cannot perform with auto on */
     l = strlen(s); /* find string length */
@@ -9813,6 +10553,9 @@ static void writejust_ivf(FILE* f, const char* s, int n)
        amoung the existing spaces */
     ss = ns*MINJST; /* set minimum distribution of space */
     if (n > sz) { spc = (n-cs)/ns; ss = n-cs; }
+    /* note damage for screen flips */
+    drwdmg(win, sc->curxg-1, sc->curyg-1, sc->curxg-1+(n > sz ? n : sz)-1,
+           sc->curyg-1+win->linespace-1);
     /* Output the string with our choosen spacing */
     for (i = 0; i < l; i++) {
 
@@ -9883,6 +10626,7 @@ static void writejust_ivf(FILE* f, const char* s, int n)
         } else plcchr(win, s[i]); /* print the character with natural spacing */
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -9921,6 +10665,7 @@ static int justpos_ivf(FILE* f, const char* s, int p, int n)
     int    l;
 
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1]; /* index update screen */
     if (sc->autof) error(eatopos); /* cannot perform with auto on */
     l = strlen(s); /* find string length */
@@ -9960,6 +10705,7 @@ static int justpos_ivf(FILE* f, const char* s, int p, int n)
         } else cp += xwidth(win, s[i]); /* move forward character space */
 
     }
+    WINUNLOCK(win);
 
     return (crp); /* return result */
 
@@ -9990,6 +10736,7 @@ static void condensed_ivf(FILE* f, int e)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (e) { /* strikeout on */
 
@@ -10011,6 +10758,7 @@ static void condensed_ivf(FILE* f, int e)
     XSetFont(padisplay, sc->xcxt, win->xfont->fid);
     XWUNLOCK();
     curon(win); /* replace cursor with new font characteristics */
+    WINUNLOCK(win);
 
 }
 
@@ -10039,6 +10787,7 @@ static void extended_ivf(FILE* f, int e)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (e) { /* strikeout on */
 
@@ -10060,6 +10809,7 @@ static void extended_ivf(FILE* f, int e)
     XSetFont(padisplay, sc->xcxt, win->xfont->fid);
     XWUNLOCK();
     curon(win); /* replace cursor with new font characteristics */
+    WINUNLOCK(win);
 
 }
 
@@ -10088,6 +10838,7 @@ static void xlight_ivf(FILE* f, int e)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (e) { /* strikeout on */
 
@@ -10109,6 +10860,7 @@ static void xlight_ivf(FILE* f, int e)
     XSetFont(padisplay, sc->xcxt, win->xfont->fid);
     XWUNLOCK();
     curon(win); /* replace cursor with new font characteristics */
+    WINUNLOCK(win);
 
 }
 
@@ -10137,6 +10889,7 @@ static void light_ivf(FILE* f, int e)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (e) { /* strikeout on */
 
@@ -10158,6 +10911,7 @@ static void light_ivf(FILE* f, int e)
     XSetFont(padisplay, sc->xcxt, win->xfont->fid);
     XWUNLOCK();
     curon(win); /* replace cursor with new font characteristics */
+    WINUNLOCK(win);
 
 }
 
@@ -10186,6 +10940,7 @@ static void xbold_ivf(FILE* f, int e)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (e) { /* strikeout on */
 
@@ -10207,6 +10962,7 @@ static void xbold_ivf(FILE* f, int e)
     XSetFont(padisplay, sc->xcxt, win->xfont->fid);
     XWUNLOCK();
     curon(win); /* replace cursor with new font characteristics */
+    WINUNLOCK(win);
 
 }
 
@@ -10235,6 +10991,7 @@ static void hollow_ivf(FILE* f, int e)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (e) { /* strikeout on */
 
@@ -10256,6 +11013,7 @@ static void hollow_ivf(FILE* f, int e)
     XSetFont(padisplay, sc->xcxt, win->xfont->fid);
     XWUNLOCK();
     curon(win); /* replace cursor with new font characteristics */
+    WINUNLOCK(win);
 
 }
 
@@ -10284,6 +11042,7 @@ static void raised_ivf(FILE* f, int e)
     scnptr sc;  /* screen pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (e) { /* strikeout on */
 
@@ -10305,6 +11064,7 @@ static void raised_ivf(FILE* f, int e)
     XSetFont(padisplay, sc->xcxt, win->xfont->fid);
     XWUNLOCK();
     curon(win); /* replace cursor with new font characteristics */
+    WINUNLOCK(win);
 
 }
 
@@ -10328,9 +11088,11 @@ static void delpict_ivf(FILE* f, int p)
     picptr pp; /* image pointer */
 
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
     if (p < 1 || p > MAXPIC) error(einvhan); /* bad picture handle */
     if (!win->pictbl[p-1]->xi) error(einvhan); /* bad picture handle */
     delpic(win, p); /* delete all of the scaled copies */
+    WINUNLOCK(win);
 
 }
 
@@ -10420,7 +11182,8 @@ static unsigned int read16(FILE* f)
 
 void _pa_loadpict_ovr(pa_loadpict_t nfp, pa_loadpict_t* ofp)
     { *ofp = loadpict_vect; loadpict_vect = nfp; }
-void pa_loadpict(FILE* f, int p, char* fn) { (*loadpict_vect)(f, p, fn); }
+void pa_loadpict(FILE* f, int p, char* fn)
+    { STSBGN(st); (*loadpict_vect)(f, p, fn); STSEND(st, stloadpict, f); }
 
 static void loadpict_ivf(FILE* f, int p, char* fn)
 
@@ -10445,6 +11208,7 @@ static void loadpict_ivf(FILE* f, int p, char* fn)
     char fnh[MAXFNM]; /* file name holder */
 
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
     if (p < 1 || p > MAXPIC)  error(einvhan); /* bad picture handle */
     /* if the slot is already occupied, delete that picture */
     delpic(win, p);
@@ -10519,6 +11283,7 @@ static void loadpict_ivf(FILE* f, int p, char* fn)
 
     }
     fclose(pf); /* close the input file */
+    WINUNLOCK(win);
 
 }
 
@@ -10539,12 +11304,16 @@ static int pictsizx_ivf(FILE* f, int p)
 {
 
     winptr win; /* window pointer */
+    int    rv; /* return value */
 
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
     if (p < 1 || p > MAXPIC) error(einvhan); /* bad picture handle */
     if (!win->pictbl[p-1]->xi) error(einvhan); /* bad picture handle */
+    rv = win->pictbl[p-1]->sx; /* return x size */
+    WINUNLOCK(win);
 
-    return (win->pictbl[p-1]->sx); /* return x size */
+    return (rv);
 
 }
 
@@ -10565,12 +11334,16 @@ static int pictsizy_ivf(FILE* f, int p)
 {
 
     winptr win; /* window pointer */
+    int    rv; /* return value */
 
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
     if (p < 1 || p > MAXPIC) error(einvhan); /* bad picture handle */
     if (!win->pictbl[p-1]->xi) error(einvhan); /* bad picture handle */
+    rv = win->pictbl[p-1]->sy; /* return x size */
+    WINUNLOCK(win);
 
-    return (win->pictbl[p-1]->sy); /* return x size */
+    return (rv);
 
 }
 
@@ -10588,7 +11361,8 @@ Images will be kept in a rotating cache to prevent repeating reloads.
 void _pa_picture_ovr(pa_picture_t nfp, pa_picture_t* ofp)
     { *ofp = picture_vect; picture_vect = nfp; }
 void pa_picture(FILE* f, int p, int x1, int y1, int x2, int y2)
-    { (*picture_vect)(f, p, x1, y1, x2, y2); }
+    { STSBGN(st); (*picture_vect)(f, p, x1, y1, x2, y2);
+      STSEND(st, stpicture, f); }
 
 static void picture_ivf(FILE* f, int p, int x1, int y1, int x2, int y2)
 
@@ -10603,6 +11377,7 @@ static void picture_ivf(FILE* f, int p, int x1, int y1, int x2, int y2)
     Visual* vi;
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (p < 1 || p > MAXPIC) error(einvhan); /* bad picture handle */
     if (!win->pictbl[p-1]->xi) error(einvhan); /* bad picture handle */
@@ -10653,6 +11428,8 @@ static void picture_ivf(FILE* f, int p, int x1, int y1, int x2, int y2)
         rescale(fp->xi, pp->xi); /* rescale to new image */
 
     }
+    /* note damage for screen flips */
+    drwdmg(win, x1-1, y1-1, x2-1, y2-1);
     /* set foreground function */
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[sc->fmod]);
@@ -10663,6 +11440,7 @@ static void picture_ivf(FILE* f, int p, int x1, int y1, int x2, int y2)
         XWLOCK();
         XPutImage(padisplay, sc->xbuf, sc->xcxt, fp->xi, 0, 0, x1-1, y1-1,
                   x2-x1+1, y2-y1+1);
+        IMGSNT((unsigned long long)fp->xi->bytes_per_line*(y2-y1+1));
         XWUNLOCK();
 
     }
@@ -10674,6 +11452,7 @@ static void picture_ivf(FILE* f, int p, int x1, int y1, int x2, int y2)
         XWLOCK();
         XPutImage(padisplay, win->xwhan, sc->xcxt, fp->xi, 0, 0,
                              x1-1, y1-1, x2-x1+1, y2-y1+1);
+        IMGSNT((unsigned long long)fp->xi->bytes_per_line*(y2-y1+1));
         XWUNLOCK();
         curon(win); /* show the cursor */
 
@@ -10682,6 +11461,7 @@ static void picture_ivf(FILE* f, int p, int x1, int y1, int x2, int y2)
     XWLOCK();
     XSetFunction(padisplay, sc->xcxt, mod2fnc[mdnorm]);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -11158,6 +11938,7 @@ static void winstat(winptr win, pa_evtrec* er, XEvent* e, int* keep)
                                         0L, after, 0,
                                         4/*XA_ATOM*/, &type, &format,
                                         &length, &after, &dp);
+            RNDTRP(1);
             XWUNLOCK();
             if (status == Success && type == 4/*XA_ATOM*/ && dp && format == 32 && length) {
 
@@ -11273,7 +12054,7 @@ static void xwinevt(winptr win, pa_evtrec* er, XEvent* e, int* keep)
                     else XSetForeground(padisplay, sc->xcxt, sc->fcrgb);
                     /* we shouldn't need to do this, but I have seen unpainted
                        of the window if not while resizing */
-                    XFlush(padisplay);
+                    XFLUSH();
 
                 }
                 XWUNLOCK();
@@ -11293,7 +12074,7 @@ static void xwinevt(winptr win, pa_evtrec* er, XEvent* e, int* keep)
                 if (BIT(sarev) & sc->attr)
                     XSetForeground(padisplay, sc->xcxt, sc->bcrgb);
                 else XSetForeground(padisplay, sc->xcxt, sc->fcrgb);
-                XFlush(padisplay);
+                XFLUSH();
                 XWUNLOCK();
 
             }
@@ -11635,7 +12416,9 @@ static void xwinprc(XEvent* e, pa_evtrec* er, int* keep)
 
         win = lfn2win(ofn); /* get window for that */
         er->winid = filwin[ofn]; /* get window number */
+        WINLOCK(win);
         xwinevt(win, er, e, keep); /* process XWindow event */
+        WINUNLOCK(win);
 
     }
 
@@ -11648,6 +12431,7 @@ static void xwinget(pa_evtrec* er, int* keep)
 
     XEvent e;  /* XWindow event record */
     int    rv;
+    int    i;
 
     do {
 
@@ -11661,17 +12445,18 @@ static void xwinget(pa_evtrec* er, int* keep)
         }
         if (!*keep) {
 
+            /* drain everything pending into the input queue in one lock, so
+               that exposes, motion and configures can be compressed against
+               each other before any of them are processed */
             XWLOCK();
             rv = XPending(padisplay);
-            XWUNLOCK();
-            if (rv) {
+            for (i = 0; i < rv; i++) {
 
-                XWLOCK();
                 XNextEvent(padisplay, &e); /* get next event */
-                XWUNLOCK();
-                xwinprc(&e, er, keep); /* pass to processing */
+                if (!cmpxevt(&e)) enquexevt(&e); /* place in input queue */
 
             }
+            XWUNLOCK();
 
         }
 
@@ -11694,7 +12479,7 @@ static void ievent(FILE* f, pa_evtrec* er)
 
     /* make sure all drawing is complete before we take inputs */
     XWLOCK();
-    XFlush(padisplay);
+    XFLUSH();
     XWUNLOCK();
     keep = FALSE; /* set do not keep event */
     dfid = ConnectionNumber(padisplay); /* find XWindow display fid */
@@ -11747,7 +12532,8 @@ static void ievent(FILE* f, pa_evtrec* er)
 
 void _pa_event_ovr(pa_event_t nfp, pa_event_t* ofp)
     { *ofp = event_vect; event_vect = nfp; }
-void pa_event(FILE* f, pa_evtrec* er) { (*event_vect)(f, er); }
+void pa_event(FILE* f, pa_evtrec* er)
+    { STSBGN(st); (*event_vect)(f, er); STSEND(st, stevent, f); }
 
 static void event_ivf(FILE* f, pa_evtrec* er)
 
@@ -11815,6 +12601,187 @@ static void sendevent_ivf(FILE* f, pa_evtrec* er)
 
 /** ****************************************************************************
 
+Save drawing state
+
+Saves the drawing state of the current update screen on a stack for the window.
+The drawing state is the cursor position, colors, mix modes, line width, font,
+attributes, auto and cursor visibility. It is restored by pa_popstate().
+
+This lets a module that does not own the window, like a widget drawn into its
+parent, draw without disturbing the state the client set.
+
+*******************************************************************************/
+
+void _pa_pushstate_ovr(pa_pushstate_t nfp, pa_pushstate_t* ofp)
+    { *ofp = pushstate_vect; pushstate_vect = nfp; }
+void pa_pushstate(FILE* f) { (*pushstate_vect)(f); }
+
+static void pushstate_ivf(FILE* f)
+
+{
+
+    winptr win; /* window record pointer */
+    scnptr sc;  /* screen pointer */
+    dstptr dp;  /* drawing state entry */
+
+    win = txt2win(f); /* get window from file */
+    WINLOCK(win);
+    sc = win->screens[win->curupd-1]; /* index update screen */
+    dp = imalloc(sizeof(dstrec)); /* get a new state entry */
+    dp->curx = sc->curx; /* copy state */
+    dp->cury = sc->cury;
+    dp->curxg = sc->curxg;
+    dp->curyg = sc->curyg;
+    dp->fcrgb = sc->fcrgb;
+    dp->bcrgb = sc->bcrgb;
+    dp->fmod = sc->fmod;
+    dp->bmod = sc->bmod;
+    dp->lwidth = sc->lwidth;
+    dp->cfont = sc->cfont;
+    dp->fhigh = win->gfhigh;
+    dp->attr = sc->attr;
+    dp->autof = sc->autof;
+    dp->curv = sc->curv;
+    dp->chrspcx = win->chrspcx;
+    dp->chrspcy = win->chrspcy;
+    dp->scn = win->curupd; /* save screen the state belongs to */
+    dp->next = win->dstlst; /* push onto stack */
+    win->dstlst = dp;
+    WINUNLOCK(win);
+
+}
+
+/** ****************************************************************************
+
+Restore drawing state
+
+Restores the last drawing state saved by pa_pushstate(), and removes it from
+the stack. The state goes back to the screen it was saved from, even if the
+update screen was changed since. If that screen no longer exists, the state is
+just discarded. The font is only reloaded if it was changed since the save.
+
+*******************************************************************************/
+
+void _pa_popstate_ovr(pa_popstate_t nfp, pa_popstate_t* ofp)
+    { *ofp = popstate_vect; popstate_vect = nfp; }
+void pa_popstate(FILE* f) { (*popstate_vect)(f); }
+
+static void popstate_ivf(FILE* f)
+
+{
+
+    winptr win; /* window record pointer */
+    scnptr sc;  /* screen pointer */
+    dstptr dp;  /* drawing state entry */
+    int    fc;  /* font changed */
+
+    win = txt2win(f); /* get window from file */
+    WINLOCK(win);
+    dp = win->dstlst; /* index top state */
+    if (!dp) error(enodst); /* nothing was saved */
+    win->dstlst = dp->next; /* gap out */
+    sc = win->screens[dp->scn-1]; /* index screen it was saved from */
+    if (!sc) { /* screen was removed, nothing to restore to */
+
+        ifree(dp); /* release the state entry */
+        WINUNLOCK(win);
+        return;
+
+    }
+    curoff(win); /* remove cursor at the drawing position */
+    /* the font must be reloaded if the face, height or any attribute that
+       selects the face changed */
+    fc = sc->cfont != dp->cfont || win->gfhigh != dp->fhigh ||
+         sc->attr != dp->attr;
+    sc->curx = dp->curx; /* restore state */
+    sc->cury = dp->cury;
+    sc->curxg = dp->curxg;
+    sc->curyg = dp->curyg;
+    sc->fcrgb = dp->fcrgb;
+    win->gfcrgb = dp->fcrgb;
+    sc->bcrgb = dp->bcrgb;
+    win->gbcrgb = dp->bcrgb;
+    sc->fmod = dp->fmod;
+    win->gfmod = dp->fmod;
+    sc->bmod = dp->bmod;
+    win->gbmod = dp->bmod;
+    sc->lwidth = dp->lwidth;
+    sc->cfont = dp->cfont;
+    win->gcfont = dp->cfont;
+    sc->attr = dp->attr;
+    win->gattr = dp->attr;
+    sc->autof = dp->autof;
+    win->gauto = dp->autof;
+    sc->curv = dp->curv;
+    win->gcurv = dp->curv;
+    if (fc) {
+
+        win->gfhigh = dp->fhigh; /* set font height */
+        /* set parameters of missing font character */
+        win->mischrx = win->gfhigh*MISCHRX;
+        win->mischry = win->gfhigh*MISCHRY;
+        win->misoffx = win->gfhigh*MISOFFX;
+        win->misoffy = win->gfhigh*MISOFFY;
+        setfnt(win); /* select the font */
+
+    }
+    /* setfnt() resets spacing, so these go after it */
+    win->chrspcx = dp->chrspcx;
+    win->chrspcy = dp->chrspcy;
+    XWLOCK();
+    if (fc) XSetFont(padisplay, sc->xcxt, win->xfont->fid);
+    XSetLineAttributes(padisplay, sc->xcxt, sc->lwidth, LineSolid, CapButt,
+                       JoinMiter);
+    /* set screen colors according to reverse */
+    if (BIT(sarev) & sc->attr) {
+
+        XSetForeground(padisplay, sc->xcxt, sc->bcrgb);
+        XSetBackground(padisplay, sc->xcxt, sc->fcrgb);
+
+    } else {
+
+        XSetForeground(padisplay, sc->xcxt, sc->fcrgb);
+        XSetBackground(padisplay, sc->xcxt, sc->bcrgb);
+
+    }
+    XWUNLOCK();
+    cursts(win); /* set cursor status */
+    ifree(dp); /* release the state entry */
+    WINUNLOCK(win);
+
+}
+
+/** ****************************************************************************
+
+Find window id
+
+Returns the logical window id of the window attached to the given file. This is
+the id that events for the window carry.
+
+*******************************************************************************/
+
+void _pa_winid_ovr(pa_winid_t nfp, pa_winid_t* ofp)
+    { *ofp = winid_vect; winid_vect = nfp; }
+int pa_winid(FILE* f) { return ((*winid_vect)(f)); }
+
+static int winid_ivf(FILE* f)
+
+{
+
+    winptr win; /* window record pointer */
+    int    rv; /* return value */
+
+    win = txt2win(f); /* get window from file */
+    WINLOCK(win);
+    rv = win->wid;
+    WINUNLOCK(win);
+
+    return (rv);
+
+}
+
+/** ****************************************************************************
+
 Override event handler
 
 Overrides or "hooks" the indicated event handler. The existing event handler is
@@ -11895,6 +12862,7 @@ static void timer_ivf(FILE* f, /* file to send event to */
 
     if (i < 1 || i > PA_MAXTIM) error(einvhan); /* invalid timer handle */
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     /* set system event */
     sid = system_event_addsetim(win->timers[i-1], t, r);
     win->timers[i-1] = sid;
@@ -11902,6 +12870,7 @@ static void timer_ivf(FILE* f, /* file to send event to */
     getsee(sid); /* allocate system event entry */
     sidtab[sid-1]->win = win; /* set window assocated */
     sidtab[sid-1]->tim = i; /* set timer assocated */
+    WINUNLOCK(win);
 
 }
 
@@ -11927,8 +12896,10 @@ static void killtimer_ivf(FILE* f, /* file to kill timer on */
 
     if (i < 1 || i > PA_MAXTIM) error(einvhan); /* invalid timer handle */
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     if (!win->timers[i-1]) error(etimacc); /* no such timer */
     system_event_deasetim(win->timers[i-1]); /* deactivate timer */
+    WINUNLOCK(win);
 
 }
 
@@ -11955,6 +12926,7 @@ static void frametimer_ivf(FILE* f, int e)
     int    sid; /* system event */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     if (e) { /* set framing timer to run */
 
         sid = system_event_addsetim(win->frmsev, 166, TRUE);
@@ -11969,6 +12941,7 @@ static void frametimer_ivf(FILE* f, int e)
         system_event_deasetim(win->frmsev);
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -12132,7 +13105,9 @@ static void settabg_ivf(FILE* f, int t)
     winptr win; /* window pointer */
 
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
     isettabg(win, t); /* translate to graphical call */
+    WINUNLOCK(win);
 
 }
 
@@ -12155,7 +13130,9 @@ static void settab_ivf(FILE* f, int t)
     winptr win; /* window pointer */
 
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
     isettabg(win, (t-1)*win->charspace+1); /* translate to graphical call */
+    WINUNLOCK(win);
 
 }
 
@@ -12178,7 +13155,9 @@ static void restabg_ivf(FILE* f, int t)
     winptr win; /* window pointer */
 
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
     irestabg(win, t); /* translate to graphical call */
+    WINUNLOCK(win);
 
 }
 
@@ -12201,7 +13180,9 @@ static void restab_ivf(FILE* f, int t)
     winptr win; /* window pointer */
 
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
     irestabg(win, (t-1)*win->charspace+1); /* translate to graphical call */
+    WINUNLOCK(win);
 
 }
 
@@ -12226,7 +13207,9 @@ static void clrtab_ivf(FILE* f)
     winptr win; /* window pointer */
 
     win = txt2win(f); /* get window pointer from text file */
+    WINLOCK(win);
     for (i = 0; i < MAXTAB; i++) win->screens[win->curupd-1]->tab[i] = 0;
+    WINUNLOCK(win);
 
 }
 
@@ -12271,10 +13254,12 @@ static void title_ivf(FILE* f, char* ts)
     winptr win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     XWLOCK();
     XStoreName(padisplay, win->xmwhan, ts);
     XSetIconName(padisplay, win->xwhan, ts);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -12415,7 +13400,8 @@ Sets or resets the size of the buffer surface, in pixel units.
 
 void _pa_sizbufg_ovr(pa_sizbufg_t nfp, pa_sizbufg_t* ofp)
     { *ofp = sizbufg_vect; sizbufg_vect = nfp; }
-void pa_sizbufg(FILE* f, int x, int y) { (*sizbufg_vect)(f, x, y); }
+void pa_sizbufg(FILE* f, int x, int y)
+    { STSBGN(st); (*sizbufg_vect)(f, x, y); STSEND(st, stsizbufg, f); }
 
 static void sizbufg_ivf(FILE* f, int x, int y)
 
@@ -12428,6 +13414,7 @@ static void sizbufg_ivf(FILE* f, int x, int y)
 
     if (x < 1 || y < 1)  error(einvsiz); /* invalid buffer size */
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     if (!win->bufmod) error(ebufoff); /* error */
     /* set buffer size */
     win->gmaxx = x/win->charspace; /* find character size x */
@@ -12475,6 +13462,7 @@ static void sizbufg_ivf(FILE* f, int x, int y)
     }
 
     restore(win); /* restore buffer to screen */
+    WINUNLOCK(win);
 
 }
 
@@ -12488,7 +13476,8 @@ Sets or resets the size of the buffer surface, in character counts.
 
 void _pa_sizbuf_ovr(pa_sizbuf_t nfp, pa_sizbuf_t* ofp)
     { *ofp = sizbuf_vect; sizbuf_vect = nfp; }
-void pa_sizbuf(FILE* f, int x, int y) { (*sizbuf_vect)(f, x, y); }
+void pa_sizbuf(FILE* f, int x, int y)
+    { STSBGN(st); (*sizbuf_vect)(f, x, y); STSEND(st, stsizbuf, f); }
 
 static void sizbuf_ivf(FILE* f, int x, int y)
 
@@ -12497,8 +13486,10 @@ static void sizbuf_ivf(FILE* f, int x, int y)
     winptr win; /* pointer to windows context */
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     /* just translate from characters to pixels and do the resize in pixels. */
     pa_sizbufg(f, x*win->charspace, y*win->linespace);
+    WINUNLOCK(win);
 
 }
 
@@ -12526,6 +13517,7 @@ static void buffer_ivf(FILE* f, int e)
     int               si;  /* index for screens */
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     if (e) { /* perform buffer on actions */
 
         win->bufmod = TRUE; /* turn buffer mode on */
@@ -12574,6 +13566,7 @@ static void buffer_ivf(FILE* f, int e)
         /* get actual size of onscreen window, and set that as client space */
         XWLOCK();
         XGetWindowAttributes(padisplay, win->xwhan, &xwa);
+        RNDTRP(1);
         win->gmaxxg = xwa.width; /* return size */
         win->gmaxyg = xwa.height;
         win->gmaxx = win->gmaxxg/win->charspace; /* find character size x */
@@ -12599,6 +13592,7 @@ static void buffer_ivf(FILE* f, int e)
         XWUNLOCK();
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -12777,6 +13771,7 @@ static void menu_ivf(FILE* f, pa_menuptr m)
     int menuact; /* is a menu active */
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     menuact = FALSE; /* set no menu active */
     if (win->metlst) { /* destroy previous menu */
 
@@ -12811,6 +13806,7 @@ static void menu_ivf(FILE* f, pa_menuptr m)
         actmenu(f);
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -12836,6 +13832,7 @@ static void menuena_ivf(FILE* f, int id, int onoff)
     metptr mp;  /* menu entry pointer */
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     mp = fndmenu(win, id); /* find the menu entry */
     mp->ena = !!onoff; /* set state of enable */
     /* tell the window to repaint */
@@ -12849,6 +13846,7 @@ static void menuena_ivf(FILE* f, int id, int onoff)
     XWLOCK();
     XSendEvent(padisplay, win->xwhan, FALSE, 0, &xe);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -12915,11 +13913,13 @@ static void menusel_ivf(FILE* f, int id, int select)
     metptr mp;  /* menu entry pointer */
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     mp = fndmenu(win, id); /* find the menu entry */
     if (mp->chnhd->oneof != mp->chnhd) /* is a "one of" chain */
         clrlst(mp->chnhd); /* clear "one of" group */
     mp->select = !!select; /* set state of select */
     menu_repaint(mp); /* tell the window to repaint */
+    WINUNLOCK(win);
 
 }
 
@@ -13085,9 +14085,11 @@ static void front_ivf(FILE* f)
     winptr win; /* pointer to windows context */
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     XWLOCK();
     XRaiseWindow(padisplay, win->xmwhan);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -13110,9 +14112,11 @@ static void back_ivf(FILE* f)
     winptr win; /* pointer to windows context */
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     XWLOCK();
     XLowerWindow(padisplay, win->xmwhan);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -13139,6 +14143,7 @@ static void getsizg_ivf(FILE* f, int* x, int* y)
     unsigned          ncw;
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
 #ifdef WAITWMR
     /* if wait for window manager is set, ask the WM what the size is */
     XWLOCK();
@@ -13146,6 +14151,7 @@ static void getsizg_ivf(FILE* f, int* x, int* y)
     XQueryTree(padisplay, win->xwhan, &rw, &pw, &cwl, &ncw);
     /* get parent parameters */
     XGetWindowAttributes(padisplay, pw, &xwa);
+    RNDTRP(2);
     XWUNLOCK();
     *x = xwa.width+win->pfw;
     *y = xwa.height+win->pfh;
@@ -13154,6 +14160,7 @@ static void getsizg_ivf(FILE* f, int* x, int* y)
     *x = win->xmwr.w+win->pfw;
     *y = win->xmwr.h+win->pfh;
 #endif
+    WINUNLOCK(win);
 
 }
 
@@ -13183,6 +14190,7 @@ static void getsiz_ivf(FILE* f, int* x, int* y)
     int    gx, gy;
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     pa_getsizg(f, &gx, &gy); /* get graphics size */
     if (win->parlfn >= 0) { /* has a parent */
 
@@ -13198,6 +14206,7 @@ static void getsiz_ivf(FILE* f, int* x, int* y)
         *y = gy/stdchry;
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -13225,6 +14234,7 @@ static void setsizg_ivf(FILE* f, int x, int y)
     XEvent e; /* Xwindow event */
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     /* change to client terms with zero clip */
     xwc.width = x-win->pfw; if (xwc.width < 1) xwc.width = 1;
     xwc.height = y-win->pfh; if (xwc.height < 1) xwc.height = 1;
@@ -13263,6 +14273,7 @@ static void setsizg_ivf(FILE* f, int x, int y)
         }
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -13291,6 +14302,7 @@ static void setsiz_ivf(FILE* f, int x, int y)
     winptr win, par; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     if (win->parlfn >= 0) { /* has a parent */
 
         par = lfn2win(win->parlfn); /* index the parent */
@@ -13306,6 +14318,7 @@ static void setsiz_ivf(FILE* f, int x, int y)
 
     }
     pa_setsizg(f, x, y); /* execute */
+    WINUNLOCK(win);
 
 }
 
@@ -13330,6 +14343,7 @@ static void setposg_ivf(FILE* f, int x, int y)
     XEvent         e;   /* XWindow event */
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
 
     /* don't repeat positions, it will cause a no-op in windows manager */
     if (x-1 != win->xmwr.x || y-1 != win->xmwr.y) {
@@ -13350,6 +14364,7 @@ static void setposg_ivf(FILE* f, int x, int y)
         win->xmwr.y = y-1;
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -13377,6 +14392,7 @@ static void setpos_ivf(FILE* f, int x, int y)
     winptr win, par; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     if (win->parlfn >= 0) { /* has a parent */
 
         par = lfn2win(win->parlfn); /* index the parent */
@@ -13392,6 +14408,7 @@ static void setpos_ivf(FILE* f, int x, int y)
 
     }
     pa_setposg(f, x, y); /* execute */
+    WINUNLOCK(win);
 
 }
 
@@ -13418,14 +14435,17 @@ static void scnsizg_ivf(FILE* f, int* x, int* y)
     unsigned          ncw;
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     XWLOCK();
     /* find parent */
     XQueryTree(padisplay, win->xwhan, &rw, &pw, &cwl, &ncw);
     /* get root parameters */
     XGetWindowAttributes(padisplay, rw, &xwa);
+    RNDTRP(2);
     XWUNLOCK();
     *x = xwa.width;
     *y = xwa.height;
+    WINUNLOCK(win);
 
 }
 
@@ -13537,6 +14557,7 @@ static void winclientg_ivf(FILE* f, int cx, int cy, int* wx, int* wy, pa_winmods
     winptr win; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     *wx = cx+frmextwdt[frmcfgall]; /* find framed size */
     *wy = cy+frmexthgt[frmcfgall];
     /* we only allow one frame mode at a time, so we process here in priority
@@ -13557,6 +14578,7 @@ static void winclientg_ivf(FILE* f, int cx, int cy, int* wx, int* wy, pa_winmods
         *wy = cy+frmexthgt[frmcfgsys];
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -13572,6 +14594,7 @@ static void winclient_ivf(FILE* f, int cx, int cy, int* wx, int* wy, pa_winmodse
     winptr win, par; /* windows record pointer */
 
     win = txt2win(f); /* get window from file */
+    WINLOCK(win);
     /* execute */
     pa_winclientg(f, cx*win->charspace, cy*win->linespace, wx, wy, ms);
     /* find character based sizes */
@@ -13589,6 +14612,7 @@ static void winclient_ivf(FILE* f, int cx, int cy, int* wx, int* wy, pa_winmodse
         *wy = (*wy-1) / stdchry+1;
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -13615,6 +14639,7 @@ static void frame_ivf(FILE* f, int e)
     int chg;            /* geometry change */
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     chg = win->frame != !!e; /* set frame has changed */
     win->frame = FALSE; /* turn off all frame configures */
     win->size = FALSE;
@@ -13657,6 +14682,7 @@ static void frame_ivf(FILE* f, int e)
         restore(win); /* restore buffer to screen */
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -13687,6 +14713,7 @@ static void sizable_ivf(FILE* f, int e)
     int chg;            /* geometry change */
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     chg = win->size != !!e; /* set size has changed */
     win->frame = FALSE; /* turn off all frame configures */
     win->size = FALSE;
@@ -13729,6 +14756,7 @@ static void sizable_ivf(FILE* f, int e)
         restore(win); /* restore buffer to screen */
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -13758,6 +14786,7 @@ static void sysbar_ivf(FILE* f, int e)
     int chg;            /* geometry change */
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     chg = win->sysbar != !!e; /* set sysbar has changed */
     win->frame = FALSE; /* turn off all frame configures */
     win->size = FALSE;
@@ -13800,6 +14829,7 @@ static void sysbar_ivf(FILE* f, int e)
         restore(win); /* restore buffer to screen */
 
     }
+    WINUNLOCK(win);
 
 }
 
@@ -13822,9 +14852,11 @@ static void focus_ivf(FILE* f)
     winptr win; /* pointer to windows context */
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     XWLOCK();
     XSetInputFocus(padisplay, win->xmwhan, RevertToNone, CurrentTime);
     XWUNLOCK();
+    WINUNLOCK(win);
 
 }
 
@@ -13860,9 +14892,11 @@ static void path_ivf(FILE* f, int a)
     scnptr sc;  /* screen buffer */
 
     win = txt2win(f); /* get window context */
+    WINLOCK(win);
     sc = win->screens[win->curupd-1];
     if (sc->autof) error(eangato); /* autowrap is on */
     sc->angle = a; /* set drawing angle */
+    WINUNLOCK(win);
 
 }
 
@@ -14566,6 +15600,117 @@ static void queryfont_ivf(FILE* f, int* fc, int* s, int* fr, int* fg, int* fb,
 
 /** ****************************************************************************
 
+Get statistic
+
+Returns the value of a statistic by name. Statistics are only collected when
+enabled, by the "print_statistics" diagnostic setting or the PA_GRAPH_STATS
+environment variable. Otherwise all values read zero.
+
+The names are:
+
+<point>.calls - Number of calls to the statistics point.
+<point>.time  - Total time in calls, in nanoseconds.
+<point>.xreqs - Xlib requests issued by calls.
+xreqs         - Xlib requests issued for the window of the given file, or if
+                the file is NULL, for the whole program.
+flushes       - Flushes of the request queue to the server.
+roundtrips    - Calls that waited on a reply from the server.
+locks         - Acquisitions of the XWindow call lock.
+lockcontends  - Acquisitions that had to wait.
+lockwait      - Total time waiting for the lock, in nanoseconds.
+lockhold      - Total time the lock was held, in nanoseconds.
+imagebytes    - Image bytes sent to the server.
+
+Where <point> is one of the names in stsnam[], for example "picture.time".
+
+*******************************************************************************/
+
+unsigned long long pa_getstat(FILE* f, const char* n)
+
+{
+
+    unsigned long long v;
+    const char* dp;
+    int p;
+
+    v = 0;
+    dp = strchr(n, '.');
+    if (dp) { /* point statistic */
+
+        for (p = 0; p < stmax && (strlen(stsnam[p]) != dp-n ||
+                                  strncmp(stsnam[p], n, dp-n)); p++);
+        if (p >= stmax) error(einvsts);
+        if (!strcmp(dp+1, "calls")) v = stsapi[p].calls;
+        else if (!strcmp(dp+1, "time")) v = stsapi[p].time;
+        else if (!strcmp(dp+1, "xreqs")) v = stsapi[p].xreqs;
+        else error(einvsts);
+
+    } else if (!strcmp(n, "xreqs")) {
+
+        if (f) v = txt2win(f)->xreqs;
+        else if (stsenb) v = NextRequest(padisplay)-1;
+
+    }
+    else if (!strcmp(n, "flushes")) v = stsflsh;
+    else if (!strcmp(n, "roundtrips")) v = stsrtp;
+    else if (!strcmp(n, "locks")) v = stslck;
+    else if (!strcmp(n, "lockcontends")) v = stslckc;
+    else if (!strcmp(n, "lockwait")) v = stslckw;
+    else if (!strcmp(n, "lockhold")) v = stslckh;
+    else if (!strcmp(n, "imagebytes")) v = stsimg;
+    else error(einvsts);
+
+    return v;
+
+}
+
+/** ****************************************************************************
+
+Print statistics
+
+Prints all of the statistics to the given file. Points that were never called
+are left out. This is done automatically at exit if statistics are enabled.
+
+*******************************************************************************/
+
+void pa_prtstats(FILE* fp)
+
+{
+
+    int    p;
+    int    fn;
+    winptr win;
+
+    fprintf(fp, "\nGraphics statistics:\n\n");
+    fprintf(fp, "%-12s %12s %14s %12s %12s\n", "Point", "Calls", "Time (us)",
+            "Avg (us)", "Xlib reqs");
+    for (p = 0; p < stmax; p++) if (stsapi[p].calls)
+        fprintf(fp, "%-12s %12lu %14.1f %12.2f %12lu\n", stsnam[p],
+                stsapi[p].calls, stsapi[p].time/1000.0,
+                stsapi[p].time/1000.0/stsapi[p].calls, stsapi[p].xreqs);
+    fprintf(fp, "\n");
+    if (padisplay)
+        fprintf(fp, "Xlib requests:        %lu\n", NextRequest(padisplay)-1);
+    for (fn = 0; fn < MAXFIL; fn++)
+        if (opnfil[fn] && opnfil[fn]->win && !opnfil[fn]->inw) {
+
+        win = opnfil[fn]->win;
+        fprintf(fp, "  window %-4d         %lu\n", win->wid, win->xreqs);
+
+    }
+    fprintf(fp, "Flushes:              %lu\n", stsflsh);
+    fprintf(fp, "Round trips:          %lu\n", stsrtp);
+    fprintf(fp, "Image bytes sent:     %llu\n", stsimg);
+    fprintf(fp, "Lock acquisitions:    %lu\n", stslck);
+    fprintf(fp, "Lock contentions:     %lu\n", stslckc);
+    fprintf(fp, "Lock wait (us):       %.1f\n", stslckw/1000.0);
+    fprintf(fp, "Lock hold (us):       %.1f\n", stslckh/1000.0);
+    fflush(fp);
+
+}
+
+/** ****************************************************************************
+
 Gralib startup
 
 *******************************************************************************/
@@ -14593,6 +15738,7 @@ static void pa_init_graphics(int argc, char *argv[])
     char      joyfil[] = "/dev/input/js0";
     int       joyfid;
     char      jc;
+    pthread_mutexattr_t xwlatt; /* XWindow call lock attributes */
 
     /* set override vectors to defaults */
     cursor_vect =          cursor_ivf;
@@ -14641,6 +15787,9 @@ static void pa_init_graphics(int argc, char *argv[])
     eventover_vect =       eventover_ivf;
     eventsover_vect =      eventsover_ivf;
     sendevent_vect =       sendevent_ivf;
+    pushstate_vect =       pushstate_ivf;
+    popstate_vect =        popstate_ivf;
+    winid_vect =           winid_ivf;
     maxxg_vect =           maxxg_ivf;
     maxyg_vect =           maxyg_ivf;
     curxg_vect =           curxg_ivf;
@@ -14846,8 +15995,11 @@ static void pa_init_graphics(int argc, char *argv[])
     mettot = 0; /* menu entries total space */
     evtcnt = 0; /* clear PA event count */
 
-    /* initialize the XWindow lock */
-    pthread_mutex_init(&xwlock, NULL);
+    /* initialize the XWindow lock, recursive so primitives can batch */
+    pthread_mutexattr_init(&xwlatt);
+    pthread_mutexattr_settype(&xwlatt, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&xwlock, &xwlatt);
+    pthread_mutexattr_destroy(&xwlatt);
 
     /* turn off I/O buffering */
     setvbuf(stdin, NULL, _IONBF, 0);
@@ -14876,6 +16028,7 @@ static void pa_init_graphics(int argc, char *argv[])
     dmpmsg    = DMPMSG;    /* dump XWindow messages */
     dmpevt    = DMPEVT;    /* dump Petit-Ami messages */
     prtftm    = PRTFTM;    /* print font metrics on load */
+    stsenb    = STSENB;    /* collect and print statistics */
     conpnt    = CONPNT;    /* point size of console font */
 
     /* set state of shift, control and alt keys */
@@ -15025,12 +16178,23 @@ static void pa_init_graphics(int argc, char *argv[])
 
                 }
 
+                vp = pa_schlst("print_statistics", diag_root->sublist);
+                if (vp) {
+
+                    stsenb = strtol(vp->value, &errstr, 10);
+                    if (*errstr) error(ecfgval);
+
+                }
+
             }
 
         }
 
     }
 
+    /* the environment can turn on statistics without a config change */
+    if (getenv("PA_GRAPH_STATS")) stsenb = !!atoi(getenv("PA_GRAPH_STATS"));
+
     /* capture the XWindow errors */
     xerrbyp = FALSE; /* set no xerror() bypass */
     XSetErrorHandler(xerror); /* establish handler */
@@ -15154,6 +16318,9 @@ static void pa_deinit_graphics()
 
     pa_evtrec er;
 
+    /* print statistics while the windows are still present */
+    if (stsenb) pa_prtstats(stderr);
+
     /* try to get window from stdout */
     win = NULL; /* set no window */
     fn = fileno(stdout); /* get fid */
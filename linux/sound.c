@@ -56,11 +56,18 @@
 #include <alsa/asoundlib.h>
 #include <sys/time.h>
 #include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <limits.h>
+#include <math.h>
 
 #include <localdefs.h>
 #include <sound.h>
+#include <config.h>
 
 #include <diag.h>
 
@@ -76,6 +83,22 @@
 
 #define WAVBUF (16*1024) /* size of output wave buffer */
 #define MAXFIL 200 /* maximum size of wave table filename */
+#define MIXPER 256 /* default wave mixer period in frames */
+#define MIXMAX 8192 /* maximum wave mixer period in frames */
+#define MIXPERS 4 /* number of mixer periods buffered in output */
+#define MIXRATE 48000 /* mixer rate for devices that don't give one */
+#define STRFRM 16384 /* frames buffered for a wave output stream */
+#define STRCVT 1024 /* samples converted at a time for a wave stream */
+#define WAVLAT 500000 /* default wave output latency, in microseconds */
+#define RSMTAP 16 /* taps in resampling filter, a multiple of 4 */
+#define RSMPHS 64 /* phases in resampling filter */
+#define MIDBUF 1024 /* size of midi output buffer */
+#define MIDRST 1000000000 /* idle time before midi status is resent, in ns */
+
+/* .wav format types */
+#define WAVPCM 1      /* integer PCM */
+#define WAVFLT 3      /* IEEE floating point */
+#define WAVEXT 0xfffe /* extensible, type is in the subformat */
 
 #define DEFMIDITIM 5000 /* default midi quarter note (.5 seconds) */
 
@@ -246,15 +269,85 @@ typedef struct fmthdr {
 /* turn off critical packing */
 #pragma pack()
 
-/* port/id structure to start player tasks */
-typedef struct portid {
-
-    int port;
-    int id;
-
-} portid;
-
-typedef portid* portidptr;
+/* decoded wave. Waves are decoded when loaded to 16 bit signed samples in
+   machine order, in one or two channels, at the rate of the file. The entry is
+   shared by the wave table and the plays of it, and is freed when the last of
+   those releases it. The samples can be evicted to keep to the cache budget,
+   and are decoded again from the file when next played */
+typedef struct wavbuf {
+
+    struct wavbuf* next;   /* next in LRU list, less recently used */
+    struct wavbuf* last;   /* last in LRU list, the head keeps the tail */
+    string         fn;     /* file name */
+    int            ref;    /* number of references, table and plays */
+    int            rate;   /* sample rate */
+    int            chan;   /* number of channels, 1 or 2 */
+    long           frames; /* number of frames */
+    long           len;    /* length of samples in bytes */
+    short*         data;   /* samples, NULL if evicted */
+
+} wavbuf;
+
+typedef wavbuf* wavbufptr;
+
+/* resampling filter. A polyphase filter for one source rate on a mixer */
+typedef struct rsmflt {
+
+    struct rsmflt* next; /* next filter for mixer */
+    int rate;            /* source rate */
+    int coef[RSMPHS][RSMTAP]; /* coefficients for each phase, 15 bits */
+    int coef2[RSMPHS][RSMTAP*2]; /* coefficients doubled for stereo */
+
+} rsmflt;
+
+typedef rsmflt* rsmptr;
+
+/* wave mixer voice. Each voice is one play of a wave on a mixer */
+typedef struct voice {
+
+    struct voice* next;     /* next entry in list */
+    wavbufptr     wb;       /* wave to play */
+    long          pos;      /* current frame in wave */
+    unsigned int  step;     /* source frames per mixer frame, 16.16 */
+    unsigned int  frac;     /* position between source frames, 16.16 */
+    rsmptr        flt;      /* resampling filter, NULL if at mixer rate */
+    int           port;     /* port played on */
+    int           lgain;    /* left gain, 0 to 65536 */
+    int           rgain;    /* right gain, 0 to 65536 */
+
+} voice;
+
+typedef voice* voiceptr;
+
+/* wave mixer. There is one per wave output port */
+typedef struct mixer {
+
+    pthread_t       tid;  /* mixer thread */
+    pthread_mutex_t lock; /* mixer lock */
+    pthread_cond_t  cond; /* new plays or stop */
+    voiceptr        inq;  /* plays to start */
+    voiceptr        act;  /* active plays, used by mixer thread only */
+    voiceptr        fre;  /* free voices */
+    rsmptr          rsm;  /* resampling filters, used by mixer thread only */
+    int             stop; /* stop mixer thread */
+    int             cfg;  /* output port is set to the mixer format */
+    short*          sbuf; /* stream from pa_wrwave(), in stereo frames */
+    long            ssiz; /* size of stream buffer in frames */
+    long            sout; /* next stream frame out */
+    long            scnt; /* number of stream frames in buffer */
+    unsigned int    sfrc; /* stream position past next frame, 16.16 */
+    pthread_cond_t  scnd; /* stream buffer has room */
+    /* format of the data given to pa_wrwave() */
+    int             uchan, urate, ulen, usgn, uflt, uend;
+    int             chan; /* mixer channels, 1 or 2 */
+    int             rate; /* mixer rate */
+    int             per;  /* mixer period in frames */
+    int             vol;  /* volume for new plays, 0 to maxint */
+    int             pan;  /* pan for new plays, -maxint to maxint */
+
+} mixer;
+
+typedef mixer* mixptr;
 
 /* alsa device descriptor */
 
@@ -272,9 +365,16 @@ typedef struct snddev {
     int            flt;        /* preferred format floating point */
     int            ssiz;       /* sample size, bits*chan in bytes */
     int            fmt;        /* alsa format code for output, -1 if not set */
+    int            lat;        /* output buffer latency in microseconds */
     byte           last;       /* last byte on midi input */
     int            pback;      /* pushback for input */
     int            sync;       /* midi channel synced */
+    byte           obuf[MIDBUF]; /* midi output buffer */
+    int            olen;       /* length of midi output */
+    byte           osts;       /* running status of midi output, 0 if none */
+    long long      otim;       /* time of last midi output, ns */
+    int            opnd;       /* midi output pending in batch */
+    pthread_mutex_t olck;      /* midi output lock */
     /* These entries support plug in devices, but are also set for internal devices */
     void (*open)(int p);                  /* open port */
     void (*close)(int p);                 /* close port */
@@ -312,19 +412,91 @@ typedef enum {
 
 } devtyp;
 
-static pa_seqptr seqlst;               /* active sequencer entries */
+/* synth file event table. The events of all tracks of a file are merged into
+   time order, and kept as parallel arrays, so that playing the file walks each
+   array in order. The sequencer messages are formed from the table as the file
+   is played. The arrays follow the header in the same allocation */
+typedef struct syntbl {
+
+    int   num;  /* number of events */
+    int*  time; /* time of event in 100us */
+    int*  val;  /* velocity, pressure, pitch or mode value */
+    byte* st;   /* type of event, pa_seqtyp */
+    byte* chan; /* channel, 1-16 */
+    byte* key;  /* note or instrument */
+
+} syntbl;
+
+typedef syntbl* syntblptr;
+
+/* midi file track cursor, used to decode the mapped file */
+typedef struct syntrk {
+
+    byte*        p;    /* next byte */
+    byte*        e;    /* end of data */
+    unsigned int tick; /* time of next event in ticks */
+    byte         last; /* last command, for running status */
+    int          end;  /* track has ended */
+
+} syntrk;
+
+typedef syntrk* syntrkptr;
+
+/* synth file play. Each play has its own cursor into the event table of the
+   file, and sits in the sequencer heap at the time of its next event, so any
+   number of plays run on the sequencer thread */
+typedef struct synply {
+
+    struct synply* next;  /* next in list */
+    syntblptr      tbl;   /* event table of file */
+    int            s;     /* logical synth file */
+    int            port;  /* port to play to */
+    int            cur;   /* next event to play */
+    long long      start; /* start of play, ns on monotonic clock */
+    long long      pause; /* time play was paused, or 0 if not paused */
+    unsigned int   non[16][4]; /* notes sounding, by channel */
+
+} synply;
+
+typedef synply* synplyptr;
+
+/* synth file play controls */
+typedef enum { pc_stop, pc_pause, pc_resume } plyctlcod;
+
+/* sequencer heap entry. The time and order are kept with the entry, so the
+   heap can be ordered without touching the messages. An entry is either a
+   message, or a synth file play */
+typedef struct seqhrec {
+
+    long long time; /* deadline, ns on monotonic clock */
+    unsigned  ser;  /* order of entry, for messages with the same time */
+    pa_seqptr sp;   /* message, or NULL if a play */
+    synplyptr pl;   /* synth file play */
+
+} seqhrec;
+
+static seqhrec* seqhep;                /* heap of active sequencer entries */
+static int seqhepn;                    /* number of entries in heap */
+static int seqheps;                    /* size of heap array */
+static unsigned seqser;                /* order for next heap entry */
+static pa_seqptr seqinq;               /* sequencer intake stack */
+static synplyptr plyinq;               /* synth file play intake stack */
+static synplyptr plylst;               /* synth file plays in progress, under
+                                          the sequencer lock */
+static int seqevt;                     /* handle for sequencer intake event */
 static pa_seqptr seqfre;               /* free sequencer entries */
+static pthread_mutex_t seqflck;        /* sequencer free list lock */
 static int seqrun;                     /* sequencer running */
-static struct timeval strtim;          /* start time for sequencer, in raw linux
-                                          time */
+static struct timespec strtim;         /* start time for sequencer, on the
+                                          monotonic clock */
 static int seqtimact;                  /* sequencer timer active */
 static int seqhan;                     /* handle for sequencer timer */
 static pthread_mutex_t seqlock;        /* sequencer task lock */
 static pthread_t sequencer_thread_id;  /* sequencer thread id */
 
 static int sinrun;                     /* input timer running */
-static struct timeval sintim;          /* start time input midi marking, in raw
-                                          linux time */
+static struct timespec sintim;         /* start time input midi marking, on the
+                                          monotonic clock */
 
 /*
  * Set of input file ids for select
@@ -335,11 +507,24 @@ static int ifdmax;
 
 /* Wave track storage. Note this needs locking */
 static pthread_mutex_t wavlck; /* wave track lock */
-static volatile string wavfil[MAXWAVT]; /* storage for wave track files */
+static wavbufptr wavtab[MAXWAVT]; /* storage for wave tracks */
+static wavbufptr wavlru; /* wave tracks, most recently played first */
+static long wavmem; /* memory used by decoded waves */
+static long wavbgt; /* budget for decoded waves, 0 if none */
+
+/* wave mixers for output ports */
+static mixer wavmix[MAXWAVP];
+
+/* decode of evicted waves, done off the mixer threads */
+static pthread_mutex_t declck; /* decode queue lock */
+static pthread_cond_t  deccnd; /* decode queue has plays */
+static voiceptr        decq;   /* plays waiting for their wave to decode */
+static int             decrun; /* decode thread started */
+static pthread_t       dectid; /* decode thread */
 
 /* Synth track storage. Note this needs locking */
 static pthread_mutex_t synlck; /* synth track lock */
-static volatile pa_seqptr syntab[MAXMIDT]; /* storage for synth track files */
+static volatile syntblptr syntab[MAXMIDT]; /* storage for synth track files */
 
 /* The active wave track counter uses both a lock and a condition to signal
    that it has returned to zero */
@@ -379,9 +564,18 @@ static int alsamidiinplug; /* MIDI in */
 static int alsapcmoutplug; /* PCM out */
 static int alsapcminplug; /* PCM in */
 
+/* midi output batching, by thread */
+static __thread int midbat; /* thread is batching midi output */
+static __thread devptr midpnd[MAXMIDP]; /* devices with batched output */
+static __thread int midpndn; /* number of devices with batched output */
+
 /* forwards */
 static void alsaplaysynth_kickoff(int p, int s);
+static void plyrun(synplyptr pl, long long t);
+static void plyend(synplyptr pl);
 static void alsaplaywave_kickoff(int p, int w);
+static void mixstr(int p);
+static void mixstp(int p);
 
 /*******************************************************************************
 
@@ -679,119 +873,235 @@ static int params2alsa(devptr dp)
 
 /*******************************************************************************
 
-Issue MIDI 2 byte message
+Find elapsed nanosecond time
 
-Sends a 2 byte MIDI message to the given ALSA midi port.
+Finds the time elapsed since the given start time in nanoseconds.
+
+Times are taken from the monotonic clock, which is not changed when the time of
+day is set, so sequencing does not jump or stall if the system clock is
+adjusted.
 
 *******************************************************************************/
 
-static void midimsg2(snd_rawmidi_t *midiout, byte sts, byte dat1)
+static long long timedifns(struct timespec* rt)
 
 {
 
-    int r; /* function result */
-    byte oa[2]; /* output holding array */
+    struct timespec ts; /* record to get time */
 
-    /* load the output array */
-    oa[0] = sts;
-    oa[1] = dat1;
-#ifdef SHOWMIDIOUT
-    printf("MIDI out: %2.2x %2.2x\n", oa[0], oa[1]);
-#endif
-    /* send it */
-    r = snd_rawmidi_write(midiout, oa, 2);
-    if (r < 0) error("Unable to send to MIDI channel");
+    clock_gettime(CLOCK_MONOTONIC, &ts); /* get current time */
+
+    return ((long long)(ts.tv_sec-rt->tv_sec)*1000000000+ts.tv_nsec-rt->tv_nsec);
 
 }
 
 /*******************************************************************************
 
-Issue MIDI 3 byte message
+Find elapsed time
 
-Sends a 3 byte MIDI message to the given ALSA midi port.
+Finds the time elapsed since the given start time in 100us increments, which
+is the time unit used by the sequencer calls.
 
 *******************************************************************************/
 
-static void midimsg3(snd_rawmidi_t *midiout, byte sts, byte dat1, byte dat2)
+static int timediff(struct timespec* rt)
 
 {
 
-    int r; /* function result */
-    byte oa[3]; /* output holding array */
+    return (timedifns(rt)/100000); /* return difference in 100us increments */
 
-    /* load the output array */
-    oa[0] = sts;
-    oa[1] = dat1;
-    oa[2] = dat2;
-#ifdef SHOWMIDIOUT
-    printf("MIDI out: %2.2x %2.2x %2.2x\n", oa[0], oa[1], oa[2]);
-#endif
-    /* send it */
-    r = snd_rawmidi_write(midiout, oa, 3);
-    if (r < 0) error("Unable to send to MIDI channel");
+}
+
+/*******************************************************************************
+
+Find absolute nanosecond time
+
+Finds the given time on the monotonic clock in nanoseconds. If no time is
+given, the current time is used.
+
+*******************************************************************************/
+
+static long long timns(struct timespec* rt)
+
+{
+
+    struct timespec ts; /* record to get time */
+
+    if (!rt) { /* use current time */
+
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        rt = &ts;
+
+    }
+
+    return ((long long)rt->tv_sec*1000000000+rt->tv_nsec);
+
+}
+
+/*******************************************************************************
+
+Set timer deadline
+
+Sets a timer to go off at the given time on the monotonic clock, in
+nanoseconds. The deadline is set as an absolute time, so each event is timed
+from the start of its sequence and errors in waking up do not add up over a
+long sequence. If the deadline has already passed, the timer goes off at once.
+A deadline of 0 stops the timer.
+
+*******************************************************************************/
+
+static void settim(int fd, long long t)
+
+{
+
+    struct itimerspec ts; /* timer data */
+
+    ts.it_value.tv_sec = t/1000000000;
+    ts.it_value.tv_nsec = t%1000000000;
+    ts.it_interval.tv_sec = 0; /* set does not rerun */
+    ts.it_interval.tv_nsec = 0;
+    timerfd_settime(fd, TFD_TIMER_ABSTIME, &ts, NULL);
 
 }
 
 /*******************************************************************************
 
-Find elapsed microsecond time corrected
+Flush MIDI output
+
+Writes out the contents of the MIDI output buffer of a device. Called with the
+output lock of the device held.
+
+*******************************************************************************/
+
+static void midfls(devptr dp)
 
-Finds the elapsed time on the linux microsecond time, then corrects that for
-100us time.
+{
+
+    int r; /* function result */
+
+    if (dp->olen) { /* there is output */
+
+        r = snd_rawmidi_write(dp->midi, dp->obuf, dp->olen);
+        if (r < 0) error("Unable to send to MIDI channel");
+        dp->olen = 0; /* set buffer empty */
+
+    }
+
+}
+
+/*******************************************************************************
+
+Flush pending MIDI output
 
-Linux time is kept as seconds and a microseconds offset from that. It does not
-wrap.
+Writes out the output buffers of all the devices that had messages placed in
+batch mode, and leaves batch mode. The sequencer thread batches the messages of
+each dispatch, so all the messages that come due together go out in one write
+per device.
 
 *******************************************************************************/
 
-static int timediff(struct timeval* rt)
+static void midflsbat(void)
 
 {
 
-    int ds; /* seconds difference */
-    int du; /* microseconds difference */
-    struct timeval tv; /* record to get time */
+    devptr dp;
 
-    gettimeofday(&tv, NULL); /* get current time */
-    ds = tv.tv_sec-rt->tv_sec; /* find difference in seconds */
-    du = tv.tv_usec-rt->tv_usec; /* find difference in microseconds */
+    while (midpndn) { /* flush each pending device */
 
-    return (ds*10000+du/100); /* return difference in 100us increments */
+        dp = midpnd[--midpndn];
+        pthread_mutex_lock(&dp->olck);
+        midfls(dp);
+        dp->opnd = FALSE;
+        pthread_mutex_unlock(&dp->olck);
+
+    }
+    midbat = FALSE; /* leave batch mode */
 
 }
 
 /*******************************************************************************
 
-Activate sequencer timer
+Issue MIDI message
 
-If the sequencer timer is not running, we activate it.
+Sends a 2 or 3 byte MIDI message to the given ALSA midi device. The message is
+placed in the output buffer of the device with running status, that is, the
+status byte is left off if it is the same as the last one sent. A note off with
+zero velocity following a note on of the same channel is sent as a note on with
+zero velocity, which means the same thing, so that it keeps the running status.
+The status is sent again after the line has been idle for a while, in case the
+receiver has lost it.
+
+Unless the calling thread is in batch mode, the buffer is written out right
+away.
 
 *******************************************************************************/
 
-static void acttim(void)
+static void midimsg(devptr dp, int n, byte sts, byte dat1, byte dat2)
 
 {
 
-    struct itimerspec ts; /* timer data */
-    int    elap;          /* elapsed time */
-    long tl;
+    long long t; /* current time */
 
-    if (!seqtimact && seqlst) { /* sequencer list has contents, activate timer */
+#ifdef SHOWMIDIOUT
+    if (n == 2) printf("MIDI out: %2.2x %2.2x\n", sts, dat1);
+    else printf("MIDI out: %2.2x %2.2x %2.2x\n", sts, dat1, dat2);
+#endif
+    pthread_mutex_lock(&dp->olck);
+    if (dp->olen+n > MIDBUF) midfls(dp); /* no room, write out */
+    t = timns(NULL); /* find current time */
+    if (t-dp->otim > MIDRST) dp->osts = 0; /* idle, resend status */
+    dp->otim = t;
+    /* note off with zero velocity is the same as note on with zero velocity */
+    if ((sts & 0xf0) == MESS_NOTE_OFF && !dat2 &&
+        dp->osts == MESS_NOTE_ON+(sts & 0x0f)) sts = dp->osts;
+    if (sts != dp->osts) { /* status changes, place it */
+
+        dp->obuf[dp->olen++] = sts;
+        dp->osts = sts;
+
+    }
+    dp->obuf[dp->olen++] = dat1; /* place data */
+    if (n > 2) dp->obuf[dp->olen++] = dat2;
+    if (!midbat) midfls(dp); /* not batching, write out now */
+    else if (!dp->opnd) { /* add to pending devices */
+
+        dp->opnd = TRUE;
+        midpnd[midpndn++] = dp;
+
+    }
+    pthread_mutex_unlock(&dp->olck);
+
+}
+
+/*******************************************************************************
+
+Set sequencer active
+
+Sets the sequencer timer active or inactive. The sequencer counts as an active
+sequence instance while it has entries, so a change of state is counted, and a
+return to zero signaled.
+
+*******************************************************************************/
+
+static void seqact(int a)
 
-        elap = timediff(&strtim); /* find elapsed time since seq start */
-        tl = seqlst->time-elap; /* set next time to run */
-        ts.it_value.tv_sec = tl/10000; /* set number of seconds to run */
-        /* set number of nanoseconds to run */
-        ts.it_value.tv_nsec = tl%10000*100000;
-        ts.it_interval.tv_sec = 0; /* set does not rerun */
-        ts.it_interval.tv_nsec = 0;
-        timerfd_settime(seqhan, 0, &ts, NULL);
-        seqtimact = TRUE; /* set sequencer timer active */
+{
+
+    if (a != seqtimact) { /* state changes */
 
+        seqtimact = a; /* set new state */
         /* count active sequence instances */
         pthread_mutex_lock(&snmlck);
-        numseq++; /* count active */
+        if (a) numseq++; /* count active */
+        else {
+
+            numseq--; /* count inactive */
+            /* if now zero, signal zero crossing */
+            if (!numseq) pthread_cond_signal(&snmzer);
+
+        }
         pthread_mutex_unlock(&snmlck); /* release lock */
+        if (numseq < 0) error("Sequencer locking imbalance");
 
     }
 
@@ -811,14 +1121,13 @@ static void getseq(pa_seqptr* p)
 
 {
 
-    if (seqfre) { /* get a previous sequencer message */
-
-        *p = seqfre; /* index top entry */
-        seqfre = seqfre->next; /* gap out */
-
-    } else
-        /* else get a new entry, with full allocation */
-        *p = (pa_seqptr) malloc(sizeof(pa_seqmsg));
+    pthread_mutex_lock(&seqflck); /* take free list lock */
+    *p = seqfre; /* index top entry */
+    if (seqfre) seqfre = seqfre->next; /* gap out */
+    pthread_mutex_unlock(&seqflck); /* release lock */
+    /* if none, get a new entry, with full allocation */
+    if (!*p) *p = (pa_seqptr) malloc(sizeof(pa_seqmsg));
+    if (!*p) error("Out of memory");
     (*p)->next = NULL; /* clear next */
 
 }
@@ -835,8 +1144,10 @@ static void putseq(pa_seqptr p)
 
 {
 
+   pthread_mutex_lock(&seqflck); /* take free list lock */
    p->next = seqfre; /* link to top of list */
    seqfre = p; /* push onto list */
+   pthread_mutex_unlock(&seqflck); /* release lock */
 
 }
 
@@ -994,7 +1305,8 @@ static void dmpseqlst(pa_seqptr p)
 
 Put sequencer list
 
-Frees a sequencer instruction list.
+Frees a sequencer instruction list. The list is placed on the free list as a
+whole.
 
 *******************************************************************************/
 
@@ -1002,13 +1314,16 @@ static void putseqlst(pa_seqptr p)
 
 {
 
-    pa_seqptr tp;
+    pa_seqptr lp;
 
-    while (p) {
+    if (p) {
 
-        tp = p; /* remove top entry from list */
-        p = p->next;
-        putseq(tp); /* free that */
+        lp = p; /* find last entry */
+        while (lp->next) lp = lp->next;
+        pthread_mutex_lock(&seqflck); /* take free list lock */
+        lp->next = seqfre; /* link list to top of free list */
+        seqfre = p;
+        pthread_mutex_unlock(&seqflck); /* release lock */
 
     }
 
@@ -1017,51 +1332,345 @@ static void putseqlst(pa_seqptr p)
 
 /*******************************************************************************
 
-Insert sequencer message
+Heap entry less than
 
-Inserts a sequencer message into the list, in ascending time order.
+Finds if the first heap entry comes before the second. Entries are ordered by
+time, then by the order they were entered, so that messages with the same time
+are executed in the order they were sent. The order number is compared with
+wraparound.
 
 *******************************************************************************/
 
-static void insseq(pa_seqptr p)
+#define SEQLESS(a, b) ((a).time < (b).time || \
+                       ((a).time == (b).time && (int)((a).ser-(b).ser) < 0))
+
+/*******************************************************************************
+
+Move heap entry up
+
+Moves the heap entry at the given index up until its parent is not after it.
+
+*******************************************************************************/
+
+static void hepup(int i)
 
 {
 
-    pa_seqptr lp, l;
+    seqhrec h;
+    int     pi;
 
-    pthread_mutex_lock(&seqlock); /* take sequencer data lock */
-    /* check sequencer list empty */
-    if (!seqlst) seqlst = p; /* place as first if so */
-    /* check insert to start */
-    else if (p->time < seqlst->time) {
+    h = seqhep[i]; /* save entry */
+    while (i > 0) { /* not at root */
+
+        pi = (i-1)/2; /* find parent */
+        if (!SEQLESS(h, seqhep[pi])) break; /* in order */
+        seqhep[i] = seqhep[pi]; /* move parent down */
+        i = pi;
+
+    }
+    seqhep[i] = h; /* place entry */
+
+}
+
+/*******************************************************************************
+
+Move heap entry down
+
+Moves the heap entry at the given index down until neither child is before it.
+
+*******************************************************************************/
+
+static void hepdown(int i)
+
+{
+
+    seqhrec h;
+    int     ci;
+
+    h = seqhep[i]; /* save entry */
+    while ((ci = i*2+1) < seqhepn) { /* there is a child */
+
+        /* pick the earlier child */
+        if (ci+1 < seqhepn && SEQLESS(seqhep[ci+1], seqhep[ci])) ci++;
+        if (!SEQLESS(seqhep[ci], h)) break; /* in order */
+        seqhep[i] = seqhep[ci]; /* move child up */
+        i = ci;
+
+    }
+    seqhep[i] = h; /* place entry */
+
+}
+
+/*******************************************************************************
+
+Make heap space
+
+Makes sure the heap array has room for the given number of entries.
+
+*******************************************************************************/
+
+static void hepspc(int n)
 
-        p->next = seqlst; /* push onto list */
-        seqlst = p;
+{
+
+    int      s;
+    seqhrec* hp;
+
+    if (n > seqheps) { /* must expand */
+
+        s = seqheps ? seqheps : 256; /* find new size */
+        while (s < n) s *= 2;
+        hp = realloc(seqhep, sizeof(seqhrec)*s);
+        if (!hp) error("Out of memory");
+        seqhep = hp;
+        seqheps = s;
+
+    }
+
+}
+
+/*******************************************************************************
+
+Insert heap entry
+
+Inserts a message or synth file play to the heap at the given deadline.
+
+*******************************************************************************/
+
+static void hepins(long long t, pa_seqptr sp, synplyptr pl)
+
+{
+
+    hepspc(seqhepn+1); /* make room */
+    seqhep[seqhepn].time = t;
+    seqhep[seqhepn].ser = seqser++;
+    seqhep[seqhepn].sp = sp;
+    seqhep[seqhepn].pl = pl;
+    seqhepn++;
+    hepup(seqhepn-1);
+
+}
+
+/*******************************************************************************
+
+Delete heap entry
+
+Removes the heap entry at the given index.
+
+*******************************************************************************/
+
+static void hepdel(int i)
+
+{
+
+    seqhepn--; /* remove */
+    if (i < seqhepn) { /* move last to gap and reorder */
+
+        seqhep[i] = seqhep[seqhepn];
+        hepdown(i);
+        hepup(i);
+
+    }
+
+}
+
+/*******************************************************************************
+
+Transfer sequencer intake
+
+Takes all messages from the intake stack and places them in the heap. The
+intake holds messages newest first, so the list is reversed to number them in
+the order they were sent. Message times are from the sequencer start.
+
+If there are more new messages than are in the heap already, they are added to
+the end and the whole heap rebuilt, which is faster than inserting each one.
+This happens when a whole track is sent.
+
+New synth file plays are taken from their own intake and placed in the heap at
+the time of their first event.
+
+Must be called with the sequencer lock held.
+
+*******************************************************************************/
+
+static void xfrseq(void)
+
+{
+
+    pa_seqptr p, lp, np;
+    synplyptr pl, npl;
+    long long st;
+    int       n, i;
 
-    } else { /* must search list */
+    /* take new plays */
+    pl = __atomic_exchange_n(&plyinq, NULL, __ATOMIC_ACQUIRE);
+    while (pl) {
 
-        lp = seqlst; /* index top of list */
-        while (p->time >= lp->time && lp->next) {
+        npl = pl->next;
+        pl->next = plylst; /* link to active plays */
+        plylst = pl;
+        hepins(pl->start+(long long)pl->tbl->time[0]*100000, NULL, pl);
+        pl = npl;
 
-            /* skip to key entry or end */
-            l = lp; /* set last */
-            lp = lp->next; /* index next */
+    }
+
+    /* take the whole intake */
+    p = __atomic_exchange_n(&seqinq, NULL, __ATOMIC_ACQUIRE);
+    lp = NULL; /* reverse the list and count it */
+    n = 0;
+    while (p) {
+
+        np = p->next;
+        p->next = lp;
+        lp = p;
+        p = np;
+        n++;
+
+    }
+    if (n) { /* there are new messages */
+
+        hepspc(seqhepn+n); /* make room */
+        i = seqhepn; /* save start of new */
+        st = timns(&strtim); /* find sequencer start */
+        while (lp) { /* place new messages at end */
+
+            seqhep[seqhepn].time = st+(long long)lp->time*100000;
+            seqhep[seqhepn].ser = seqser++;
+            seqhep[seqhepn].sp = lp;
+            seqhep[seqhepn].pl = NULL;
+            seqhepn++;
+            lp = lp->next;
 
         }
-        if (p->time < lp->time) { /* insert here */
+        /* rebuild or insert each */
+        if (n > i) for (i = seqhepn/2-1; i >= 0; i--) hepdown(i);
+        else for (; i < seqhepn; i++) hepup(i);
+
+    }
+
+}
+
+/*******************************************************************************
+
+Remove top heap entry
+
+Removes and returns the earliest message in the heap.
 
-            l->next = p; /* link last to this */
-            p->next = lp; /* link this to next */
+*******************************************************************************/
+
+static pa_seqptr hepget(void)
+
+{
+
+    pa_seqptr p;
+
+    p = seqhep[0].sp; /* get top */
+    seqhepn--; /* remove */
+    if (seqhepn) { /* move last to top and reorder */
+
+        seqhep[0] = seqhep[seqhepn];
+        hepdown(0);
+
+    }
+
+    return (p);
+
+}
+
+/*******************************************************************************
+
+Set sequencer timer
+
+Sets the sequencer timer to go off at the deadline of the earliest entry in the
+heap, or stops it if the heap is empty.
+
+Must be called with the sequencer lock held.
+
+*******************************************************************************/
+
+static void seqtim(void)
+
+{
+
+    if (seqhepn) { /* start sequencer timer again */
+
+        /* set to go off at the deadline of the next entry */
+        settim(seqhan, seqhep[0].time);
+        seqact(TRUE); /* set sequencer timer active */
+
+    } else if (seqtimact) { /* stop the timer */
+
+        settim(seqhan, 0);
+        seqact(FALSE); /* set sequencer timer inactive */
+
+    }
+
+}
+
+/*******************************************************************************
 
-        } else { /* insert after */
+Insert sequencer message list
 
-            p->next = lp->next;
-            lp->next = p;
+Sends a list of messages to the sequencer. The list is given by its first and
+last entries, and is in the order sent.
+
+The messages are pushed onto the intake stack without locking, so that any
+number of threads can send messages without waiting on the sequencer thread.
+The whole list goes on in one operation. Since the intake is kept newest first,
+the list is reversed as it is pushed. If the intake was empty, the sequencer
+thread is signaled to take it. Otherwise it has already been signaled, and
+will take these messages with the others.
+
+*******************************************************************************/
+
+static void insseqlst(pa_seqptr p)
+
+{
+
+    pa_seqptr fp, lp, np, op;
+    uint64_t  v;
+
+    fp = NULL; /* reverse the list */
+    lp = p; /* the first entry becomes the last */
+    while (p) {
+
+        np = p->next;
+        p->next = fp;
+        fp = p;
+        p = np;
+
+    }
+    if (fp) { /* list not empty */
+
+        op = __atomic_load_n(&seqinq, __ATOMIC_RELAXED);
+        do { lp->next = op; } /* link to intake and push */
+        while (!__atomic_compare_exchange_n(&seqinq, &op, fp, TRUE,
+                                            __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+        if (!op) { /* intake was empty, signal sequencer thread */
+
+            v = 1;
+            write(seqevt, &v, sizeof(uint64_t));
 
         }
 
     }
-    pthread_mutex_unlock(&seqlock); /* release lock */
+
+}
+
+/*******************************************************************************
+
+Insert sequencer message
+
+Sends a single message to the sequencer.
+
+*******************************************************************************/
+
+static void insseq(pa_seqptr p)
+
+{
+
+    p->next = NULL; /* make single entry list */
+    insseqlst(p);
 
 }
 
@@ -1078,7 +1687,7 @@ static void ctlchg(int p, pa_channel c, int cn, int v)
 {
 
     /* construct midi message */
-    midimsg3(alsamidiout[p-1]->midi, MESS_CTRL_CHG+(c-1), cn, v);
+    midimsg(alsamidiout[p-1], 3, MESS_CTRL_CHG+(c-1), cn, v);
 
 }
 
@@ -1101,16 +1710,16 @@ void _pa_excseq(int p, pa_seqptr sp)
     switch (sp->st) { /* sequencer message type */
 
         case st_noteon:
-            midimsg3(alsamidiout[sp->port-1]->midi, MESS_NOTE_ON+(sp->ntc-1),
-                     sp->ntn-1, sp->ntv/0x01000000);
+            midimsg(alsamidiout[sp->port-1], 3, MESS_NOTE_ON+(sp->ntc-1),
+                    sp->ntn-1, sp->ntv/0x01000000);
             break;
         case st_noteoff:
-            midimsg3(alsamidiout[sp->port-1]->midi, MESS_NOTE_OFF+(sp->ntc-1),
-                     sp->ntn-1, sp->ntv/0x01000000);
+            midimsg(alsamidiout[sp->port-1], 3, MESS_NOTE_OFF+(sp->ntc-1),
+                    sp->ntn-1, sp->ntv/0x01000000);
             break;
         case st_instchange:
-            midimsg2(alsamidiout[sp->port-1]->midi, MESS_PGM_CHG+(sp->icc-1),
-                     sp->ici-1);
+            midimsg(alsamidiout[sp->port-1], 2, MESS_PGM_CHG+(sp->icc-1),
+                    sp->ici-1, 0);
             break;
         case st_attack: ctlchg(sp->port, sp->vsc, CTLR_SOUND_ATTACK_TIME,
                                sp->vsv/0x01000000);
@@ -1169,18 +1778,18 @@ void _pa_excseq(int p, pa_seqptr sp)
             ctlchg(sp->port, sp->vsc, CTLR_PHASER_LEVEL, sp->vsv/0x01000000);
             break;
         case st_aftertouch:
-            midimsg3(alsamidiout[sp->port-1]->midi, MESS_AFTTCH+(sp->ntc-1),
-                     sp->ntn-1, sp->ntv/0x01000000);
+            midimsg(alsamidiout[sp->port-1], 3, MESS_AFTTCH+(sp->ntc-1),
+                    sp->ntn-1, sp->ntv/0x01000000);
             break;
         case st_pressure:
-            midimsg2(alsamidiout[sp->port-1]->midi, MESS_CHN_PRES+(sp->ntc-1),
-                     sp->ntv/0x01000000);
+            midimsg(alsamidiout[sp->port-1], 2, MESS_CHN_PRES+(sp->ntc-1),
+                    sp->ntv/0x01000000, 0);
             break;
         case st_pitch:
             pt = sp->vsv/0x00040000+0x2000; /* reduce to 14 bits, positive only */
             /* construct midi message */
-            midimsg3(alsamidiout[sp->port-1]->midi, MESS_PTCH_WHL+(sp->vsc-1),
-                     pt & 0x7f, pt/0x80);
+            midimsg(alsamidiout[sp->port-1], 3, MESS_PTCH_WHL+(sp->vsc-1),
+                    pt & 0x7f, pt/0x80);
             break;
         case st_pitchrange:
             /* set up data entry */
@@ -1208,7 +1817,7 @@ void _pa_excseq(int p, pa_seqptr sp)
             alsaplaywave_kickoff(sp->port, sp->wt);
             break;
         case st_volwave:
-            /* not implemented at present */
+            wavmix[sp->port-1].vol = sp->wv; /* set volume for new plays */
             break;
 
     }
@@ -1453,7 +2062,9 @@ static void inpseq(int p, pa_seqptr sp)
 
 Open ALSA MIDI output device
 
-Opens an ALSA MIDI output port for use.
+Opens an ALSA MIDI output port for use. The port is not opened in sync mode,
+since that waits for each write to be sent out on the line. Output is only
+drained when the port is closed.
 
 *******************************************************************************/
 
@@ -1464,8 +2075,10 @@ static void openalsamidiout(int p)
     int r;
 
     r = snd_rawmidi_open(NULL, &alsamidiout[p-1]->midi, alsamidiout[p-1]->name,
-                         SND_RAWMIDI_SYNC);
+                         0);
     if (r < 0) alsaerror(r);
+    alsamidiout[p-1]->olen = 0; /* set output empty */
+    alsamidiout[p-1]->osts = 0; /* set no running status */
 
 }
 
@@ -1492,6 +2105,10 @@ static void closealsamidiout(int p)
     for (c = 1; c <= 16; c++) ctlchg(p, c, CTLR_ALL_NOTES_OFF, 0);
     /* send all sound off to all channels */
     for (c = 1; c <= 16; c++) ctlchg(p, c, CTLR_ALL_SOUND_OFF, 0);
+    pthread_mutex_lock(&alsamidiout[p-1]->olck);
+    midfls(alsamidiout[p-1]); /* write out anything batched */
+    pthread_mutex_unlock(&alsamidiout[p-1]->olck);
+    snd_rawmidi_drain(alsamidiout[p-1]->midi); /* wait for it to be sent */
     snd_rawmidi_close(alsamidiout[p-1]->midi); /* close port */
 
 }
@@ -1564,6 +2181,7 @@ static void closealsapcmout(int p)
 
 {
 
+    snd_pcm_drain(alsapcmout[p-1]->pcm); /* play out remaining output */
     snd_pcm_close(alsapcmout[p-1]->pcm); /* close port */
 
 }
@@ -1673,7 +2291,7 @@ static void wralsapcmout(int p, byte* buff, int len)
         alsapcmout[p-1]->fmt = params2alsa(alsapcmout[p-1]);
         r = snd_pcm_set_params(alsapcmout[p-1]->pcm, alsapcmout[p-1]->fmt,
                                SND_PCM_ACCESS_RW_INTERLEAVED, alsapcmout[p-1]->chan,
-                               alsapcmout[p-1]->rate, 1, 500000);
+                               alsapcmout[p-1]->rate, 1, alsapcmout[p-1]->lat);
         if (r < 0) alsaerror(r);
         /* find size of sample */
         bytes = alsapcmout[p-1]->bits/8; /* find bytes per */
@@ -1687,8 +2305,11 @@ static void wralsapcmout(int p, byte* buff, int len)
     if (r == -EPIPE) {
         /* uncomment next for a broken pipe diagnostic */
         /* printf("Recovered from output error\n"); */
-        snd_pcm_recover(alsapcmin[p-1]->pcm, r, 1);
-    } else if (r < 0) alsaerror(r);
+        snd_pcm_recover(alsapcmout[p-1]->pcm, r, 1);
+        /* output ran dry, write again to restart */
+        r = snd_pcm_writei(alsapcmout[p-1]->pcm, buff, len);
+    }
+    if (r < 0) alsaerror(r);
 
 }
 
@@ -1986,7 +2607,10 @@ static void wrtseq(pa_seqptr sp)
 
 {
 
-    alsamidiout[sp->port-1]->wrseq(sp->port, sp);
+    /* wave entries are for wave ports, and are executed here */
+    if (sp->st == st_playwave) alsaplaywave_kickoff(sp->port, sp->wt);
+    else if (sp->st == st_volwave) wavmix[sp->port-1].vol = sp->wv;
+    else alsamidiout[sp->port-1]->wrseq(sp->port, sp);
 
 }
 
@@ -2085,6 +2709,11 @@ void _pa_synthoutplug(
     strcpy(alsamidiout[p]->name, name);
     alsamidiout[p]->last = 0; /* clear last byte */
     alsamidiout[p]->pback = -1; /* set no pushback */
+    alsamidiout[p]->olen = 0; /* set no midi output */
+    alsamidiout[p]->osts = 0;
+    alsamidiout[p]->otim = 0;
+    alsamidiout[p]->opnd = FALSE;
+    pthread_mutex_init(&alsamidiout[p]->olck, NULL);
     alsamidiout[p]->open = open; /* set open alsa midi device */
     alsamidiout[p]->close = close; /* set close alsa midi device */
     alsamidiout[p]->wrseq = wrseq; /* set sequencer execute function */
@@ -2219,6 +2848,17 @@ void _pa_waveoutplug(
     alsapcmout[p]->setparam = setparam; /* set parameter */
     alsapcmout[p]->getparam = getparam; /* get parameter */
     alsapcmout[p]->devopn = FALSE; /* set not open */
+    alsapcmout[p]->chan = 2; /* set default format until set */
+    alsapcmout[p]->rate = MIXRATE;
+    alsapcmout[p]->bits = 16;
+    alsapcmout[p]->sgn = TRUE;
+    alsapcmout[p]->flt = FALSE;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    alsapcmout[p]->big = TRUE;
+#else
+    alsapcmout[p]->big = FALSE;
+#endif
+    alsapcmout[p]->lat = WAVLAT;
     alsapcmoutnum++; /* count total devices */
 
 
@@ -2318,6 +2958,13 @@ snd_rawmidi_t* _pa_getsythouthdl(int p)
     if (!alsamidiout[p-1])
         error("No synth output device defined at logical number");
 
+    /* the caller may write to the port directly, so write out what we have,
+       and start over with running status */
+    pthread_mutex_lock(&alsamidiout[p-1]->olck);
+    midfls(alsamidiout[p-1]);
+    alsamidiout[p-1]->osts = 0;
+    pthread_mutex_unlock(&alsamidiout[p-1]->olck);
+
     return (alsamidiout[p-1]->midi);
 
 }
@@ -2410,19 +3057,30 @@ snd_pcm_t* _pa_getwaveinhdl(int p)
 
 Timer thread
 
-Called when the windows event timer expires, we first check if the sequencer
-is still running. If not, we do nothing, because we may have been called
-while the sequencer is being shut down. If it is running, we then take all
-messages off the top of the queue that have become due. Timer overruns are
+Called when the sequencer timer expires, we move any newly sent messages and
+synth file plays from the intake into the queue, and take all entries off the
+top of the queue that have become due. Timer overruns are
 handled by executing all past due events, on the idea that things like volume
 changes, etc, need to be performed to stay in sync. If notes are past due,
 this will cause "note scramble" for a short time, and we might have to improve
 this.
 
-After all due messages are cleared, if the queue still has active messages,
-then another timer is set for that new top message. This keeps the queue moving
+A due synth file play sends all of its events that are due, then goes back into
+the queue at the time of its next event, or ends if it has none. All of the
+plays and the sequenced messages share the one queue and timer, so the number
+of threads and timer wakeups does not go up with the number of plays.
+
+The MIDI output of all the entries that come due together is batched, and
+written out in one go for each port when they are done.
+
+After all due entries are cleared, if the queue still has active entries,
+then another timer is set for that new top entry. This keeps the queue moving
 until clear.
 
+The thread is woken either by the timer, or by the intake event when messages
+or plays are sent to an empty intake. Executed messages are freed together
+after the sequencer lock is released.
+
 *******************************************************************************/
 
 static void* sequencer_thread(void* data)
@@ -2430,10 +3088,10 @@ static void* sequencer_thread(void* data)
 {
 
     pa_seqptr p;             /* message entry pointer */
-    int    elap;          /* elapsed time */
-    struct itimerspec ts; /* timer data */
+    pa_seqptr fl;            /* list of executed entries */
+    synplyptr pl;            /* synth file play */
+    long long now;           /* current time in nanoseconds */
     uint64_t   exp;      /* timer expiration time */
-    long tl;
     int r;
 
     while (1) { /* until thread cancelled */
@@ -2444,53 +3102,52 @@ static void* sequencer_thread(void* data)
         /* if error, the input set won't be modified and thus will appear as
            if they were active. We clear them in this case */
         if (r < 0) FD_ZERO(&ifdsets);
-        if (FD_ISSET(seqhan, &ifdsets)) {
+        /* clear the timer and intake event by reading them */
+        if (FD_ISSET(seqhan, &ifdsets)) read(seqhan, &exp, sizeof(uint64_t));
+        if (FD_ISSET(seqevt, &ifdsets)) read(seqevt, &exp, sizeof(uint64_t));
+        if (FD_ISSET(seqhan, &ifdsets) || FD_ISSET(seqevt, &ifdsets)) {
 
-            /* the sequencer timer went off */
-            if (seqrun) { /* sequencer is still running */
+            /* the sequencer timer went off, or there are new entries */
+            fl = NULL; /* clear executed list */
+            pthread_mutex_lock(&seqlock); /* take sequencer data lock */
+            xfrseq(); /* take new entries */
+            midbat = TRUE; /* batch midi output of the due entries */
+            now = timns(NULL); /* find current time */
+            /* process all past due entries */
+            while (seqhepn && seqhep[0].time <= now) {
 
-                /* clear the timer by reading it */
-                read(seqhan, &exp, sizeof(uint64_t));
-                pthread_mutex_lock(&seqlock); /* take sequencer data lock */
-                p = seqlst; /* index top of list */
-                elap = timediff(&strtim); /* find elapsed time since seq start */
-                while (p) { /* process all past due messages */
+                pl = seqhep[0].pl;
+                if (pl) { /* synth file play */
 
-                    if (p->time <= elap) { /* execute this message */
+                    plyrun(pl, now); /* send due events */
+                    if (pl->cur < pl->tbl->num) {
 
-                        seqlst = seqlst->next; /* gap out */
-                        wrtseq(p); /* execute it */
-                        putseq(p); /* release entry */
-                        p = seqlst; /* index top of list again */
+                        /* requeue at next event */
+                        seqhep[0].time = pl->start+(long long)pl->tbl->time[pl->cur]*100000;
+                        seqhep[0].ser = seqser++;
+                        hepdown(0);
 
-                    } else p = NULL; /* stop search */
+                    } else { /* play is done */
 
-                }
-                if (seqlst) { /* start sequencer timer again */
-
-                    tl = seqlst->time-elap; /* set next time to run */
-                    ts.it_value.tv_sec = tl/10000; /* set number of seconds to run */
-                    ts.it_value.tv_nsec = tl%10000*100000; /* set number of nanoseconds to run */
-                    ts.it_interval.tv_sec = 0; /* set does not rerun */
-                    ts.it_interval.tv_nsec = 0;
-                    timerfd_settime(seqhan, 0, &ts, NULL);
-                    seqtimact = TRUE; /* set sequencer timer active */
-
-                } else seqtimact = FALSE; /* set sequencer timer inactive */
-                pthread_mutex_unlock(&seqlock);
-                if (!seqtimact) { /* must have gone inactive above */
-
-                    /* count active sequencer instances */
-                    pthread_mutex_lock(&snmlck);
-                    numseq--; /* count active */
-                    /* if now zero, signal zero crossing */
-                    if (!numseq) pthread_cond_signal(&snmzer);
-                    pthread_mutex_unlock(&snmlck); /* release lock */
-                    if (numseq < 0) error("Wave locking imbalance");
+                        hepget(); /* remove top */
+                        plyend(pl);
+
+                    }
+
+                } else {
+
+                    p = hepget(); /* remove top */
+                    wrtseq(p); /* execute it */
+                    p->next = fl; /* save to release */
+                    fl = p;
 
                 }
 
             }
+            midflsbat(); /* write out the batched midi output */
+            seqtim(); /* set timer for next entry */
+            pthread_mutex_unlock(&seqlock);
+            putseqlst(fl); /* release executed entries */
 
         }
 
@@ -2590,11 +3247,11 @@ they are either:
 
 3. Buffered and scheduled to be set out at the correct time.
 
-We mark sequencer start by recording the start base time, which is the
-windows free running time that all sequencer times will be measured from.
-That counter is 32 bits unsigned millisecond, which gives 49.71 days. We
-take half that, because we store as signed, so we are 24.855 days full
-sequencer time.
+We mark sequencer start by recording the start base time on the monotonic
+clock, which all sequencer times will be measured from. Each event is timed as
+an absolute deadline from that base, so timing does not drift over a long
+sequence, and setting the time of day has no effect. Sequencer times are
+signed counts of 100us, which gives 59.65 hours of full sequencer time.
 
 Note that there will be no sequencer events, because we don't allow them to
 be set without the sequencer running. The first event will be kicked off by
@@ -2606,7 +3263,7 @@ void pa_starttimeout(void)
 
 {
 
-    gettimeofday(&strtim, NULL); /* get current time */
+    clock_gettime(CLOCK_MONOTONIC, &strtim); /* get current time */
     seqrun = TRUE; /* set sequencer running */
 
 }
@@ -2618,7 +3275,8 @@ Stop time output
 Stops midi sequencer function. Any timers and buffers in use by the sequencer
 are cleared, and all pending events dropped.
 
-Note that this does not stop any midi files from being sequenced.
+Note that this does not stop any midi files from being sequenced. Their plays
+stay in the queue, and the timer is kept running for them.
 
 *******************************************************************************/
 
@@ -2627,33 +3285,27 @@ void pa_stoptimeout(void)
 {
 
     pa_seqptr p; /* message pointer */
-    struct itimerspec ts;
+    int i, n;
 
+    pthread_mutex_lock(&seqlock); /* take sequencer data lock */
+    /* now clear all pending events */
+    xfrseq(); /* take any still in the intake */
     strtim.tv_sec = 0; /* clear start time */
-    strtim.tv_usec = 0;
+    strtim.tv_nsec = 0;
     seqrun = FALSE; /* set sequencer not running */
-    /* if there is a pending sequencer timer, kill it */
-    if (seqtimact) {
-
-        /* set timer run time to zero to kill it */
-        ts.it_value.tv_sec = 0;
-        ts.it_value.tv_nsec = 0;
-        ts.it_interval.tv_sec = 0;
-        ts.it_interval.tv_nsec = 0;
-        timerfd_settime(seqhan, 0, &ts, NULL);
-        seqtimact = FALSE; /* set sequencer timer inactive */
-
-    }
-    /* now clear all pending events */
-    pthread_mutex_lock(&seqlock); /* take sequencer data lock */
-    while (seqlst) { /* clear */
+    p = NULL;
+    n = 0; /* keep only the plays */
+    for (i = 0; i < seqhepn; i++) {
 
-        p = seqlst; /* index top of list */
-        seqlst = seqlst->next; /* gap out */
-        putseq(p); /* release entry */
+        if (seqhep[i].sp) { seqhep[i].sp->next = p; p = seqhep[i].sp; }
+        else seqhep[n++] = seqhep[i];
 
     }
+    seqhepn = n;
+    for (i = seqhepn/2-1; i >= 0; i--) hepdown(i); /* reorder */
+    seqtim(); /* reset or kill the sequencer timer */
     pthread_mutex_unlock(&seqlock); /* drop lock */
+    putseqlst(p); /* release entries */
 
 }
 
@@ -2691,7 +3343,7 @@ void pa_starttimein(void)
 
 {
 
-    gettimeofday(&sintim, NULL); /* get current time */
+    clock_gettime(CLOCK_MONOTONIC, &sintim); /* get current time */
     sinrun = TRUE; /* set sequencer running */
 
 }
@@ -2781,7 +3433,6 @@ void pa_noteon(int p, int t, pa_channel c, pa_note n, int v)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -2834,7 +3485,6 @@ void pa_noteoff(int p, int t, pa_channel c, pa_note n, int v)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -2883,7 +3533,6 @@ void pa_instchange(int p, int t, pa_channel c, pa_instrument i)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -2930,7 +3579,6 @@ void pa_attack(int p, int t, pa_channel c, int at)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -2977,7 +3625,6 @@ void pa_release(int p, int t, pa_channel c, int rt)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3023,7 +3670,6 @@ void pa_legato(int p, int t, pa_channel c, int b)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3069,7 +3715,6 @@ void pa_portamento(int p, int t, pa_channel c, int b)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3115,7 +3760,6 @@ void pa_volsynthchan(int p, int t, pa_channel c, int v)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3162,7 +3806,6 @@ void pa_balance(int p, int t, pa_channel c, int b)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3208,7 +3851,6 @@ void pa_porttime(int p, int t, pa_channel c, int v)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3254,7 +3896,6 @@ void pa_vibrato(int p, int t, pa_channel c, int v)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3301,7 +3942,6 @@ void pa_pan(int p, int t, pa_channel c, int b)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3347,7 +3987,6 @@ void pa_timbre(int p, int t, pa_channel c, int tb)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3393,7 +4032,6 @@ void pa_brightness(int p, int t, pa_channel c, int b)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
    }
 
@@ -3439,7 +4077,6 @@ void pa_reverb(int p, int t, pa_channel c, int r)
        /* check sequencer running */
        if (!seqrun) error("Sequencer not running");
        insseq(sp); /* insert to sequencer list */
-       acttim(); /* kick timer if needed */
 
     }
 
@@ -3485,7 +4122,6 @@ void pa_tremulo(int p, int t, pa_channel c, int tr)
         /* check sequencer running */
        if (!seqrun) error("Sequencer not running");
        insseq(sp); /* insert to sequencer list */
-       acttim(); /* kick timer if needed */
 
     }
 
@@ -3531,7 +4167,6 @@ void pa_chorus(int p, int t, pa_channel c, int cr)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3577,7 +4212,6 @@ void pa_celeste(int p, int t, pa_channel c, int ce)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3623,7 +4257,6 @@ void pa_phaser(int p, int t, pa_channel c, int ph)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3673,7 +4306,6 @@ void pa_pitchrange(int p, int t, pa_channel c, int v)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3722,7 +4354,6 @@ void pa_mono(int p, int t, pa_channel c, int ch)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3767,7 +4398,6 @@ void pa_poly(int p, int t, pa_channel c)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3815,7 +4445,6 @@ void pa_aftertouch(int p, int t, pa_channel c, pa_note n, int at)
        /* check sequencer running */
        if (!seqrun) error("Sequencer not running");
        insseq(sp); /* insert to sequencer list */
-       acttim(); /* kick timer if needed */
 
     }
 
@@ -3861,7 +4490,6 @@ void pa_pressure(int p, int t, pa_channel c, int pr)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3910,7 +4538,6 @@ void pa_pitch(int p, int t, pa_channel c, int pt)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -3918,455 +4545,649 @@ void pa_pitch(int p, int t, pa_channel c, int pt)
 
 /*******************************************************************************
 
-Play ALSA midi file
+Form sequencer message from synth event
 
-Plays the given ALSA midi file given the filename.
+Fills in a sequencer message from an entry in a synth event table, for the
+given port.
 
 *******************************************************************************/
 
-static void *alsaplaymidi(void* data)
+static void synmsg(syntblptr tbl, int i, int p, pa_seqptr sp)
 
 {
 
-    int               curtim;  /* current time in 100us */
-    int               qnote;   /* number of 100us/quarter note */
-    pa_seqptr         sp;      /* sequencer entry */
-    pa_seqptr         seqlst;  /* sorted sequencer list */
-    int               tfd;     /* timer file descriptor */
-    struct itimerspec ts;      /* timer data */
-    uint64_t          exp;     /* timer expire value */
-    struct timeval    strtim;  /* start time for sequencer */
-    portidptr         pip;     /* pointer for data we need */
-    int               s;       /* synthesizer file instance */
-    int               p;       /* port */
-    long              tl;
+    sp->port = p; /* set port */
+    sp->time = tbl->time[i]; /* set time */
+    sp->st = tbl->st[i]; /* set type */
+    switch (sp->st) {
 
-    pip = (portidptr) data; /* get data pointer */
-    s = pip->id; /* get id */
-    p = pip->port; /* get port */
-    pthread_mutex_lock(&synlck); /* take wave table lock */
-    seqlst = syntab[s]; /* get the existing entry */
-    pthread_mutex_unlock(&synlck); /* release lock */
-    if (!seqlst) return (NULL); /* entry is empty, abort */
+        case st_noteon:
+        case st_noteoff:
+        case st_aftertouch:
+        case st_pressure:
+            sp->ntc = tbl->chan[i]; /* set channel */
+            sp->ntn = tbl->key[i]; /* set note */
+            sp->ntv = tbl->val[i]; /* set velocity/pressure */
+            break;
+        case st_instchange:
+            sp->icc = tbl->chan[i]; /* set channel */
+            sp->ici = tbl->key[i]; /* set instrument */
+            break;
+        case st_poly:
+            sp->pc = tbl->chan[i]; /* set channel */
+            break;
+        default: /* st_pitch, st_mono */
+            sp->vsc = tbl->chan[i]; /* set channel */
+            sp->vsv = tbl->val[i]; /* set value */
+            break;
 
-    /* count active sequence instances */
-    pthread_mutex_lock(&snmlck);
-    numseq++; /* count active */
-    numsql[s]++;
-    pthread_mutex_unlock(&snmlck); /* release lock */
+    }
 
-    /* sequence and destroy the master list */
-    tfd = timerfd_create(CLOCK_REALTIME, 0); /* create timer */
-    gettimeofday(&strtim, NULL); /* get current time */
-    while (seqlst) {
+}
 
-        curtim = timediff(&strtim); /* find elapsed time since seq start */
-        tl = seqlst->time-curtim; /* set next time to run */
-        /* check event still is in the future */
-        if (tl > 0) {
+/*******************************************************************************
 
-            ts.it_value.tv_sec = tl/10000; /* set number of seconds to run */
-            ts.it_value.tv_nsec = tl%10000*100000; /* set number of nanoseconds to run */
-            ts.it_interval.tv_sec = 0; /* set does not rerun */
-            ts.it_interval.tv_nsec = 0;
-            timerfd_settime(tfd, 0, &ts, NULL);
-            read(tfd, &exp, sizeof(uint64_t)); /* wait for timer expire */
+Track notes of synth file play
 
-        }
-        /* Change the port to be the one requested. In this case we are treating
-           the sequencer list to be a form to be applied to any port */
-        seqlst->port = p;
-        wrtseq(seqlst); /* execute top entry */
-        seqlst = seqlst->next;
+Keeps the set of notes a play has sounding, so that they can be turned off if
+the play is stopped or paused.
 
-    }
-    close(tfd); /* release the timer */
+*******************************************************************************/
 
-    /* count active sequencer instances */
-    pthread_mutex_lock(&snmlck);
-    numseq--; /* count active */
-    numsql[s]--;
-    /* if now zero, signal zero crossing */
-    if (!numseq) pthread_cond_signal(&snmzer);
-    pthread_mutex_unlock(&snmlck); /* release lock */
-    if (numseq < 0) error("Sequencer locking imbalance");
-    free(pip); /* release data pointer */
+static void plynot(synplyptr pl, pa_seqptr sp)
 
-    return (NULL);
+{
+
+    unsigned int* w; /* word for note */
+    unsigned int  b; /* bit for note */
+
+    if (sp->st == st_noteon || sp->st == st_noteoff) {
+
+        w = &pl->non[(sp->ntc-1)&15][((sp->ntn-1)>>5)&3];
+        b = 1u<<((sp->ntn-1)&31);
+        if (sp->st == st_noteon && sp->ntv) *w |= b; /* note on */
+        else *w &= ~b; /* note off */
+
+    }
 
 }
 
 /*******************************************************************************
 
-Play ALSA synth file kickoff routine
+Silence synth file play
 
-Plays an ALSA .mid file. This is the kickoff routine. We play .mid files on a
-thread, and this routine spawns a thread to accomplish that. The thread is
-"set and forget", in that it self terminates when the play routine terminates.
+Sends note offs for all the notes a play has sounding.
 
 *******************************************************************************/
 
-void alsaplaysynth_kickoff(int p, int s)
+static void plysil(synplyptr pl)
 
 {
 
-    pthread_t tid; /* thread id (unused) */
-    portidptr pip; /* port/id structure */
+    pa_seqmsg msg; /* message for note off */
+    int       c, n;
+
+    for (c = 0; c < 16; c++) for (n = 0; n < 128; n++) {
+
+        if (pl->non[c][n>>5] & 1u<<(n&31)) { /* note is on */
+
+            msg.port = pl->port; /* set port */
+            msg.time = 0;
+            msg.st = st_noteoff; /* set type */
+            msg.ntc = c+1; /* set channel */
+            msg.ntn = n+1; /* set note */
+            msg.ntv = 0; /* set velocity */
+            wrtseq(&msg);
 
-    pip = malloc(sizeof(portid)); /* get a port/id structure */
-    pip->port = p; /* place port */
-    pip->id = s; /* place synth file id */
-    pthread_create(&tid, NULL, alsaplaymidi, (void*)pip);
+        }
+
+    }
+    memset(pl->non, 0, sizeof(pl->non)); /* clear notes */
 
 }
 
 /*******************************************************************************
 
-Load synthesizer file
+Run synth file play
 
-Loads a synthesizer control file, usually midi format, into a logical cache,
-from 1 to N. These are loaded up into memory for minimum latency. The file is
-specified by file name, and the file type is system dependent.
+Sends all of the events of a play that are due at the given time, on the
+monotonic clock in nanoseconds, and moves its cursor past them.
 
-Note that we support 100 synth files loaded, but the Petit-ami "rule of thumb"
-is no more than 10 synth files at a time.
+Called with the sequencer lock held.
 
 *******************************************************************************/
 
-static byte readbyt(FILE* fh)
+static void plyrun(synplyptr pl, long long t)
 
 {
 
-    byte b;
-    int v;
+    pa_seqmsg msg; /* message for event */
 
-    v = getc(fh);
-    if (v == EOF) error("Invalid .mid file format");
-    b = v;
-/* All but the header reads call this routine, so uncommenting this print will
-   give a good diagnostic for data reads */
-/*
-printf("@%ld: byte: %2.2x\n", ftell(fh), b);
-*/
+    while (pl->cur < pl->tbl->num &&
+           pl->start+(long long)pl->tbl->time[pl->cur]*100000 <= t) {
+
+        /* form the message for the port of the play and execute it. The event
+           table is a form to be applied to any port */
+        synmsg(pl->tbl, pl->cur, pl->port, &msg);
+        plynot(pl, &msg);
+        wrtseq(&msg);
+        pl->cur++;
 
-    return (b);
+    }
 
 }
 
-static int readvar(FILE* fh, unsigned int* v)
+/*******************************************************************************
 
-{
+End synth file play
 
-    byte b;
-    int cnt;
+Removes a play from the active plays, counts it down, and frees it. The play
+must already be out of the heap.
 
-    *v = 0;
-    cnt = 0;
-    do {
+Called with the sequencer lock held.
 
-        b = readbyt(fh); /* get next part */
-        cnt++;
-        *v = *v<<7|(b&0x7f); /* shift and place new value */
+*******************************************************************************/
 
-    } while (b >= 128);
+static void plyend(synplyptr pl)
 
-    return (cnt);
+{
 
-}
+    synplyptr* lp; /* link to play */
 
-static void prttxt(FILE* fh, unsigned int len)
+    for (lp = &plylst; *lp && *lp != pl; lp = &(*lp)->next);
+    if (*lp) *lp = pl->next; /* gap out of list */
 
-{
+    /* count active sequencer instances */
+    pthread_mutex_lock(&snmlck);
+    numseq--; /* count active */
+    numsql[pl->s-1]--;
+    /* if now zero, signal zero crossing */
+    if (!numseq) pthread_cond_signal(&snmzer);
+    pthread_mutex_unlock(&snmlck); /* release lock */
+    if (numseq < 0) error("Sequencer locking imbalance");
+    free(pl);
 
-    byte b;
+}
 
-    while (len) {
+/*******************************************************************************
 
-        b = readbyt(fh);
-        putchar(b);
-        len--;
+Control synth file plays
 
-    }
+Stops, pauses or resumes the plays on a port of the given logical synth file,
+or of all files if the file is 0. Stopped and paused plays have their sounding
+notes turned off. A paused play is taken out of the queue, and when resumed,
+continues from where it was paused. Paused plays still count as active, so
+pa_waitsynth() and pa_delsynth() wait until they are resumed and done.
 
-}
+*******************************************************************************/
 
-static int dcdmidi(FILE* fh, byte b, int* endtrk, int p, int t, int* qnote,
-                   pa_seqptr* rsp)
+static void plyctl(int p, int s, plyctlcod c)
 
 {
 
-    byte p1;
-    byte p2;
-    byte p3;
-    byte p4;
-    byte p5;
-    unsigned len;
-    int cnt;
-    pa_seqptr sp;
+    synplyptr pl, npl; /* play */
+    long long now;     /* current time */
+    int       i;
 
-    cnt = 0;
-    *endtrk = FALSE;
-    sp = NULL; /* clear sequencer entry */
-    switch (b>>4) { /* command nybble */
+    pthread_mutex_lock(&seqlock); /* take sequencer data lock */
+    xfrseq(); /* take any new plays */
+    midbat = TRUE; /* batch the note offs */
+    now = timns(NULL); /* find current time */
+    for (pl = plylst; pl; pl = npl) {
 
-        case 0x8: /* note off */
-                  p1 = readbyt(fh); cnt++;
-                  p2 = readbyt(fh); cnt++;
-                  getseq(&sp); /* get sequencer entry */
-                  sp->port = p; /* set port */
-                  sp->time = t; /* set time */
-                  sp->st = st_noteoff; /* set type */
-                  sp->ntc = (b&15)+1; /* set channel */
-                  sp->ntn = p1+1; /* set note */
-                  sp->ntv = p2*0x01000000; /* set velocity */
-                  break;
-        case 0x9: /* note on */
-                  p1 = readbyt(fh); cnt++;
-                  p2 = readbyt(fh); cnt++;
-                  getseq(&sp); /* get a sequencer message */
-                  sp->port = p; /* set port */
-                  sp->time = t; /* set time */
-                  sp->st = st_noteon; /* set type */
-                  sp->ntc = (b&15)+1; /* set channel */
-                  sp->ntn = p1+1; /* set note */
-                  sp->ntv = p2*0x01000000; /* set velocity */
-                  break;
-        case 0xa: /* polyphonic key pressure */
-                  p1 = readbyt(fh); cnt++;
-                  p2 = readbyt(fh); cnt++;
-                  getseq(&sp); /* get a sequencer message */
-                  sp->port = p; /* set port */
-                  sp->time = t; /* set time */
-                  sp->st = st_aftertouch; /* set type */
-                  sp->ntc = (b&15)+1; /* set channel */
-                  sp->ntn = p1+1; /* set note */
-                  sp->ntv = p2*0x01000000; /* set aftertouch */
-                  break;
-        case 0xb: /* controller change/channel mode */
-                  p1 = readbyt(fh); cnt++;
-                  p2 = readbyt(fh); cnt++;
-                  switch (p1) { /* channel mode messages */
+        npl = pl->next; /* save next, the play may be freed */
+        if (pl->port == p && (!s || pl->s == s)) {
 
-                      /* note we don't implement all controller messages */
-                      case CTLR_SOUND_ATTACK_TIME:
-                      case CTLR_SOUND_RELEASE_TIME:
-                      case CTLR_LEGATO_PEDAL:
-                      case CTLR_PORTAMENTO:
-                      case CTLR_VOLUME_COARSE:
-                      case CTLR_VOLUME_FINE:
-                      case CTLR_BALANCE_COARSE:
-                      case CTLR_BALANCE_FINE:
-                      case CTLR_PORTAMENTO_TIME_COARSE:
-                      case CTLR_PORTAMENTO_TIME_FINE:
-                      case CTLR_MODULATION_WHEEL_COARSE:
-                      case CTLR_MODULATION_WHEEL_FINE:
-                      case CTLR_PAN_POSITION_COARSE:
-                      case CTLR_PAN_POSITION_FINE:
-                      case CTLR_SOUND_TIMBRE:
-                      case CTLR_SOUND_BRIGHTNESS:
-                      case CTLR_EFFECTS_LEVEL:
-                      case CTLR_TREMULO_LEVEL:
-                      case CTLR_CHORUS_LEVEL:
-                      case CTLR_CELESTE_LEVEL:
-                      case CTLR_PHASER_LEVEL:
-                      case CTLR_REGISTERED_PARAMETER_COARSE:
-                      case CTLR_REGISTERED_PARAMETER_FINE:
-                      case CTLR_DATA_ENTRY_COARSE:
-                      case CTLR_DATA_ENTRY_FINE:
-                                 break;
+            if (c == pc_resume) {
 
-                      case CTLR_MONO_OPERATION: /* Mono mode on */
-                                 getseq(&sp); /* get a sequencer message */
-                                 sp->port = p; /* set port */
-                                 sp->time = t; /* set time */
-                                 sp->st = st_mono; /* set type */
-                                 sp->vsc = (b&15)+1; /* set channel */
-                                 sp->vsv = p2; /* set mono mode */
-                                 break;
-                      case CTLR_POLY_OPERATION: /* Poly mode on */
-                                 getseq(&sp); /* get a sequencer message */
-                                 sp->port = p; /* set port */
-                                 sp->time = t; /* set time */
-                                 sp->st = st_poly; /* set type */
-                                 sp->pc = (b&15)+1; /* set channel */
-                                 break;
+                if (pl->pause) { /* paused, shift start and requeue */
 
-                  }
-                  break;
-        case 0xc: /* program change */
-                  p1 = readbyt(fh); cnt++;
-                  getseq(&sp); /* get a sequencer message */
-                  sp->port = p; /* set port */
-                  sp->time = t; /* set time */
-                  sp->st = st_instchange; /* set type */
-                  sp->icc = (b&15)+1; /* set channel */
-                  sp->ici = p1+1; /* set instrument */
-                  break;
-        case 0xd: /* channel key pressure */
-                  p1 = readbyt(fh); cnt++;
-                  getseq(&sp); /* get a sequencer message */
-                  sp->port = p; /* set port */
-                  sp->time = t; /* set time */
-                  sp->st = st_pressure; /* set type */
-                  sp->ntc = (b&15)+1; /* set channel */
-                  sp->ntv = p1*0x01000000; /* set pressure */
-                  break;
-        case 0xe: /* pitch bend */
-                  p1 = readbyt(fh); cnt++;
-                  p2 = readbyt(fh); cnt++;
-                  getseq(&sp); /* get a sequencer message */
-                  sp->port = p; /* set port */
-                  sp->time = t; /* set time */
-                  sp->st = st_pitch; /* set type */
-                  sp->vsc = (b&15)+1; /* set channel */
-                  sp->vsv = p2<<7|p1; /* set pitch */
-                  break;
-        case 0xf: /* sysex/meta */
-                  switch (b) {
+                    pl->start += now-pl->pause;
+                    pl->pause = 0;
+                    hepins(pl->start+(long long)pl->tbl->time[pl->cur]*100000,
+                           NULL, pl);
 
-                      case 0xf0: /* F0 sysex event */
-                      case 0xf7: /* F7 sysex event */
-                                 cnt += readvar(fh, &len); /* get length */
-                                 fseek(fh, len, SEEK_CUR);
-                                 break;
-                      case 0xff: /* meta events */
-                                 p1 = readbyt(fh);  cnt++; /* get next byte */
-                                 cnt += readvar(fh, &len); /* get length */
-                                 switch (p1) {
+                }
 
-                                     case 0x2f: /* End of track */
-                                                if (len != 0) error("Meta event length does not match");
-                                                *endtrk = TRUE; /* set end of track */
-                                                break;
-                                     case 0x51: /* Set tempo */
-                                                if (len != 3) error("Meta event length does not match");
-                                                p1 = readbyt(fh); cnt++; /* get b1-b3 */
-                                                p2 = readbyt(fh); cnt++;
-                                                p3 = readbyt(fh); cnt++;
-                                                *qnote = (p1<<16|p2<<8|p3)/100;
-                                                break;
-                                     default:   /* unknown/other */
-                                                fseek(fh, len, SEEK_CUR);
-                                                break;
+            } else if (!pl->pause || c == pc_stop) {
 
-                                 }
-                                 break;
+                if (!pl->pause) { /* take out of queue */
 
-                      default: error("Invalid .mid file format");
+                    for (i = 0; i < seqhepn && seqhep[i].pl != pl; i++);
+                    if (i < seqhepn) hepdel(i);
 
-                  }
-                  break;
+                }
+                plysil(pl); /* turn off its notes */
+                if (c == pc_stop) plyend(pl);
+                else pl->pause = now;
 
-        default: error("Invalid .mid file format");
+            }
 
-    }
-    *rsp = sp; /* return sequencer entry (or NULL if none) */
+        }
 
-    return (cnt);
+    }
+    midflsbat(); /* write out the note offs */
+    seqtim(); /* set timer for the new top entry */
+    pthread_mutex_unlock(&seqlock);
 
 }
 
-unsigned int read16be(FILE* fh)
+/*******************************************************************************
 
-{
+Play ALSA synth file kickoff routine
 
-    byte b;
-    unsigned int v;
+Plays an ALSA .mid file. This is the kickoff routine. We start a play with its
+cursor at the first event of the file, and send it to the sequencer thread,
+which plays it along with all the other plays and sequenced messages. The
+play is "set and forget", in that it is freed when it completes.
 
-    v = readbyt(fh) << 8;
-    v |= readbyt(fh);
+*******************************************************************************/
 
-    return (v);
+void alsaplaysynth_kickoff(int p, int s)
 
-}
+{
 
-unsigned int read32be(FILE* fh)
+    syntblptr tbl; /* synth event table */
+    synplyptr pl;  /* play */
+    synplyptr op;  /* old intake */
+    uint64_t  v;
 
-{
+    if (s < 1 || s > MAXMIDT) return; /* bad logical file, abort */
+    /* get the entry and count it active under the table lock, so it can't be
+       deleted out from under us */
+    pthread_mutex_lock(&synlck); /* take synth table lock */
+    tbl = syntab[s-1]; /* get the existing entry */
+    if (tbl && tbl->num) {
 
-    byte b;
-    unsigned int v;
+        /* count active sequence instances */
+        pthread_mutex_lock(&snmlck);
+        numseq++; /* count active */
+        numsql[s-1]++;
+        pthread_mutex_unlock(&snmlck); /* release lock */
 
-    v = readbyt(fh) << 24;
-    v |= readbyt(fh) << 16;
-    v |= readbyt(fh) << 8;
-    v |= readbyt(fh);
+    }
+    pthread_mutex_unlock(&synlck); /* release lock */
+    if (!tbl || !tbl->num) return; /* entry is empty, abort */
+
+    pl = malloc(sizeof(synply)); /* get a play */
+    if (!pl) error("Out of memory");
+    pl->tbl = tbl;
+    pl->s = s;
+    pl->port = p;
+    pl->cur = 0; /* set at first event */
+    pl->start = timns(NULL); /* start now */
+    pl->pause = 0;
+    memset(pl->non, 0, sizeof(pl->non));
+
+    /* push to the play intake, and signal the sequencer if it was empty */
+    op = __atomic_load_n(&plyinq, __ATOMIC_RELAXED);
+    do { pl->next = op; }
+    while (!__atomic_compare_exchange_n(&plyinq, &op, pl, TRUE,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    if (!op) {
+
+        v = 1;
+        write(seqevt, &v, sizeof(uint64_t));
 
-    return (v);
+    }
 
 }
 
-unsigned int str2id(string ids)
+/*******************************************************************************
 
-{
+Read byte from midi file
 
-    return (ids[0]<<24|ids[1]<<16|ids[2]<<8|ids[3]);
+Reads the next byte from a midi file cursor. The file is mapped into memory, so
+this is just a bounds check and a fetch. Running off the end of the data is a
+format error.
 
-}
+*******************************************************************************/
 
-void prthid(FILE* fh, unsigned int id)
+static byte rdbyt(syntrkptr tp)
 
 {
 
-    putc(id >>24 & 0xff, fh);
-    putc(id >>16 & 0xff, fh);
-    putc(id >>8 & 0xff, fh);
-    putc(id & 0xff, fh);
+    if (tp->p >= tp->e) error("Invalid .mid file format");
+
+    return (*tp->p++);
 
 }
 
-void pa_loadsynth(int s, string fn)
+/*******************************************************************************
+
+Read variable length value from midi file
+
+Reads a midi variable length value, 7 bits per byte with the high bit set on
+all but the last byte. Values are limited to 4 bytes by the standard.
+
+*******************************************************************************/
+
+static unsigned int rdvar(syntrkptr tp)
 
 {
 
-    FILE*          fh;           /* file handle */
-    unsigned int   rem;          /* remaining track length */
+    byte         b;
+    unsigned int v;
+    int          cnt;
+
+    v = 0;
+    cnt = 0;
+    do {
+
+        b = rdbyt(tp); /* get next part */
+        v = v<<7|(b&0x7f); /* shift and place new value */
+        if (++cnt > 4) error("Invalid .mid file format");
+
+    } while (b >= 128);
+
+    return (v);
+
+}
+
+/*******************************************************************************
+
+Read big endian values from midi file
+
+Reads 16 and 32 bit big endian values from a midi file cursor.
+
+*******************************************************************************/
+
+static unsigned int rd16be(syntrkptr tp)
+
+{
+
+    unsigned int v;
+
+    v = rdbyt(tp) << 8;
+    v |= rdbyt(tp);
+
+    return (v);
+
+}
+
+static unsigned int rd32be(syntrkptr tp)
+
+{
+
+    unsigned int v;
+
+    v = rdbyt(tp) << 24;
+    v |= rdbyt(tp) << 16;
+    v |= rdbyt(tp) << 8;
+    v |= rdbyt(tp);
+
+    return (v);
+
+}
+
+/*******************************************************************************
+
+Skip midi file data
+
+Skips the given number of bytes in a midi file cursor.
+
+*******************************************************************************/
+
+static void skpmid(syntrkptr tp, unsigned int len)
+
+{
+
+    if (len > tp->e-tp->p) error("Invalid .mid file format");
+    tp->p += len;
+
+}
+
+/*******************************************************************************
+
+Convert string to header id
+
+Forms a 4 character chunk id from a string.
+
+*******************************************************************************/
+
+static unsigned int str2id(string ids)
+
+{
+
+    return (ids[0]<<24|ids[1]<<16|ids[2]<<8|ids[3]);
+
+}
+
+/*******************************************************************************
+
+Create synth event table
+
+Allocates a synth event table for the given number of events. The table and its
+arrays are allocated as a single block, and are freed with a single free().
+
+*******************************************************************************/
+
+static syntblptr synnew(int num)
+
+{
+
+    syntblptr tbl;
+
+    tbl = malloc(sizeof(syntbl)+(sizeof(int)*2+3)*(size_t)num);
+    if (!tbl) error("Out of memory");
+    tbl->num = 0; /* set no events */
+    tbl->time = (int*)(tbl+1); /* place arrays, widest first */
+    tbl->val = tbl->time+num;
+    tbl->st = (byte*)(tbl->val+num);
+    tbl->chan = tbl->st+num;
+    tbl->key = tbl->chan+num;
+
+    return (tbl);
+
+}
+
+/*******************************************************************************
+
+Place event to synth event table
+
+Places an event at the end of a synth event table.
+
+*******************************************************************************/
+
+static void synput(syntblptr tbl, int t, pa_seqtyp st, int c, int k, int v)
+
+{
+
+    tbl->time[tbl->num] = t;
+    tbl->st[tbl->num] = st;
+    tbl->chan[tbl->num] = c;
+    tbl->key[tbl->num] = k;
+    tbl->val[tbl->num] = v;
+    tbl->num++;
+
+}
+
+/*******************************************************************************
+
+Decode midi event
+
+Decodes a single midi event from a track, with the command byte already read,
+and places any sequencer event it produces at the end of the event table. Set
+tempo meta events change the quarter note time, and end of track sets the end
+flag for the track. Events we don't implement are skipped.
+
+*******************************************************************************/
+
+static void dcdmidi(syntrkptr tp, byte b, syntblptr tbl, int t, int* qnote)
+
+{
+
+    byte         p1;
+    byte         p2;
+    byte         p3;
+    unsigned int len;
+    int          c;
+
+    c = (b&15)+1; /* set channel */
+    switch (b>>4) { /* command nybble */
+
+        case 0x8: /* note off */
+                  p1 = rdbyt(tp);
+                  p2 = rdbyt(tp);
+                  synput(tbl, t, st_noteoff, c, p1+1, p2*0x01000000);
+                  break;
+        case 0x9: /* note on */
+                  p1 = rdbyt(tp);
+                  p2 = rdbyt(tp);
+                  synput(tbl, t, st_noteon, c, p1+1, p2*0x01000000);
+                  break;
+        case 0xa: /* polyphonic key pressure */
+                  p1 = rdbyt(tp);
+                  p2 = rdbyt(tp);
+                  synput(tbl, t, st_aftertouch, c, p1+1, p2*0x01000000);
+                  break;
+        case 0xb: /* controller change/channel mode */
+                  p1 = rdbyt(tp);
+                  p2 = rdbyt(tp);
+                  /* note we don't implement all controller messages */
+                  if (p1 == CTLR_MONO_OPERATION) /* Mono mode on */
+                      synput(tbl, t, st_mono, c, 0, p2);
+                  else if (p1 == CTLR_POLY_OPERATION) /* Poly mode on */
+                      synput(tbl, t, st_poly, c, 0, 0);
+                  break;
+        case 0xc: /* program change */
+                  p1 = rdbyt(tp);
+                  synput(tbl, t, st_instchange, c, p1+1, 0);
+                  break;
+        case 0xd: /* channel key pressure */
+                  p1 = rdbyt(tp);
+                  synput(tbl, t, st_pressure, c, 0, p1*0x01000000);
+                  break;
+        case 0xe: /* pitch bend */
+                  p1 = rdbyt(tp);
+                  p2 = rdbyt(tp);
+                  synput(tbl, t, st_pitch, c, 0, p2<<7|p1);
+                  break;
+        case 0xf: /* sysex/meta */
+                  switch (b) {
+
+                      case 0xf0: /* F0 sysex event */
+                      case 0xf7: /* F7 sysex event */
+                                 len = rdvar(tp); /* get length */
+                                 skpmid(tp, len);
+                                 break;
+                      case 0xff: /* meta events */
+                                 p1 = rdbyt(tp); /* get next byte */
+                                 len = rdvar(tp); /* get length */
+                                 switch (p1) {
+
+                                     case 0x2f: /* End of track */
+                                                if (len != 0) error("Meta event length does not match");
+                                                tp->end = TRUE; /* set end of track */
+                                                break;
+                                     case 0x51: /* Set tempo */
+                                                if (len != 3) error("Meta event length does not match");
+                                                p1 = rdbyt(tp); /* get b1-b3 */
+                                                p2 = rdbyt(tp);
+                                                p3 = rdbyt(tp);
+                                                *qnote = (p1<<16|p2<<8|p3)/100;
+                                                break;
+                                     default:   /* unknown/other */
+                                                skpmid(tp, len);
+                                                break;
+
+                                 }
+                                 break;
+
+                      default: error("Invalid .mid file format");
+
+                  }
+                  break;
+
+        default: error("Invalid .mid file format");
+
+    }
+
+}
+
+/*******************************************************************************
+
+Load synthesizer file
+
+Loads a synthesizer control file, usually midi format, into a logical cache,
+from 1 to N. These are loaded up into memory for minimum latency. The file is
+specified by file name, and the file type is system dependent.
+
+The file is mapped into memory and all of the tracks are decoded together in a
+single pass. Each track has a cursor, and the track with the earliest next event
+is always decoded next, so the events come out merged and in time order, and
+go straight into the event table. Because the tracks advance together, a tempo
+change in any track applies to the events of all tracks that follow it, and
+times are figured from the tick count since the last tempo change, so rounding
+does not accumulate from event to event.
+
+Note that we support 100 synth files loaded, but the Petit-ami "rule of thumb"
+is no more than 10 synth files at a time.
+
+*******************************************************************************/
+
+void pa_loadsynth(int s, string fn)
+
+{
+
+    int            fd;           /* file descriptor */
+    struct stat    fst;          /* file status */
+    byte*          fb;           /* mapped file */
+    size_t         fl;           /* length of file */
+    syntrk         fc;           /* cursor for whole file */
+    syntrkptr      trk;          /* track cursors */
+    syntrkptr      tp;           /* track cursor */
+    int            ntrk;         /* number of tracks found */
     unsigned int   len;          /* length read */
     unsigned int   hlen;         /* header length */
-    unsigned int   delta_time;   /* delta time */
-    int            endtrk;       /* end of track flag */
-    byte           last;         /* last command */
     unsigned short fmt;          /* format code */
     unsigned short tracks;       /* number of tracks */
     unsigned short division;     /* delta time */
     int            found;        /* found our header */
     unsigned int   id;           /* id */
+    unsigned int   btck;         /* tick of last tempo change */
+    int            btim;         /* time of last tempo change in 100us */
     int            curtim;       /* current time in 100us */
     int            qnote;        /* number of 100us/quarter note */
-    pa_seqptr      sp, sp2, sp3; /* sequencer entry */
-    pa_seqptr      seqlst;       /* sorted sequencer list */
-    pa_seqptr      trklst;       /* sorted track list */
-    pa_seqptr      trklas;       /* track last entry */
+    int            lqnote;       /* last quarter note time */
+    syntblptr      tbl;          /* event table */
+    syntblptr      otbl;         /* existing event table */
     char           fnh[MAXFNM];  /* file name holder */
     byte           b;
     int            i;
-    int            r;
 
     if (s < 1 || s > MAXMIDT) error("Invalid logical synthesize file number");
 
     /* copy filename and add extension if required */
     strcpy(fnh, fn); /* copy */
     setext(fnh, ".mid"); /* set or overwrite extension */
-    fh = fopen(fnh, "r");
-    if (!fh) error("Cannot open input .mid file");
-    id = read32be(fh); /* get header id */
+    fd = open(fnh, O_RDONLY);
+    if (fd < 0) error("Cannot open input .mid file");
+    if (fstat(fd, &fst) || !fst.st_size) error("Invalid .mid file format");
+    fl = fst.st_size;
+    fb = mmap(NULL, fl, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); /* the mapping holds the file */
+    if (fb == MAP_FAILED) error("Cannot read input .mid file");
+    fc.p = fb; /* set cursor to whole file */
+    fc.e = fb+fl;
+    id = rd32be(&fc); /* get header id */
 
     /* check RIFF prefix */
     if (id == str2id("RIFF")) {
 
-        len = read32be(fh); /* read and discard length */
+        len = rd32be(&fc); /* read and discard length */
         /* a RIFF file can contain a MIDI file, so we search within it */
-        id = read32be(fh); /* get header id */
+        id = rd32be(&fc); /* get header id */
         if (id != str2id("RMID")) error("Invalid .mid file header");
         do {
 
-            id = read32be(fh); /* get next id */
-            len = read32be(fh); /* get length */
+            id = rd32be(&fc); /* get next id */
+            len = rd32be(&fc); /* get length */
             found = id == str2id("data"); /* check data header */
-            if (!found) fseek(fh, len, SEEK_CUR);
+            if (!found) skpmid(&fc, len);
 
         } while (!found); /* not SMF header */
-        id = read32be(fh); /* get next id */
+        id = rd32be(&fc); /* get next id */
 
     }
 
@@ -4374,134 +5195,111 @@ void pa_loadsynth(int s, string fn)
     if (id != str2id("MThd")) error("Invalid .mid file header");
 
     /* read the rest of the file header */
-    hlen = read32be(fh); /* get length */
-    fmt = read16be(fh); /* format */
-    tracks = read16be(fh); /* tracks */
-    division = read16be(fh); /* delta time */
+    hlen = rd32be(&fc); /* get length */
+    if (hlen < 6) error("Invalid .mid file header");
+    fmt = rd16be(&fc); /* format */
+    tracks = rd16be(&fc); /* tracks */
+    division = rd16be(&fc); /* delta time */
+    skpmid(&fc, hlen-6); /* skip any header extension */
 
     /* check and reject SMTPE framing */
-    if (division & 0x80000000) error("Cannot handle SMTPE framing");
-
-    /*
-     * Read the midi file in and construct a sorted sequencer list.
-     */
-    qnote = DEFMIDITIM; /* set default quarter note time */
-    seqlst = NULL; /* clear the master sequencer list */
-    for (i = 0; i < tracks && !feof(fh); i++) { /* read track chunks */
-
-        curtim = 0; /* set zero offset time */
-        trklst = NULL; /* clear track sequencer list */
-        trklas = NULL; /* clear track last sequencer entry */
-        if (!feof(fh)) { /* not eof */
-
-            /* Read in .mid track header */
-            id = read32be(fh); /* get header id */
-            hlen = read32be(fh); /* get length */
-
-            /* check a midi header */
-            if (id == str2id("MTrk")) {
-
-                rem = hlen; /* set remainder to parse */
-                last = 0; /* clear last command */
-                do {
-
-                    len = readvar(fh, &delta_time); /* get delta time */
-                    rem -= len; /* count */
-                    curtim += delta_time*qnote/division; /* advance with delta time */
-                    b = getc(fh); /* get the command byte */
-                    rem--; /* count */
-                    if (b < 0x80) { /* process running status or repeat */
-
-                        ungetc(b, fh); /* put back parameter byte */
-                        rem++; /* back out count */
-                        b = last; /* put back command for repeat */
+    if (division & 0x8000) error("Cannot handle SMTPE framing");
+    if (!division) error("Invalid .mid file header");
+
+    /* find the track chunks, and set a cursor at the first event of each */
+    trk = malloc(sizeof(syntrk)*(tracks+1));
+    if (!trk) error("Out of memory");
+    ntrk = 0;
+    for (i = 0; i < tracks && fc.p < fc.e; i++) { /* read track chunks */
+
+        id = rd32be(&fc); /* get header id */
+        hlen = rd32be(&fc); /* get length */
+        if (hlen > fc.e-fc.p) error("Invalid .mid file format");
+        if (id == str2id("MTrk")) {
+
+            tp = &trk[ntrk++];
+            tp->p = fc.p; /* set track data */
+            tp->e = fc.p+hlen;
+            tp->last = 0; /* clear last command */
+            tp->end = tp->p >= tp->e; /* set end if empty */
+            if (!tp->end) tp->tick = rdvar(tp); /* get first delta time */
 
-                    }
-                    /* decode midi instruction. Note that the output port is
-                       irrelivant, since the actual port will be specified at
-                       play time */
-                    len = dcdmidi(fh, b, &endtrk, PA_SYNTH_OUT, curtim, &qnote, &sp);
-                    rem -= len; /* count */
-                    if (sp) { /* a sequencer entry was produced */
-
-                        /* note the track list is inherently constructed in time
-                           order */
-                        sp->next = NULL; /* clear next */
-                        if (!trklas) trklst = sp; /* list empty, place first */
-                        else trklas->next = sp; /* link last to this */
-                        trklas = sp; /* set new last */
-                    }
-                    /* if command is not meta, save as last command */
-                    if (b < 0xf0) last = b;
-
-                } while (rem && !endtrk); /* until run out of commands */
-                /* merge track list with master list */
-                if (trklst) {
-
-                    sp2 = seqlst; /* save master list */
-                    seqlst = NULL; /* clear new list */
-                    sp3 = NULL; /* clear last */
-                    while (sp2 && trklst) { /* while both lists have content */
+        }
+        fc.p += hlen; /* next chunk */
 
-                        if (sp2->time <= trklst->time) {
+    }
 
-                            /* take from master */
-                            sp = sp2; /* remove top entry */
-                            sp2 = sp2->next;
+    /* Every event takes at least a delta time byte and a data byte, so the
+       events can't outnumber half the file bytes. We decode into a table of
+       that size, then copy down to the exact size */
+    tbl = synnew(fl/2+1);
 
-                        } else {
+    /*
+     * Decode the tracks, taking the earliest event each time.
+     */
+    qnote = DEFMIDITIM; /* set default quarter note time */
+    btck = 0; /* set tempo base at start */
+    btim = 0;
+    do {
 
-                            /* take from track */
-                            sp = trklst; /* remove top entry */
-                            trklst = sp->next;
+        /* find the track with the earliest event, the first track wins ties */
+        tp = NULL;
+        for (i = 0; i < ntrk; i++)
+            if (!trk[i].end && (!tp || trk[i].tick < tp->tick)) tp = &trk[i];
+        if (tp) { /* there is an event */
 
-                        }
-                        sp->next = NULL; /* clear next */
-                        /* insert to new list */
-                        if (sp3) sp3->next = sp; /* link last to this */
-                        else seqlst = sp; /* set first entry */
-                        sp3 = sp; /* set new last */
+            curtim = btim+(long long)(tp->tick-btck)*qnote/division;
+            b = rdbyt(tp); /* get the command byte */
+            if (b < 0x80) { /* process running status or repeat */
 
-                    }
-                    /* dump rest of master list */
-                    while (sp2) {
-
-                        /* take from master */
-                        sp = sp2; /* remove top entry */
-                        sp2 = sp2->next;
-                        sp->next = NULL; /* clear next */
-                        /* insert to new list */
-                        if (sp3) sp3->next = sp; /* link last to this */
-                        else seqlst = sp; /* set first entry */
-                        sp3 = sp; /* set new last */
+                tp->p--; /* put back parameter byte */
+                b = tp->last; /* put back command for repeat */
 
-                    }
-                    /* dump rest of track list */
-                    while (trklst) {
+            }
+            /* decode midi instruction. Note that the output port is not kept,
+               since the actual port will be specified at play time */
+            lqnote = qnote;
+            dcdmidi(tp, b, tbl, curtim, &qnote);
+            if (qnote != lqnote) { /* tempo changed, set new base */
 
-                        /* take from track */
-                        sp = trklst; /* remove top entry */
-                        trklst = sp->next;
-                        /* insert to new list */
-                        if (sp3) sp3->next = sp; /* link last to this */
-                        else seqlst = sp; /* set first entry */
-                        sp3 = sp; /* set new last */
+                btck = tp->tick;
+                btim = curtim;
 
-                    }
+            }
+            /* if command is not meta, save as last command */
+            if (b < 0xf0) tp->last = b;
+            /* get time of next event, or end the track if out of data */
+            if (tp->p >= tp->e) tp->end = TRUE;
+            if (!tp->end) tp->tick += rdvar(tp);
 
-                }
+        }
 
-            } else fseek(fh, hlen, SEEK_CUR);
+    } while (tp); /* until all tracks end */
+    free(trk);
+    munmap(fb, fl);
+
+    /* copy down to exact size */
+    otbl = tbl;
+    tbl = synnew(otbl->num);
+    tbl->num = otbl->num;
+    memcpy(tbl->time, otbl->time, sizeof(int)*tbl->num);
+    memcpy(tbl->val, otbl->val, sizeof(int)*tbl->num);
+    memcpy(tbl->st, otbl->st, tbl->num);
+    memcpy(tbl->chan, otbl->chan, tbl->num);
+    memcpy(tbl->key, otbl->key, tbl->num);
+    free(otbl);
+
+    /* place completed event table into the logical table */
+    pthread_mutex_lock(&synlck); /* take synth table lock */
+    otbl = syntab[s-1]; /* get existing entry */
+    if (!otbl) syntab[s-1] = tbl; /* place new */
+    pthread_mutex_unlock(&synlck); /* release lock */
+    if (otbl) {
 
-        }
+        free(tbl);
+        error("Synthesizer file already defined for logical number");
 
     }
-    /* place completed synth list into the logical table */
-    pthread_mutex_lock(&synlck); /* take wave table lock */
-    sp = syntab[s]; /* get existing entry */
-    syntab[s] = seqlst; /* place new */
-    pthread_mutex_unlock(&synlck); /* release lock */
-    if (sp) error("Synthesizer file already defined for logical number");
 
 }
 
@@ -4521,9 +5319,9 @@ void pa_delsynth(int s)
 
 {
 
-    pa_seqptr  p;
-    int     n;
-    int accessed;
+    syntblptr tbl;
+    int       n;
+    int       accessed;
 
     if (s < 1 || s > MAXMIDT) error("Invalid logical synth file number");
 
@@ -4536,21 +5334,50 @@ void pa_delsynth(int s)
         pthread_mutex_lock(&synlck); /* take synth table lock */
 
         pthread_mutex_lock(&snmlck);
-        n = numsql[s]++;
+        n = numsql[s-1];
         pthread_mutex_unlock(&snmlck); /* release lock */
 
         if (!n) { /* no active synths, proceed to delete */
 
-            p = syntab[s]; /* get the existing entry */
-            syntab[s] = NULL; /* clear original */
+            tbl = syntab[s-1]; /* get the existing entry */
+            syntab[s-1] = NULL; /* clear original */
             accessed = TRUE; /* set sucessful access */
 
         }
         pthread_mutex_unlock(&synlck); /* release lock */
 
     } while (!accessed); /* until we get a successful access */
-    if (!p) error("No synth file loaded for logical wave number");
-    putseqlst(p); /* free the sequencer list */
+    if (!tbl) error("No synth file loaded for logical wave number");
+    free(tbl); /* free the event table */
+
+}
+
+/*******************************************************************************
+
+Get synth file event
+
+Fills in a sequencer message from the given event, 0 based, of a loaded synth
+file, and returns TRUE. Returns FALSE if the event is past the end of the file.
+The time of the message is the time of the event from the start of the file.
+
+This lets plug-ins walk a file without playing it, for example to render it
+offline. The file must stay loaded while it is walked.
+
+*******************************************************************************/
+
+int _pa_synthevt(int s, int i, pa_seqptr sp)
+
+{
+
+    syntblptr tbl; /* synth event table */
+
+    if (s < 1 || s > MAXMIDT) error("Invalid logical synth file number");
+    tbl = syntab[s-1]; /* get the table */
+    if (!tbl) error("No synth file loaded for logical synth number");
+    if (i < 0 || i >= tbl->num) return (FALSE); /* past end */
+    synmsg(tbl, i, 0, sp); /* form message */
+
+    return (TRUE);
 
 }
 
@@ -4603,7 +5430,6 @@ void pa_playsynth(int p, int t, int s)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -4620,257 +5446,1269 @@ the correct behavior. However, in some cases we want the synth sequencers to
 complete. for example a "play mymidi.mid" command should wait until the synth
 sequencers finish.
 
-This routine waits until ALL synth operations complete. There is no way to
-determine indivudual sequencer completions, since even the same track could have
-mutiple plays active at the same time. So we keep a counter of active plays, and
-wait until they all stop.
+This routine waits until ALL synth operations complete. There is no way to
+determine indivudual sequencer completions, since even the same track could have
+mutiple plays active at the same time. So we keep a counter of active plays, and
+wait until they all stop.
+
+The active sequencer count includes all sequencers, including syth (midi) file
+plays and individual notes/events sent to the midi "manual" interface. Thus this
+call only makes sense if the calling program has stopped sending events to the
+sequencer(s), including background tasks.
+
+*******************************************************************************/
+
+void pa_waitsynth(int p)
+
+{
+
+    if (p < 1 || p > MAXMIDP) error("Invalid synthesizer port");
+    if (!alsamidiout[p-1]) error("No synthsizer defined for logical port");
+    if (!alsamidiout[p-1]->devopn) error("Synthsizer port not open");
+
+    pthread_mutex_lock(&snmlck); /* lock counter */
+    pthread_cond_wait(&snmzer, &snmlck); /* wait zero event */
+    pthread_mutex_unlock(&snmlck); /* release lock */
+
+}
+
+/*******************************************************************************
+
+Find number of output wave devices.
+
+Returns the number of wave output devices available.
+
+*******************************************************************************/
+
+int pa_waveout(void)
+
+{
+
+    return (alsapcmoutnum);
+
+}
+
+/*******************************************************************************
+
+Find number of input wave devices.
+
+Returns the number of wave output devices available.
+
+*******************************************************************************/
+
+int pa_wavein(void)
+
+{
+
+    return (alsapcminnum);
+
+}
+
+/*******************************************************************************
+
+Open wave output device
+
+Opens a wave output device by number. By convention, wave out 1 is the default
+output device. The mixer for wave plays on the port is started, and wave plays
+on the port go out through the open device.
+
+*******************************************************************************/
+
+void pa_openwaveout(int p)
+
+{
+
+    int r;
+
+    if (p < 1 || p > MAXWAVP) error("Invalid wave output port");
+    if (!alsapcmout[p-1]) error("No wave output device defined at logical number");
+    if (alsapcmout[p-1]->devopn) error("Wave port already open");
+
+    alsapcmout[p-1]->open(p); /* open device */
+    alsapcmout[p-1]->devopn = TRUE; /* set open */
+    alsapcmout[p-1]->fmt = -1; /* set format undefined until read/write time */
+    mixstr(p); /* start wave mixer */
+
+}
+
+/*******************************************************************************
+
+CLose wave output device
+
+Closes a wave output device by number. The mixer for the port is stopped, and
+any wave plays still active on it are abandoned.
+
+*******************************************************************************/
+
+void pa_closewaveout(int p)
+
+{
+
+    if (p < 1 || p > MAXWAVP) error("Invalid wave output port");
+    if (!alsapcmout[p-1]) error("No wave output device defined at logical number");
+    if (!alsapcmout[p-1]->devopn) error("Wave port not open");
+
+    mixstp(p); /* stop wave mixer */
+    alsapcmout[p-1]->close(p); /* close device */
+    alsapcmout[p-1]->devopn = FALSE; /* set closed */
+
+
+}
+
+/*******************************************************************************
+
+Convert samples to float
+
+The first stage of sample conversion. Converts a run of samples in .wav file
+format, which is little endian, to floating point samples from -1 to 1. The
+samples are integer of 1 to 4 bytes, unsigned for 1 byte and signed otherwise,
+or floating point of 4 or 8 bytes. Integers of less than the full size are
+left justified in the .wav format, so they convert the same way.
+
+The samples are put together a byte at a time, so this works the same on hosts
+of either byte order.
+
+*******************************************************************************/
+
+static void smpflt(byte* bp, int bytes, int flt, long n, float* out)
+
+{
+
+    long     i;
+    uint32_t u; /* assembled sample */
+    uint64_t u2;
+    float    f;
+    double   d;
+
+    if (flt && bytes == 8) for (i = 0; i < n; i++, bp += 8) {
+
+        u2 = (uint64_t)(bp[0]|bp[1]<<8|bp[2]<<16|(uint32_t)bp[3]<<24)|
+             (uint64_t)(bp[4]|bp[5]<<8|bp[6]<<16|(uint32_t)bp[7]<<24)<<32;
+        memcpy(&d, &u2, 8);
+        out[i] = d;
+
+    } else if (flt) for (i = 0; i < n; i++, bp += 4) {
+
+        u = bp[0]|bp[1]<<8|bp[2]<<16|(uint32_t)bp[3]<<24;
+        memcpy(&f, &u, 4);
+        out[i] = f;
+
+    } else switch (bytes) {
+
+        case 1: for (i = 0; i < n; i++) out[i] = (bp[i]-128)*(1.0f/128);
+                break;
+        case 2: for (i = 0; i < n; i++, bp += 2)
+                    out[i] = (int16_t)(bp[0]|bp[1]<<8)*(1.0f/32768);
+                break;
+        case 3: for (i = 0; i < n; i++, bp += 3)
+                    out[i] = (int32_t)((uint32_t)bp[0]<<8|(uint32_t)bp[1]<<16|
+                                       (uint32_t)bp[2]<<24)*(1.0f/2147483648.0f);
+                break;
+        case 4: for (i = 0; i < n; i++, bp += 4)
+                    out[i] = (int32_t)(bp[0]|bp[1]<<8|bp[2]<<16|
+                                       (uint32_t)bp[3]<<24)*(1.0f/2147483648.0f);
+                break;
+
+    }
+
+}
+
+/*******************************************************************************
+
+Mix channels to output samples
+
+The second stage of sample conversion. Mixes frames of floating point samples
+down to the given number of output channels, 1 or 2, and converts them to 16
+bit signed samples, with clipping. Mono and stereo pass straight through, or a
+stereo input can be mixed to mono. Inputs of more than two channels are taken
+to be in the standard .wav channel order, front left and right, center, low
+frequency, then back and side pairs, and are mixed down to stereo. The low
+frequency channel is dropped, and channels past the eighth are ignored.
+
+*******************************************************************************/
+
+static const float chnmtx[8][2] = {
+
+    { 1.0f,      0.0f      }, /* front left */
+    { 0.0f,      1.0f      }, /* front right */
+    { 0.707107f, 0.707107f }, /* center */
+    { 0.0f,      0.0f      }, /* low frequency */
+    { 0.707107f, 0.0f      }, /* back left */
+    { 0.0f,      0.707107f }, /* back right */
+    { 0.707107f, 0.0f      }, /* side left */
+    { 0.0f,      0.707107f }  /* side right */
+
+};
+
+static void chnmix(float* in, int chan, long n, short* out, int ochan)
+
+{
+
+    long  i;
+    int   c;
+    float l, r; /* mixed left and right */
+    int   s;
+
+    for (i = 0; i < n; i++, in += chan) {
+
+        if (chan == 1) l = r = in[0];
+        else if (chan == 2) { l = in[0]; r = in[1]; }
+        else { /* mix down */
+
+            l = r = 0;
+            for (c = 0; c < chan && c < 8; c++) {
+
+                l += in[c]*chnmtx[c][0];
+                r += in[c]*chnmtx[c][1];
+
+            }
+
+        }
+        if (ochan == 1) l = (l+r)*0.5f; /* mix to mono */
+        for (c = 0; c < ochan; c++) { /* quantize with clipping */
+
+            s = lrintf((c ? r : l)*32768);
+            *out++ = s > 32767 ? 32767 : s < -32768 ? -32768 : s;
+
+        }
+
+    }
+
+}
+
+/*******************************************************************************
+
+Decode wave file
+
+Reads a .wav file and decodes its samples to 16 bit signed samples, in one or
+two channels, kept at the rate of the file. Any integer or floating point
+sample format is accepted, including the extensible format, and files of more
+than two channels are mixed down to stereo. Chunks before the data chunk that
+are not recognized are skipped, and only the first data chunk is used.
+
+Returns NULL if the file cannot be opened. A file that exists but is not a
+playable .wav file is an error. The format is placed in the given wave entry,
+and the decoded samples are returned. The length of the sample data in bytes
+is returned in len.
+
+*******************************************************************************/
+
+static short* wavdec(string fn, wavbufptr wb, long* len)
+
+{
+
+    wavhdr whd;    /* .wav file header */
+    fmthdr fhd;    /* fmt chunk header */
+    cnkhdr chd;    /* chunk header */
+    byte   ext[24]; /* extensible format fields */
+    int    fmtfnd; /* format chunk was found */
+    int    datfnd; /* data chunk was found */
+    int    fh;     /* file handle */
+    int    tag;    /* format type */
+    int    flt;    /* samples are floating point */
+    int    bytes;  /* bytes per sample in file */
+    int    blk;    /* bytes per frame in file */
+    int    chan;   /* channels in file */
+    long   remsiz; /* bytes remaining in data chunk */
+    long   frm;    /* frames decoded */
+    long   m;      /* frames in block */
+    short* data;   /* decoded samples */
+    short* dp;
+    float* fbuf;   /* samples converted to float */
+    byte   buff[WAVBUF]; /* buffer for file data */
+    int    l;
+
+    fh = open(fn, O_RDONLY);
+    if (fh < 0) return (NULL); /* file does not exist */
+
+    /* Read in IFF File header */
+    l = read(fh, &whd, sizeof(wavhdr));
+    if (l != sizeof(wavhdr)) error(".wav file format");
+
+    /* check a RIFF header with WAVE type */
+    if (strncmpus(whd.id, "RIFF", 4) || strncmpus(whd.type, "WAVE", 4))
+       error("Not a valid .wav file");
+
+    /* find format and data chunks */
+    fmtfnd = FALSE;
+    datfnd = FALSE;
+    tag = 0;
+    while (!datfnd) {
+
+        l = read(fh, &chd, sizeof(cnkhdr));
+        if (l != sizeof(cnkhdr)) error(".wav file format");
+        if (!strncmpus(chd.id, "fmt ", 4)) {
+
+            /* format chunk, read the fields after the header */
+            if (chd.len < sizeof(fmthdr)-sizeof(cnkhdr))
+                error(".wav file format");
+            l = read(fh, (byte*)&fhd+sizeof(cnkhdr),
+                     sizeof(fmthdr)-sizeof(cnkhdr));
+            if (l != sizeof(fmthdr)-sizeof(cnkhdr)) error(".wav file format");
+            tag = (unsigned short)fhd.tag;
+            l = chd.len-(sizeof(fmthdr)-sizeof(cnkhdr));
+            if (tag == WAVEXT && l >= sizeof(ext)) {
+
+                /* extensible format, the type is in the subformat */
+                if (read(fh, ext, sizeof(ext)) != sizeof(ext))
+                    error(".wav file format");
+                tag = ext[8]|ext[9]<<8;
+                l -= sizeof(ext);
+
+            }
+            /* skip any remaining extension to format */
+            if (chd.len & 1) l++;
+            if (l) lseek(fh, l, SEEK_CUR);
+            fmtfnd = TRUE;
+
+        } else if (!strncmpus(chd.id, "data", 4)) datfnd = TRUE;
+        else {
+
+            /* skip unrecognized chunk */
+            if (chd.len & 1) lseek(fh, chd.len+1, SEEK_CUR);
+            else lseek(fh, chd.len, SEEK_CUR);
+
+        }
+
+    }
+    if (!fmtfnd) error("Not a valid .wav file");
+    flt = tag == WAVFLT;
+    if ((tag != WAVPCM && !flt) || fhd.channels < 1 || !fhd.samplerate ||
+        (!flt && (fhd.bitspersample < 8 || fhd.bitspersample > 32)) ||
+        (flt && fhd.bitspersample != 32 && fhd.bitspersample != 64))
+        error("Cannot play this PCM format");
+
+    chan = fhd.channels; /* find file format */
+    bytes = (fhd.bitspersample+7)/8;
+    blk = bytes*chan;
+    if (blk > WAVBUF) error("Cannot play this PCM format");
+    wb->rate = fhd.samplerate; /* set decoded format */
+    wb->chan = chan > 2 ? 2 : chan;
+    data = malloc(chd.len/blk*wb->chan*sizeof(short)+1);
+    fbuf = malloc(WAVBUF*sizeof(float));
+    if (!data || !fbuf) error("Out of memory");
+
+    /* decode the samples */
+    remsiz = chd.len;
+    frm = 0;
+    dp = data;
+    while (remsiz >= blk) {
+
+        l = WAVBUF/blk*blk; /* find whole frames that fit */
+        if (l > remsiz) l = remsiz/blk*blk;
+        l = read(fh, buff, l);
+        if (l < blk) remsiz = 0; /* file ended early */
+        else {
+
+            remsiz -= l;
+            m = l/blk; /* find whole frames read */
+            smpflt(buff, bytes, flt, m*chan, fbuf);
+            chnmix(fbuf, chan, m, dp, wb->chan);
+            dp += m*wb->chan;
+            frm += m;
+
+        }
+
+    }
+    free(fbuf);
+    close(fh); /* close input file */
+    wb->frames = frm;
+    *len = frm*wb->chan*sizeof(short);
+
+    return (data);
+
+}
+
+/*******************************************************************************
+
+Evict decoded waves
+
+Frees the samples of the least recently played waves until the memory used is
+within the wave cache budget. Waves that are playing are not evicted, nor is
+the most recently used wave. Evicted waves are decoded again from their files
+when next played. Does nothing if there is no budget. Must be called with the
+wave table lock held.
+
+*******************************************************************************/
+
+static void wavevc(void)
+
+{
+
+    wavbufptr wb;
+
+    wb = wavlru ? wavlru->last : NULL; /* start at least recent */
+    while (wavbgt && wavmem > wavbgt && wb && wb != wavlru) {
+
+        if (wb->ref == 1 && wb->data) { /* loaded and not playing */
+
+            free(wb->data);
+            wb->data = NULL;
+            wavmem -= wb->len;
+
+        }
+        wb = wb->last;
+
+    }
+
+}
+
+/*******************************************************************************
+
+Move wave to front of LRU list
+
+Places the given wave at the most recently used end of the LRU list. Must be
+called with the wave table lock held.
+
+*******************************************************************************/
+
+static void wavfnt(wavbufptr wb)
+
+{
+
+    if (wb != wavlru) {
+
+        /* unlink from list */
+        wb->last->next = wb->next;
+        if (wb->next) wb->next->last = wb->last;
+        else wavlru->last = wb->last; /* was tail */
+        /* insert at head, head keeps the tail in last */
+        wb->next = wavlru;
+        wb->last = wavlru->last;
+        wavlru->last = wb;
+        wavlru = wb;
+
+    }
+
+}
+
+/*******************************************************************************
+
+Release wave
+
+Releases a reference to a wave entry. If that was the last reference, the wave
+has been deleted, and the entry and its samples are freed.
+
+*******************************************************************************/
+
+static void wavrel(wavbufptr wb)
+
+{
+
+    int fre;
+
+    pthread_mutex_lock(&wavlck); /* take wave table lock */
+    fre = !--wb->ref;
+    if (fre && wb->data) wavmem -= wb->len;
+    pthread_mutex_unlock(&wavlck); /* release lock */
+    if (fre) { /* no references left, free */
+
+        free(wb->data);
+        free(wb->fn);
+        free(wb);
+
+    }
+
+}
+
+/*******************************************************************************
+
+Find resampling filter
+
+Finds the polyphase filter for resampling from the given source rate to the
+mixer rate, making it if the mixer does not have one yet. The filter is a
+windowed sinc low pass, cut off below the lower of the two Nyquist rates, and
+divided into phases for positions between source frames. Each phase is scaled
+to unity gain. Filters are kept on the mixer, and are only used by the mixer
+thread.
+
+*******************************************************************************/
+
+static rsmptr rsmfnd(mixptr mp, int rate)
+
+{
+
+    rsmptr fp;  /* filter */
+    int    p;   /* phase */
+    int    k;   /* tap */
+    double fc;  /* cutoff as fraction of source rate */
+    double x;   /* distance from tap to output position */
+    double h[RSMTAP]; /* coefficients */
+    double sum;
+
+    /* search for existing filter */
+    for (fp = mp->rsm; fp && fp->rate != rate; fp = fp->next);
+    if (!fp) { /* make new filter */
+
+        fp = malloc(sizeof(rsmflt));
+        if (!fp) error("Out of memory");
+        fp->rate = rate;
+        fc = 0.45; /* cut off just under Nyquist */
+        if (mp->rate < rate) fc = fc*mp->rate/rate; /* downsampling */
+        for (p = 0; p < RSMPHS; p++) {
+
+            sum = 0;
+            for (k = 0; k < RSMTAP; k++) {
+
+                x = k-RSMTAP/2+1-(double)p/RSMPHS;
+                /* sinc with Blackman window */
+                h[k] = x == 0 ? 2*fc : sin(2*M_PI*fc*x)/(M_PI*x);
+                h[k] *= 0.42+0.5*cos(M_PI*x/(RSMTAP/2))+
+                        0.08*cos(2*M_PI*x/(RSMTAP/2));
+                sum += h[k];
+
+            }
+            for (k = 0; k < RSMTAP; k++) {
+
+                fp->coef[p][k] = lrint(h[k]/sum*32768);
+                fp->coef2[p][k*2] = fp->coef[p][k]; /* doubled for stereo */
+                fp->coef2[p][k*2+1] = fp->coef[p][k];
+
+            }
+
+        }
+        fp->next = mp->rsm; /* link to mixer */
+        mp->rsm = fp;
+
+    }
+
+    return (fp);
+
+}
+
+/*******************************************************************************
+
+Mixing kernels
+
+These are the inner loops of the mixer. Each has a version written with GCC
+vector extensions, which the compiler turns into SIMD instructions where the
+machine has them, or into plain code where it does not. Other compilers use
+the scalar version.
+
+The vector versions work on four 32 bit lanes, which hold two stereo frames, or
+one frame for the filter taps, and finish with the scalar version for any
+leftover samples.
+
+*******************************************************************************/
+
+#ifdef __GNUC__
+typedef int v4si __attribute__((vector_size(16)));
+typedef int v4siu __attribute__((vector_size(16), aligned(4)));
+typedef short v4hi __attribute__((vector_size(8)));
+typedef short v4hiu __attribute__((vector_size(8), aligned(2)));
+#endif
+
+/*******************************************************************************
+
+Mix samples
+
+Adds samples to the accumulator with left and right gains, 0 to 65536. The
+source is interleaved stereo frames.
+
+*******************************************************************************/
+
+static void krnmix(int* acc, short* src, long n, int lg, int rg)
+
+{
+
+    long i;
+
+#ifdef __GNUC__
+    v4si g = { lg, rg, lg, rg }; /* gains for two frames */
+    v4si s;
+
+    n *= 2; /* find samples */
+    for (i = 0; i+4 <= n; i += 4) {
+
+        s = __builtin_convertvector(*(v4hiu*)&src[i], v4si);
+        *(v4siu*)&acc[i] += s*g>>16;
+
+    }
+    for (; i < n; i += 2) {
+
+        acc[i] += src[i]*lg>>16;
+        acc[i+1] += src[i+1]*rg>>16;
+
+    }
+#else
+    for (i = 0; i < n*2; i += 2) {
+
+        acc[i] += src[i]*lg>>16;
+        acc[i+1] += src[i+1]*rg>>16;
+
+    }
+#endif
+
+}
+
+/*******************************************************************************
+
+Filter stereo frame
+
+Finds the dot product of RSMTAP stereo frames with the doubled coefficients of
+one filter phase, and returns the left and right results, at 16 bits.
+
+*******************************************************************************/
+
+static void krnflt2(short* src, int* coef, int* l, int* r)
+
+{
+
+    int  i;
+
+#ifdef __GNUC__
+    v4si sum = { 0, 0, 0, 0 };
+
+    for (i = 0; i < RSMTAP*2; i += 4)
+        sum += __builtin_convertvector(*(v4hiu*)&src[i], v4si)*
+               *(v4siu*)&coef[i];
+    *l = (sum[0]+sum[2])>>15;
+    *r = (sum[1]+sum[3])>>15;
+#else
+    int sl, sr;
+
+    sl = sr = 0;
+    for (i = 0; i < RSMTAP*2; i += 2) {
+
+        sl += src[i]*coef[i];
+        sr += src[i+1]*coef[i+1];
+
+    }
+    *l = sl>>15;
+    *r = sr>>15;
+#endif
+
+}
+
+/*******************************************************************************
+
+Filter mono frame
+
+Finds the dot product of RSMTAP mono frames with the coefficients of one filter
+phase, and returns the result, at 16 bits.
+
+*******************************************************************************/
+
+static int krnflt1(short* src, int* coef)
+
+{
+
+    int  i;
+
+#ifdef __GNUC__
+    v4si sum = { 0, 0, 0, 0 };
+
+    for (i = 0; i < RSMTAP; i += 4)
+        sum += __builtin_convertvector(*(v4hiu*)&src[i], v4si)*
+               *(v4siu*)&coef[i];
+
+    return ((sum[0]+sum[1]+sum[2]+sum[3])>>15);
+#else
+    int s;
+
+    s = 0;
+    for (i = 0; i < RSMTAP; i++) s += src[i]*coef[i];
+
+    return (s>>15);
+#endif
+
+}
+
+/*******************************************************************************
+
+Clip samples
+
+Converts accumulated samples to 16 bit output samples, clipping them to the
+16 bit range.
+
+*******************************************************************************/
+
+static void krnclp(short* out, int* acc, long n)
+
+{
+
+    long i;
+    int  s;
+
+#ifdef __GNUC__
+    v4si hi = { 32767, 32767, 32767, 32767 };
+    v4si lo = { -32768, -32768, -32768, -32768 };
+    v4si v, m;
+
+    for (i = 0; i+4 <= n; i += 4) {
+
+        v = *(v4siu*)&acc[i];
+        m = v > hi; /* lanes over top */
+        v = (v & ~m)|(hi & m);
+        m = v < lo; /* lanes under bottom */
+        v = (v & ~m)|(lo & m);
+        *(v4hiu*)&out[i] = __builtin_convertvector(v, v4hi);
+
+    }
+#else
+    i = 0;
+#endif
+    for (; i < n; i++) {
+
+        s = acc[i];
+        out[i] = s > 32767 ? 32767 : s < -32768 ? -32768 : s;
+
+    }
+
+}
+
+/*******************************************************************************
+
+Open wave voice
+
+Readies a wave voice to be mixed. The samples of the wave are always present,
+since a play holds a reference to the wave, which keeps it from being evicted,
+and an evicted wave is decoded again before its play reaches the mixer. If the
+wave is not at the mixer rate, the resampling filter for its rate is found.
+
+*******************************************************************************/
+
+static void vocopn(voiceptr vp, mixptr mp)
+
+{
+
+    wavbufptr wb; /* wave entry */
+
+    wb = vp->wb;
+    vp->pos = 0; /* set start of wave */
+    vp->frac = 0;
+    /* find step through source for each mixer frame */
+    vp->step = ((unsigned long long)wb->rate<<16)/mp->rate;
+    vp->flt = NULL; /* set no resampling */
+    if (wb->rate != mp->rate) vp->flt = rsmfnd(mp, wb->rate);
+
+}
+
+/*******************************************************************************
+
+Close wave voice
+
+Releases the wave of a voice, and counts the voice as complete. If that was the
+last active wave play, waiters on the wave count are released.
+
+*******************************************************************************/
+
+static void voccls(voiceptr vp)
+
+{
+
+    wavrel(vp->wb); /* release wave */
+    vp->wb = NULL;
+
+    /* count active wave instances */
+    pthread_mutex_lock(&wnmlck);
+    numwav--; /* count active */
+    /* if now zero, signal zero crossing */
+    if (!numwav) pthread_cond_broadcast(&wnmzer);
+    pthread_mutex_unlock(&wnmlck); /* release lock */
+    if (numwav < 0) error("Wave locking imbalance");
+
+}
+
+/*******************************************************************************
+
+Mix wave voice
+
+Adds the given number of frames from a voice into the mixer accumulator, which
+is kept as interleaved left and right 32 bit sums. A voice at the mixer rate is
+added straight in. Otherwise it is stepped through the source at the ratio of
+its rate to the mixer rate, and each mixer frame is found with the polyphase
+filter, using the phase closest to the position between source frames. Frames
+outside of the wave are taken as zero. Returns FALSE if the voice has ended.
+
+*******************************************************************************/
+
+static int vocmix(voiceptr vp, int* acc, int n)
+
+{
+
+    wavbufptr wb;   /* wave */
+    short*    data; /* samples */
+    int       chan; /* channels */
+    long      m;    /* frames to mix */
+    long      s;    /* first frame under filter */
+    long      f;
+    short     tmp[RSMTAP*2]; /* frames at the ends of the wave */
+    short*    sp;
+    int       l, r; /* left and right samples */
+    int       i, k;
+
+    wb = vp->wb;
+    data = wb->data;
+    chan = wb->chan;
+    if (!vp->flt) { /* same rate, mix straight */
+
+        m = wb->frames-vp->pos;
+        if (m > n) m = n;
+        if (chan == 2) krnmix(acc, &data[vp->pos*2], m, vp->lgain, vp->rgain);
+        else for (i = 0; i < m; i++) {
+
+            acc[i*2] += data[vp->pos+i]*vp->lgain>>16;
+            acc[i*2+1] += data[vp->pos+i]*vp->rgain>>16;
+
+        }
+        vp->pos += m;
+
+        return (vp->pos < wb->frames);
+
+    }
+    for (i = 0; i < n; i++) {
+
+        s = vp->pos-RSMTAP/2+1;
+        if (s >= wb->frames) return (FALSE); /* filter is past the end */
+        if (s >= 0 && s+RSMTAP <= wb->frames) sp = &data[s*chan];
+        else { /* at an end, fill frames outside the wave with zero */
+
+            for (k = 0; k < RSMTAP*chan; k++) {
+
+                f = s+k/chan;
+                tmp[k] = f >= 0 && f < wb->frames ? data[s*chan+k] : 0;
+
+            }
+            sp = tmp;
+
+        }
+        if (chan == 2)
+            krnflt2(sp, vp->flt->coef2[vp->frac*RSMPHS>>16], &l, &r);
+        else l = r = krnflt1(sp, vp->flt->coef[vp->frac*RSMPHS>>16]);
+        /* filter can overshoot, keep to 16 bits */
+        l = l > 32767 ? 32767 : l < -32768 ? -32768 : l;
+        r = r > 32767 ? 32767 : r < -32768 ? -32768 : r;
+        acc[i*2] += l*vp->lgain>>16;
+        acc[i*2+1] += r*vp->rgain>>16;
+        vp->frac += vp->step; /* step through source */
+        vp->pos += vp->frac>>16;
+        vp->frac &= 0xffff;
+
+    }
+
+    return (TRUE);
+
+}
+
+/*******************************************************************************
+
+Configure wave mixer output
 
-The active sequencer count includes all sequencers, including syth (midi) file
-plays and individual notes/events sent to the midi "manual" interface. Thus this
-call only makes sense if the calling program has stopped sending events to the
-sequencer(s), including background tasks.
+Sets the output port to the mixer format, which is 16 bit signed samples in the
+machine byte order, in one or two channels at the rate of the port. The buffer
+latency for the port is set to a few mixer periods, so that new plays are heard
+shortly after they start. The setting is done through the device vectors, so it
+works the same for plug-in devices.
+
+This is done once, before the first period is written. The mixer thread is the
+only writer of the port, so the format does not change after that.
 
 *******************************************************************************/
 
-void pa_waitsynth(int p)
+static void mixcfg(int p)
 
 {
 
-    if (p < 1 || p > MAXMIDP) error("Invalid synthesizer port");
-    if (!alsamidiout[p-1]) error("No synthsizer defined for logical port");
-    if (!alsamidiout[p-1]->devopn) error("Synthsizer port not open");
+    mixptr mp; /* mixer */
+    devptr dp; /* device */
 
-    pthread_mutex_lock(&snmlck); /* lock counter */
-    pthread_cond_wait(&snmzer, &snmlck); /* wait zero event */
-    pthread_mutex_unlock(&snmlck); /* release lock */
+    mp = &wavmix[p-1];
+    dp = alsapcmout[p-1];
+    dp->chanwavout(p, mp->chan);
+    dp->ratewavout(p, mp->rate);
+    dp->lenwavout(p, 16);
+    dp->sgnwavout(p, TRUE);
+    dp->fltwavout(p, FALSE);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    dp->endwavout(p, TRUE);
+#else
+    dp->endwavout(p, FALSE);
+#endif
+    dp->lat = (long long)mp->per*MIXPERS*1000000/mp->rate;
+    mp->cfg = TRUE; /* set configured */
 
 }
 
 /*******************************************************************************
 
-Find number of output wave devices.
+Find stream frames needed for a period
 
-Returns the number of wave output devices available.
+Finds the number of frames the wave stream must have buffered to fill a mixer
+period at the stream rate, including the next frame used for interpolation. It
+is limited to half the stream buffer, so a writer can always fill it. Done with
+the mixer lock held.
 
 *******************************************************************************/
 
-int pa_waveout(void)
+static long strneed(mixptr mp)
 
 {
 
-    return (alsapcmoutnum);
+    long n; /* frames needed */
+
+    n = (long long)mp->per*mp->urate/mp->rate+2;
+    if (n > mp->ssiz/2) n = mp->ssiz/2;
+
+    return (n);
 
 }
 
 /*******************************************************************************
 
-Find number of input wave devices.
+Mix wave stream
 
-Returns the number of wave output devices available.
+Mixes a period of the wave stream written by pa_wrwave() into the mix
+accumulator, at full volume. The stream is kept at the rate the caller set, and
+is converted to the mixer rate by linear interpolation between frames. A rate
+change applies to data already in the stream buffer.
+
+If the stream runs short, the rest of the period is left silent. Frames taken
+from the stream buffer make room for the writer, which is signaled. Done with
+the mixer lock held.
 
 *******************************************************************************/
 
-int pa_wavein(void)
+static void strmix(mixptr mp, int* acc, int n)
 
 {
 
-    return (alsapcminnum);
+    unsigned int step; /* stream frames per mixer frame, 16.16 */
+    long         f0, f1; /* stream frames either side of position */
+    int          i, c;
+
+    if (mp->scnt < 2) return; /* not enough to interpolate */
+    step = ((long long)mp->urate<<16)/mp->rate;
+    for (i = 0; i < n && mp->scnt >= 2; i++) {
+
+        f0 = mp->sout*2;
+        f1 = (mp->sout+1)%mp->ssiz*2;
+        for (c = 0; c < 2; c++)
+            acc[i*2+c] += mp->sbuf[f0+c]+
+                (int)((long long)(mp->sbuf[f1+c]-mp->sbuf[f0+c])*mp->sfrc>>16);
+        mp->sfrc += step; /* advance position */
+        while (mp->sfrc >= 65536 && mp->scnt) {
+
+            mp->sfrc -= 65536;
+            mp->sout = (mp->sout+1)%mp->ssiz;
+            mp->scnt--;
+
+        }
+
+    }
+    pthread_cond_broadcast(&mp->scnd); /* signal room */
 
 }
 
 /*******************************************************************************
 
-Open wave output device
+Wave mixer thread
 
-Opens a wave output device by number. By convention, wave out 1 is the default
-output device. This is presently a no-op for linux.
+Each open wave output port has a mixer thread, which owns the output for wave
+plays on that port. New plays are taken from the intake list of the mixer and
+opened, then all active voices are mixed a period at a time and written to the
+port. Writing to the port blocks when the output buffer is full, which paces
+the mixer to the output rate.
+
+Data the caller writes with pa_wrwave() is mixed in as a stream, ahead of the
+voices. The thread is the only writer of the port, so the port is set to the
+mixer format once, and never set up again while it is running. When the mixer
+is stopped, any stream data left is played out before the thread exits.
+
+When no voices are active and the stream has less than a period, the thread
+waits on the mixer condition, and does not write to the port. The output then
+runs dry, which is recovered when the next play or stream data starts.
 
 *******************************************************************************/
 
-void pa_openwaveout(int p)
+static void* wave_mixer_thread(void* data)
 
 {
 
-    int r;
+    int      p;    /* port */
+    mixptr   mp;   /* mixer */
+    voiceptr vp;   /* voice */
+    voiceptr vl;   /* voice list */
+    voiceptr lp;   /* last voice in active list */
+    voiceptr fl;   /* list of voices to free */
+    int*     acc;  /* mix accumulator */
+    short*   out;  /* output buffer */
+    int      n;    /* frames in period */
+    int      str;  /* stream is ready to mix */
+    int      i;
 
-    if (p < 1 || p > MAXWAVP) error("Invalid wave output port");
-    if (!alsapcmout[p-1]) error("No wave output device defined at logical number");
-    if (alsapcmout[p-1]->devopn) error("Wave port already open");
+    p = (int)(long)data; /* get port */
+    mp = &wavmix[p-1];
+    acc = malloc(sizeof(int)*MIXMAX*2);
+    out = malloc(sizeof(short)*MIXMAX*2);
+    if (!acc || !out) error("Out of memory");
+    pthread_mutex_lock(&mp->lock); /* take mixer lock */
+    while (!mp->stop || mp->scnt >= 2) {
 
-    alsapcmout[p-1]->open(p); /* open device */
-    alsapcmout[p-1]->devopn = TRUE; /* set open */
-    alsapcmout[p-1]->fmt = -1; /* set format undefined until read/write time */
+        /* move new plays to active list, and open them */
+        vl = mp->inq;
+        mp->inq = NULL;
+        /* mix the stream when it fills a period, or to empty it on stop */
+        str = mp->scnt >= strneed(mp) || mp->stop;
+        pthread_mutex_unlock(&mp->lock); /* release mixer lock */
+        while (vl) {
+
+            vp = vl;
+            vl = vl->next;
+            vocopn(vp, mp);
+            vp->next = mp->act;
+            mp->act = vp;
+
+        }
+        if (mp->act || str) { /* mix a period */
+
+            n = mp->per; /* get period size */
+            for (i = 0; i < n*2; i++) acc[i] = 0; /* clear mix */
+            pthread_mutex_lock(&mp->lock); /* take mixer lock */
+            strmix(mp, acc, n); /* mix stream */
+            pthread_mutex_unlock(&mp->lock); /* release mixer lock */
+            /* mix voices, and remove finished voices */
+            fl = NULL;
+            lp = NULL;
+            vp = mp->act;
+            while (vp) {
+
+                vl = vp->next;
+                if (vocmix(vp, acc, n)) lp = vp; /* still active */
+                else { /* ended, remove from active list */
+
+                    if (lp) lp->next = vl; else mp->act = vl;
+                    vp->next = fl;
+                    fl = vp;
+
+                }
+                vp = vl;
+
+            }
+            /* clip to output samples */
+            if (mp->chan == 1) { /* fold to mono */
+
+                for (i = 0; i < n; i++) acc[i] = (acc[i*2]+acc[i*2+1])/2;
+                krnclp(out, acc, n);
+
+            } else krnclp(out, acc, n*2);
+            if (!mp->cfg) mixcfg(p); /* configure output */
+            alsapcmout[p-1]->wrwav(p, (byte*)out, n);
+            /* finished voices are complete once their last period is out */
+            for (vp = fl; vp; vp = vp->next) voccls(vp);
+            pthread_mutex_lock(&mp->lock); /* take mixer lock */
+            if (fl) { /* return finished voices to free list */
+
+                for (vp = fl; vp->next; vp = vp->next);
+                vp->next = mp->fre;
+                mp->fre = fl;
+
+            }
+
+        } else {
+
+            /* nothing to play, wait for new plays or stream data */
+            pthread_mutex_lock(&mp->lock); /* take mixer lock */
+            if (!mp->inq && !mp->stop && mp->scnt < strneed(mp))
+                pthread_cond_wait(&mp->cond, &mp->lock);
+
+        }
+
+    }
+    /* stopping, abandon any remaining plays */
+    vl = mp->inq;
+    mp->inq = NULL;
+    pthread_mutex_unlock(&mp->lock); /* release mixer lock */
+    while (mp->act) {
+
+        vp = mp->act;
+        mp->act = vp->next;
+        voccls(vp);
+        free(vp);
+
+    }
+    while (vl) {
+
+        vp = vl;
+        vl = vl->next;
+        voccls(vp);
+        free(vp);
+
+    }
+    free(acc);
+    free(out);
+
+    return (NULL);
 
 }
 
 /*******************************************************************************
 
-CLose wave output device
+Start wave mixer
 
-Closes a wave output device by number. This is presently a no-op for linux.
+Starts the mixer thread for a wave output port. This is done when the port is
+opened.
 
 *******************************************************************************/
 
-void pa_closewaveout(int p)
+static void mixstr(int p)
 
 {
 
-    if (p < 1 || p > MAXWAVP) error("Invalid wave output port");
-    if (!alsapcmout[p]) error("No wave output device defined at logical number");
-    if (!alsapcmout[p-1]->devopn) error("Wave port not open");
-
-    alsapcmout[p-1]->close(p); /* close device */
-    alsapcmout[p-1]->devopn = FALSE; /* set closed */
+    mixptr mp; /* mixer */
+    devptr dp; /* device */
 
+    mp = &wavmix[p-1];
+    dp = alsapcmout[p-1];
+    /* mix in stereo, or mono if the device is mono */
+    mp->chan = dp->chan >= 2 ? 2 : 1;
+    mp->rate = dp->rate > 0 ? dp->rate : MIXRATE;
+    mp->cfg = FALSE; /* set output not configured */
+    /* stream data starts in the format the device opened with */
+    mp->uchan = dp->chan;
+    mp->urate = dp->rate > 0 ? dp->rate : mp->rate;
+    mp->ulen = dp->bits;
+    mp->usgn = dp->sgn;
+    mp->uflt = dp->flt;
+    mp->uend = dp->big;
+    mp->ssiz = STRFRM;
+    mp->sbuf = malloc(sizeof(short)*mp->ssiz*2);
+    if (!mp->sbuf) error("Out of memory");
+    mp->sout = 0;
+    mp->scnt = 0;
+    mp->sfrc = 0;
+    mp->stop = FALSE;
+    mp->inq = NULL;
+    mp->act = NULL;
+    pthread_create(&mp->tid, NULL, wave_mixer_thread, (void*)(long)p);
 
 }
 
 /*******************************************************************************
 
-Play ALSA sound file
+Stop wave mixer
 
-Plays the given ALSA sound file given the logical wave track file number.
-Accepts a limited number of formats for the .wav file. A format header must
-appear after the initial chunk, and we don't accept further format changes.
+Stops the mixer thread for a wave output port and waits for it to exit. Data
+written with pa_wrwave() is played out, but any wave plays still active are
+abandoned. This is done when the port is closed.
 
 *******************************************************************************/
 
-static void* alsaplaywave(void* data)
+static void mixstp(int p)
 
 {
 
-    wavhdr            whd;    /* .wav file header */
-    fmthdr            fhd;    /* fmt chunk header */
-    cnkhdr            chd;    /* data chunk header */
-    snd_pcm_t*        pdh;    /* playback device handle */
-    snd_pcm_format_t  fmt;    /* PCM format */
-    snd_pcm_uframes_t frmsiz; /* frame size, sample bits*channels */
-    unsigned int      remsiz; /* remaining transfer bytes */
-    snd_pcm_uframes_t remfrm; /* remaining frames to transfer */
-    unsigned int      xfrsiz; /* partial transfer size */
-    snd_pcm_uframes_t frmbuf; /* frames in buffer */
-    portidptr         pip;    /* pointer for data we need */
-    int               w;      /* wave file instance */
-    int               p;      /* port */
-    int               fh;
-    int               r;
-    int               len;
-    byte              buff[WAVBUF]; /* buffer for frames */
-    int               i;
-    byte*             buffp;
-    char              fn[MAXFIL];
+    mixptr   mp; /* mixer */
+    voiceptr vp;
+    rsmptr   fp;
 
-    pip = (portidptr) data; /* get data pointer */
-    w = pip->id; /* get id */
-    p = pip->port; /* get port */
+    mp = &wavmix[p-1];
+    pthread_mutex_lock(&mp->lock); /* take mixer lock */
+    mp->stop = TRUE; /* flag stop */
+    pthread_cond_signal(&mp->cond);
+    pthread_cond_broadcast(&mp->scnd); /* release any waiting writer */
+    pthread_mutex_unlock(&mp->lock); /* release mixer lock */
+    pthread_join(mp->tid, NULL); /* wait for exit */
+    free(mp->sbuf);
+    mp->sbuf = NULL;
+    while (mp->fre) { /* release free voices */
 
-    /* Have to be very careful about wavetable access, we won't call external
-       routines with the lock on. We are read access, the writer is the
-       delwave() routine. We have to get the filename while locked, copy it
-       out of the table to fixed string (can't call malloc), then check we
-       actually got it outside the lock */
-    pthread_mutex_lock(&wavlck); /* take wave table lock */
-    fn[0] = 0; /* terminate wave table entry */
-    if (wavfil[w]) strncpy(fn, wavfil[w], MAXFIL);
-    pthread_mutex_unlock(&wavlck); /* release lock */
-    if (!fn[0]) return (NULL); /* entry is empty, abort */
+        vp = mp->fre;
+        mp->fre = vp->next;
+        free(vp);
 
-    /* count active wave instances */
-    pthread_mutex_lock(&wnmlck);
-    numwav++; /* count active */
-    pthread_mutex_unlock(&wnmlck); /* release lock */
+    }
+    while (mp->rsm) { /* release resampling filters */
 
-    fh = open(fn, O_RDONLY);
-    if (fh < 0) error("Cannot open input .wav file");
+        fp = mp->rsm;
+        mp->rsm = fp->next;
+        free(fp);
 
-    /* Read in IFF File header */
-    len = read(fh, &whd, sizeof(wavhdr));
-    if (len != sizeof(wavhdr)) error(".wav file format");
+    }
 
-    /* check a RIFF header with WAVE type */
-    if (strncmpus(whd.id, "RIFF", 4) || strncmpus(whd.type, "WAVE", 4))
-       error("Not a valid .wav file");
+}
+
+/*******************************************************************************
 
-    /* read in fmt header. Note we expect that at the top of the file, and that
-       there is only one such header. */
-    len = read(fh, &fhd, sizeof(fmthdr));
-    if (len != sizeof(fmthdr)) error(".wav file format");
+Wave decode thread
 
-    /* check a format header */
-    if (strncmpus(fhd.id, "fmt ", 4)) error("Not a valid .wav file");
+Decodes waves whose samples were evicted from the cache, for plays that are
+waiting on them, then places each play on the intake of the mixer for its port.
+This keeps file reads and decoding off the mixer threads, which must keep the
+output fed, and off the sequencer thread, which must keep time. The thread is
+started when the first evicted wave is played.
 
-    r = snd_pcm_open(&pdh, alsapcmout[p-1]->name, SND_PCM_STREAM_PLAYBACK, 0);
-    if (r < 0) error("Cannot open audio output device");
+A play whose file no longer exists is dropped. So is a play for a port that was
+closed meanwhile, since its mixer thread is gone.
 
-    /* set PCM format */
-    switch (fhd.bitspersample) {
+*******************************************************************************/
 
-        case 8:  fmt = SND_PCM_FORMAT_U8;  break;
-        case 16: fmt = SND_PCM_FORMAT_S16; break;
-        case 24: fmt = SND_PCM_FORMAT_S24; break;
-        case 32: fmt = SND_PCM_FORMAT_S32; break;
-        default: error("Cannot play this PCM format");
+static void* wave_decode_thread(void* data)
 
-    }
-    r = snd_pcm_set_params(pdh, fmt, SND_PCM_ACCESS_RW_INTERLEAVED,
-                           fhd.channels, fhd.samplerate, 1, 500000);
-    if (r < 0) error("Cannot set sound parameters");
+{
 
-    /* calculate frame size, or minimum transfer length in bytes */
-    frmsiz = fhd.blockalign*fhd.channels;
-    frmbuf = WAVBUF/frmsiz; /* find number of frames in a buffer */
+    voiceptr  vp;   /* voice */
+    wavbufptr wb;   /* wave entry */
+    mixptr    mp;   /* mixer */
+    wavbuf    fmt;  /* format of decode */
+    short*    sp;   /* decoded samples */
+    long      len;  /* length of samples */
+    int       rdy;  /* wave is ready */
 
-    /* read data chunks */
-    do {
+    pthread_mutex_lock(&declck); /* take decode queue lock */
+    while (TRUE) {
 
-        len = read(fh, &chd, sizeof(cnkhdr));
-        if (len && len != sizeof(cnkhdr)) error(".wav file format");
-        if (len) { /* not EOF */
+        while (!decq) pthread_cond_wait(&deccnd, &declck);
+        vp = decq; /* remove next play */
+        decq = vp->next;
+        pthread_mutex_unlock(&declck); /* release decode queue lock */
+        wb = vp->wb;
+        pthread_mutex_lock(&wavlck); /* take wave table lock */
+        rdy = !!wb->data; /* may have been decoded for an earlier play */
+        pthread_mutex_unlock(&wavlck); /* release lock */
+        if (!rdy) { /* decode again */
 
-            if (!strncmpus(chd.id, "data", 4)) {
+            sp = wavdec(wb->fn, &fmt, &len);
+            if (sp) {
 
-                /* is a "data" chunk, play */
-                remsiz = chd.len; /* set remaining transfer length */
-                while (remsiz) {
+                pthread_mutex_lock(&wavlck); /* take wave table lock */
+                if (!wb->data) { /* not decoded meanwhile */
 
-                    /* find number of frames remaining */
-                    remfrm = remsiz/frmsiz;
-                    if (remfrm > frmbuf) remfrm = frmbuf;
-                    xfrsiz = remfrm*frmsiz; /* find bytes to transfer */
-                    len = read(fh, buff, xfrsiz);
-                    if (len != xfrsiz) error(".wav file format");
-                    r = snd_pcm_writei(pdh, &buff, remfrm);
-                    // If an error, try to recover from it
-                    if (r < 0) r = snd_pcm_recover(pdh, r, 0);
-                    if (r < 0) error("Cannot play .wav file");
-                    remsiz -= xfrsiz; /* find remaining total size */
+                    wb->data = sp;
+                    wb->frames = fmt.frames;
+                    wb->len = len;
+                    wavmem += len;
+                    wavevc(); /* keep to budget */
+                    sp = NULL;
 
                 }
+                pthread_mutex_unlock(&wavlck); /* release lock */
+                free(sp); /* free if not used */
+                rdy = TRUE;
 
-            } else {
+            }
 
-                /* skip unrecognized chunk */
-                if (chd.len & 1) lseek(fh, chd.len+1, SEEK_CUR);
-                else lseek(fh, chd.len, SEEK_CUR);
+        }
+        mp = &wavmix[vp->port-1];
+        pthread_mutex_lock(&mp->lock); /* take mixer lock */
+        if (rdy && !mp->stop) { /* place on mixer intake */
 
-            }
+            vp->next = mp->inq;
+            mp->inq = vp;
+            pthread_cond_signal(&mp->cond);
+            vp = NULL;
 
         }
+        pthread_mutex_unlock(&mp->lock); /* release mixer lock */
+        if (vp) { /* could not play, drop */
 
-    } while (len); /* not EOF */
+            voccls(vp);
+            free(vp);
 
-    snd_pcm_drain(pdh); /* drain partial frames */
-    snd_pcm_close(pdh); /* close playback device */
-    close(fh); /* close input file */
+        }
+        pthread_mutex_lock(&declck); /* take decode queue lock */
 
-    /* count active wave instances */
-    pthread_mutex_lock(&wnmlck);
-    numwav--; /* count active */
-    /* if now zero, signal zero crossing */
-    if (!numwav) pthread_cond_signal(&wnmzer);
-    pthread_mutex_unlock(&wnmlck); /* release lock */
-    if (numwav < 0) error("Wave locking imbalance");
-    free(pip); /* release data pointer */
+    }
 
     return (NULL);
 
@@ -4880,9 +6718,14 @@ static void* alsaplaywave(void* data)
 
 Play ALSA sound file kickoff routine
 
-Plays an ALSA .wav file. This is the kickoff routine. We play .wav files on a
-thread, and this routine spawns a thread to accomplish that. The thread is
-"set and forget", in that it self terminates when the play routine terminates.
+Starts a play of a .wav file on the mixer for the port. This gets a voice,
+sets its wave, volume and pan position from the current settings of the port,
+and places it on the intake of the mixer. The voice holds a reference to the
+decoded wave, so the wave is shared by all of its plays without copying. The
+mixer mixes it in at the start of its next period. If the samples of the wave
+were evicted from the cache, the play goes to the decode thread instead, which
+passes it on to the mixer once the wave is decoded again. This does not block,
+so it can be called from the sequencer.
 
 *******************************************************************************/
 
@@ -4890,13 +6733,81 @@ static void alsaplaywave_kickoff(int p, int w)
 
 {
 
-    pthread_t tid; /* thread id (unused) */
-    portidptr pip; /* port/id structure */
+    mixptr   mp;   /* mixer */
+    voiceptr vp;   /* voice */
+    long long pan; /* pan position */
+    long long vol; /* volume */
+    int      rdy;  /* wave samples are present */
+
+    mp = &wavmix[p-1];
+    pthread_mutex_lock(&mp->lock); /* take mixer lock */
+    vp = mp->fre; /* get a free voice */
+    if (vp) mp->fre = vp->next;
+    pthread_mutex_unlock(&mp->lock); /* release mixer lock */
+    if (!vp) {
+
+        vp = malloc(sizeof(voice)); /* get a new voice */
+        if (!vp) error("Out of memory");
+
+    }
+
+    /* Take a reference to the wave while locked. The writer is the delwave()
+       routine, and the wave stays valid until we release it */
+    pthread_mutex_lock(&wavlck); /* take wave table lock */
+    vp->wb = wavtab[w-1];
+    if (vp->wb) {
+
+        vp->wb->ref++; /* add play reference */
+        wavfnt(vp->wb); /* set most recently used */
+        rdy = !!vp->wb->data; /* the reference keeps them from eviction */
+
+    }
+    pthread_mutex_unlock(&wavlck); /* release lock */
+    if (!vp->wb) { /* entry is empty, abort */
+
+        pthread_mutex_lock(&mp->lock);
+        vp->next = mp->fre;
+        mp->fre = vp;
+        pthread_mutex_unlock(&mp->lock);
+        return;
+
+    }
+
+    /* find left and right gains from volume and pan, 0 to 65536 */
+    vol = (long long)mp->vol*65536/INT_MAX;
+    pan = (long long)mp->pan*65536/INT_MAX;
+    vp->lgain = pan > 0 ? vol*(65536-pan)/65536 : vol;
+    vp->rgain = pan < 0 ? vol*(65536+pan)/65536 : vol;
+    vp->port = p;
+
+    /* count active wave instances */
+    pthread_mutex_lock(&wnmlck);
+    numwav++; /* count active */
+    pthread_mutex_unlock(&wnmlck); /* release lock */
+
+    if (rdy) { /* place on mixer intake */
+
+        pthread_mutex_lock(&mp->lock); /* take mixer lock */
+        vp->next = mp->inq;
+        mp->inq = vp;
+        pthread_cond_signal(&mp->cond);
+        pthread_mutex_unlock(&mp->lock); /* release mixer lock */
+
+    } else { /* evicted, place on decode queue */
+
+        pthread_mutex_lock(&declck); /* take decode queue lock */
+        if (!decrun) { /* start decode thread */
+
+            pthread_create(&dectid, NULL, wave_decode_thread, NULL);
+            decrun = TRUE;
 
-    pip = malloc(sizeof(portid)); /* get a port/id structure */
-    pip->port = p; /* place port */
-    pip->id = w; /* place synth file id */
-    pthread_create(&tid, NULL, alsaplaywave, (void*)pip);
+        }
+        vp->next = decq;
+        decq = vp;
+        pthread_cond_signal(&deccnd);
+        pthread_mutex_unlock(&declck); /* release decode queue lock */
+
+    }
 
 }
 
@@ -4911,8 +6822,11 @@ type is system dependent.
 Note that we support 100 wave files loaded, but the Petit-ami "rule of thumb"
 is no more than 10 wave files at a time.
 
-Note that at present, we don't implement wave caching. This is mainly because on
-the test system, the latency to play is acceptable.
+The file is decoded here, once, to 16 bit samples in memory. Plays share the
+decoded samples, so starting a play does not touch the file. If the wave_cache
+value in the sound block of the configuration sets a budget, the samples of the
+least recently played waves are dropped when over budget, and decoded again
+from the file when next played.
 
 *******************************************************************************/
 
@@ -4920,22 +6834,40 @@ void pa_loadwave(int w, string fn)
 
 {
 
-    string p, p2;
+    wavbufptr wb, wb2;
     char fnh[MAXFNM]; /* file name holder */
+    short* data;      /* decoded samples */
 
     if (w < 1 || w > MAXWAVT) error("Invalid logical wave number");
 
     /* copy filename and add extension if required */
     strcpy(fnh, fn); /* copy */
     setext(fnh, ".wav"); /* set or overwrite extension */
-    p = malloc(strlen(fnh)+1); /* allocate filename for slot */
-    if (!p) error("Could not alocate wave file");
-    strcpy(p, fnh); /* place filename */
+    wb = malloc(sizeof(wavbuf)); /* allocate wave entry */
+    if (!wb) error("Could not alocate wave file");
+    wb->fn = malloc(strlen(fnh)+1); /* allocate filename for slot */
+    if (!wb->fn) error("Could not alocate wave file");
+    strcpy(wb->fn, fnh); /* place filename */
+    data = wavdec(wb->fn, wb, &wb->len); /* decode file */
+    if (!data) error("Cannot open input .wav file");
+    wb->data = data;
+    wb->ref = 1; /* set referenced by table */
     pthread_mutex_lock(&wavlck); /* take wave table lock */
-    p2 = wavfil[w]; /* get existing entry */
-    wavfil[w] = p; /* place new */
+    wb2 = wavtab[w-1]; /* get existing entry */
+    if (!wb2) {
+
+        wavtab[w-1] = wb; /* place new */
+        /* insert at most recently used */
+        wb->next = wavlru;
+        if (wavlru) { wb->last = wavlru->last; wavlru->last = wb; }
+        else wb->last = wb;
+        wavlru = wb;
+        wavmem += wb->len; /* count memory and keep to budget */
+        wavevc();
+
+    }
     pthread_mutex_unlock(&wavlck); /* release lock */
-    if (p2) error("Wave file already defined for logical wave number");
+    if (wb2) error("Wave file already defined for logical wave number");
 
 }
 
@@ -4944,7 +6876,8 @@ void pa_loadwave(int w, string fn)
 Delete waveform file
 
 Removes a waveform file from the caching table. This frees up the entry to be
-redefined.
+redefined. Plays of the wave that are active continue, and the decoded wave is
+freed when the last of them ends.
 
 *******************************************************************************/
 
@@ -4952,16 +6885,32 @@ void pa_delwave(int w)
 
 {
 
-    string p;
+    wavbufptr wb;
 
     if (w < 1 || w > MAXWAVT) error("Invalid logical wave number");
 
     pthread_mutex_lock(&wavlck); /* take wave table lock */
-    p = wavfil[w]; /* get the existing entry */
-    wavfil[w] = NULL; /* clear original */
+    wb = wavtab[w-1]; /* get the existing entry */
+    wavtab[w-1] = NULL; /* clear original */
+    if (wb) { /* remove from LRU list */
+
+        if (wb == wavlru) {
+
+            wavlru = wb->next;
+            if (wavlru) wavlru->last = wb->last;
+
+        } else {
+
+            wb->last->next = wb->next;
+            if (wb->next) wb->next->last = wb->last;
+            else wavlru->last = wb->last; /* was tail */
+
+        }
+
+    }
     pthread_mutex_unlock(&wavlck); /* release lock */
-    if (!p) error("No wave file loaded for logical wave number");
-    free(p); /* free the entry */
+    if (!wb) error("No wave file loaded for logical wave number");
+    wavrel(wb); /* release table reference */
 
 }
 
@@ -4987,7 +6936,7 @@ void pa_playwave(int p, int t, int w)
     if (!alsapcmout[p-1]) error("No wave device defined for logical port");
     if (!alsapcmout[p-1]->devopn) error("Wave port not open");
     if (w < 1 || w > MAXWAVT) error("Invalid logical wave number");
-    if (!wavfil[w]) error("No wave file loaded for logical wave number");
+    if (!wavtab[w-1]) error("No wave file loaded for logical wave number");
 
     /* create sequencer entry */
     getseq(&sp); /* get a sequencer message */
@@ -5008,7 +6957,6 @@ void pa_playwave(int p, int t, int w)
         /* check sequencer running */
         if (!seqrun) error("Sequencer not running");
         insseq(sp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     }
 
@@ -5019,8 +6967,8 @@ void pa_playwave(int p, int t, int w)
 Adjust waveform volume
 
 Adjusts the volume on waveform playback. The volume value is from 0 to maxint.
-
-Not implemented at present.
+The volume applies to wave plays started on the port after it is set, so a
+sequenced volume change affects the plays sequenced after it.
 
 *******************************************************************************/
 
@@ -5028,10 +6976,35 @@ void pa_volwave(int p, int t, int v)
 
 {
 
+    pa_seqptr sp;   /* message pointer */
+    int    elap; /* current elapsed time */
+
     if (p < 1 || p > MAXWAVP) error("Invalid wave output port");
-    if (!alsapcmout[p]) error("No wave output device defined at logical number");
+    if (!alsapcmout[p-1]) error("No wave output device defined at logical number");
     if (!alsapcmout[p-1]->devopn) error("Wave port not open");
 
+    /* create sequencer entry */
+    getseq(&sp); /* get a sequencer message */
+    sp->port = p; /* set port */
+    sp->time = t; /* set time */
+    sp->st = st_volwave; /* set type */
+    sp->wv = v; /* set volume */
+
+    elap = timediff(&strtim); /* find elapsed time */
+    /* execute immediate if 0 or sequencer running and time past */
+    if (t == 0 || (t <= elap && seqrun)) {
+
+        wrtseq(sp); /* execute */
+        putseq(sp); /* free */
+
+    } else { /* sequence */
+
+        /* check sequencer running */
+        if (!seqrun) error("Sequencer not running");
+        insseq(sp); /* insert to sequencer list */
+
+    }
+
 }
 
 /*******************************************************************************
@@ -5060,7 +7033,8 @@ void pa_waitwave(int p)
     if (!alsapcmout[p-1]->devopn) error("Wave port not open");
 
     pthread_mutex_lock(&wnmlck); /* lock counter */
-    pthread_cond_wait(&wnmzer, &wnmlck); /* wait zero event */
+    /* wait zero event */
+    while (numwav) pthread_cond_wait(&wnmzer, &wnmlck);
     pthread_mutex_unlock(&wnmlck); /* release lock */
 
 }
@@ -5085,7 +7059,10 @@ void pa_chanwaveout(int p, int c)
     if (!alsapcmout[p-1]) error("No wave output device defined at logical number");
     if (!alsapcmout[p-1]->devopn) error("Wave port not open");
 
-    alsapcmout[p-1]->chanwavout(p, c); /* set channels */
+    /* the mixer converts pa_wrwave() data from this format */
+    pthread_mutex_lock(&wavmix[p-1].lock); /* take mixer lock */
+    wavmix[p-1].uchan = c; /* set channels */
+    pthread_mutex_unlock(&wavmix[p-1].lock); /* release mixer lock */
 
 }
 
@@ -5108,8 +7085,12 @@ void pa_ratewaveout(int p, int r)
     if (p < 1 || p > MAXWAVP) error("Invalid wave output port");
     if (!alsapcmout[p-1]) error("No wave output device defined at logical number");
     if (!alsapcmout[p-1]->devopn) error("Wave port not open");
+    if (r <= 0) error("Invalid wave output rate");
 
-    alsapcmout[p-1]->ratewavout(p, r); /* set rate */
+    /* the mixer converts pa_wrwave() data from this format */
+    pthread_mutex_lock(&wavmix[p-1].lock); /* take mixer lock */
+    wavmix[p-1].urate = r; /* set rate */
+    pthread_mutex_unlock(&wavmix[p-1].lock); /* release mixer lock */
 
 }
 
@@ -5133,7 +7114,10 @@ void pa_lenwaveout(int p, int l)
     if (!alsapcmout[p-1]) error("No wave output device defined at logical number");
     if (!alsapcmout[p-1]->devopn) error("Wave port not open");
 
-    alsapcmout[p-1]->lenwavout(p, l); /* set length */
+    /* the mixer converts pa_wrwave() data from this format */
+    pthread_mutex_lock(&wavmix[p-1].lock); /* take mixer lock */
+    wavmix[p-1].ulen = l; /* set length */
+    pthread_mutex_unlock(&wavmix[p-1].lock); /* release mixer lock */
 
 }
 
@@ -5154,7 +7138,10 @@ void pa_sgnwaveout(int p, int s)
     if (!alsapcmout[p-1]) error("No wave output device defined at logical number");
     if (!alsapcmout[p-1]->devopn) error("Wave port not open");
 
-    alsapcmout[p-1]->sgnwavout(p, s); /* set sign */
+    /* the mixer converts pa_wrwave() data from this format */
+    pthread_mutex_lock(&wavmix[p-1].lock); /* take mixer lock */
+    wavmix[p-1].usgn = s; /* set sign */
+    pthread_mutex_unlock(&wavmix[p-1].lock); /* release mixer lock */
 
 }
 
@@ -5174,7 +7161,10 @@ void pa_fltwaveout(int p, int f)
     if (!alsapcmout[p-1]) error("No wave output device defined at logical number");
     if (!alsapcmout[p-1]->devopn) error("Wave port not open");
 
-    alsapcmout[p-1]->fltwavout(p, f); /* set float */
+    /* the mixer converts pa_wrwave() data from this format */
+    pthread_mutex_lock(&wavmix[p-1].lock); /* take mixer lock */
+    wavmix[p-1].uflt = f; /* set float */
+    pthread_mutex_unlock(&wavmix[p-1].lock); /* release mixer lock */
 
 }
 
@@ -5196,7 +7186,10 @@ void pa_endwaveout(int p, int e)
     if (!alsapcmout[p-1]) error("No wave output device defined at logical number");
     if (!alsapcmout[p-1]->devopn) error("Wave port not open");
 
-    alsapcmout[p-1]->endwavout(p, e); /* set endian */
+    /* the mixer converts pa_wrwave() data from this format */
+    pthread_mutex_lock(&wavmix[p-1].lock); /* take mixer lock */
+    wavmix[p-1].uend = e; /* set endian */
+    pthread_mutex_unlock(&wavmix[p-1].lock); /* release mixer lock */
 
 }
 
@@ -5218,20 +7211,86 @@ the data is used without regard for realtime concerns. The nececessary buffering
 for real time is implemented by the user of this package, which is generally
 recommended to be 1ms or less (64 samples at a 44100 sample rate).
 
+The data is converted to stereo 16 bit samples and placed in the stream buffer
+of the port mixer, which mixes it with any wave plays and writes it to the
+device. This blocks while the stream buffer is full. Integer samples of 1 to 4
+bytes, packed, and floating point samples of 4 or 8 bytes are accepted. If the
+stream runs short while wave plays are active, the gap is filled with silence.
+Data short of a mixer period is held until more is written, or the port is
+closed.
+
 *******************************************************************************/
 
 void pa_wrwave(int p, byte* buff, int len)
 
 {
 
-    int r;
-    int bytes;
+    mixptr mp;             /* mixer */
+    byte   sb[STRCVT*8];   /* samples in .wav format */
+    float  fb[STRCVT];     /* samples in float */
+    short  ob[STRCVT*2];   /* stereo output frames */
+    int    chan, bytes, sgn, flt, big; /* format of data */
+    int    n;              /* frames in chunk */
+    int    l;              /* bits in sample */
+    int    r;              /* rate of data */
+    int    i, j;
+    long   si;
 
     if (p < 1 || p > MAXWAVP) error("Invalid wave output port");
     if (!alsapcmout[p-1]) error("No wave output device defined at logical number");
     if (!alsapcmout[p-1]->devopn) error("Wave port not open");
 
-    alsapcmout[p-1]->wrwav(p, buff, len);
+    mp = &wavmix[p-1];
+    pthread_mutex_lock(&mp->lock); /* take mixer lock */
+    chan = mp->uchan;
+    l = mp->ulen;
+    sgn = mp->usgn;
+    flt = mp->uflt;
+    big = mp->uend;
+    r = mp->urate;
+    pthread_mutex_unlock(&mp->lock); /* release mixer lock */
+    bytes = l/8;
+    if (chan < 1 || chan > STRCVT || r <= 0 || l%8 ||
+        (flt && bytes != 4 && bytes != 8) || (!flt && (bytes < 1 || bytes > 4)))
+        error("Cannot play this PCM format");
+    while (len > 0) {
+
+        /* convert a chunk of frames to stereo 16 bit */
+        n = STRCVT/chan;
+        if (n > len) n = len;
+        for (i = 0; i < n*chan; i++, buff += bytes) {
+
+            /* put sample in .wav order, little endian and signed */
+            for (j = 0; j < bytes; j++)
+                sb[i*bytes+j] = big ? buff[bytes-1-j] : buff[j];
+            /* flip the sign of signed bytes and unsigned words */
+            if (!flt && (bytes == 1 ? sgn : !sgn)) sb[i*bytes+bytes-1] ^= 0x80;
+
+        }
+        smpflt(sb, bytes, flt, n*chan, fb);
+        chnmix(fb, chan, n, ob, 2);
+        len -= n;
+        /* place in stream buffer, waiting for room as needed */
+        pthread_mutex_lock(&mp->lock); /* take mixer lock */
+        i = 0;
+        while (i < n && !mp->stop) {
+
+            while (mp->scnt >= mp->ssiz && !mp->stop)
+                pthread_cond_wait(&mp->scnd, &mp->lock);
+            for (; i < n && mp->scnt < mp->ssiz; i++) {
+
+                si = (mp->sout+mp->scnt)%mp->ssiz*2;
+                mp->sbuf[si] = ob[i*2];
+                mp->sbuf[si+1] = ob[i*2+1];
+                mp->scnt++;
+
+            }
+            pthread_cond_signal(&mp->cond); /* tell mixer */
+
+        }
+        pthread_mutex_unlock(&mp->lock); /* release mixer lock */
+
+    }
 
 }
 
@@ -5684,7 +7743,6 @@ void pa_wrsynth(int p, pa_seqptr sp)
         memcpy(spp, sp, sizeof(pa_seqmsg));
         spp->port = p; /* override the port number */
         insseq(spp); /* insert to sequencer list */
-        acttim(); /* kick timer if needed */
 
     } else  {
 
@@ -5706,6 +7764,60 @@ void pa_wrsynth(int p, pa_seqptr sp)
 
 /*******************************************************************************
 
+Write synthesizer port list
+
+Writes a list of sequencer instruction entries, linked by their next fields, to
+the given output port. Each entry is treated as by pa_wrsynth(), but the entries
+to be sequenced are sent to the sequencer together. This is the efficient way to
+schedule a whole track or song ahead of time.
+
+The entries given are not modified or freed. The port numbers in the input are
+ignored and replaced with the port given as a parameter.
+
+*******************************************************************************/
+
+void pa_wrsynthlst(int p, pa_seqptr sp)
+
+{
+
+    pa_seqptr spp;
+    pa_seqptr fl, ll; /* list of entries to sequence */
+
+    if (p < 1 || p > MAXMIDP) error("Invalid synthesizer port");
+    if (!alsamidiout[p-1]) error("No synthesizer defined for logical port");
+    if (!alsamidiout[p-1]->devopn) error("Synthesizer port not open");
+
+    fl = NULL; /* clear list to sequence */
+    ll = NULL;
+    while (sp) { /* traverse list */
+
+        /* make a copy of the command record */
+        getseq(&spp); /* get a sequencer message */
+        memcpy(spp, sp, sizeof(pa_seqmsg));
+        spp->port = p; /* override the port number */
+        spp->next = NULL;
+        if (sp->time) {
+
+            /* entry to be sequenced, add to end of list */
+            if (!seqrun) error("Sequencer not running");
+            if (ll) ll->next = spp; else fl = spp;
+            ll = spp;
+
+        } else {
+
+            wrtseq(spp); /* execute the synth note */
+            putseq(spp); /* free */
+
+        }
+        sp = sp->next; /* next entry */
+
+    }
+    insseqlst(fl); /* send list to sequencer */
+
+}
+
+/*******************************************************************************
+
 Read synthesizer port
 
 Reads and parses a midi instruction record from the given input port. ALSA midi
@@ -5803,10 +7915,20 @@ void pa_getparamwaveout(int p, string name, string value, int len)
 
 {
 
+    char buff[20];
+
     if (p < 1 || p > MAXWAVP) error("Invalid synthesizer port");
     if (!alsapcmout[p-1]) error("No wave device defined for logical port");
 
-    alsapcmout[p-1]->getparam(p, name, value, len);
+    if (!strcmp(name, "period") || !strcmp(name, "pan")) {
+
+        /* mixer parameter */
+        if (!strcmp(name, "period")) sprintf(buff, "%d", wavmix[p-1].per);
+        else sprintf(buff, "%d", wavmix[p-1].pan);
+        if (strlen(buff)+1 > (size_t)len) error("Parameter too long for buffer");
+        strcpy(value, buff);
+
+    } else alsapcmout[p-1]->getparam(p, name, value, len);
 
 }
 
@@ -5845,15 +7967,41 @@ If the parameter was successfully set, a 0 is returned, otherwise 1.
 Device parameters are generally implemented for plug-ins only. The set of
 parameters implemented on a particular device are dependent on that device.
 
+The synth file play controls are implemented here for all synth output devices.
+Each takes a logical synth file number, and applies to all plays of that file
+on the port, or to all plays on the port if the number is 0:
+
+stop   - Stops the plays. Any notes they have sounding are turned off.
+
+pause  - Pauses the plays. Any notes they have sounding are turned off.
+
+resume - Continues paused plays from where they were paused.
+
 *******************************************************************************/
 
 int pa_setparamsynthout(int p, string name, string value)
 
 {
 
+    long v;
+    char* ep;
+
     if (p < 1 || p > MAXMIDP) error("Invalid synthesizer port");
     if (!alsamidiout[p-1]) error("No synthsizer defined for logical port");
 
+    if (!strcmp(name, "stop") || !strcmp(name, "pause") ||
+        !strcmp(name, "resume")) {
+
+        v = strtol(value, &ep, 10);
+        if (!*value || *ep || v < 0 || v > MAXMIDT) return (1);
+        if (!strcmp(name, "stop")) plyctl(p, v, pc_stop);
+        else if (!strcmp(name, "pause")) plyctl(p, v, pc_pause);
+        else plyctl(p, v, pc_resume);
+
+        return (0);
+
+    }
+
     return (alsamidiout[p-1]->setparam(p, name, value));
 
 }
@@ -5894,15 +8042,47 @@ If the parameter was successfully set, a 0 is returned, otherwise 1.
 Device parameters are generally implemented for plug-ins only. The set of
 parameters implemented on a particular device are dependent on that device.
 
+The wave mixer parameters are implemented here for all wave output devices:
+
+period - The number of frames the mixer outputs at a time. The output buffer
+         holds a few periods, so this sets the delay from a play to its sound.
+         Takes effect when the port is next opened.
+
+pan    - The left/right position for wave plays started after it is set.
+         -maxint is hard left, 0 is center, maxint is hard right.
+
 *******************************************************************************/
 
 int pa_setparamwaveout(int p, string name, string value)
 
 {
 
+    long v;
+    char* ep;
+
     if (p < 1 || p > MAXWAVP) error("Invalid wave port");
     if (!alsapcmout[p-1]) error("No wave device defined for logical port");
 
+    if (!strcmp(name, "period") || !strcmp(name, "pan")) {
+
+        v = strtol(value, &ep, 10);
+        if (!*value || *ep) return (1); /* not a number */
+        if (!strcmp(name, "period")) {
+
+            if (v < 16 || v > MIXMAX) return (1);
+            wavmix[p-1].per = v;
+
+        } else {
+
+            if (v < -INT_MAX || v > INT_MAX) return (1);
+            wavmix[p-1].pan = v;
+
+        }
+
+        return (0);
+
+    }
+
     return (alsapcmout[p-1]->setparam(p, name, value));
 
 }
@@ -6237,7 +8417,13 @@ static void readalsadev(devptr table[], string devt, string iotyp, int tabmax,
             table[i]->wrseq = _pa_excseq; /* set sequencer execute function */
             table[i]->rdseq = inpseq; /* set sequencer read function */
             table[i]->midi = NULL; /* clear midi handle */
+            table[i]->olen = 0; /* set no midi output */
+            table[i]->osts = 0;
+            table[i]->otim = 0;
+            table[i]->opnd = FALSE;
+            pthread_mutex_init(&table[i]->olck, NULL);
             table[i]->pcm = NULL; /* clear PCM handle */
+            table[i]->lat = WAVLAT; /* set default output latency */
             table[i]->devopn = FALSE; /* set device not open */
             /* if the device is not midi, get the parameters of wave */
             if (strcmp(devt, "rawmidi")) {
@@ -6284,19 +8470,68 @@ static void pa_init_sound()
 
 {
 
-    int    i; /* index for midi tables */
+    int       i;           /* index for midi tables */
+    pa_valptr config_root; /* root for config block */
+    pa_valptr snd_root;    /* root for sound block */
+    pa_valptr vp;
+    char*     errstr;
 
-    seqlst = NULL; /* clear active sequencer list */
+    seqhep = NULL; /* clear active sequencer heap */
+    seqhepn = 0;
+    seqheps = 0;
+    seqser = 0;
+    seqinq = NULL; /* clear sequencer intake */
     seqfre = NULL; /* clear free sequencer messages */
     seqrun = FALSE; /* set sequencer not running */
     strtim.tv_sec = 0; /* clear start time */
-    strtim.tv_usec = 0;
+    strtim.tv_nsec = 0;
     sinrun = FALSE; /* set no input midi time marking */
     sintim.tv_sec = 0; /* clear input midi start time */
-    sintim.tv_usec = 0;
+    sintim.tv_nsec = 0;
 
     /* clear the wave track cache */
-    for (i = 0; i < MAXWAVT; i++) wavfil[i] = NULL;
+    for (i = 0; i < MAXWAVT; i++) wavtab[i] = NULL;
+    wavlru = NULL;
+    wavmem = 0;
+    wavbgt = 0;
+
+    /* get setup configuration */
+    config_root = NULL;
+    pa_config(&config_root);
+
+    /* find "sound" block */
+    snd_root = pa_schlst("sound", config_root);
+    if (snd_root && snd_root->sublist) snd_root = snd_root->sublist;
+
+    if (snd_root) {
+
+        /* find wave cache budget in kilobytes */
+        vp = pa_schlst("wave_cache", snd_root);
+        if (vp) {
+
+            wavbgt = strtol(vp->value, &errstr, 10)*1024;
+            if (*errstr || wavbgt < 0) error("Invalid configuration value");
+
+        }
+
+    }
+
+    /* set up the wave mixers */
+    for (i = 0; i < MAXWAVP; i++) {
+
+        pthread_mutex_init(&wavmix[i].lock, NULL);
+        pthread_cond_init(&wavmix[i].cond, NULL);
+        pthread_cond_init(&wavmix[i].scnd, NULL);
+        wavmix[i].sbuf = NULL;
+        wavmix[i].inq = NULL;
+        wavmix[i].act = NULL;
+        wavmix[i].fre = NULL;
+        wavmix[i].rsm = NULL;
+        wavmix[i].per = MIXPER;
+        wavmix[i].vol = INT_MAX;
+        wavmix[i].pan = 0;
+
+    }
 
     /* clear the synth track cache */
     for (i = 0; i < MAXMIDT; i++) syntab[i] = NULL;
@@ -6304,26 +8539,33 @@ static void pa_init_sound()
     /* clear the synth track active counts */
     for (i = 0; i < MAXMIDT; i++) numsql[i] = 0;
 
-    /* create sequencer timer */
-    seqhan = timerfd_create(CLOCK_REALTIME, 0);
+    /* create sequencer timer and intake event */
+    seqhan = timerfd_create(CLOCK_MONOTONIC, 0);
+    seqevt = eventfd(0, 0);
     seqtimact = FALSE;
 
     /* clear input select set */
     FD_ZERO(&ifdseta);
 
-    /* select input file */
+    /* select input files */
     FD_SET(seqhan, &ifdseta);
+    FD_SET(seqevt, &ifdseta);
 
     /* set current max input fd */
-    ifdmax = seqhan+1;
+    ifdmax = (seqhan > seqevt ? seqhan : seqevt)+1;
 
     pthread_mutex_init(&seqlock, NULL); /* init sequencer lock */
+    pthread_mutex_init(&seqflck, NULL); /* init sequencer free list lock */
 
     /* start sequencer thread */
     pthread_create(&sequencer_thread_id, NULL, sequencer_thread, NULL);
 
     /* initialize other locks */
     pthread_mutex_init(&wavlck, NULL); /* init wave output lock */
+    pthread_mutex_init(&declck, NULL); /* init wave decode queue lock */
+    pthread_cond_init(&deccnd, NULL);
+    decq = NULL; /* set no plays waiting on decode */
+    decrun = FALSE; /* set decode thread not started */
     pthread_mutex_init(&wnmlck, NULL); /* init wave count lock */
     pthread_mutex_init(&synlck, NULL); /* init synth sequencer lock */
     pthread_mutex_init(&snmlck, NULL); /* init synth count lock */
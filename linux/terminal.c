@@ -97,6 +97,7 @@
 #include <localdefs.h>
 #include <config.h>
 #include <terminal.h>
+#include <termenc.h>
 #include "system_event.h"
 
 #include <diag.h>
@@ -670,6 +671,7 @@ static int    nmpx;        /* mouse x/y current position */
 static int    nmpy;
 
 static pthread_mutex_t termlock;        /* broadlock for terminal calls */
+static pa_encrec trmenc;                /* terminal output encoder */
 static scnrec* screens[MAXCON];         /* screen contexts array */ 
 static int curdsp;                      /* index for current display screen */ 
 static int curupd;                      /* index for current update screen */ 
@@ -1007,7 +1009,8 @@ Write character to output file
 Writes a single character to the output file. Used to write to the output file
 directly.
 
-Uses the write() override.
+The character is collected in the output encoder, which is written out with
+trmflush(). Uses the write() override.
 
 *******************************************************************************/
 
@@ -1015,12 +1018,44 @@ static void putchr(unsigned char c)
 
 {
 
-    ssize_t rc; /* return code */
+    /* place in encoder, which may send to the next handler in the chain */
+    if (!pa_encchr(&trmenc, c)) error(pa_dispeoutdev); /* output device error */
+
+}
+
+/** ****************************************************************************
+
+Flush output file
+
+Sends the output collected in the encoder to the next handler in the override
+chain, in one write.
+
+*******************************************************************************/
+
+static void trmflush(void)
+
+{
+
+    if (!pa_encflush(&trmenc)) error(pa_dispeoutdev); /* output device error */
+
+}
+
+/** ****************************************************************************
+
+Release terminal broadlock
+
+Writes out the output from the call that held the lock, then releases the lock.
+This makes each API call, or write() to the terminal, a single write to the
+output file.
 
-    /* send character to the next hander in the override chain */
-    rc = (*ofpwrite)(OUTFIL, &c, 1);
+*******************************************************************************/
+
+static void trmunlock(void)
 
-    if (rc != 1) error(pa_dispeoutdev); /* output device error */
+{
+
+    trmflush(); /* write out collected output */
+    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
 
 }
 
@@ -1540,17 +1575,17 @@ a clear (as the ANSI spec says). We fake this by adding a specific cursor home.
 /** clear screen and home cursor */
 static void trm_clear(void) { putstrc("\33[2J\33[H"); }
 /** home cursor */ static void trm_home(void) { putstrc("\33[H"); }
-/** move cursor up */ static void trm_up(void) { putstrc("\33[A"); }
-/** move cursor down */ static void trm_down(void) { putstrc("\33[B"); }
-/** move cursor left */ static void trm_left(void) { putstrc("\33[D"); }
-/** move cursor right */ static void trm_right(void) { putstrc("\33[C"); }
-/** turn on blink attribute */ static void trm_blink(void) { putstrc("\33[5m"); }
-/** turn on reverse video */ static void trm_rev(void) { putstrc("\33[7m"); }
-/** turn on underline */ static void trm_undl(void) { putstrc("\33[4m"); }
-/** turn on bold attribute */ static void trm_bold(void) { putstrc("\33[1m"); }
-/** turn on italic attribute */ static void trm_ital(void) { putstrc("\33[3m"); }
+/** set graphic rendition, joined to the last if possible */
+static void trm_sgr(int n, int p[])
+    { if (!pa_encsgr(&trmenc, n, p)) error(pa_dispeoutdev); }
+/** set single graphic rendition */ static void trm_sgr1(int a) { trm_sgr(1, &a); }
+/** turn on blink attribute */ static void trm_blink(void) { trm_sgr1(5); }
+/** turn on reverse video */ static void trm_rev(void) { trm_sgr1(7); }
+/** turn on underline */ static void trm_undl(void) { trm_sgr1(4); }
+/** turn on bold attribute */ static void trm_bold(void) { trm_sgr1(1); }
+/** turn on italic attribute */ static void trm_ital(void) { trm_sgr1(3); }
 /** turn off all attributes */
-static void trm_attroff(void) { putstrc("\33[0m"); }
+static void trm_attroff(void) { trm_sgr1(0); }
 /** turn on cursor wrap */ static void trm_wrapon(void) { putstrc("\33[7h"); }
 /** turn off cursor wrap */ static void trm_wrapoff(void) { putstrc("\33[7l"); }
 /** turn off cursor */ static void trm_curoff(void) { putstrc("\33[?25l"); }
@@ -1561,13 +1596,14 @@ static void trm_fcolorrgb(int rgb)
 
 {
 
-    putstrc("\33[38;2;");
-    wrtint(rgb >> 16 & 0xff);
-    putstrc(";");
-    wrtint(rgb >> 8 & 0xff);
-    putstrc(";");
-    wrtint(rgb & 0xff);
-    putstrc("m");
+    int p[5]; /* SGR parameters */
+
+    p[0] = 38; /* set foreground rgb */
+    p[1] = 2;
+    p[2] = rgb >> 16 & 0xff;
+    p[3] = rgb >> 8 & 0xff;
+    p[4] = rgb & 0xff;
+    trm_sgr(5, p);
 
 }
 
@@ -1576,13 +1612,14 @@ static void trm_bcolorrgb(int rgb)
 
 {
 
-    putstrc("\33[48;2;");
-    wrtint(rgb >> 16 & 0xff);
-    putstrc(";");
-    wrtint(rgb >> 8 & 0xff);
-    putstrc(";");
-    wrtint(rgb & 0xff);
-    putstrc("m");
+    int p[5]; /* SGR parameters */
+
+    p[0] = 48; /* set background rgb */
+    p[1] = 2;
+    p[2] = rgb >> 16 & 0xff;
+    p[3] = rgb >> 8 & 0xff;
+    p[4] = rgb & 0xff;
+    trm_sgr(5, p);
 
 }
 
@@ -1592,22 +1629,16 @@ static void trm_fcolor(pa_color c)
 {
 
 #if defined(COLOR24) || defined(NATIVE24)
-    int r, g, b;
+    int p[5]; /* SGR parameters */
 
-    colnumrgb(c, &r, &g, &b); /* get rgb equivalent color */
-    putstrc("\33[38;2;");
-    wrtint(r);
-    putstrc(";");
-    wrtint(g);
-    putstrc(";");
-    wrtint(b);
-    putstrc("m");
+    p[0] = 38; /* set foreground rgb */
+    p[1] = 2;
+    colnumrgb(c, &p[2], &p[3], &p[4]); /* get rgb equivalent color */
+    trm_sgr(5, p);
 #else
-    putstrc("\33[");
     /* override "bright" black, which is more like grey */
-    if (c == pa_black) wrtint(ANSIFORECOLORBASE+colnum(c));
-    else wrtint(FORECOLORBASE+colnum(c));
-    putstrc("m");
+    if (c == pa_black) trm_sgr1(ANSIFORECOLORBASE+colnum(c));
+    else trm_sgr1(FORECOLORBASE+colnum(c));
 #endif
 
 }
@@ -1618,22 +1649,16 @@ static void trm_bcolor(pa_color c)
 {
 
 #if defined(COLOR24) || defined(NATIVE24)
-    int r, g, b;
+    int p[5]; /* SGR parameters */
 
-    colnumrgb(c, &r, &g, &b); /* get rgb equivalent color */
-    putstrc("\33[48;2;");
-    wrtint(r);
-    putstrc(";");
-    wrtint(g);
-    putstrc(";");
-    wrtint(b);
-    putstrc("m");
+    p[0] = 48; /* set background rgb */
+    p[1] = 2;
+    colnumrgb(c, &p[2], &p[3], &p[4]); /* get rgb equivalent color */
+    trm_sgr(5, p);
 #else
-    putstrc("\33[");
     /* override "bright" black, which is more like grey */
-    if (c == pa_black) wrtint(ANSIBACKCOLORBASE+colnum(c));
-    else wrtint(BACKCOLORBASE+colnum(c));
-    putstrc("m");
+    if (c == pa_black) trm_sgr1(ANSIBACKCOLORBASE+colnum(c));
+    else trm_sgr1(BACKCOLORBASE+colnum(c));
 #endif
 
 }
@@ -1818,16 +1843,11 @@ static void setcur(scnptr sc)
             /* set cursor position */
             if ((ncurx != curx || ncury != cury) && curval) {
 
-                /* Cursor position and actual don't match. Try some optimized
-                   cursor positions to reduce bandwidth. Note we don't count on
-                   real terminal behavior at the borders. */
-                if (ncurx == 1 && ncury == 1) trm_home();
-                else if (ncurx == curx && ncury == cury-1) trm_up();
-                else if (ncurx == curx && ncury == cury+1) trm_down();
-                else if (ncurx == curx-1 && ncury == cury) trm_left();
-                else if (ncurx == curx+1 && ncury == cury) trm_right();
-                else if (ncurx == 1 && ncury == cury) putchr('\r');
-                else trm_cursor(ncurx, ncury);
+                /* Cursor position and actual don't match. Let the encoder pick
+                   the shortest motion to reduce bandwidth. Note we don't count
+                   on real terminal behavior at the borders. */
+                if (!pa_enccur(&trmenc, curx, cury, ncurx, ncury))
+                    error(pa_dispeoutdev);
                 curx = ncurx;
                 cury = ncury;
                 curval = 1;
@@ -2314,8 +2334,10 @@ static void ievent(void)
             if (!evtfnd && sev.lse == respsev && unresponse) {
 
                 /* present unresponsive message and flag state */
+                pthread_mutex_lock(&termlock); /* lock terminal broadlock */
                 trm_title("Program unresponsive");
                 respto = TRUE;
+                trmunlock(); /* release terminal broadlock */
 
             }
 
@@ -3155,7 +3177,7 @@ static void readline(void)
     xoff = ncurx; /* save starting line offset */
     do { /* get line characters */
 
-        pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+        trmunlock(); /* release terminal broadlock */
         pa_event(stdin, &er); /* get next event */
         pthread_mutex_lock(&termlock); /* lock terminal broadlock */
         switch (er.etype) { /* event */
@@ -3526,7 +3548,7 @@ static ssize_t iread(int fd, void* buff, size_t count)
             if (*p == '\n') inpptr = -1;
             p++; /* next character */
             cnt--; /* count characters */
-            pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+            trmunlock(); /* release terminal broadlock */
 
         }
         rc = count; /* set return same as count */
@@ -3554,13 +3576,9 @@ static ssize_t iwrite(int fd, const void* buff, size_t count)
     if (fd == OUTFIL) {
 
         /* send data to terminal */
-        while (cnt--) {
-
-            pthread_mutex_lock(&termlock); /* lock terminal broadlock */
-            plcchr(screens[curupd-1], *p++);
-            pthread_mutex_unlock(&termlock); /* release terminal broadlock */
-
-        }
+        pthread_mutex_lock(&termlock); /* lock terminal broadlock */
+        while (cnt--) plcchr(screens[curupd-1], *p++);
+        trmunlock(); /* release terminal broadlock */
         rc = count; /* set return same as count */
 
     } else rc = (*ofpwrite)(fd, buff, count);
@@ -3662,7 +3680,7 @@ static void cursor_ivf(FILE *f, int x, int y)
     dbg_printf(dlapi, "API\n");
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     icursor(screens[curupd-1], x, y); /* position cursor */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -3685,7 +3703,7 @@ static int curbnd_ivf(FILE *f)
     dbg_printf(dlapi, "API\n");
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     fl = icurbnd(screens[curupd-1]);
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
     return (fl);
 
@@ -3750,7 +3768,7 @@ static void home_ivf(FILE *f)
     ncury = 1; /* set cursor at home */
     ncurx = 1;
     setcur(screens[curupd-1]);
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -3774,7 +3792,7 @@ static void del_ivf(FILE* f)
     ileft(screens[curupd-1]); /* back up cursor */
     plcchr(screens[curupd-1], ' '); /* blank out */
     ileft(screens[curupd-1]); /* back up again */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -3795,7 +3813,7 @@ static void up_ivf(FILE *f)
     dbg_printf(dlapi, "API\n");
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     iup(screens[curupd-1]); /* move up */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -3817,7 +3835,7 @@ static void down_ivf(FILE *f)
     dbg_printf(dlapi, "API\n");
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     idown(screens[curupd-1]); /* move cursor down */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -3838,7 +3856,7 @@ static void left_ivf(FILE *f)
     dbg_printf(dlapi, "API\n");
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     ileft(screens[curupd-1]); /* move cursor left */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -3859,7 +3877,7 @@ static void right_ivf(FILE *f)
     dbg_printf(dlapi, "API\n");
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     iright(screens[curupd-1]); /* move cursor right */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -3915,7 +3933,7 @@ static void attronoff(FILE *f, int e, scnatt nattr)
         }
 
     }
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -4114,7 +4132,7 @@ static void fcolor_ivf(FILE *f, pa_color c)
     if (curupd == curdsp) trm_fcolor(c); /* set color */
     forec = c;
     forergb = colnumrgbp(c);
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -4137,7 +4155,7 @@ static void bcolor_ivf(FILE *f, pa_color c)
     if (curupd == curdsp) trm_bcolor(c); /* set color */
     backc = c;
     backrgb = colnumrgbp(c);
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -4159,7 +4177,7 @@ static void auto_ivf(FILE *f, int e)
     dbg_printf(dlapi, "API\n");
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     scroll = e; /* set line wrap status */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -4181,7 +4199,7 @@ static void curvis_ivf(FILE *f, int e)
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     curvis = !!e; /* set cursor visible status */
     if (e) trm_curon(); else trm_curoff();
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -4203,7 +4221,7 @@ static void scroll_ivf(FILE *f, int x, int y)
     dbg_printf(dlapi, "API\n");
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     iscroll(screens[curupd-1], x, y); /* process scroll */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -4299,7 +4317,7 @@ static void select_ivf(FILE *f, int u, int d)
         }
 
     }
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -4561,19 +4579,19 @@ static void event_ivf(FILE* f, pa_evtrec *er)
     do { /* loop handling via event vectors */
 
         /* reset the response timer */
-        if (unresponse) {
-
+        if (unresponse)
             system_event_deasetim(respsev); /* kill the response timer */
-            /* reset any response state */
-            if (respto) {
-
-                if (titsav) trm_title(titsav); /* set previous title */
-                else trm_title(""); /* reset message (should reset previous) */
-                respto = FALSE; /* reset state */
+        /* the encoder is shared with the input thread, so the title reset
+           and the flush go under the lock */
+        pthread_mutex_lock(&termlock); /* lock terminal broadlock */
+        if (unresponse && respto) { /* reset any response state */
 
-            }
+            if (titsav) trm_title(titsav); /* set previous title */
+            else trm_title(""); /* reset message (should reset previous) */
+            respto = FALSE; /* reset state */
 
         }
+        trmunlock(); /* write out any output before waiting */
 
         /* get next input event */
         dequepaevt(er); /* get next queued event */
@@ -4592,7 +4610,7 @@ static void event_ivf(FILE* f, pa_evtrec *er)
         } else if (er->etype == pa_etterm) 
             /* set user ordered termination */
             fend = TRUE;
-        pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+        trmunlock(); /* release terminal broadlock */
         er->handled = 1; /* set event is handled by default */
         (evtshan)(er); /* call master event handler */
         if (!er->handled) { /* send it to fanout */
@@ -4621,7 +4639,7 @@ static void event_ivf(FILE* f, pa_evtrec *er)
         prtevt(er); fprintf(stderr, "\n"); fflush(stderr);
 
     }
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -4760,18 +4778,18 @@ static int joybutton_ivf(FILE *f, int j)
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     if (j < 1 || j > numjoy) {
 
-        pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+        trmunlock(); /* release terminal broadlock */
         error(pa_dispeinvjoy); /* bad joystick id */
 
     }
     if (!joytab[j-1]) {
 
-        pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+        trmunlock(); /* release terminal broadlock */
         error(pa_dispesystem); /* should be a table entry */
 
     }
     b = joytab[j-1]->button; /* get button count */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
     return (b); /* return button count */
 
@@ -4800,19 +4818,19 @@ static int joyaxis_ivf(FILE *f, int j)
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     if (j < 1 || j > numjoy) {
 
-        pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+        trmunlock(); /* release terminal broadlock */
         error(pa_dispeinvjoy); /* bad joystick id */
 
     }
     if (!joytab[j-1]) {
 
-        pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+        trmunlock(); /* release terminal broadlock */
         error(pa_dispesystem); /* should be a table entry */
 
     }
     ja = joytab[j-1]->axis; /* get axis number */
     if (ja > 6) ja = 6; /* limit to 6 maximum */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
     return (ja); /* set axis number */
 
@@ -4838,12 +4856,12 @@ static void settab_ivf(FILE* f, int t)
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     if (t < 1 || t > dimx) {
 
-        pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+        trmunlock(); /* release terminal broadlock */
         error(pa_dispeinvtab); /* invalid tab position */
 
     }
     tabs[t-1] = 1; /* set tab position */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -4865,12 +4883,12 @@ static void restab_ivf(FILE* f, int t)
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     if (t < 1 || t > dimx) {
 
-        pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+        trmunlock(); /* release terminal broadlock */
         error(pa_dispeinvtab); /* invalid tab position */
 
     }
     tabs[t-1] = 0; /* reset tab position */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -4893,7 +4911,7 @@ static void clrtab_ivf(FILE* f)
     dbg_printf(dlapi, "API\n");
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     for (i = 0; i < dimx; i++) tabs[i] = 0; /* clear all tab stops */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -4994,7 +5012,7 @@ static void wrtstr_ivf(FILE* f, char *s)
     dbg_printf(dlapi, "API\n");
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     putstrc(s);
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -5016,7 +5034,7 @@ static void wrtstrn_ivf(FILE* f, char *s, int n)
     dbg_printf(dlapi, "API\n");
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     while (n--) putchr(*s++);
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -5071,7 +5089,7 @@ static void sizbuf_ivf(FILE* f, int x, int y)
         restore(screens[curdsp-1]);
 
     }
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -5097,7 +5115,7 @@ static void titlen_ivf(FILE* f, char* ts, int l)
     if (!titsav) error(pa_dispenomem); /* no memory */
     strncpy(titsav, ts, l); /* place string */
     titsav[l] = 0; /* terminate */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -5144,7 +5162,7 @@ static void fcolorc_ivf(FILE* f, int r, int g, int b)
 #else
         trm_fcolor(forec); /* set color */
 #endif
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -5172,7 +5190,7 @@ static void bcolorc_ivf(FILE* f, int r, int g, int b)
 #else
         trm_bcolor(backc); /* set color */
 #endif
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -5198,7 +5216,7 @@ static void eventover_ivf(pa_evtcod e, pa_pevthan eh,  pa_pevthan* oeh)
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     *oeh = evthan[e]; /* save existing event handler */
     evthan[e] = eh; /* place new event handler */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -5224,7 +5242,7 @@ static void eventsover_ivf(pa_pevthan eh,  pa_pevthan* oeh)
     pthread_mutex_lock(&termlock); /* lock terminal broadlock */
     *oeh = evtshan; /* save existing event handler */
     evtshan = eh; /* place new event handler */
-    pthread_mutex_unlock(&termlock); /* release terminal broadlock */
+    trmunlock(); /* release terminal broadlock */
 
 }
 
@@ -5513,6 +5531,8 @@ static void pa_init_terminal(int argc, char* argv[])
     /* override system calls for basic I/O */
     ovr_read(iread, &ofpread);
     ovr_write(iwrite, &ofpwrite);
+    /* output goes through the encoder to the next write in the chain */
+    pa_encini(&trmenc, ofpwrite, OUTFIL);
     ovr_open(iopen, &ofpopen);
     ovr_close(iclose, &ofpclose);
 //    ovr_unlink(iunlink, &ofpunlink);
@@ -5762,6 +5782,8 @@ static void pa_init_terminal(int argc, char* argv[])
     if (unresponse)
         respsev = system_event_addsetim(respsev, RESPTIME, FALSE);
 
+    trmflush(); /* write out startup output */
+
 }
 
 /** ****************************************************************************
@@ -5836,6 +5858,7 @@ static void pa_deinit_terminal()
 
     /* restore cursor visible */
     trm_curon();
+    trmflush();
 
     /* restore terminal */
     tcsetattr(0,TCSAFLUSH,&trmsav);
@@ -5845,6 +5868,7 @@ static void pa_deinit_terminal()
 
     /* turn off mouse tracking */
     putstrc("\33[?1003l");
+    trmflush();
 
     /* swap old vectors for existing vectors */
     ovr_read(ofpread, &cppread);
@@ -5859,6 +5883,6 @@ static void pa_deinit_terminal()
         error(pa_dispesystem);
 
     /* back to normal buffer on xterm */
-    putstrc("\033[?1049l"); fflush(stdout);
+    putstrc("\033[?1049l"); trmflush(); fflush(stdout);
 
 }
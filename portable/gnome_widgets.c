@@ -102,7 +102,11 @@ static enum { /* debug levels */
 /* user defined messages */
 #define WMC_LGTFOC pa_etwidget+0 /* widget message code: light up focus */
 #define WMC_DRKFOC pa_etwidget+1 /* widget message code: turn off focus */
+#define WMC_LWTRDW pa_etwidget+2 /* widget message code: repaint lightweights */
+#define WMC_WIGRDW pa_etwidget+3 /* widget message code: repaint widget */
 #define TABHGT 2 /* tab bar tab height * char size y */
+#define LSTSCROLL 3 /* list box rows per mouse wheel step */
+#define DRPROWS 10 /* dropdown list rows shown, longer lists scroll */
 
 /* macro to make a color from RGB values */
 #define RGB(r, g, b) (r<<16|g<<8|b)
@@ -372,6 +376,11 @@ typedef struct wigrec {
     /** down buton pressed */                 int       downpress;
     /** progress bar position */              int       ppos;
     /** string list */                        pa_strptr strlst;
+    /** string list index table */            pa_strptr* strtbl;
+    /** number of strings in list */          int       strcnt;
+    /** first row displayed in list */        int       top;
+    /** tab offset table */                   int*      stroff;
+    /** number of valid tab offsets */        int       ofscnt;
     /** string selected, 0 if none */         int       ss;
     /** string hovered, 0 if none */          int       sh;
     /** position of widget in parent */       int       px, py;
@@ -384,6 +393,18 @@ typedef struct wigrec {
     /** Configurable button fields */         ccolorp   cbc;
     /** use check/text */                     int       check;
 
+    /** drawn in parent, has no window */     int       lwt;
+    /** size of lightweight widget */         int       sx, sy;
+    /** drawing origin offset in wf */        int       ox, oy;
+    /** next lightweight in parent */         wigptr    lnext;
+
+    /** text length, gap start, capacity */   int       flen, gs, fcap;
+    /** text glyph offset table */            int*      goff;
+    /** glyph offsets allocated, valid */     int       gofc, gofv;
+
+    /** repaint is pending */                 int       rdw;
+    /** pending repaint rectangle */          int       rx1, ry1, rx2, ry2;
+
 } wigrec;
 
 /*
@@ -500,12 +521,28 @@ typedef struct filrec {
     /* table of widgets in window, includes negatives and 0 */
     wigptr widgets[MAXWIG*2+1];
 
+    /* lightweight widgets. These draw into this window and get their input
+       from it, instead of having a window of their own */
+    FILE*  wf;       /* window file */
+    int    wid;      /* window id, 0 if not known yet */
+    wigptr lwtlst;   /* list of lightweights, bottom of Z order first */
+    wigptr lwtfoc;   /* lightweight with focus */
+    wigptr lwthov;   /* lightweight being hovered */
+    wigptr lwtgrb;   /* lightweight holding mouse button 1 */
+    int    lwtdep;   /* drawing state save nesting depth */
+    int    mpx, mpy; /* last mouse position in window */
+    int    rdw;      /* repaint is pending */
+    int    rx1, ry1; /* repaint rectangle */
+    int    rx2, ry2;
+
 } filrec;
 
 static pa_pevthan    widget_event_old;   /* previous event vector save */
 static wigptr        wigfre;             /* free widget entry list */
 static filptr        opnfil[MAXFIL];     /* open files table */
 static wigptr        xltwig[MAXFIL*2+1]; /* widget entry equivalence table */
+static filptr        xltlwt[MAXFIL*2+1]; /* window id to file with lightweights */
+static int           lwtenb;             /* lightweight widgets enabled */
 static FILE*         win0;               /* "window zero" dummy window */
 /* table of colors or other theme values */
 static unsigned long themetable[th_endmarker];
@@ -803,6 +840,228 @@ static void frestrlst(
 
 /** ****************************************************************************
 
+Plant string list
+
+Plants a string list in a widget, and builds the index table for it. The table
+gives the entry for any logical string number directly, so list, drop and tab
+widgets don't walk the list to find an entry. Any existing index or tab offsets
+are recycled.
+
+*******************************************************************************/
+
+static void plnstrlst(
+    /** Widget entry */ wigptr    wp,
+    /** String list */  pa_strptr sp
+)
+
+{
+
+    pa_strptr sp1;
+    int       c;
+
+    if (wp->strtbl) free(wp->strtbl); /* free any existing index */
+    if (wp->stroff) free(wp->stroff); /* free any existing tab offsets */
+    wp->stroff = NULL;
+    wp->ofscnt = 0;
+    c = 0; /* count the entries */
+    for (sp1 = sp; sp1; sp1 = sp1->next) c++;
+    wp->strtbl = malloc(sizeof(pa_strptr)*(c+1)); /* get index table */
+    c = 0; /* fill the table */
+    for (sp1 = sp; sp1; sp1 = sp1->next) wp->strtbl[c++] = sp1;
+    wp->strtbl[c] = NULL; /* terminate */
+    wp->strlst = sp; /* plant the list */
+    wp->strcnt = c; /* set number of entries */
+
+}
+
+/** ****************************************************************************
+
+Find string list entry
+
+Finds the string list entry for the given logical string number, 1 to n.
+
+\returns The entry, or NULL if the number is out of range.
+
+*******************************************************************************/
+
+static pa_strptr fndstr(
+    /** Widget entry */          wigptr wp,
+    /** Logical string number */ int    sn
+)
+
+{
+
+    pa_strptr sp;
+
+    sp = NULL; /* set not found */
+    if (sn >= 1 && sn <= wp->strcnt) sp = wp->strtbl[sn-1];
+
+    return (sp);
+
+}
+
+/** ****************************************************************************
+
+Set widget text
+
+Replaces the face text of a widget. The face text of edit boxes is kept as a gap
+buffer, and this resets it to a plain string with no gap. Any cached glyph
+offsets are invalidated.
+
+*******************************************************************************/
+
+static void edtset(
+    /** Widget entry */ wigptr wp,
+    /** New text */     char*  s
+)
+
+{
+
+    char* p;
+
+    p = str(s); /* copy first, s may be our own text */
+    if (wp->face) free(wp->face); /* release previous text */
+    wp->face = p; /* place new text */
+    wp->flen = strlen(p); /* set length */
+    wp->gs = wp->flen; /* set gap at end */
+    wp->fcap = wp->flen; /* set no gap */
+    if (wp->gofv > 1) wp->gofv = 1; /* invalidate glyph offsets */
+
+}
+
+/** ****************************************************************************
+
+Move edit text gap
+
+Moves the gap in the widget text to the given logical character position.
+Only the characters between the old and new gap positions move, so edits near
+the last one are cheap regardless of the text length.
+
+*******************************************************************************/
+
+static void edtgap(
+    /** Widget entry */          wigptr wp,
+    /** New gap start position */ int   p
+)
+
+{
+
+    int gap; /* length of gap */
+
+    gap = wp->fcap-wp->flen;
+    if (p < wp->gs) /* move characters before gap to after it */
+        memmove(&wp->face[p+gap], &wp->face[p], wp->gs-p);
+    else if (p > wp->gs) /* move characters after gap to before it */
+        memmove(&wp->face[wp->gs], &wp->face[wp->gs+gap], p-wp->gs);
+    wp->gs = p; /* set new gap position */
+
+}
+
+/** ****************************************************************************
+
+Get widget text
+
+Gets the face text of a widget as a string. For an edit box, the gap is moved
+to the end of the text and the string terminated there.
+
+\returns The face text string.
+
+*******************************************************************************/
+
+static char* edtstr(
+    /** Widget entry */ wigptr wp
+)
+
+{
+
+    edtgap(wp, wp->flen); /* move gap to end */
+    wp->face[wp->flen] = 0; /* terminate */
+
+    return (wp->face);
+
+}
+
+/** ****************************************************************************
+
+Get edit text character
+
+Gets the character at the given logical position in the widget text, skipping
+the gap.
+
+\returns The character.
+
+*******************************************************************************/
+
+static char edtchr(
+    /** Widget entry */       wigptr wp,
+    /** Character position */ int    i
+)
+
+{
+
+    if (i >= wp->gs) i += wp->fcap-wp->flen; /* skip gap */
+
+    return (wp->face[i]);
+
+}
+
+/** ****************************************************************************
+
+Insert edit text character
+
+Inserts a character into the widget text at the given position. If the gap is
+used up, the buffer is doubled, so a run of inserts is amortized constant time.
+Glyph offsets from the position on are invalidated.
+
+*******************************************************************************/
+
+static void edtins(
+    /** Widget entry */          wigptr wp,
+    /** Position to insert at */ int    p,
+    /** Character to insert */   char   c
+)
+
+{
+
+    if (wp->flen == wp->fcap) { /* no gap left, expand */
+
+        edtgap(wp, wp->flen); /* move gap to end */
+        wp->fcap = wp->fcap*2+16; /* find new capacity */
+        wp->face = realloc(wp->face, wp->fcap+1);
+
+    }
+    edtgap(wp, p); /* move gap to insert position */
+    wp->face[wp->gs++] = c; /* place character before gap */
+    wp->flen++; /* count */
+    if (wp->gofv > p+1) wp->gofv = p+1; /* invalidate glyph offsets */
+
+}
+
+/** ****************************************************************************
+
+Delete edit text character
+
+Deletes the character at the given position from the widget text. The gap is
+moved to the position and extended over the character. Glyph offsets from the
+position on are invalidated.
+
+*******************************************************************************/
+
+static void edtdel(
+    /** Widget entry */          wigptr wp,
+    /** Position to delete at */ int    p
+)
+
+{
+
+    edtgap(wp, p); /* move gap to delete position */
+    wp->flen--; /* grow gap over following character */
+    if (wp->gofv > p+1) wp->gofv = p+1; /* invalidate glyph offsets */
+
+}
+
+/** ****************************************************************************
+
 Get file entry
 
 Allocates and initializes a new file entry. File entries are left in the opnfil
@@ -822,6 +1081,16 @@ static filptr getfil(void)
     fp = malloc(sizeof(filrec)); /* get new file entry */
     /* clear widget table */
     for (i = 0; i < MAXWIG*2+1; i++) fp->widgets[i] = NULL;
+    fp->wf = NULL; /* clear lightweight tracking */
+    fp->wid = 0;
+    fp->lwtlst = NULL;
+    fp->lwtfoc = NULL;
+    fp->lwthov = NULL;
+    fp->lwtgrb = NULL;
+    fp->lwtdep = 0;
+    fp->mpx = 0;
+    fp->mpy = 0;
+    fp->rdw = FALSE;
 
     return (fp); /* exit with file entry */
 
@@ -899,6 +1168,11 @@ static wigptr getwig(void)
     wp->downpress = FALSE; /* set down not pressed */
     wp->ppos = 0; /* progress bar extreme left */
     wp->strlst = NULL; /* clear string list */
+    wp->strtbl = NULL; /* clear string index */
+    wp->strcnt = 0;
+    wp->top = 0; /* set list at top */
+    wp->stroff = NULL; /* clear tab offsets */
+    wp->ofscnt = 0;
     wp->ss = 0; /* no string selected */
     wp->sh = 0; /* no string hovered */
     wp->px = 0; /* clear origin in parent */
@@ -909,6 +1183,20 @@ static wigptr getwig(void)
     wp->tor = pa_totop; /* set tab orientation top */
     wp->charb = FALSE; /* widget based on character grid */
     wp->check = FALSE; /* do not use check instead of text */
+    wp->lwt = FALSE; /* set has own window */
+    wp->sx = 0; /* clear lightweight size and origin */
+    wp->sy = 0;
+    wp->ox = 0;
+    wp->oy = 0;
+    wp->lnext = NULL;
+    wp->rdw = FALSE; /* set no repaint pending */
+    wp->face = NULL; /* clear face text */
+    wp->flen = 0;
+    wp->gs = 0;
+    wp->fcap = 0;
+    wp->goff = NULL; /* clear glyph offsets */
+    wp->gofc = 0;
+    wp->gofv = 0;
 
     return wp; /* return entry */
 
@@ -928,8 +1216,15 @@ static void putwig(
 
 {
 
-    /* if not a subclass widget, free string list */
-    if (!wp->pw) frestrlst(wp->strlst);
+    /* if not a subclass widget, free string list and index */
+    if (!wp->pw) {
+
+        frestrlst(wp->strlst);
+        if (wp->strtbl) free(wp->strtbl);
+
+    }
+    if (wp->stroff) free(wp->stroff); /* free tab offsets */
+    if (wp->goff) free(wp->goff); /* free glyph offsets */
     if (wp->face) free(wp->face); /* free face string if exists */
     wp->next = wigfre; /* push to free list */
     wigfre = wp;
@@ -969,11 +1264,221 @@ static wigptr fndwig(
 
 /** ****************************************************************************
 
+Add to lightweight repaint
+
+Adds the given rectangle to the area of the window where lightweight widgets
+need to be repainted. The first addition sends a repaint message to the window,
+so the repaint happens once on the next event, after any client drawing that is
+pending.
+
+*******************************************************************************/
+
+static void lwtdmg(
+    /** File entry */          filptr fp,
+    /** Rectangle to repaint */ int x1, int y1, int x2, int y2
+)
+
+{
+
+    pa_evtrec ev; /* outbound repaint message */
+
+    if (!fp->rdw) { /* first add, set rectangle and send message */
+
+        fp->rx1 = x1;
+        fp->ry1 = y1;
+        fp->rx2 = x2;
+        fp->ry2 = y2;
+        fp->rdw = TRUE; /* set repaint pending */
+        ev.etype = WMC_LWTRDW; /* set repaint message */
+        pa_sendevent(fp->wf, &ev);
+
+    } else { /* expand pending rectangle */
+
+        if (x1 < fp->rx1) fp->rx1 = x1;
+        if (y1 < fp->ry1) fp->ry1 = y1;
+        if (x2 > fp->rx2) fp->rx2 = x2;
+        if (y2 > fp->ry2) fp->ry2 = y2;
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Begin lightweight drawing
+
+Saves the drawing state of a window with lightweight widgets, then sets the
+state a widget window would have. Calls nest, and only the outermost saves.
+Any text the client has not flushed is sent first, so that it draws with the
+client's state.
+
+*******************************************************************************/
+
+static void lwtbgn(
+    /** File entry */ filptr fp
+)
+
+{
+
+    if (!fp->lwtdep++) { /* outermost */
+
+        fflush(fp->wf); /* send any pending client text */
+        pa_pushstate(fp->wf); /* save client state */
+        pa_curvis(fp->wf, FALSE); /* turn off cursor */
+        pa_auto(fp->wf, FALSE); /* turn off auto */
+        pa_reverse(fp->wf, FALSE); /* clear attributes drawn over text */
+        pa_underline(fp->wf, FALSE);
+        pa_strikeout(fp->wf, FALSE);
+        pa_font(fp->wf, PA_FONT_SIGN); /* set sign font */
+        pa_fover(fp->wf); /* foreground overwrites */
+        pa_binvis(fp->wf); /* no background write */
+
+    }
+
+}
+
+/** ****************************************************************************
+
+End lightweight drawing
+
+Ends drawing started by lwtbgn(). The outermost call restores the state of the
+window.
+
+*******************************************************************************/
+
+static void lwtend(
+    /** File entry */ filptr fp
+)
+
+{
+
+    if (!--fp->lwtdep) { /* outermost */
+
+        fflush(fp->wf); /* send widget text */
+        pa_popstate(fp->wf); /* restore client state */
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Begin/end widget drawing
+
+Brackets the drawing of a widget. For a lightweight widget this saves and
+restores the state of the parent it draws in, and for other widgets it does
+nothing.
+
+*******************************************************************************/
+
+static void wigbgn(
+    /** Widget data pointer */ wigptr wg
+)
+
+{
+
+    if (wg->lwt) lwtbgn(opnfil[fileno(wg->wf)]);
+
+}
+
+static void wigend(
+    /** Widget data pointer */ wigptr wg
+)
+
+{
+
+    if (wg->lwt) lwtend(opnfil[fileno(wg->wf)]);
+
+}
+
+/** ****************************************************************************
+
+Find widget size
+
+Returns the width or height of the widget drawing area. A lightweight widget
+draws in its parent, so its size is kept in the widget.
+
+*******************************************************************************/
+
+static int wmaxxg(
+    /** Widget data pointer */ wigptr wg
+)
+
+{
+
+    if (wg->lwt) return (wg->sx);
+    else return (pa_maxxg(wg->wf));
+
+}
+
+static int wmaxyg(
+    /** Widget data pointer */ wigptr wg
+)
+
+{
+
+    if (wg->lwt) return (wg->sy);
+    else return (pa_maxyg(wg->wf));
+
+}
+
+/** ****************************************************************************
+
+Add damage to widget
+
+Adds the given rectangle, in widget coordinates, to the area of the widget that
+needs repainting. Damage collects until the next event is read. The first
+addition sends a repaint message to the widget window, and any damage added
+before it arrives just grows the rectangle. The widget then repaints once, with
+a redraw event for the combined rectangle, however many times it was damaged.
+
+A lightweight widget has no window to send to. Its area is added to the repaint
+pending on the parent instead, which collects damage for all of its lightweight
+widgets in the same way.
+
+*******************************************************************************/
+
+static void widget_damage(
+    /** Widget data block pointer */ wigptr wp,
+    /** Rectangle to repaint */      int x1, int y1, int x2, int y2
+)
+
+{
+
+    pa_evtrec ev; /* outbound repaint message */
+
+    if (wp->lwt)
+        lwtdmg(opnfil[fileno(wp->wf)], wp->px+x1-1, wp->py+y1-1,
+               wp->px+x2-1, wp->py+y2-1);
+    else if (!wp->rdw) { /* first add, set rectangle and send message */
+
+        wp->rx1 = x1;
+        wp->ry1 = y1;
+        wp->rx2 = x2;
+        wp->ry2 = y2;
+        wp->rdw = TRUE; /* set repaint pending */
+        ev.etype = WMC_WIGRDW; /* set repaint message */
+        pa_sendevent(wp->wf, &ev); /* send to widget window */
+
+    } else { /* expand pending rectangle */
+
+        if (x1 < wp->rx1) wp->rx1 = x1;
+        if (y1 < wp->ry1) wp->ry1 = y1;
+        if (x2 > wp->rx2) wp->rx2 = x2;
+        if (y2 > wp->ry2) wp->ry2 = y2;
+
+    }
+
+}
+
+/** ****************************************************************************
+
 Send redraw to widget
 
 Sends a redraw request to the given widget. The common workflow with widgets
 is to reconfigure it by changing the parameters of it, then sending it a redraw
-to update itself with the new parameters.
+to update itself with the new parameters. The whole widget is damaged, and the
+repaint is deferred until the next event.
 
 *******************************************************************************/
 
@@ -983,14 +1488,7 @@ static void widget_redraw(
 
 {
 
-    pa_evtrec ev;  /* outbound menu event */
-
-    ev.etype = pa_etredraw; /* set redraw event */
-    ev.rsx = 1; /* set extent */
-    ev.rsy = 1;
-    ev.rex = pa_maxxg(wp->wf);
-    ev.rey = pa_maxyg(wp->wf);
-    pa_sendevent(wp->wf, &ev); /* send to widget window */
+    widget_damage(wp, 1, 1, wmaxxg(wp), wmaxyg(wp));
 
 }
 
@@ -1120,6 +1618,7 @@ static void intkillwidget(
 {
 
     wigptr wp; /* widget entry pointer */
+    wigptr p, lp; /* lightweight list pointers */
 
     if (fn < 0 || fn > MAXFIL) error("Invalid file number");
     if (!opnfil[fn]) error("File by id not open");
@@ -1129,7 +1628,25 @@ static void intkillwidget(
     /* if there is a subwidget, kill that as well */
     if (wp->cw) pa_killwidget(wp->cw->pw->wf, wp->cw->id);
     if (wp->cw2) pa_killwidget(wp->cw2->pw->wf, wp->cw2->id);
-    fclose(wp->wf); /* close the window file */
+    /* a lightweight widget has no window, it draws in the parent */
+    if (wp->lwt) {
+
+        /* remove from lightweights list */
+        lp = NULL;
+        p = opnfil[fn]->lwtlst;
+        while (p && p != wp) { lp = p; p = p->lnext; }
+        if (p) {
+
+            if (lp) lp->lnext = p->lnext;
+            else opnfil[fn]->lwtlst = p->lnext;
+
+        }
+        /* clear any input tracking on it */
+        if (opnfil[fn]->lwtfoc == wp) opnfil[fn]->lwtfoc = NULL;
+        if (opnfil[fn]->lwthov == wp) opnfil[fn]->lwthov = NULL;
+        if (opnfil[fn]->lwtgrb == wp) opnfil[fn]->lwtgrb = NULL;
+
+    } else fclose(wp->wf); /* close the window file */
     opnfil[fn]->widgets[wid+MAXWIG] = NULL; /* clear widget slot  */
     putwig(wp); /* release widget data */
 
@@ -1148,6 +1665,11 @@ subclasser uses the pass-in to set parameters to control the subclassing. If the
 pass-in is NULL, then a new entry will be created. This, or the predefined entry
 will be passed back to the user.
 
+If lightweight widgets are enabled, the simple widget types that are not
+subclassed are created without a window. They draw into the parent, and the
+parent's input is hit tested to find them. Their first paint is deferred to
+the next event.
+
 *******************************************************************************/
 
 static void widget(
@@ -1161,36 +1683,89 @@ static void widget(
 
 {
 
-    int fn; /* logical file name */
+    int    fn;  /* logical file name */
+    int    lwt; /* create lightweight */
+    int    pid; /* parent window id */
+    filptr fp;  /* parent file entry */
     wigptr wp;
+    wigptr p;
 
     if (id <= -MAXWIG || id > MAXWIG || !id) error("Invalid widget id");
     makfil(f); /* ensure there is a file entry and validate */
     fn = fileno(f); /* get the file index */
+    fp = opnfil[fn];
+    /* find if this will be lightweight */
+    lwt = lwtenb && !*wpr &&
+          (typ == wtbutton || typ == wtcheckbox || typ == wtradiobutton ||
+           typ == wtgroup || typ == wtbackground || typ == wtprogbar);
+    if (lwt && !fp->wid) { /* find parent window id */
+
+        pid = pa_winid(f);
+        /* the id must fit the translation table */
+        if (pid > -MAXFIL && pid <= MAXFIL) {
+
+            fp->wf = f;
+            fp->wid = pid;
+            xltlwt[pid+MAXFIL] = fp;
+
+        } else lwt = FALSE;
+
+    }
     wp = *wpr; /* get any predefined widget entry */
     if (!wp) wp = getwig(); /* get widget entry if none passed in */
     if (opnfil[fn]->widgets[id+MAXWIG]) error("Widget by id already in use");
     opnfil[fn]->widgets[id+MAXWIG] = wp; /* set widget entry */
 
-    wp->face = str(s); /* place face */
-    wp->wid = pa_getwinid(); /* allocate a buried wid */
-    pa_openwin(&stdin, &wp->wf, f, wp->wid); /* open widget window */
-    wp->parent = f; /* save parent file */
-    xltwig[wp->wid+MAXFIL] = wp; /* set the tracking entry for the window */
-    wp->id = id; /* set button widget id */
-    pa_buffer(wp->wf, FALSE); /* turn off buffering */
-    pa_auto(wp->wf, FALSE); /* turn off auto */
-    pa_curvis(wp->wf, FALSE); /* turn off cursor */
-    pa_font(wp->wf, PA_FONT_SIGN); /* set sign font */
-    pa_frame(wp->wf, FALSE); /* turn off frame */
-    pa_setposg(wp->wf, x1, y1); /* place at position */
-    pa_setsizg(wp->wf, x2-x1, y2-y1); /* set size */
-    pa_binvis(wp->wf); /* no background write */
-    wp->typ = typ; /* place type */
-    wp->enb = TRUE; /* set is enabled */
-    wp->sclsiz = INT_MAX/10; /* set default size scrollbar */
-    wp->px = x1; /* set widget position in parent */
-    wp->py = y1;
+    edtset(wp, s); /* place face */
+    if (lwt) {
+
+        wp->lwt = TRUE; /* set lightweight */
+        wp->wid = 0; /* no window */
+        wp->wf = f; /* draw to parent */
+        wp->parent = f; /* save parent file */
+        wp->id = id; /* set widget id */
+        wp->typ = typ; /* place type */
+        wp->enb = TRUE; /* set is enabled */
+        wp->sclsiz = INT_MAX/10; /* set default size scrollbar */
+        wp->px = x1; /* set widget position in parent */
+        wp->py = y1;
+        wp->sx = x2-x1; /* set size as the window would have */
+        wp->sy = y2-y1;
+        wp->ox = x1-1; /* set drawing origin */
+        wp->oy = y1-1;
+        wp->lnext = NULL; /* place on top of Z order */
+        if (!fp->lwtlst) fp->lwtlst = wp;
+        else {
+
+            p = fp->lwtlst;
+            while (p->lnext) p = p->lnext;
+            p->lnext = wp;
+
+        }
+        widget_redraw(wp); /* paint on next event */
+
+    } else {
+
+        wp->wid = pa_getwinid(); /* allocate a buried wid */
+        pa_openwin(&stdin, &wp->wf, f, wp->wid); /* open widget window */
+        wp->parent = f; /* save parent file */
+        xltwig[wp->wid+MAXFIL] = wp; /* set the tracking entry for the window */
+        wp->id = id; /* set button widget id */
+        pa_buffer(wp->wf, FALSE); /* turn off buffering */
+        pa_auto(wp->wf, FALSE); /* turn off auto */
+        pa_curvis(wp->wf, FALSE); /* turn off cursor */
+        pa_font(wp->wf, PA_FONT_SIGN); /* set sign font */
+        pa_frame(wp->wf, FALSE); /* turn off frame */
+        pa_setposg(wp->wf, x1, y1); /* place at position */
+        pa_setsizg(wp->wf, x2-x1, y2-y1); /* set size */
+        pa_binvis(wp->wf); /* no background write */
+        wp->typ = typ; /* place type */
+        wp->enb = TRUE; /* set is enabled */
+        wp->sclsiz = INT_MAX/10; /* set default size scrollbar */
+        wp->px = x1; /* set widget position in parent */
+        wp->py = y1;
+
+    }
 
     *wpr = wp; /* copy back to caller */
 
@@ -1330,23 +1905,25 @@ static void button_draw(
 
 {
 
+    wigbgn(wg); /* start drawing */
     /* color the background */
     if (wg->pressed) fcolort(wg->wf, th_backpressed);
     else fcolort(wg->wf, th_back);
-    pa_frect(wg->wf, 1, 1, pa_maxxg(wg->wf),
-              pa_maxyg(wg->wf));
+    pa_frect(wg->wf, wg->ox+1, wg->oy+1, wg->ox+wmaxxg(wg),
+              wg->oy+wmaxyg(wg));
     /* outline */
     pa_linewidth(wg->wf, 4);
     if (wg->focus) fcolort(wg->wf, th_focus);
     else fcolort(wg->wf, th_outline1);
-    pa_rrect(wg->wf, 2, 2, pa_maxxg(wg->wf)-1,
-             pa_maxyg(wg->wf)-1, 20, 20);
+    pa_rrect(wg->wf, wg->ox+2, wg->oy+2, wg->ox+wmaxxg(wg)-1,
+             wg->oy+wmaxyg(wg)-1, 20, 20);
     if (wg->enb) fcolort(wg->wf, th_text);
     else fcolort(wg->wf, th_textdis);
     pa_cursorg(wg->wf,
-               pa_maxxg(wg->wf)/2-pa_strsiz(wg->wf, wg->face)/2,
-               pa_maxyg(wg->wf)/2-pa_chrsizy(wg->wf)/2);
+               wg->ox+wmaxxg(wg)/2-pa_strsiz(wg->wf, wg->face)/2,
+               wg->oy+wmaxyg(wg)/2-pa_chrsizy(wg->wf)/2);
     fprintf(wg->wf, "%s", wg->face); /* place button face */
+    wigend(wg); /* end drawing */
 
 }
 
@@ -1422,28 +1999,29 @@ static void checkbox_draw(
     int md; /* checkbox center line */
     int cb; /* bounding box of check figure */
 
+    wigbgn(wg); /* start drawing */
     /* color the background */
     pa_fcolor(wg->wf, pa_backcolor);
-    pa_frect(wg->wf, 1, 1, pa_maxxg(wg->wf), pa_maxyg(wg->wf));
+    pa_frect(wg->wf, wg->ox+1, wg->oy+1, wg->ox+wmaxxg(wg), wg->oy+wmaxyg(wg));
     /* outline */
     pa_linewidth(wg->wf, 4);
     if (wg->focus) {
 
         fcolort(wg->wf, th_focus);
-        pa_rrect(wg->wf, 2, 2, pa_maxxg(wg->wf)-1,
-                 pa_maxyg(wg->wf)-1, 20, 20);
+        pa_rrect(wg->wf, wg->ox+2, wg->oy+2, wg->ox+wmaxxg(wg)-1,
+                 wg->oy+wmaxyg(wg)-1, 20, 20);
 
     }
     /* draw text */
     if (wg->enb) fcolort(wg->wf, th_text);
     else fcolort(wg->wf, th_textdis);
-    pa_cursorg(wg->wf, pa_chrsizy(wg->wf)+pa_chrsizy(wg->wf)/2,
-                       pa_maxyg(wg->wf)/2-pa_chrsizy(wg->wf)/2);
+    pa_cursorg(wg->wf, wg->ox+pa_chrsizy(wg->wf)+pa_chrsizy(wg->wf)/2,
+                       wg->oy+wmaxyg(wg)/2-pa_chrsizy(wg->wf)/2);
     fprintf(wg->wf, "%s", wg->face); /* place button face */
     /* set size of square as ratio of font height */
     sq = 0.80*pa_chrsizy(wg->wf);
-    md = pa_maxyg(wg->wf)/2; /* set middle line of checkbox */
-    sqo = pa_maxyg(wg->wf)/4; /* set offset of square from left */
+    md = wg->oy+wmaxyg(wg)/2; /* set middle line of checkbox */
+    sqo = wg->ox+wmaxyg(wg)/4; /* set offset of square from left */
     sqm = sqo+sq/2; /* set square middle x */
     cb = sq*.70; /* set bounding box of check figure */
 
@@ -1470,6 +2048,7 @@ static void checkbox_draw(
         pa_rrect(wg->wf, sqo, md-sq/2, sqo+sq, md+sq/2, 10, 10);
 
     }
+    wigend(wg); /* end drawing */
 
 }
 
@@ -1537,28 +2116,29 @@ static void radiobutton_draw(
     int cro; /* radiobutton offset left */
     int md; /* radiobutton center line */
 
+    wigbgn(wg); /* start drawing */
     /* color the background */
     pa_fcolor(wg->wf, pa_backcolor);
-    pa_frect(wg->wf, 1, 1, pa_maxxg(wg->wf), pa_maxyg(wg->wf));
+    pa_frect(wg->wf, wg->ox+1, wg->oy+1, wg->ox+wmaxxg(wg), wg->oy+wmaxyg(wg));
     /* outline */
     pa_linewidth(wg->wf, 4);
     if (wg->focus) {
 
         fcolort(wg->wf, th_focus);
-        pa_rrect(wg->wf, 2, 2, pa_maxxg(wg->wf)-1,
-                 pa_maxyg(wg->wf)-1, 20, 20);
+        pa_rrect(wg->wf, wg->ox+2, wg->oy+2, wg->ox+wmaxxg(wg)-1,
+                 wg->oy+wmaxyg(wg)-1, 20, 20);
 
     }
     /* draw text */
     if (wg->enb) fcolort(wg->wf, th_text);
     else fcolort(wg->wf, th_textdis);
-    pa_cursorg(wg->wf, pa_chrsizy(wg->wf)+pa_chrsizy(wg->wf)/2,
-                       pa_maxyg(wg->wf)/2-pa_chrsizy(wg->wf)/2);
+    pa_cursorg(wg->wf, wg->ox+pa_chrsizy(wg->wf)+pa_chrsizy(wg->wf)/2,
+                       wg->oy+wmaxyg(wg)/2-pa_chrsizy(wg->wf)/2);
     fprintf(wg->wf, "%s", wg->face); /* place button face */
     /* set size of circle as ratio of font height */
     cr = 0.80*pa_chrsizy(wg->wf);
-    md = pa_maxyg(wg->wf)/2; /* set middle line of radiobutton */
-    cro = pa_maxyg(wg->wf)/4; /* set offset of circle from left */
+    md = wg->oy+wmaxyg(wg)/2; /* set middle line of radiobutton */
+    cro = wg->ox+wmaxyg(wg)/4; /* set offset of circle from left */
     crm = cro+cr/2; /* set circle middle x */
 
     if (wg->select) {
@@ -1579,6 +2159,7 @@ static void radiobutton_draw(
         pa_ellipse(wg->wf, cro, md-cr/2, cro+cr, md+cr/2);
 
     }
+    wigend(wg); /* end drawing */
 
 }
 
@@ -1913,18 +2494,20 @@ static void group_draw(
 
 {
 
+    wigbgn(wg); /* start drawing */
     /* color the background */
     pa_fcolor(wg->wf, pa_backcolor);
-    pa_frect(wg->wf, 1, 1, pa_maxxg(wg->wf), pa_maxyg(wg->wf));
+    pa_frect(wg->wf, wg->ox+1, wg->oy+1, wg->ox+wmaxxg(wg), wg->oy+wmaxyg(wg));
     fcolort(wg->wf, th_outline1);
     pa_linewidth(wg->wf, 2);
-    pa_rect(wg->wf, 2, pa_chrsizy(wg->wf)/2, pa_maxxg(wg->wf), pa_maxyg(wg->wf));
+    pa_rect(wg->wf, wg->ox+2, wg->oy+pa_chrsizy(wg->wf)/2, wg->ox+wmaxxg(wg),
+            wg->oy+wmaxyg(wg));
     pa_fcolor(wg->wf, pa_black);
-    pa_cursorg(wg->wf, 1, 1);
+    pa_cursorg(wg->wf, wg->ox+1, wg->oy+1);
     pa_bover(wg->wf);
     pa_bcolor(wg->wf, pa_backcolor);
     fprintf(wg->wf, "%s", wg->face); /* place button face */
-
+    wigend(wg); /* end drawing */
 
 }
 
@@ -1961,10 +2544,12 @@ static void background_draw(
 
 {
 
+    wigbgn(wg); /* start drawing */
     /* color the background */
     pa_fcolor(wg->wf, pa_backcolor);
-    pa_frect(wg->wf, 1, 1, pa_maxxg(wg->wf), pa_maxyg(wg->wf));
+    pa_frect(wg->wf, wg->ox+1, wg->oy+1, wg->ox+wmaxxg(wg), wg->oy+wmaxyg(wg));
     pa_fcolor(wg->wf, pa_black);
+    wigend(wg); /* end drawing */
 
 }
 
@@ -1989,32 +2574,172 @@ static void background_event(
 
 /** ****************************************************************************
 
-Edit box draw handler
+Find edit box glyph offset
 
-Handles drawing edit boxes.
+Finds the pixel offset of the given character position in the edit box text,
+from the start of the text. Offsets are cached, and only the part of the table
+invalidated by edits is measured again, a character at a time, and only as far
+as is asked for.
+
+\returns The pixel offset.
 
 *******************************************************************************/
 
-static void editbox_draw(
+static int edtofs(
+    /** Widget data pointer */ wigptr wg,
+    /** Character position */  int    i
+)
+
+{
+
+    char cs[2]; /* single character string */
+
+    if (wg->gofc < wg->flen+1) { /* table too small, expand it */
+
+        wg->gofc = (wg->flen+1)*2;
+        wg->goff = realloc(wg->goff, sizeof(int)*wg->gofc);
+
+    }
+    if (!wg->gofv) { wg->goff[0] = 0; wg->gofv = 1; } /* set first offset */
+    cs[1] = 0; /* terminate character string */
+    while (wg->gofv <= i) { /* measure up to position */
+
+        cs[0] = edtchr(wg, wg->gofv-1);
+        wg->goff[wg->gofv] = wg->goff[wg->gofv-1]+pa_strsiz(wg->wf, cs);
+        wg->gofv++;
+
+    }
+
+    return (wg->goff[i]);
+
+}
+
+/** ****************************************************************************
+
+Place edit box cursor in view
+
+Moves the left side of the displayed text until the cursor is within the edit
+field.
+
+*******************************************************************************/
+
+static void edtview(
     /** Widget data pointer */ wigptr wg
 )
 
 {
 
-    int   cl;
+    /* check cursor in box */
+    if (wg->tleft > wg->flen) wg->tleft = 0;
+    /* cursor out of field left, back up left margin */
+    while (ENDLEDSPC+edtofs(wg, wg->curs)-edtofs(wg, wg->tleft) < ENDLEDSPC &&
+           wg->tleft > 0) wg->tleft--;
+    /* cursor out of field right, advance left margin */
+    while (ENDLEDSPC+edtofs(wg, wg->curs)-edtofs(wg, wg->tleft) >
+           pa_maxxg(wg->wf)-ENDLEDSPC && wg->tleft < wg->flen) wg->tleft++;
+
+}
+
+/** ****************************************************************************
+
+Draw edit box text
+
+Draws the text in an edit box from the given character position to the right
+side of the field, erasing what was there, and the cursor if it lies in that
+part. This lets edits and cursor movement redraw only the tail of the text that
+changed.
+
+*******************************************************************************/
+
+static void editbox_text(
+    /** Widget data pointer */  wigptr wg,
+    /** Position to draw from */ int   p
+)
+
+{
+
     int   x;
-    char* s;
+    int   y;
+    int   e;
     int   err;
     int   v;
+    int   gap;
 
     /* see if the numeric contents are in range */
     err = FALSE; /* set no error */
     if (wg->num) {
 
-        v = atoi(wg->face); /* get the value */
+        v = atoi(edtstr(wg)); /* get the value */
         if (v < wg->lbnd || v > wg->ubnd) err = TRUE;
 
     }
+    x = ENDLEDSPC+edtofs(wg, p)-edtofs(wg, wg->tleft); /* find start */
+    y = pa_maxyg(wg->wf)/2-pa_chrsizy(wg->wf)/2;
+    /* erase the tail, including any cursor line at the start */
+    pa_fcolor(wg->wf, pa_white);
+    pa_frect(wg->wf, x-1, y, pa_maxxg(wg->wf)-ENDLEDSPC, y+pa_chrsizy(wg->wf));
+    /* text */
+    if (wg->enb) {
+
+        if (err) fcolort(wg->wf, th_texterr);
+        else fcolort(wg->wf, th_text);
+
+    } else fcolort(wg->wf, th_textdis);
+    pa_cursorg(wg->wf, x, y);
+    /* display only characters that completely fit the field */
+    e = p;
+    while (e < wg->flen && ENDLEDSPC+edtofs(wg, e+1)-edtofs(wg, wg->tleft) <
+                           pa_maxxg(wg->wf)-ENDLEDSPC) e++;
+    /* output the text either side of the gap */
+    gap = wg->fcap-wg->flen;
+    if (p < wg->gs)
+        fwrite(&wg->face[p], 1, (e < wg->gs ? e : wg->gs)-p, wg->wf);
+    if (e > wg->gs)
+        fwrite(&wg->face[(p > wg->gs ? p : wg->gs)+gap], 1,
+               e-(p > wg->gs ? p : wg->gs), wg->wf);
+    /* if in focus and enabled, draw the cursor */
+    if (wg->focus && wg->enb && wg->curs >= p) {
+
+        fcolort(wg->wf, th_text); /* set color */
+        /* find x location of cursor */
+        x = ENDLEDSPC+edtofs(wg, wg->curs)-edtofs(wg, wg->tleft);
+        if (wg->ins) { /* in overwrite mode */
+
+            pa_reverse(wg->wf, TRUE); /* set reverse mode */
+            pa_bover(wg->wf); /* paint background */
+            /* index cursor character */
+            pa_cursorg(wg->wf, x, y);
+            /* if off the end of string, use space to reverse */
+            if (wg->curs >= wg->flen) fputc(' ', wg->wf);
+            else fputc(edtchr(wg, wg->curs), wg->wf);
+            pa_reverse(wg->wf, FALSE); /* reset reverse mode */
+            pa_binvis(wg->wf); /* remove background */
+
+        } else { /* in insert mode */
+
+            pa_linewidth(wg->wf, 2); /* set line size */
+            pa_line(wg->wf, x, y, x, y+pa_chrsizy(wg->wf));
+
+        }
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Edit box draw handler
+
+Handles drawing edit boxes.
+
+*******************************************************************************/
+
+static void editbox_draw(
+    /** Widget data pointer */ wigptr wg
+)
+
+{
+
     /* color the background */
     pa_fcolor(wg->wf, pa_white);
     pa_frect(wg->wf, 1, 1, pa_maxxg(wg->wf), pa_maxyg(wg->wf));
@@ -2036,67 +2761,40 @@ static void editbox_draw(
                  pa_maxyg(wg->wf)-1, 20, 20);
 
     }
-    /* text */
-    if (wg->enb) {
-
-        if (err) fcolort(wg->wf, th_texterr);
-        else fcolort(wg->wf, th_text);
+    edtview(wg); /* place cursor in view */
+    editbox_text(wg, wg->tleft); /* draw text */
 
-    } else fcolort(wg->wf, th_textdis);
-    pa_cursorg(wg->wf, ENDLEDSPC, pa_maxyg(wg->wf)/2-pa_chrsizy(wg->wf)/2);
-    /* check cursor in box */
-    if (wg->tleft > strlen(wg->face)) wg->tleft = 0;
-    cl = ENDLEDSPC+pa_chrpos(wg->wf, wg->face, wg->curs)-
-         pa_chrpos(wg->wf, wg->face, wg->tleft);
-    while (cl < ENDLEDSPC && wg->tleft > 0) {
+}
 
-        /* cursor out of field left */
-        wg->tleft--; /* back up left margin */
-        /* recalculate */
-        cl = ENDLEDSPC+pa_chrpos(wg->wf, wg->face, wg->curs)-
-             pa_chrpos(wg->wf, wg->face, wg->tleft);
+/** ****************************************************************************
 
-    }
-    while (cl > pa_maxxg(wg->wf)-ENDLEDSPC && wg->tleft < strlen(wg->face)) {
+Update edit box
 
-        /* cursor out of field right */
-        wg->tleft++; /* advance left margin */
-        /* recalculate */
-        cl = ENDLEDSPC+pa_chrpos(wg->wf, wg->face, wg->curs)-
-             pa_chrpos(wg->wf, wg->face, wg->tleft);
+Updates an edit box after an edit or cursor move at or after the given
+position. If the text did not scroll, only the text from the character before
+the position is redrawn. Numeric boxes can change their text color with any
+edit, and are redrawn in full.
 
-    }
-    /* display only characters that completely fit the field */
-    s = &wg->face[wg->tleft]; /* index displayable string */
-    while (*s && pa_curxg(wg->wf)+pa_chrpos(wg->wf, s, 1) <
-                 pa_maxxg(wg->wf)-ENDLEDSPC)
-        fputc(*s++, wg->wf);
-    if (wg->focus && wg->enb) { /* if in focus and enabled, draw the cursor */
+*******************************************************************************/
 
-        fcolort(wg->wf, th_text); /* set color */
-        /* find x location of cursor */
-        x = ENDLEDSPC+pa_chrpos(wg->wf, wg->face, wg->curs)-
-            pa_chrpos(wg->wf, wg->face, wg->tleft);
-        if (wg->ins) { /* in overwrite mode */
+static void editbox_update(
+    /** Widget data pointer */ wigptr wg,
+    /** Position of change */  int    p
+)
 
-            pa_reverse(wg->wf, TRUE); /* set reverse mode */
-            pa_bover(wg->wf); /* paint background */
-            /* index cursor character */
-            pa_cursorg(wg->wf, x, pa_maxyg(wg->wf)/2-pa_chrsizy(wg->wf)/2);
-            /* if off the end of string, use space to reverse */
-            if (wg->curs >= strlen(wg->face)) fputc(' ', wg->wf);
-            else fputc(wg->face[wg->curs], wg->wf);
-            pa_reverse(wg->wf, FALSE); /* reset reverse mode */
-            pa_binvis(wg->wf); /* remove background */
+{
 
-        } else { /* in insert mode */
+    int tleft;
 
-            pa_linewidth(wg->wf, 2); /* set line size */
-            pa_line(wg->wf, x, pa_maxyg(wg->wf)/2-pa_chrsizy(wg->wf)/2,
-                            x, pa_maxyg(wg->wf)/2-pa_chrsizy(wg->wf)/2+
-                            pa_chrsizy(wg->wf));
+    tleft = wg->tleft; /* save left side */
+    edtview(wg); /* place cursor in view */
+    if (wg->tleft != tleft || wg->num) editbox_draw(wg); /* redraw all */
+    else {
 
-        }
+        /* back up over the character before, a cursor can touch it */
+        if (p > 0) p--;
+        if (p < wg->tleft) p = wg->tleft;
+        editbox_text(wg, p); /* redraw the tail */
 
     }
 
@@ -2117,12 +2815,12 @@ static void editbox_event(
 
 {
 
-    char*     s;    /* temp string */
-    int       l;    /* length */
     int       span; /* span between characters */
     int       off;  /* offset from last character */
     pa_evtrec er;   /* outbound button event */
     int       i;
+    int       l, h; /* search bounds */
+    int       oc;   /* old cursor position */
 
     switch (ev->etype) {
 
@@ -2133,20 +2831,11 @@ static void editbox_event(
             if (!wg->num || isdigit(ev->echar) || ev->echar == '-' ||
                 ev->echar == '=') {
 
-                l = strlen(wg->face); /* get length of existing face string */
-                if (!wg->ins || wg->curs >= l) { /* insert mode or end */
-
-                    s = malloc(l+1+1); /* get new face string */
-                    strcpy(s, wg->face); /* copy old string into place */
-                    free(wg->face); /* release previous string */
-                    /* move characters after cursor up */
-                    for (i = l; i >= wg->curs; i--) s[i+1] = s[i];
-                    wg->face = s; /* place new string */
-
-                }
-                wg->face[wg->curs] = ev->echar; /* place new character */
+                /* in overwrite mode and not at end, remove old character */
+                if (wg->ins && wg->curs < wg->flen) edtdel(wg, wg->curs);
+                edtins(wg, wg->curs, ev->echar); /* place new character */
                 wg->curs++; /* position after character inserted */
-                editbox_draw(wg); /* redraw the window */
+                editbox_update(wg, wg->curs-1); /* redraw the window */
 
             }
             break;
@@ -2179,10 +2868,10 @@ static void editbox_event(
 
         case pa_etright: /* right character */
             /* not extreme right, go right */
-            if (wg->curs < strlen(wg->face)) {
+            if (wg->curs < wg->flen) {
 
                 wg->curs++;
-                editbox_draw(wg); /* redraw */
+                editbox_update(wg, wg->curs-1); /* redraw */
 
             }
             break;
@@ -2192,7 +2881,7 @@ static void editbox_event(
             if (wg->curs > 0) {
 
                 wg->curs--;
-                editbox_draw(wg); /* redraw */
+                editbox_update(wg, wg->curs); /* redraw */
 
             }
             break;
@@ -2201,23 +2890,19 @@ static void editbox_event(
             /* not extreme left, delete left */
             if (wg->curs > 0) {
 
-                l = strlen(wg->face); /* get length of existing face string */
-                /* back up right characters past cursor */
-                for (i = wg->curs-1; i < l; i++) wg->face[i] = wg->face[i+1];
                 wg->curs--;
-                editbox_draw(wg); /* redraw */
+                edtdel(wg, wg->curs); /* remove character */
+                editbox_update(wg, wg->curs); /* redraw */
 
             }
             break;
 
         case pa_etdelcf: /* delete character forward */
             /* not extreme right, go right */
-            if (wg->curs < strlen(wg->face)) {
+            if (wg->curs < wg->flen) {
 
-                l = strlen(wg->face); /* get length of existing face string */
-                /* back up right characters past cursor */
-                for (i = wg->curs; i < l; i++) wg->face[i] = wg->face[i+1];
-                editbox_draw(wg); /* redraw */
+                edtdel(wg, wg->curs); /* remove character */
+                editbox_update(wg, wg->curs); /* redraw */
 
             }
             break;
@@ -2231,24 +2916,33 @@ static void editbox_event(
         case pa_etmouba: /* mouse click */
             if (ev->amoubn == 1) {
 
-                /* mouse click, select character it indexes */
-                l = strlen(wg->face); /* get length of existing face string */
-                i = 0;
-                /* find first character beyond click */
-                while (ENDLEDSPC+pa_chrpos(wg->wf, wg->face, i) < wg->mpx && i < l) i++;
-                if (i) {
+                /* mouse click, select character it indexes. Find first
+                   character beyond click by search of the glyph offsets */
+                l = wg->tleft;
+                h = wg->flen;
+                while (l < h) {
+
+                    i = (l+h)/2;
+                    if (ENDLEDSPC+edtofs(wg, i)-edtofs(wg, wg->tleft) < wg->mpx)
+                        l = i+1;
+                    else h = i;
+
+                }
+                i = l;
+                if (i > wg->tleft) {
 
                     /* find span between last and next characters */
-                    span = pa_chrpos(wg->wf, wg->face, i)-
-                           pa_chrpos(wg->wf, wg->face, i-1);
+                    span = edtofs(wg, i)-edtofs(wg, i-1);
                     /* find offset last to mouse click */
-                    off = wg->mpx-(ENDLEDSPC+pa_chrpos(wg->wf, wg->face, i-1));
+                    off = wg->mpx-(ENDLEDSPC+edtofs(wg, i-1)-
+                                   edtofs(wg, wg->tleft));
                     /* if mouse click is closer to last, index last */
                     if (off < span/2) i--;
 
                 }
+                oc = wg->curs; /* save old position */
                 wg->curs = i; /* set final position */
-                editbox_draw(wg); /* redraw */
+                editbox_update(wg, oc < i ? oc : i); /* redraw */
 
             }
             break;
@@ -2262,40 +2956,43 @@ static void editbox_event(
 
         case pa_ethomel: /* beginning of line */
             wg->curs = 0;
-            editbox_draw(wg); /* redraw */
+            editbox_update(wg, 0); /* redraw */
             break;
 
         case pa_etendl: /* end of line */
-            wg->curs = strlen(wg->face);
-            editbox_draw(wg); /* redraw */
+            oc = wg->curs; /* save old position */
+            wg->curs = wg->flen;
+            editbox_update(wg, oc); /* redraw */
             break;
 
         case pa_etinsertt: /* toggle insert mode */
             wg->ins = !wg->ins;
-            editbox_draw(wg); /* redraw */
+            editbox_update(wg, wg->curs); /* redraw */
             break;
 
         case pa_etdell: /* delete whole line */
             wg->curs = 0;
-            wg->face[0] = 0;
+            edtset(wg, ""); /* clear text */
             editbox_draw(wg); /* redraw */
             break;
 
         case pa_etleftw: /* left word */
             /* back over any spaces */
-            while (wg->curs > 0 && wg->face[wg->curs-1] == ' ') wg->curs--;
+            while (wg->curs > 0 && edtchr(wg, wg->curs-1) == ' ') wg->curs--;
             /* now back over any non-space */
-            while (wg->curs > 0 && wg->face[wg->curs-1] != ' ') wg->curs--;
-            editbox_draw(wg); /* redraw */
+            while (wg->curs > 0 && edtchr(wg, wg->curs-1) != ' ') wg->curs--;
+            editbox_update(wg, wg->curs); /* redraw */
             break;
 
         case pa_etrightw: /* right word */
-            l = strlen(wg->face); /* get string length */
+            oc = wg->curs; /* save old position */
             /* advance over any non-space */
-            while (wg->curs < l && wg->face[wg->curs] != ' ') wg->curs++;
+            while (wg->curs < wg->flen && edtchr(wg, wg->curs) != ' ')
+                wg->curs++;
             /* advance over any spaces */
-            while (wg->curs < l && wg->face[wg->curs] == ' ') wg->curs++;
-            editbox_draw(wg); /* redraw */
+            while (wg->curs < wg->flen && edtchr(wg, wg->curs) == ' ')
+                wg->curs++;
+            editbox_update(wg, oc); /* redraw */
             break;
 
         default: ;
@@ -2412,7 +3109,7 @@ static void numselbox_event(
             /* send event back to parent window */
             er.etype = pa_etnumbox; /* set button event */
             er.numbid = wg->id; /* set id */
-            er.numbsl = atoi(wg->cw->face); /* set value */
+            er.numbsl = atoi(edtstr(wg->cw)); /* set value */
             pa_sendevent(wg->parent, &er); /* send the event to the parent */
             break;
 
@@ -2425,7 +3122,7 @@ static void numselbox_event(
         case pa_etmouba: /* mouse click */
             if (ev->amoubn == 1) {
 
-                if (wg->cw->face[0]) {
+                if (wg->cw->flen) {
 
                     if (wg->mpx >= pa_maxxg(wg->wf)-udspc*2 &&
                         wg->mpx < pa_maxxg(wg->wf)-udspc) {
@@ -2436,8 +3133,8 @@ static void numselbox_event(
                         if (wg->cw->lbnd < v && v <= wg->cw->ubnd) v--;
                         sprintf(buff, "%d", v);
                         pa_putwidgettext(wg->wf, wg->cw->id, buff);
-                        if (wg->cw->curs > strlen(wg->cw->face))
-                            wg->cw->curs = strlen(wg->cw->face);
+                        if (wg->cw->curs > wg->cw->flen)
+                            wg->cw->curs = wg->cw->flen;
                         editbox_draw(wg->cw);
                         wg->downpress = TRUE; /* set down pressed */
                         numselbox_draw(wg); /* redraw */
@@ -2450,8 +3147,8 @@ static void numselbox_event(
                         if (wg->cw->lbnd <= v && v < wg->cw->ubnd) v++;
                         sprintf(buff, "%d", v);
                         pa_putwidgettext(wg->wf, wg->cw->id, buff);
-                        if (wg->cw->curs > strlen(wg->cw->face))
-                            wg->cw->curs = strlen(wg->cw->face);
+                        if (wg->cw->curs > wg->cw->flen)
+                            wg->cw->curs = wg->cw->flen;
                         editbox_draw(wg->cw);
                         wg->uppress = TRUE; /* set up pressed */
                         numselbox_draw(wg); /* redraw */
@@ -2494,22 +3191,27 @@ static void progbar_draw(
 
     int pbpp; /* prog bar pixel position right side */
 
+    wigbgn(wg); /* start drawing */
     /* draw inactive background */
     fcolort(wg->wf, th_proginacen);
     pa_linewidth(wg->wf, 2);
-    pa_frrect(wg->wf, 1, 1, pa_maxxg(wg->wf), pa_maxyg(wg->wf), 10, 10);
+    pa_frrect(wg->wf, wg->ox+1, wg->oy+1, wg->ox+wmaxxg(wg), wg->oy+wmaxyg(wg),
+              10, 10);
     /* draw inactive edget */
     fcolort(wg->wf, th_proginaedg);
-    pa_rrect(wg->wf, 2, 2, pa_maxxg(wg->wf)-1, pa_maxyg(wg->wf)-1, 10, 10);
+    pa_rrect(wg->wf, wg->ox+2, wg->oy+2, wg->ox+wmaxxg(wg)-1,
+             wg->oy+wmaxyg(wg)-1, 10, 10);
     /* find right side of prog bar */
-    pbpp = (long long)wg->ppos*pa_maxxg(wg->wf)/INT_MAX;
+    pbpp = (long long)wg->ppos*wmaxxg(wg)/INT_MAX;
     /* now draw active */
     fcolort(wg->wf, th_progactcen);
     pa_linewidth(wg->wf, 2);
-    pa_frrect(wg->wf, 1, 1, pbpp, pa_maxyg(wg->wf), 10, 10);
+    pa_frrect(wg->wf, wg->ox+1, wg->oy+1, wg->ox+pbpp, wg->oy+wmaxyg(wg), 10, 10);
     /* draw inactive edget */
     fcolort(wg->wf, th_progactedg);
-    pa_rrect(wg->wf, 2, 2,pbpp-1, pa_maxyg(wg->wf)-1, 10, 10);
+    pa_rrect(wg->wf, wg->ox+2, wg->oy+2, wg->ox+pbpp-1, wg->oy+wmaxyg(wg)-1,
+             10, 10);
+    wigend(wg); /* end drawing */
 
 }
 
@@ -2534,9 +3236,128 @@ static void progbar_event(
 
 /** ****************************************************************************
 
+Find list box visible rows
+
+Finds the number of whole rows that fit in the list box window. This is never
+less than one.
+
+*******************************************************************************/
+
+static int lstvis(
+    /** Widget data pointer */ wigptr wg
+)
+
+{
+
+    int vis;
+
+    vis = (pa_maxyg(wg->wf)-pa_chrsizy(wg->wf)*0.5)/pa_chrsizy(wg->wf);
+    if (vis < 1) vis = 1;
+
+    return (vis);
+
+}
+
+/** ****************************************************************************
+
+Clip list box top row
+
+Keeps the first displayed row of a list box within the list, so that the
+window is filled where the list allows.
+
+*******************************************************************************/
+
+static void lstclip(
+    /** Widget data pointer */ wigptr wg
+)
+
+{
+
+    if (wg->top > wg->strcnt-lstvis(wg)) wg->top = wg->strcnt-lstvis(wg);
+    if (wg->top < 0) wg->top = 0;
+
+}
+
+/** ****************************************************************************
+
+Find list box row at mouse
+
+Finds the logical string number under the last mouse position in a list box.
+Rows are fixed height, so this is calculated directly from the position.
+
+\returns The string number, or 0 if the mouse is not over a string.
+
+*******************************************************************************/
+
+static int lsthit(
+    /** Widget data pointer */ wigptr wg
+)
+
+{
+
+    int y;
+    int r;
+
+    y = pa_chrsizy(wg->wf)*0.5; /* space to first string */
+    r = 0; /* set no row */
+    if (wg->mpy >= y) {
+
+        r = (wg->mpy-y)/pa_chrsizy(wg->wf); /* find displayed row */
+        if (r >= lstvis(wg)) r = 0; /* off bottom */
+        else {
+
+            r += wg->top+1; /* find logical string */
+            if (r > wg->strcnt) r = 0; /* past end of list */
+
+        }
+
+    }
+
+    return (r);
+
+}
+
+/** ****************************************************************************
+
+Draw list box row
+
+Draws a single row of a list box with its background. Rows outside the
+displayed part of the list are ignored. This allows hover and select changes
+to redraw only the rows that changed.
+
+*******************************************************************************/
+
+static void listbox_row(
+    /** Widget data pointer */    wigptr wg,
+    /** Logical string number */ int    sn
+)
+
+{
+
+    int y;
+
+    if (sn > wg->top && sn <= wg->top+lstvis(wg) && sn <= wg->strcnt) {
+
+        y = pa_chrsizy(wg->wf)*0.5+(sn-wg->top-1)*pa_chrsizy(wg->wf);
+        /* draw background, inside outline */
+        if (wg->hover && sn == wg->ss)
+            fcolort(wg->wf, th_lsthov); /* set hover background */
+        else pa_fcolor(wg->wf, pa_white);
+        pa_frect(wg->wf, 4, y, pa_maxxg(wg->wf)-3, y+pa_chrsizy(wg->wf)-1);
+        pa_fcolor(wg->wf, pa_black);
+        pa_cursorg(wg->wf, pa_chrsizy(wg->wf)*0.5, y);
+        fprintf(wg->wf, "%s", wg->strtbl[sn-1]->str); /* place string */
+
+    }
+
+}
+
+/** ****************************************************************************
+
 List box draw handler
 
-Handles drawing list boxes.
+Handles drawing list boxes. Only the rows in view are drawn, so the cost does
+not depend on the length of the list.
 
 *******************************************************************************/
 
@@ -2546,9 +3367,7 @@ static void listbox_draw(
 
 {
 
-    pa_strptr sp;
-    int       y;
-    int       sc;
+    int sn;
 
     /* draw background */
     pa_fcolor(wg->wf, pa_white);
@@ -2557,25 +3376,38 @@ static void listbox_draw(
     fcolort(wg->wf, th_outline1);
     pa_linewidth(wg->wf, 2);
     pa_rrect(wg->wf, 2, 2, pa_maxxg(wg->wf)-1, pa_maxyg(wg->wf)-1, 10, 10);
-    sp = wg->strlst; /* index top of stringlist */
-    y = pa_chrsizy(wg->wf)*0.5; /* space to first string */
-    pa_fcolor(wg->wf, pa_black);
-    sc = 1; /* set first string */
-    while (sp) { /* traverse and paint */
+    lstclip(wg); /* keep display within list */
+    /* paint the rows in view */
+    for (sn = wg->top+1; sn <= wg->top+lstvis(wg); sn++) listbox_row(wg, sn);
+
+}
 
-        if (wg->hover && sc == wg->ss) {
+/** ****************************************************************************
 
-            /* draw in hover background */
-            fcolort(wg->wf, th_lsthov); /* set hover background */
-            pa_frect(wg->wf, 1, y, pa_maxxg(wg->wf), y+pa_chrsizy(wg->wf)-1);
+Scroll list box
 
-        }
-        pa_fcolor(wg->wf, pa_black);
-        pa_cursorg(wg->wf, pa_chrsizy(wg->wf)*0.5, y);
-        fprintf(wg->wf, "%s", sp->str); /* place string */
-        y += pa_chrsizy(wg->wf); /* next line */
-        sp = sp->next; /* next string */
-        sc++; /* next select */
+Moves the first displayed row of a list box by the given number of rows, and
+redraws if that changed the view. The hover row is refound, since the list has
+moved under the mouse.
+
+*******************************************************************************/
+
+static void lstscroll(
+    /** Widget data pointer */ wigptr wg,
+    /** Rows to move */        int    r
+)
+
+{
+
+    int top;
+
+    top = wg->top; /* save current top */
+    wg->top += r; /* move */
+    lstclip(wg); /* keep within list */
+    if (wg->top != top) {
+
+        wg->ss = lsthit(wg); /* refind row under mouse */
+        listbox_draw(wg); /* redraw the window */
 
     }
 
@@ -2597,11 +3429,19 @@ static void listbox_event(
 {
 
     pa_evtrec er; /* outbound button event */
-    int       y;
-    int       sc;
-    pa_strptr sp;
+    int       ss;
 
     if (ev->etype == pa_etredraw) listbox_draw(wg); /* redraw the window */
+    else if (ev->etype == pa_etmouba && ev->amoubn == 4)
+        lstscroll(wg, -LSTSCROLL); /* wheel up */
+    else if (ev->etype == pa_etmouba && ev->amoubn == 5)
+        lstscroll(wg, LSTSCROLL); /* wheel down */
+    else if (ev->etype == pa_etup) lstscroll(wg, -1);
+    else if (ev->etype == pa_etdown) lstscroll(wg, 1);
+    else if (ev->etype == pa_etpagu) lstscroll(wg, -lstvis(wg));
+    else if (ev->etype == pa_etpagd) lstscroll(wg, lstvis(wg));
+    else if (ev->etype == pa_ethome) lstscroll(wg, -wg->strcnt);
+    else if (ev->etype == pa_etend) lstscroll(wg, wg->strcnt);
     else if (ev->etype == pa_etmouba && ev->amoubn == 1) {
 
         /* note that if there is a click in the window, there must have also
@@ -2628,30 +3468,24 @@ static void listbox_event(
         wg->mpy = ev->moupyg;
 
         /* find which string the mouse is over */
-        y = pa_chrsizy(wg->wf)*0.5; /* space to first string */
-        sp = wg->strlst; /* index top of string list */
-        sc = 1; /* set first string */
-        wg->ss = 0; /* set no string selected */
-        while (sp) { /* traverse string list */
-
-            /* if within the string bounding box, select it */
-            if (wg->mpy >= y && wg->mpy <= y+pa_chrsizy(wg->wf)) wg->ss = sc;
-            y += pa_chrsizy(wg->wf); /* next line */
-            sc++; /* next select */
-            sp = sp->next; /* next string */
+        ss = wg->ss; /* save previous */
+        wg->ss = lsthit(wg);
+        if (wg->ss != ss) { /* redraw only the rows that changed */
+
+            listbox_row(wg, ss);
+            listbox_row(wg, wg->ss);
 
         }
-        listbox_draw(wg); /* redraw the window */
 
     } else if (ev->etype == pa_ethover) {
 
         wg->hover = 1; /* hovered */
-        listbox_draw(wg); /* redraw the window */
+        listbox_row(wg, wg->ss); /* redraw the hover row */
 
     } else if (ev->etype == pa_etnohover) {
 
         wg->hover = 0; /* not hovered */
-        listbox_draw(wg); /* redraw the window */
+        listbox_row(wg, wg->ss); /* redraw the hover row */
 
     }
 
@@ -2674,7 +3508,6 @@ static void dropbox_draw(
     int       ddspc;  /* up/down control space */
     int       figsiz; /* size of up/down figures */
     pa_strptr sp;
-    int       sc;
     int       aw;
     int       ah;
     int       cx;
@@ -2713,13 +3546,14 @@ static void dropbox_draw(
     pa_ftriangle(wg->wf, cx-aw*0.5, cy, cx+aw*0.5, cy, cx, cy+ah);
 
     /* draw current select */
-    sp = wg->strlst;
-    sc = wg->ss;
-    /* find selected string */
-    while (sc > 1 && sp) { sp = sp->next; sc--; }
-    fcolort(wg->wf, th_droptext);
-    pa_cursorg(wg->wf, pa_chrsizy(wg->wf)*0.5, pa_chrsizy(wg->wf)*0.5);
-    fprintf(wg->wf, "%s", sp->str); /* place string */
+    sp = fndstr(wg, wg->ss);
+    if (sp) {
+
+        fcolort(wg->wf, th_droptext);
+        pa_cursorg(wg->wf, pa_chrsizy(wg->wf)*0.5, pa_chrsizy(wg->wf)*0.5);
+        fprintf(wg->wf, "%s", sp->str); /* place string */
+
+    }
 
 }
 
@@ -2788,10 +3622,20 @@ static void dropbox_event(
                 pa_listboxsizg(wg->wf, wg->strlst, &lbw, &lbh);
                 w = pa_maxxg(wg->wf); /* set width as same */
                 h = lbh;
+                /* show a fixed number of rows at most, and let the list scroll
+                   the rest. A long list would otherwise ask for a window
+                   taller than the display can have */
+                if (wg->strcnt > DRPROWS)
+                    h -= (wg->strcnt-DRPROWS)*pa_chrsizy(wg->wf);
 
                 /* create the list subwidget */
                 wp = getwig(); /* predef so we can plant list before display */
-                wp->strlst = wg->strlst; /* plant the list */
+                /* share the list and its index */
+                wp->strlst = wg->strlst;
+                wp->strtbl = wg->strtbl;
+                wp->strcnt = wg->strcnt;
+                /* start the view at the current select */
+                if (wg->ss > 0) wp->top = wg->ss-1;
                 /* set to send messages to us (and not logical parent) */
                 wp->pf = wg->wf;
                 wg->cw = wp; /* set child widget */
@@ -2867,8 +3711,6 @@ static void dropeditbox_event(
 
     pa_evtrec er; /* outbound event */
     pa_strptr sp;
-    int       sc;
-    int       l;
 
     if (ev->etype == pa_etredraw) dropeditbox_draw(wg); /* redraw the window */
     else if (ev->etype == WMC_LGTFOC) { /* light focus */
@@ -2886,21 +3728,15 @@ static void dropeditbox_event(
     } else if (ev->etype == pa_etdrpbox) {
 
         /* find current select */
-        sp = wg->cw->strlst;
-        sc = ev->drpbsl;
-        /* find selected string */
-        while (sc > 1 && sp) { sp = sp->next; sc--; }
-        free(wg->cw2->face); /* free existing face string in edit */
-        wg->cw2->face = str(sp->str); /* copy selected to edit */
-        l = strlen(sp->str); /* find string length */
+        sp = fndstr(wg->cw, ev->drpbsl);
+        edtset(wg->cw2, sp->str); /* copy selected to edit */
         /* if cursor past string, clip it */
-        if (wg->cw2->curs > l) wg->cw2->curs = l;
+        if (wg->cw2->curs > wg->cw2->flen) wg->cw2->curs = wg->cw2->flen;
         editbox_draw(wg->cw2); /* redraw edit widget */
 
     } else if (ev->etype == pa_etedtbox) {
 
-        free(wg->face); /* release previous face string */
-        wg->face = str(wg->cw2->face); /* copy the resulting string */
+        edtset(wg, edtstr(wg->cw2)); /* copy the resulting string */
         /* send event back to parent window */
         er.etype = pa_etdrebox; /* set drop edit completion event */
         er.drebid = wg->id; /* set id */
@@ -3244,26 +4080,117 @@ static void slidevert_event(
 
 /** ****************************************************************************
 
-Tab bar draw handler
+Extend tab offsets
 
-Handles drawing a tab bar.
+Tab offsets are found with the widget font and kept, and the table is only
+extended as far as a position along the tab bar needs, so tabs past that
+position are never measured. Each entry is the position of the start of the
+text of a tab, and the entry after the last tab is where the next tab would
+start.
 
 *******************************************************************************/
 
-static void tabbar_draw(
-    /** Widget data pointer */ wigptr wg
+static void tabext(
+    /** Widget data pointer */         wigptr wg,
+    /** Position along the tab bar */ int    p
 )
 
 {
 
-    pa_strptr sp; /* string list pointer */
-    int       sc;
-    int       xm, y, x1, x2;
-    int       th; /* tabbar height/width (by orientation) */
+    int h2; /* half character spacing */
+
+    h2 = pa_chrsizy(wg->wf)*0.5;
+    if (!wg->stroff) { /* no offset table, start one */
+
+        wg->stroff = malloc(sizeof(int)*(wg->strcnt+1));
+        wg->stroff[0] = pa_chrsizy(wg->wf); /* space to first tab */
+        wg->ofscnt = 1;
+
+    }
+    /* extend the table until it passes the position */
+    while (wg->ofscnt <= wg->strcnt && wg->stroff[wg->ofscnt-1]-h2 <= p) {
+
+        wg->stroff[wg->ofscnt] = wg->stroff[wg->ofscnt-1]+
+                                 pa_strsiz(wg->wf,
+                                           wg->strtbl[wg->ofscnt-1]->str)+
+                                 pa_chrsizy(wg->wf);
+        wg->ofscnt++;
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Find tab at position
+
+Finds the tab at the given position along a tab bar, measured in the direction
+the tabs run. The offset table is extended to the position, then the tab is
+found by binary search of the table.
+
+\returns The logical tab number, or 0 if no tab is at the position.
+
+*******************************************************************************/
+
+static int tabhit(
+    /** Widget data pointer */         wigptr wg,
+    /** Position along the tab bar */ int    p
+)
+
+{
+
+    int h2; /* half character spacing */
+    int l, h, m;
+    int tn;
+
+    h2 = pa_chrsizy(wg->wf)*0.5;
+    tabext(wg, p); /* find offsets up to the position */
+    /* find the last tab starting at or before the position */
+    tn = 0;
+    l = 0;
+    h = wg->ofscnt-2;
+    while (l <= h) {
+
+        m = (l+h)/2;
+        if (wg->stroff[m]-h2 <= p) { tn = m+1; l = m+1; }
+        else h = m-1;
+
+    }
+    /* check position is within the tab */
+    if (tn && p > wg->stroff[tn]-pa_chrsizy(wg->wf)+h2) tn = 0;
+
+    return (tn);
+
+}
+
+/** ****************************************************************************
+
+Tab bar draw handler
+
+Handles drawing a tab bar. The tabs are placed from the offset table, which is
+extended only to the end of the bar, so tabs that are out of view are neither
+measured nor drawn.
+
+*******************************************************************************/
+
+static void tabbar_draw(
+    /** Widget data pointer */ wigptr wg
+)
+
+{
+
+    int sc;
+    int xm, y, x1, x2;
+    int th;  /* tabbar height/width (by orientation) */
+    int lim; /* end of the bar in the direction the tabs run */
+    int ts;  /* start of tab text */
+    int te;  /* end of tab text */
+    int h2;  /* half character spacing */
 
     /* find tabbar height/width */
     if (wg->charb) th = pa_chrsizy(wg->parent)*TABHGT; /* character */
     th = pa_chrsizy(wg->wf)*TABHGT; /* graphical */
+    h2 = pa_chrsizy(wg->wf)*0.5;
     if (wg->tor == pa_totop || wg->tor == pa_tobottom) { /* top or bottom */
 
         /* color the background */
@@ -3285,372 +4212,640 @@ static void tabbar_draw(
             pa_line(wg->wf, 1, th, pa_maxxg(wg->wf), th);
             pa_line(wg->wf, 1, th-1, pa_maxxg(wg->wf), th-1);
 
-        } else {
+        } else {
+
+            pa_line(wg->wf, 1, pa_maxyg(wg->wf)-th+1, 
+                            pa_maxxg(wg->wf), pa_maxyg(wg->wf)-th+1);
+            pa_line(wg->wf, 1, pa_maxyg(wg->wf)-th+2, 
+                            pa_maxxg(wg->wf), pa_maxyg(wg->wf)-th+2);
+
+        }
+        /* draw tab text */
+        if (wg->tor == pa_totop) y = pa_chrsizy(wg->wf)*0.5;
+        else y = pa_maxyg(wg->wf)-th+pa_chrsizy(wg->wf)*0.5; /* bottom */
+        lim = pa_maxxg(wg->wf);
+        tabext(wg, lim); /* find offsets of the tabs in view */
+        for (sc = 1; sc < wg->ofscnt && wg->stroff[sc-1] <= lim; sc++) {
+
+            ts = wg->stroff[sc-1]; /* find extent of text */
+            te = wg->stroff[sc]-pa_chrsizy(wg->wf);
+            if (sc == wg->ss || sc == wg->sh) { /* draw select/hover */
+
+                pa_linewidth(wg->wf, 6);
+                if (sc == wg->ss) fcolort(wg->wf, th_tabsel);
+                else fcolort(wg->wf, th_outline1);
+                if (wg->tor == pa_totop)
+                    pa_line(wg->wf, ts-h2, th-2, te+h2, th-2);
+                else
+                    pa_line(wg->wf, ts-h2, pa_maxyg(wg->wf)-th+4,
+                                    te+h2, pa_maxyg(wg->wf)-th+4);
+
+            }
+            if (sc == wg->ss && wg->focus) { /* draw focus box */
+
+                pa_linewidth(wg->wf, 2);
+                fcolort(wg->wf, th_tabfocus);
+                if (wg->tor == pa_totop)
+                    pa_rrect(wg->wf, ts-h2, 5, te+h2, th-3, 10, 10);
+                else
+                    pa_rrect(wg->wf, ts-h2, pa_maxyg(wg->wf)-th+5,
+                                     te+h2, pa_maxyg(wg->wf)-th+th-3,
+                                     10, 10);
+
+            }
+            fcolort(wg->wf, th_tabdis); /* set color disabled */
+            pa_cursorg(wg->wf, ts, y); /* place button face */
+            fprintf(wg->wf, "%s", wg->strtbl[sc-1]->str);
+
+        }
+
+    } else { /* left or right */
+
+        /* if in character mode, round tabbar size to character cell */
+        if (wg->charb && th % pa_chrsizx(wg->parent)) 
+            th = th-(th % pa_chrsizx(wg->parent))+pa_chrsizx(wg->parent);
+        /* color the background */
+        pa_fcolor(wg->wf, pa_white);
+        pa_frect(wg->wf, 1, 1, pa_maxxg(wg->wf), pa_maxyg(wg->wf));
+        fcolort(wg->wf, th_tabback);
+        if (wg->tor == pa_toleft) {
+
+            x1 = 1;
+            x2 = th;
+            pa_frect(wg->wf, x1, 1, x2, pa_maxyg(wg->wf));
+
+        } else {
+
+            x1 = pa_maxxg(wg->wf)-th;
+            x2 = pa_maxxg(wg->wf);
+            pa_frect(wg->wf, x1+1, 1, x2, pa_maxyg(wg->wf));
+
+        }
+        /* outline */
+        pa_linewidth(wg->wf, 1);
+        fcolort(wg->wf, th_outline1);
+        pa_rect(wg->wf, 1, 1, pa_maxxg(wg->wf), pa_maxyg(wg->wf));
+        pa_rect(wg->wf, 2, 2, pa_maxxg(wg->wf)-1, pa_maxyg(wg->wf)-1);
+
+        if (wg->tor == pa_toleft) {
+
+            pa_line(wg->wf, th, 1, th, pa_maxyg(wg->wf));
+            pa_line(wg->wf, th, 1, th-1, pa_maxyg(wg->wf)-1);
+
+        } else { /* right */
+
+           pa_line(wg->wf, pa_maxxg(wg->wf)-th+1, 1,
+                           pa_maxxg(wg->wf)-th+1, pa_maxyg(wg->wf));
+           pa_line(wg->wf, pa_maxxg(wg->wf)-th+2, 1,
+                           pa_maxxg(wg->wf)-th+2, pa_maxyg(wg->wf));
+
+        }
+
+        /* draw tab text */
+        if (wg->tor == pa_toleft) xm = pa_chrsizy(wg->wf)*0.5;
+        else xm = pa_maxxg(wg->wf)-th+pa_chrsizy(wg->wf)+pa_chrsizy(wg->wf)*0.5;
+        if (wg->tor == pa_toleft)
+            pa_path(wg->wf, 0); /* set vertical upwards text */
+        else /* right */
+            pa_path(wg->wf, INT_MAX/2); /* set vertical downwards text */
+        lim = pa_maxyg(wg->wf);
+        tabext(wg, lim); /* find offsets of the tabs in view */
+        for (sc = 1; sc < wg->ofscnt && wg->stroff[sc-1] <= lim; sc++) {
+
+            ts = wg->stroff[sc-1]; /* find extent of text */
+            te = wg->stroff[sc]-pa_chrsizy(wg->wf);
+            if (sc == wg->ss || sc == wg->sh) { /* draw select/hover */
+
+                pa_linewidth(wg->wf, 6);
+                if (sc == wg->ss) fcolort(wg->wf, th_tabsel);
+                else fcolort(wg->wf, th_outline1);
+                if (wg->tor == pa_toleft)
+                    pa_line(wg->wf, th-3, ts-h2, th-3, te+h2);
+                else
+                    pa_line(wg->wf, pa_maxxg(wg->wf)-th+3, ts-h2,
+                                    pa_maxxg(wg->wf)-th+3, te+h2);
+
+            }
+            if (sc == wg->ss && wg->focus) { /* draw focus box */
+
+                pa_linewidth(wg->wf, 2);
+                fcolort(wg->wf, th_tabfocus);
+                if (wg->tor == pa_toleft)
+                    pa_rrect(wg->wf, 5, ts-h2, th-3, te+h2, 10, 10);
+                else
+                    pa_rrect(wg->wf, pa_maxxg(wg->wf)-th+5, ts-h2,
+                                     pa_maxxg(wg->wf)-th+th-3, te+h2,
+                                     10, 10);
+
+            }
+            fcolort(wg->wf, th_tabdis); /* set color disabled */
+            /* upwards text starts at the bottom of the tab */
+            if (wg->tor == pa_toleft) pa_cursorg(wg->wf, xm, te);
+            else pa_cursorg(wg->wf, xm, ts);
+            fprintf(wg->wf, "%s", wg->strtbl[sc-1]->str); /* place button face */
+
+        }
+        pa_path(wg->wf, INT_MAX/4); /* set normal text */
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Tab bar event handler
+
+Handles the events posted to a tab bar.
+
+*******************************************************************************/
+
+static void tabbar_event(
+    /** Event record pointer */ pa_evtrec* ev,
+    /** Widget data pointer */  wigptr wg
+)
+
+{
+
+    pa_evtrec er; /* outbound button event */
+    int       th; /* tabbar height/width (by orientation) */
+    int       sh;
+
+    th = pa_chrsizy(wg->wf)*TABHGT; /* find tabbar height/width graphical */
+    if (ev->etype == pa_etredraw) tabbar_draw(wg); /* redraw the window */
+    else if (ev->etype == pa_etmouba && ev->amoubn == 1) {
+
+        /* note that if there is a click in the window, there must have also
+           a mouse move */
+        if (wg->sh) { /* there is a string hover */
+
+            wg->ss = wg->sh; /* set hover as select */
+            /* send event back to parent window */
+            er.etype = pa_ettabbar; /* set tabbar event */
+            er.tabid = wg->id; /* set id */
+            er.tabsel = wg->ss; /* set string select */
+            /* send the event to the parent */
+            pa_sendevent(wg->parent, &er);
+            tabbar_draw(wg); /* redraw the window */
+
+        }
+
+    } else if (ev->etype == pa_etmoumovg) {
+
+        /* track position */
+        wg->mpx = ev->moupxg; /* set present position */
+        wg->mpy = ev->moupyg;
+
+        /* find which string the mouse is over */
+        sh = wg->sh; /* save previous hover */
+        wg->sh = 0; /* set no string selected */
+        if ((wg->tor == pa_totop && wg->mpy <= th) ||
+            (wg->tor == pa_tobottom && wg->mpy >= pa_maxyg(wg->wf)-th))
+            wg->sh = tabhit(wg, wg->mpx);
+        else if ((wg->tor == pa_toleft && wg->mpx <= th) ||
+                 (wg->tor == pa_toright && wg->mpx >= pa_maxxg(wg->wf)-th))
+            wg->sh = tabhit(wg, wg->mpy);
+        /* only draw if the hover has changed */
+        if (sh != wg->sh) tabbar_draw(wg); /* redraw the window */
+
+    } else if (ev->etype == pa_ethover) {
+
+        wg->hover = 1; /* hovered */
+        tabbar_draw(wg); /* redraw the window */
+
+    } else if (ev->etype == pa_etnohover) {
+
+        wg->hover = 0; /* not hovered */
+        tabbar_draw(wg); /* redraw the window */
+
+    } else if (ev->etype == pa_etfocus) {
+
+        wg->focus = 1; /* in focus */
+        tabbar_draw(wg); /* redraw the window */
+
+    } else if (ev->etype == pa_etnofocus) {
+
+        wg->focus = 0; /* out of focus */
+        tabbar_draw(wg); /* redraw the window */
+
+    } else if (ev->etype == pa_etleft &&
+                   (wg->tor == pa_totop || wg->tor == pa_tobottom) ||
+               ev->etype == pa_etup &&
+                   (wg->tor == pa_toleft || wg->tor == pa_toright)) {
+
+        if (wg->focus && wg->strcnt) {
+
+            /* in focus, there is a list */
+            wg->ss--; /* back up */
+            /* off end, go to last entry */
+            if (wg->ss < 1) wg->ss = wg->strcnt;
+            /* send event back to parent window */
+            er.etype = pa_ettabbar; /* set tabbar event */
+            er.tabid = wg->id; /* set id */
+            er.tabsel = wg->ss; /* set string select */
+            /* send the event to the parent */
+            pa_sendevent(wg->parent, &er);
+            tabbar_draw(wg); /* redraw the window */
+
+        }
+
+    } else if (ev->etype == pa_etright &&
+                   (wg->tor == pa_totop || wg->tor == pa_tobottom) ||
+               ev->etype == pa_etdown &&
+                   (wg->tor == pa_toleft || wg->tor == pa_toright)) {
+
+        if (wg->focus && wg->strcnt) { /* in focus, there is a list */
+
+            wg->ss++; /* next tab */
+            if (wg->ss > wg->strcnt) wg->ss = 1; /* off end, wrap */
+            /* send event back to parent window */
+            er.etype = pa_ettabbar; /* set tabbar event */
+            er.tabid = wg->id; /* set id */
+            er.tabsel = wg->ss; /* set string select */
+            /* send the event to the parent */
+            pa_sendevent(wg->parent, &er);
+            tabbar_draw(wg); /* redraw the window */
+
+        }
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Dispatch widget event
+
+Sends an event to the handler for the type of the widget.
+
+*******************************************************************************/
+
+static void wigevent(
+    /** Event record pointer */ pa_evtrec* ev,
+    /** Widget data pointer */  wigptr     wg
+)
+
+{
+
+    switch (wg->typ) { /* handle according to type */
+
+        case wtcbutton:      cbutton_event(ev, wg); break;
+        case wtbutton:       button_event(ev, wg); break;
+        case wtcheckbox:     checkbox_event(ev, wg); break;
+        case wtradiobutton:  radiobutton_event(ev, wg); break;
+        case wtgroup:        group_event(ev, wg); break;
+        case wtbackground:   background_event(ev, wg); break;
+        case wtscrollvert:   scrollvert_event(ev, wg); break;
+        case wtscrollhoriz:  scrollhoriz_event(ev, wg); break;
+        case wtnumselbox:    numselbox_event(ev, wg); break;
+        case wteditbox:      editbox_event(ev, wg); break;
+        case wtprogbar:      progbar_event(ev, wg); break;
+        case wtlistbox:      listbox_event(ev, wg); break;
+        case wtdropbox:      dropbox_event(ev, wg); break;
+        case wtdropeditbox:  dropeditbox_event(ev, wg); break;
+        case wtslidehoriz:   slidehoriz_event(ev, wg); break;
+        case wtslidevert:    slidevert_event(ev, wg); break;
+        case wttabbar:       tabbar_event(ev, wg); break;
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Draw lightweight widget
+
+Draws a lightweight widget in its parent.
+
+*******************************************************************************/
+
+static void lwtdraw(
+    /** Widget data pointer */ wigptr wg
+)
+
+{
+
+    switch (wg->typ) { /* draw according to type */
+
+        case wtbutton:      button_draw(wg); break;
+        case wtcheckbox:    checkbox_draw(wg); break;
+        case wtradiobutton: radiobutton_draw(wg); break;
+        case wtgroup:       group_draw(wg); break;
+        case wtbackground:  background_draw(wg); break;
+        case wtprogbar:     progbar_draw(wg); break;
+        default: break; /* others are not lightweight */
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Paint lightweight widgets
+
+Draws all of the lightweight widgets in a window that intersect the given
+rectangle, from the bottom of the Z order to the top.
+
+*******************************************************************************/
+
+static void lwtpaint(
+    /** File entry */          filptr fp,
+    /** Rectangle to paint */  int x1, int y1, int x2, int y2
+)
+
+{
+
+    wigptr wp; /* widget pointer */
+
+    lwtbgn(fp); /* draw all with one state save */
+    for (wp = fp->lwtlst; wp; wp = wp->lnext)
+        if (wp->px <= x2 && wp->px+wp->sx-1 >= x1 &&
+            wp->py <= y2 && wp->py+wp->sy-1 >= y1) lwtdraw(wp);
+    lwtend(fp);
+
+}
+
+/** ****************************************************************************
+
+Clear lightweight area
+
+Clears the given rectangle of a window to its background color, then repaints
+the lightweight widgets that remain over it. Used when a lightweight widget is
+moved, resized or removed. What the client drew under the widget is not kept.
+
+*******************************************************************************/
+
+static void lwtclear(
+    /** File entry */          filptr fp,
+    /** Rectangle to clear */  int x1, int y1, int x2, int y2
+)
+
+{
+
+    lwtbgn(fp);
+    pa_reverse(fp->wf, TRUE); /* draw in background color */
+    pa_frect(fp->wf, x1, y1, x2, y2);
+    pa_reverse(fp->wf, FALSE);
+    lwtpaint(fp, x1, y1, x2, y2);
+    lwtend(fp);
+
+}
+
+/** ****************************************************************************
+
+Hit test lightweight widgets
+
+Finds the topmost lightweight widget in a window under the given point, or NULL
+if there is none.
+
+*******************************************************************************/
+
+static wigptr lwthit(
+    /** File entry */ filptr fp,
+    /** Point */      int x, int y
+)
+
+{
 
-            pa_line(wg->wf, 1, pa_maxyg(wg->wf)-th+1, 
-                            pa_maxxg(wg->wf), pa_maxyg(wg->wf)-th+1);
-            pa_line(wg->wf, 1, pa_maxyg(wg->wf)-th+2, 
-                            pa_maxxg(wg->wf), pa_maxyg(wg->wf)-th+2);
+    wigptr wp; /* widget pointer */
+    wigptr hp; /* hit widget */
 
-        }
-        /* draw tab text */
-        if (wg->tor == pa_totop)
-            pa_cursorg(wg->wf, pa_chrsizy(wg->wf), pa_chrsizy(wg->wf)*0.5);
-        else /* bottom */
-            pa_cursorg(wg->wf, pa_chrsizy(wg->wf), 
-                               pa_maxyg(wg->wf)-th+pa_chrsizy(wg->wf)*0.5);
-        sp = wg->strlst; /* index tab string list */
-        sc = 1; /* set first string */
-        while (sp && pa_curxg(wg->wf) <= pa_maxxg(wg->wf)) {
+    hp = NULL;
+    /* the list is bottom first, so the last hit is on top */
+    for (wp = fp->lwtlst; wp; wp = wp->lnext)
+        if (x >= wp->px && x < wp->px+wp->sx &&
+            y >= wp->py && y < wp->py+wp->sy) hp = wp;
 
-            if (sc == wg->ss || sc == wg->sh) { /* draw select/hover */
+    return (hp);
 
-                pa_linewidth(wg->wf, 6);
-                if (sc == wg->ss) fcolort(wg->wf, th_tabsel);
-                else fcolort(wg->wf, th_outline1);
-                if (wg->tor == pa_totop)
-                    pa_line(wg->wf, pa_curxg(wg->wf)-pa_chrsizy(wg->wf)*0.5,
-                                    th-2,
-                                    pa_curxg(wg->wf)+pa_strsiz(wg->wf, sp->str)+
-                                             pa_chrsizy(wg->wf)*0.5,
-                                    th-2);
-                else
-                    pa_line(wg->wf, pa_curxg(wg->wf)-pa_chrsizy(wg->wf)*0.5,
-                                    pa_maxyg(wg->wf)-th+4,
-                                    pa_curxg(wg->wf)+pa_strsiz(wg->wf, sp->str)+
-                                             pa_chrsizy(wg->wf)*0.5,
-                                    pa_maxyg(wg->wf)-th+4);
+}
 
-            }
-            if (sc == wg->ss && wg->focus) { /* draw focus box */
+/** ****************************************************************************
 
-                pa_linewidth(wg->wf, 2);
-                fcolort(wg->wf, th_tabfocus);
-                if (wg->tor == pa_totop)
-                    pa_rrect(wg->wf, pa_curxg(wg->wf)-pa_chrsizy(wg->wf)*0.5,
-                                     5,
-                                     pa_curxg(wg->wf)+
-                                         pa_strsiz(wg->wf, sp->str)+
-                                         pa_chrsizy(wg->wf)*0.5,
-                                     th-3,
-                                     10, 10);
-                else
-                    pa_rrect(wg->wf, pa_curxg(wg->wf)-pa_chrsizy(wg->wf)*0.5,
-                                     pa_maxyg(wg->wf)-th+5,
-                                     pa_curxg(wg->wf)+pa_strsiz(wg->wf, sp->str)+
-                                         pa_chrsizy(wg->wf)*0.5,
-                                     pa_maxyg(wg->wf)-th+th-3,
-                                     10, 10);
+Send lightweight widget a simple event
 
-            }
-            fcolort(wg->wf, th_tabdis); /* set color disabled */
-            fprintf(wg->wf, "%s", sp->str); /* place button face */
-            /* space off between tabs */
-            if (sp->next) pa_cursorg(wg->wf,
-                                     pa_curxg(wg->wf)+pa_chrsizy(wg->wf),
-                                     pa_curyg(wg->wf));
-            sp = sp->next; /* next tab */
-            sc++; /* count */
+Sends an event with no parameters, like focus or hover, to a lightweight
+widget.
 
-        }
+*******************************************************************************/
 
-    } else { /* left or right */
+static void lwtsend(
+    /** Widget data pointer */ wigptr    wg,
+    /** Event to send */       pa_evtcod et
+)
 
-        /* if in character mode, round tabbar size to character cell */
-        if (wg->charb && th % pa_chrsizx(wg->parent)) 
-            th = th-(th % pa_chrsizx(wg->parent))+pa_chrsizx(wg->parent);
-        /* color the background */
-        pa_fcolor(wg->wf, pa_white);
-        pa_frect(wg->wf, 1, 1, pa_maxxg(wg->wf), pa_maxyg(wg->wf));
-        fcolort(wg->wf, th_tabback);
-        if (wg->tor == pa_toleft) {
+{
 
-            x1 = 1;
-            x2 = th;
-            pa_frect(wg->wf, x1, 1, x2, pa_maxyg(wg->wf));
+    pa_evtrec er; /* event to send */
 
-        } else {
+    er.etype = et;
+    er.winid = 0; /* no window */
+    er.handled = 1;
+    wigevent(&er, wg);
 
-            x1 = pa_maxxg(wg->wf)-th;
-            x2 = pa_maxxg(wg->wf);
-            pa_frect(wg->wf, x1+1, 1, x2, pa_maxyg(wg->wf));
+}
 
-        }
-        /* outline */
-        pa_linewidth(wg->wf, 1);
-        fcolort(wg->wf, th_outline1);
-        pa_rect(wg->wf, 1, 1, pa_maxxg(wg->wf), pa_maxyg(wg->wf));
-        pa_rect(wg->wf, 2, 2, pa_maxxg(wg->wf)-1, pa_maxyg(wg->wf)-1);
+/** ****************************************************************************
 
-        if (wg->tor == pa_toleft) {
+Set lightweight focus
 
-            pa_line(wg->wf, th, 1, th, pa_maxyg(wg->wf));
-            pa_line(wg->wf, th, 1, th-1, pa_maxyg(wg->wf)-1);
+Moves the focus among the lightweight widgets in a window. NULL removes the
+focus from all of them.
 
-        } else { /* right */
+*******************************************************************************/
 
-           pa_line(wg->wf, pa_maxxg(wg->wf)-th+1, 1,
-                           pa_maxxg(wg->wf)-th+1, pa_maxyg(wg->wf));
-           pa_line(wg->wf, pa_maxxg(wg->wf)-th+2, 1,
-                           pa_maxxg(wg->wf)-th+2, pa_maxyg(wg->wf));
+static void lwtfocus(
+    /** File entry */          filptr fp,
+    /** Widget to focus */     wigptr wg
+)
 
-        }
+{
 
-        /* draw tab text */
-        if (wg->tor == pa_toleft)
-            pa_cursorg(wg->wf, pa_chrsizy(wg->wf)*0.5, pa_chrsizy(wg->wf));
-        else
-            pa_cursorg(wg->wf, pa_maxxg(wg->wf)-th+
-                                   pa_chrsizy(wg->wf)+pa_chrsizy(wg->wf)*0.5,
-                               pa_chrsizy(wg->wf));
-        xm = pa_curxg(wg->wf); /* save the left margin */
-        sp = wg->strlst; /* index tab string list */
-        sc = 1; /* set first string */
-        if (wg->tor == pa_toleft)
-            pa_path(wg->wf, 0); /* set vertical upwards text */
-        else /* right */
-            pa_path(wg->wf, INT_MAX/2); /* set vertical downwards text */
-        while (sp && pa_curyg(wg->wf) >= 1) {
+    if (wg != fp->lwtfoc) { /* focus changes */
 
-            if (sc == wg->ss || sc == wg->sh) { /* draw select/hover */
+        if (fp->lwtfoc) lwtsend(fp->lwtfoc, pa_etnofocus);
+        fp->lwtfoc = wg;
+        if (wg) lwtsend(wg, pa_etfocus);
 
-                pa_linewidth(wg->wf, 6);
-                if (sc == wg->ss) fcolort(wg->wf, th_tabsel);
-                else fcolort(wg->wf, th_outline1);
-                if (wg->tor == pa_toleft)
-                    pa_line(wg->wf, th-3,
-                                    pa_curyg(wg->wf)-pa_chrsizy(wg->wf)*0.5,
-                                    th-3,
-                                    pa_curyg(wg->wf)+pa_strsiz(wg->wf, sp->str)+
-                                             pa_chrsizy(wg->wf)*0.5);
-                else
-                    pa_line(wg->wf, pa_maxxg(wg->wf)-th+3,
-                                    pa_curyg(wg->wf)-pa_chrsizy(wg->wf)*0.5,
-                                    pa_maxxg(wg->wf)-th+3,
-                                    pa_curyg(wg->wf)+pa_strsiz(wg->wf, sp->str)+
-                                             pa_chrsizy(wg->wf)*0.5);
+    }
 
-            }
-            if (sc == wg->ss && wg->focus) { /* draw focus box */
+}
 
-                pa_linewidth(wg->wf, 2);
-                fcolort(wg->wf, th_tabfocus);
-                if (wg->tor == pa_toleft)
-                    pa_rrect(wg->wf, 5, pa_curyg(wg->wf)-pa_chrsizy(wg->wf)*0.5,
-                                     th-3, pa_curyg(wg->wf)+
-                                               pa_strsiz(wg->wf, sp->str)+
-                                               pa_chrsizy(wg->wf)*0.5,
-                                     10, 10);
-                else
-                    pa_rrect(wg->wf, pa_maxxg(wg->wf)-th+5,
-                                     pa_curyg(wg->wf)-pa_chrsizy(wg->wf)*0.5,
-                                     pa_maxxg(wg->wf)-th+th-3,
-                                     pa_curyg(wg->wf)+pa_strsiz(wg->wf, sp->str)+
-                                         pa_chrsizy(wg->wf)*0.5,
-                                     10, 10);
+/** ****************************************************************************
 
-            }
-            fcolort(wg->wf, th_tabdis); /* set color disabled */
-            if (wg->tor == pa_toleft)
-                /* back up to start of string */
-                pa_cursorg(wg->wf, pa_curxg(wg->wf),
-                                   pa_curyg(wg->wf)+pa_strsiz(wg->wf, sp->str));
-            y = pa_curyg(wg->wf); /* save y position */
-            fprintf(wg->wf, "%s", sp->str); /* place button face */
-            /* space off between tabs */
-            if (sp->next) {
+Place lightweight widget
 
-                if (wg->tor == pa_toleft)
-                    pa_cursorg(wg->wf, xm, y+pa_chrsizy(wg->wf));
-                else
-                    pa_cursorg(wg->wf, xm, pa_curyg(wg->wf)+pa_chrsizy(wg->wf));
+Moves and/or resizes a lightweight widget. The old area is cleared, and the new
+area painted.
 
+*******************************************************************************/
 
-            }
-            sp = sp->next; /* next tab */
-            sc++; /* count */
+static void lwtplace(
+    /** Widget data pointer */ wigptr wg,
+    /** New position */        int x, int y,
+    /** New size */            int sx, int sy
+)
 
-        }
-        pa_path(wg->wf, INT_MAX/4); /* set normal text */
+{
 
-    }
+    filptr fp;             /* parent file entry */
+    int    x1, y1, x2, y2; /* old rectangle */
+
+    fp = opnfil[fileno(wg->wf)];
+    x1 = wg->px; /* save old rectangle */
+    y1 = wg->py;
+    x2 = wg->px+wg->sx-1;
+    y2 = wg->py+wg->sy-1;
+    wg->px = x; /* set new position and size */
+    wg->py = y;
+    wg->ox = x-1;
+    wg->oy = y-1;
+    wg->sx = sx;
+    wg->sy = sy;
+    lwtbgn(fp); /* draw both with one state save */
+    lwtclear(fp, x1, y1, x2, y2);
+    lwtpaint(fp, x, y, x+sx-1, y+sy-1);
+    lwtend(fp);
 
 }
 
 /** ****************************************************************************
 
-Tab bar event handler
+Change lightweight widget Z order
 
-Handles the events posted to a tab bar.
+Moves a lightweight widget to the top or bottom of the Z order of the
+lightweights in its parent, and repaints it.
 
 *******************************************************************************/
 
-static void tabbar_event(
-    /** Event record pointer */ pa_evtrec* ev,
-    /** Widget data pointer */  wigptr wg
+static void lwtorder(
+    /** Widget data pointer */ wigptr wg,
+    /** Move to top */         int    top
 )
 
 {
 
-    pa_evtrec er; /* outbound button event */
-    int       th; /* tabbar height/width (by orientation) */
-    int       x, y;
-    int       sc;
-    int       sh;
-    pa_strptr sp;
+    filptr fp; /* parent file entry */
+    wigptr p;  /* list pointer */
 
-    th = pa_chrsizy(wg->wf)*TABHGT; /* find tabbar height/width graphical */
-    if (ev->etype == pa_etredraw) tabbar_draw(wg); /* redraw the window */
-    else if (ev->etype == pa_etmouba && ev->amoubn == 1) {
+    fp = opnfil[fileno(wg->wf)];
+    /* remove from list */
+    if (fp->lwtlst == wg) fp->lwtlst = wg->lnext;
+    else {
 
-        /* note that if there is a click in the window, there must have also
-           a mouse move */
-        if (wg->sh) { /* there is a string hover */
+        p = fp->lwtlst;
+        while (p->lnext != wg) p = p->lnext;
+        p->lnext = wg->lnext;
 
-            wg->ss = wg->sh; /* set hover as select */
-            /* send event back to parent window */
-            er.etype = pa_ettabbar; /* set tabbar event */
-            er.tabid = wg->id; /* set id */
-            er.tabsel = wg->ss; /* set string select */
-            /* send the event to the parent */
-            pa_sendevent(wg->parent, &er);
-            tabbar_draw(wg); /* redraw the window */
+    }
+    wg->lnext = NULL;
+    if (!top) { /* insert at bottom */
 
-        }
+        wg->lnext = fp->lwtlst;
+        fp->lwtlst = wg;
 
-    } else if (ev->etype == pa_etmoumovg) {
+    } else if (!fp->lwtlst) fp->lwtlst = wg; /* insert at top */
+    else {
 
-        /* track position */
-        wg->mpx = ev->moupxg; /* set present position */
-        wg->mpy = ev->moupyg;
+        p = fp->lwtlst;
+        while (p->lnext) p = p->lnext;
+        p->lnext = wg;
 
-        /* find which string the mouse is over */
-        if (wg->tor == pa_totop || wg->tor == pa_tobottom)
-            x = pa_chrsizy(wg->wf); /* space to first string */
-        else
-            y = pa_chrsizy(wg->wf); /* space to first string */
-        sp = wg->strlst; /* index top of string list */
-        sc = 1; /* set first string */
-        sh = wg->sh; /* save previous hover */
-        wg->sh = 0; /* set no string selected */
-        while (sp) { /* traverse string list */
+    }
+    lwtpaint(fp, wg->px, wg->py, wg->px+wg->sx-1, wg->py+wg->sy-1);
 
-            /* if within the string bounding box, select it */
-            if (wg->tor == pa_totop) {
+}
 
-                if (wg->mpx >= x-pa_chrsizy(wg->wf)*0.5 &&
-                    wg->mpx <= x+pa_strsiz(wg->wf, sp->str)+pa_chrsizy(wg->wf)*0.5 &&
-                    wg->mpy <= th)
-                    wg->sh = sc;
+/** ****************************************************************************
 
-            } else if (wg->tor == pa_tobottom) {
+Process lightweight widget window event
 
-                if (wg->mpx >= x-pa_chrsizy(wg->wf)*0.5 &&
-                    wg->mpx <= x+pa_strsiz(wg->wf, sp->str)+pa_chrsizy(wg->wf)*0.5 &&
-                    wg->mpy >= pa_maxyg(wg->wf)-th)
-                    wg->sh = sc;
+Handles an event for a window that has lightweight widgets. The repaint message
+and mouse input are processed here, and anything the widgets don't take is sent
+on to the client. Mouse positions are made local to the widget they are sent
+to.
 
-            } if (wg->tor == pa_toleft) {
+A button press on a widget goes to that widget only. Mouse movement and button
+releases also go to the client, even while a widget holds the button, so the
+client always knows where the mouse is and that its buttons are up.
 
-                if (wg->mpy >= y-pa_chrsizy(wg->wf)*0.5 &&
-                    wg->mpy <= y+pa_strsiz(wg->wf, sp->str)+pa_chrsizy(wg->wf)*0.5 &&
-                    wg->mpx <= th)
-                    wg->sh = sc;
+*******************************************************************************/
 
-            } else {
+static void lwtevent(
+    /** Event record pointer */ pa_evtrec* ev,
+    /** File entry */           filptr     fp
+)
 
-                if (wg->mpy >= y-pa_chrsizy(wg->wf)*0.5 &&
-                    wg->mpy <= y+pa_strsiz(wg->wf, sp->str)+pa_chrsizy(wg->wf)*0.5 &&
-                    wg->mpx >= pa_maxxg(wg->wf)-th)
-                    wg->sh = sc;
+{
 
-            }
+    wigptr    wp; /* widget pointer */
+    pa_evtrec er; /* local event copy */
 
-            /* next tab */
-            if (wg->tor == pa_totop || wg->tor == pa_tobottom)
-                x += pa_strsiz(wg->wf, sp->str)+pa_chrsizy(wg->wf);
-            else
-                y += pa_strsiz(wg->wf, sp->str)+pa_chrsizy(wg->wf);
-            sc++; /* next select */
-            sp = sp->next; /* next string */
+    if (ev->etype == WMC_LWTRDW) { /* repaint pending */
 
-        }
-        /* only draw if the hover has changed */
-        if (sh != wg->sh) tabbar_draw(wg); /* redraw the window */
+        if (fp->rdw) {
 
-    } else if (ev->etype == pa_ethover) {
+            fp->rdw = FALSE;
+            lwtpaint(fp, fp->rx1, fp->ry1, fp->rx2, fp->ry2);
 
-        wg->hover = 1; /* hovered */
-        tabbar_draw(wg); /* redraw the window */
+        }
 
-    } else if (ev->etype == pa_etnohover) {
+    } else if (ev->etype == pa_etredraw) {
 
-        wg->hover = 0; /* not hovered */
-        tabbar_draw(wg); /* redraw the window */
+        /* the client repaints first, then we paint over it */
+        lwtdmg(fp, ev->rsx, ev->rsy, ev->rex, ev->rey);
+        widget_event_old(ev);
 
-    } else if (ev->etype == pa_etfocus) {
+    } else if (ev->etype == pa_etmoumovg) {
 
-        wg->focus = 1; /* in focus */
-        tabbar_draw(wg); /* redraw the window */
+        fp->mpx = ev->moupxg; /* track mouse */
+        fp->mpy = ev->moupyg;
+        wp = lwthit(fp, fp->mpx, fp->mpy);
+        if (wp != fp->lwthov) { /* hover changes */
 
-    } else if (ev->etype == pa_etnofocus) {
+            if (fp->lwthov) lwtsend(fp->lwthov, pa_etnohover);
+            fp->lwthov = wp;
+            if (wp) lwtsend(wp, pa_ethover);
 
-        wg->focus = 0; /* out of focus */
-        tabbar_draw(wg); /* redraw the window */
+        }
+        /* a widget holding the button gets movement outside of it */
+        if (fp->lwtgrb) wp = fp->lwtgrb;
+        if (wp) {
 
-    } else if (ev->etype == pa_etleft &&
-                   (wg->tor == pa_totop || wg->tor == pa_tobottom) ||
-               ev->etype == pa_etup &&
-                   (wg->tor == pa_toleft || wg->tor == pa_toright)) {
+            er = *ev; /* make local to widget */
+            er.moupxg -= wp->ox;
+            er.moupyg -= wp->oy;
+            wigevent(&er, wp);
 
-        if (wg->focus && wg->strlst) {
+        }
+        widget_event_old(ev); /* client sees movement too */
 
-            /* in focus, there is a list */
-            wg->ss--; /* back up */
-            if (wg->ss < 1) { /* off end, go to last entry */
+    } else if (ev->etype == pa_etmouba) {
 
-                sp = wg->strlst; /* index top of string list */
-                sc = 1; /* set first string */
-                /* find last */
-                while (sp->next) { sp = sp->next; sc++; }
-                wg->ss = sc;
+        wp = lwthit(fp, fp->mpx, fp->mpy);
+        lwtfocus(fp, wp); /* set or remove focus */
+        if (wp) {
 
-            }
-            /* send event back to parent window */
-            er.etype = pa_ettabbar; /* set tabbar event */
-            er.tabid = wg->id; /* set id */
-            er.tabsel = wg->ss; /* set string select */
-            /* send the event to the parent */
-            pa_sendevent(wg->parent, &er);
-            tabbar_draw(wg); /* redraw the window */
+            if (ev->amoubn == 1) fp->lwtgrb = wp; /* set holding button */
+            wigevent(ev, wp);
 
-        }
+        } else widget_event_old(ev);
 
-    } else if (ev->etype == pa_etright &&
-                   (wg->tor == pa_totop || wg->tor == pa_tobottom) ||
-               ev->etype == pa_etdown &&
-                   (wg->tor == pa_toleft || wg->tor == pa_toright)) {
+    } else if (ev->etype == pa_etmoubd && fp->lwtgrb) {
 
-        if (wg->focus && sp) { /* in focus, there is a list */
+        wp = fp->lwtgrb;
+        if (ev->dmoubn == 1) fp->lwtgrb = NULL; /* release */
+        er = *ev; /* send widget a copy */
+        wigevent(&er, wp);
+        widget_event_old(ev); /* client sees the release too */
 
-            /* find last entry */
-            sp = wg->strlst; /* index top of string list */
-            sc = 1; /* set first string */
-            /* find last */
-            while (sp->next) { sp = sp->next; sc++; }
-            wg->ss++; /* next tab */
-            if (wg->ss > sc) wg->ss = 1; /* off end, wrap */
-            /* send event back to parent window */
-            er.etype = pa_ettabbar; /* set tabbar event */
-            er.tabid = wg->id; /* set id */
-            er.tabsel = wg->ss; /* set string select */
-            /* send the event to the parent */
-            pa_sendevent(wg->parent, &er);
-            tabbar_draw(wg); /* redraw the window */
+    } else if (ev->etype == pa_etnohover) {
 
-        }
+        /* mouse left the window */
+        if (fp->lwthov) lwtsend(fp->lwthov, pa_etnohover);
+        fp->lwthov = NULL;
+        widget_event_old(ev);
 
-    }
+    } else widget_event_old(ev);
 
 }
 
@@ -3668,32 +4863,43 @@ static void widget_event(
 
 {
 
-    wigptr wg; /* pointer to widget */
+    wigptr    wg; /* pointer to widget */
+    pa_evtrec er; /* repaint event */
 
     /* if not our window, send it on */
     wg = xltwig[ev->winid+MAXFIL]; /* get possible widget entry */
-    if (!wg) widget_event_old(ev);
-    else switch (wg->typ) { /* handle according to type */
+    if (wg) {
 
-        case wtcbutton:      cbutton_event(ev, wg); break;
-        case wtbutton:       button_event(ev, wg); break;
-        case wtcheckbox:     checkbox_event(ev, wg); break;
-        case wtradiobutton:  radiobutton_event(ev, wg); break;
-        case wtgroup:        group_event(ev, wg); break;
-        case wtbackground:   background_event(ev, wg); break;
-        case wtscrollvert:   scrollvert_event(ev, wg); break;
-        case wtscrollhoriz:  scrollhoriz_event(ev, wg); break;
-        case wtnumselbox:    numselbox_event(ev, wg); break;
-        case wteditbox:      editbox_event(ev, wg); break;
-        case wtprogbar:      progbar_event(ev, wg); break;
-        case wtlistbox:      listbox_event(ev, wg); break;
-        case wtdropbox:      dropbox_event(ev, wg); break;
-        case wtdropeditbox:  dropeditbox_event(ev, wg); break;
-        case wtslidehoriz:   slidehoriz_event(ev, wg); break;
-        case wtslidevert:    slidevert_event(ev, wg); break;
-        case wttabbar:       tabbar_event(ev, wg); break;
+        if (ev->etype == WMC_WIGRDW) { /* repaint pending */
 
-    }
+            if (wg->rdw) { /* repaint the damage collected */
+
+                wg->rdw = FALSE;
+                er = *ev;
+                er.etype = pa_etredraw;
+                er.rsx = wg->rx1;
+                er.rsy = wg->ry1;
+                er.rex = wg->rx2;
+                er.rey = wg->ry2;
+                wigevent(&er, wg);
+
+            }
+
+        } else {
+
+            /* a system redraw over the pending damage covers it */
+            if (ev->etype == pa_etredraw && wg->rdw &&
+                ev->rsx <= wg->rx1 && ev->rsy <= wg->ry1 &&
+                ev->rex >= wg->rx2 && ev->rey >= wg->ry2) wg->rdw = FALSE;
+            wigevent(ev, wg);
+
+        }
+
+    } else if (xltlwt[ev->winid+MAXFIL])
+        lwtevent(ev, xltlwt[ev->winid+MAXFIL]);
+    /* a repaint message for a closed window goes nowhere */
+    else if (ev->etype != WMC_LWTRDW && ev->etype != WMC_WIGRDW)
+        widget_event_old(ev);
 
 }
 
@@ -3758,9 +4964,22 @@ static void ikillwidget(
 {
 
     int    fn; /* logical file name */
+    wigptr wp; /* widget entry pointer */
+    int    x1, y1, x2, y2; /* lightweight widget rectangle */
 
     fn = fileno(f); /* get the logical file number */
-    intkillwidget(fn, id); /* kill widget */
+    wp = fndwig(f, id); /* index the widget */
+    if (wp->lwt) {
+
+        /* the widget is drawn in the parent, and must be cleared from it */
+        x1 = wp->px;
+        y1 = wp->py;
+        x2 = wp->px+wp->sx-1;
+        y2 = wp->py+wp->sy-1;
+        intkillwidget(fn, id); /* kill widget */
+        lwtclear(opnfil[fn], x1, y1, x2, y2);
+
+    } else intkillwidget(fn, id); /* kill widget */
 
 }
 
@@ -3853,8 +5072,8 @@ static void igetwidgettext(
     if (wp->typ != wteditbox && wp->typ != wtdropeditbox)
         error("Widget content cannot be read");
     /* check face text too large for buffer */
-    if (strlen(wp->face) >= sl) error("Face text too large for result");
-    strcpy(s, wp->face); /* copy face text to result */
+    if (wp->flen >= sl) error("Face text too large for result");
+    strcpy(s, edtstr(wp)); /* copy face text to result */
 
 }
 
@@ -3880,9 +5099,12 @@ static void iputwidgettext(
     /* check this widget can have face text read */
     if (wp->typ != wteditbox && wp->typ != wtdropeditbox)
         error("Widget contents cannot be written");
-    free(wp->face); /* dispose of previous face string */
-    wp->face = str(s); /* place new face */
-    widget_redraw(wp); /* send redraw to widget */
+    if (strcmp(edtstr(wp), s)) { /* text has changed */
+
+        edtset(wp, s); /* place new face */
+        widget_redraw(wp); /* send redraw to widget */
+
+    }
 
 }
 
@@ -3906,7 +5128,8 @@ static void isizwidgetg(
     wigptr    wp;  /* widget entry pointer */
 
     wp = fndwig(f, id); /* index the widget */
-    pa_setsizg(wp->wf, x, y); /* set size */
+    if (wp->lwt) lwtplace(wp, wp->px, wp->py, x, y);
+    else pa_setsizg(wp->wf, x, y); /* set size */
 
 }
 
@@ -3933,7 +5156,8 @@ static void isizwidget(
     /* form graphical from character size */
     x = (x-1)*pa_chrsizx(f)+1;
     y = (y-1)*pa_chrsizy(f)+1;
-    pa_setsizg(wp->wf, x, y); /* set size */
+    if (wp->lwt) lwtplace(wp, wp->px, wp->py, x, y);
+    else pa_setsizg(wp->wf, x, y); /* set size */
 
 }
 
@@ -3957,7 +5181,8 @@ static void iposwidgetg(
     wigptr wp;  /* widget entry pointer */
 
     wp = fndwig(f, id); /* index the widget */
-    pa_setposg(wp->wf, x, y); /* set size */
+    if (wp->lwt) lwtplace(wp, x, y, wp->sx, wp->sy);
+    else pa_setposg(wp->wf, x, y); /* set size */
 
 }
 
@@ -3984,7 +5209,8 @@ static void iposwidget(
     /* form graphical from character coordinates */
     x = (x-1)*pa_chrsizx(f)+1;
     y = (y-1)*pa_chrsizy(f)+1;
-    pa_setposg(wp->wf, x, y); /* set size */
+    if (wp->lwt) lwtplace(wp, x, y, wp->sx, wp->sy);
+    else pa_setposg(wp->wf, x, y); /* set size */
 
 }
 
@@ -4004,7 +5230,8 @@ static void ibackwidget(
     wigptr wp;  /* widget entry pointer */
 
     wp = fndwig(f, id); /* index the widget */
-    pa_back(wp->wf); /* place to back */
+    if (wp->lwt) lwtorder(wp, FALSE);
+    else pa_back(wp->wf); /* place to back */
 
 }
 
@@ -4024,7 +5251,8 @@ static void ifrontwidget(
     wigptr    wp;  /* widget entry pointer */
 
     wp = fndwig(f, id); /* index the widget */
-    pa_front(wp->wf); /* place to front */
+    if (wp->lwt) lwtorder(wp, TRUE);
+    else pa_front(wp->wf); /* place to front */
 
 }
 
@@ -4044,7 +5272,9 @@ static void ifocuswidget(
     wigptr    wp;  /* widget entry pointer */
 
     wp = fndwig(f, id); /* index the widget */
-    pa_focus(wp->wf); /* send focus to that window */
+    /* a lightweight widget takes focus from its siblings */
+    if (wp->lwt) lwtfocus(opnfil[fileno(f)], wp);
+    else pa_focus(wp->wf); /* send focus to that window */
 
 }
 
@@ -4125,7 +5355,8 @@ static void ibuttong(
 
     wp = NULL; /* set no predefinition */
     widget(f, x1, y1, x2, y2, s, id, wtbutton, &wp);
-    pa_linewidth(wp->wf, 3); /* thicker lines */
+    /* thicker lines, a lightweight sets its own as it draws */
+    if (!wp->lwt) pa_linewidth(wp->wf, 3);
 
 }
 
@@ -4772,8 +6003,12 @@ static void iscrollpos(
     /* check this widget is a scrollbar */
     if (wp->typ != wtscrollvert && wp->typ != wtscrollhoriz)
         error("Widget not a scroll bar");
-    wp->sclpos = r; /* set scroll bar postition */
-    widget_redraw(wp); /* send redraw to widget */
+    if (wp->sclpos != r) { /* position has changed */
+
+        wp->sclpos = r; /* set scroll bar postition */
+        widget_redraw(wp); /* send redraw to widget */
+
+    }
 
 }
 
@@ -4800,8 +6035,12 @@ static void iscrollsiz(
     /* check this widget is a scrollbar */
     if (wp->typ != wtscrollvert && wp->typ != wtscrollhoriz)
         error("Widget not a scroll bar");
-    wp->sclsiz = r; /* set scroll bar size */
-    widget_redraw(wp); /* send redraw to widget */
+    if (wp->sclsiz != r) { /* size has changed */
+
+        wp->sclsiz = r; /* set scroll bar size */
+        widget_redraw(wp); /* send redraw to widget */
+
+    }
 
 }
 
@@ -5167,8 +6406,12 @@ static void iprogbarpos(
     wp = fndwig(f, id); /* index the widget */
     if (wp->typ != wtprogbar) error("Type of widget is not progress bar");
     if (pos < 0) error("Invalid progress bar position");
-    wp->ppos = pos; /* set progress bar position */
-    progbar_draw(wp); /* redraw the widget with that */
+    if (wp->ppos != pos) { /* position has changed */
+
+        wp->ppos = pos; /* set progress bar position */
+        widget_redraw(wp); /* send redraw to widget */
+
+    }
 
 }
 
@@ -5280,7 +6523,7 @@ static void ilistboxg(
 
     /* create the widget */
     wp = getwig(); /* predef so we can plant list before display */
-    wp->strlst = nl; /* plant the list */
+    plnstrlst(wp, nl); /* plant the list */
     widget(f, x1, y1, x2, y2, "", id, wtlistbox, &wp);
 
 }
@@ -5421,7 +6664,7 @@ static void idropboxg(
 
     /* create the widget */
     wp = getwig(); /* predef so we can plant list before display */
-    wp->strlst = nl; /* plant the list */
+    plnstrlst(wp, nl); /* plant the list */
     wp->ss = 1; /* select first entry */
     widget(f, x1, y1, x2, y1+ch-1, "", id, wtdropbox, &wp);
 
@@ -5560,7 +6803,7 @@ static void idropeditboxg(
 
     /* set up a subclass entry for dropbox */
     wps = getwig(); /* get widget entry */
-    wps->strlst = nl; /* set up string list */
+    plnstrlst(wps, nl); /* set up string list */
     wps->ss = 1; /* select first entry */
     /* subclass drop/edit control */
     widget(wp->wf, 1, 1, cw, ch, "", 1, wtdropbox, &wps);
@@ -6002,7 +7245,7 @@ static void itabbarg(
 
     /* create the widget */
     wp = getwig(); /* predef so we can plant list before display */
-    wp->strlst = nl; /* plant the list */
+    plnstrlst(wp, nl); /* plant the list */
     wp->ss = 1; /* select first entry */
     wp->tor = tor; /* set tab orientation */
     widget(f, x1, y1, x2, y2, "", id, wttabbar, &wp);
@@ -6044,7 +7287,7 @@ static void itabbar(
 
     /* create the widget */
     wp = getwig(); /* predef so we can plant list before display */
-    wp->strlst = nl; /* plant the list */
+    plnstrlst(wp, nl); /* plant the list */
     wp->ss = 1; /* select first entry */
     wp->tor = tor; /* set tab orientation */
     wp->charb = TRUE; /* set character grid */
@@ -6071,20 +7314,15 @@ static void itabsel(
 
     wigptr    wp;  /* widget entry pointer */
     int       chg; /* widget state changes */
-    pa_strptr sp;
-    int       ss;
 
     wp = fndwig(f, id); /* index the widget */
     /* check this widget is tab bar */
     if (wp->typ != wttabbar) error("Widget is not a tab bar");
-    sp = wp->strlst; /* index top of string list */
-    ss = 1;
     /* find indicated tab */
-    while (ss != tn && sp) { sp = sp->next; ss++; }
-    if (!sp) error("No tab exists by logical number");
-    if (wp->ss != ss) { /* if select has changed */
+    if (!fndstr(wp, tn)) error("No tab exists by logical number");
+    if (wp->ss != tn) { /* if select has changed */
 
-        wp->ss = ss; /* set select */
+        wp->ss = tn; /* set select */
         /* refresh */
         widget_redraw(wp); /* send redraw to widget */
 
@@ -6778,6 +8016,8 @@ static int ivclose(
         /* close any widgets in file */
         for (i = 0; i < MAXWIG*2+1; i++)
             if (opnfil[fd]->widgets[i]) intkillwidget(fd, i-MAXWIG);
+        /* remove lightweight event routing */
+        if (opnfil[fd]->wid) xltlwt[opnfil[fd]->wid+MAXFIL] = NULL;
         free(opnfil[fd]); /* free the file record */
         opnfil[fd] = NULL; /* clear it */
 
@@ -6814,8 +8054,13 @@ static void init_widgets()
 
 {
 
-    int fn; /* file number */
-    int wid; /* window id */
+    int       fn;          /* file number */
+    int       wid;         /* window id */
+    pa_valptr config_root; /* root for config block */
+    pa_valptr graph_root;  /* root for graphics block */
+    pa_valptr wig_root;    /* root for widgets block */
+    pa_valptr vp;
+    char*     errstr;
 
     /* override the event handler */
     pa_eventsover(widget_event, &widget_event_old);
@@ -6829,6 +8074,30 @@ static void init_widgets()
     for (fn = 0; fn < MAXFIL*2+1; fn++)
         /* clear window logical number translator table */
         xltwig[fn] = NULL; /* set no widget entry */
+    for (fn = 0; fn < MAXFIL*2+1; fn++)
+        xltlwt[fn] = NULL; /* set no lightweight widgets */
+
+    /* find if lightweight widgets are enabled */
+    lwtenb = FALSE;
+    config_root = NULL;
+    pa_config(&config_root);
+    graph_root = pa_schlst("graphics", config_root);
+    if (graph_root) {
+
+        wig_root = pa_schlst("widgets", graph_root->sublist);
+        if (wig_root) {
+
+            vp = pa_schlst("lightweight", wig_root->sublist);
+            if (vp) {
+
+                lwtenb = strtol(vp->value, &errstr, 10);
+                if (*errstr) error("Invalid configuration value");
+
+            }
+
+        }
+
+    }
 
     /* open "window 0" dummy window */
     pa_openwin(&stdin, &win0, NULL, pa_getwinid()); /* open window */
@@ -82,6 +82,7 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <localdefs.h>
 #include <config.h>
 #include <terminal.h>
+#include <termenc.h>
 
 #include <diag.h>
 
@@ -405,6 +406,17 @@ typedef enum {
 
 } framecomp;
 
+/* run of characters on a root line with the same top window */
+typedef struct runrec {
+
+    int    x1, x2; /* extent of run */
+    winptr win;    /* top window over run, or NULL */
+
+} runrec;
+
+/* top window at root location */
+#define TOPMAP(x, y) (topmap[((y)-1)*dimx+((x)-1)])
+
 #ifdef USEUNICODE
 /*
  * Unicode characters MUST be fixed pitch and match the other fixed pitch
@@ -481,6 +493,12 @@ static pa_pevthan evtshan;        /* single master event handler routine */
 static paevtque*  paqfre;         /* free PA event queue entries list */
 static paevtque*  paqevt;         /* PA event input save queue */
 static int        dimx, dimy;     /* terminal/root dimensions */
+static pa_encrec  outenc;         /* root output buffer */
+static winptr*    topmap;         /* top window at each root location */
+static runrec*    runcur;         /* redraw run list for current line */
+static runrec*    runpnd;         /* redraw run list for pending lines */
+static pa_dmgrec  rootdmg;        /* root damage list */
+static winptr     dmgwin;         /* last window damaged */
 
 /* forwards */
 static void plcchr(FILE* f, char c);
@@ -1115,6 +1133,42 @@ static void dequepaevt(pa_evtrec* e)
 
 /*******************************************************************************
 
+Flush root output buffer
+
+Writes any characters in the root output buffer to the root window. Characters
+for the root are collected in the buffer and written in one call. Anything that
+sends other output to the root, such as cursor, color and attribute changes,
+must flush first to keep the order.
+
+*******************************************************************************/
+
+static void outflush(void)
+
+{
+
+    pa_encflush(&outenc); /* write it */
+
+}
+
+/*******************************************************************************
+
+Place character in root output buffer
+
+Places a character in the root output buffer, writing the buffer first if it is
+full.
+
+*******************************************************************************/
+
+static void outchr(char c)
+
+{
+
+    pa_encchr(&outenc, c); /* place character */
+
+}
+
+/*******************************************************************************
+
 Set cursor cached
 
 Sets the root cursor if it has changed.
@@ -1127,6 +1181,7 @@ static int setcursor(int x, int y)
 
     if (x != curx || y != cury) {
 
+        outflush(); /* write pending characters first */
         (*cursor_vect)(stdout, x, y); /* set new position */
         curx = x; /* set new location */
         cury = y;
@@ -1149,6 +1204,7 @@ static void setcurvis(int e)
 
     if (e != curon) {
 
+        outflush(); /* write pending characters first */
         (*curvis_vect)(stdout, e); /* set new visible state */
         curon = e; /* set cache */
 
@@ -1170,6 +1226,7 @@ static int setfcolor(pa_color c)
 
     if (c != fcolor) {
 
+        outflush(); /* write pending characters first */
         (*fcolor_vect)(stdout, c); /* set new color */
         fcolor = c; /* cache that */
 
@@ -1191,6 +1248,7 @@ static int setbcolor(pa_color c)
 
     if (c != bcolor) {
 
+        outflush(); /* write pending characters first */
         (*bcolor_vect)(stdout, c); /* set new color */
         bcolor = c; /* cache that */
 
@@ -1252,6 +1310,7 @@ static void setattrs(int at)
 
 {
 
+   if (at != attr) outflush(); /* write pending characters first */
    /* process "off" attributes */
    if ((BIT(sasuper) & at) != (BIT(sasuper) & attr)) /* has changed */
         if (!(BIT(sasuper) & at)) (*superscript_vect)(stdout, FALSE);
@@ -1305,7 +1364,7 @@ static void wrtchr(char c)
 
 {
 
-    (*ofpwrite)(OUTFIL, &c, 1);
+    outchr(c); /* place in output buffer */
     curx++;
 
 }
@@ -1342,7 +1401,7 @@ static void wrtext(char* s)
 
 {
 
-    while (*s) { (*ofpwrite)(OUTFIL, s, 1); s++; }
+    while (*s) { outchr(*s); s++; }
     curx++; /* advance cursor */
 
 }
@@ -1381,7 +1440,7 @@ static void wrtchrclp(char c, rectangle* cr)
 
     if (inrect(curx, cury, cr)) { /* not clipped */
 
-        (*ofpwrite)(OUTFIL, &c, 1);
+        outchr(c); /* place in output buffer */
         curx++;
 
     } else setcursor(curx+1, cury); /* just move the cursor */
@@ -1426,7 +1485,7 @@ static void wrtextclp(char* s, rectangle* cr)
 
     if (inrect(curx, cury, cr)) { /* not clipped */
 
-        while (*s) { (*ofpwrite)(OUTFIL, s, 1); s++; }
+        while (*s) { outchr(*s); s++; }
         curx++; /* advance cursor */
 
     } else setcursor(curx+1, cury); /* just move the cursor */
@@ -1517,6 +1576,131 @@ static void alcfmask(winptr win)
 
 /** ****************************************************************************
 
+Set run of forward mask bits
+
+Sets or clears a run of bits in the forward mask of a window. Whole bytes in the
+run are set at once, so the cost is by bytes and not by characters. The run is
+clipped to the mask.
+
+*******************************************************************************/
+
+static void fmaskrun(winptr win, /* window to set */
+                     int l,      /* first bit of run */
+                     int n,      /* number of bits in run */
+                     int v)      /* set (TRUE) or clear (FALSE) */
+
+{
+
+    int e; /* end of run */
+
+    e = l+n; /* find end */
+    if (l < 0) l = 0; /* clip to mask */
+    if (e > win->fmasklen*8) e = win->fmasklen*8;
+    /* do leading bits up to byte boundary */
+    while (l < e && l%8) {
+
+        if (v) win->fmask[l/8] |= 1<<(l%8);
+        else win->fmask[l/8] &= ~(1<<(l%8));
+        l++;
+
+    }
+    /* do whole bytes */
+    if (e-l >= 8) {
+
+        memset(&win->fmask[l/8], v ? 0xff : 0, (e-l)/8);
+        l += (e-l)/8*8;
+
+    }
+    /* do trailing bits */
+    while (l < e) {
+
+        if (v) win->fmask[l/8] |= 1<<(l%8);
+        else win->fmask[l/8] &= ~(1<<(l%8));
+        l++;
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Set rectangle in forward mask
+
+Sets or clears the bits in the forward mask of a window that lie under the
+given rectangle, in root terms. The rectangle is processed as one run per row.
+
+*******************************************************************************/
+
+static void fmaskrect(winptr win,    /* window to set */
+                      rectangle* r,  /* rectangle in root terms */
+                      int v)         /* set (TRUE) or clear (FALSE) */
+
+{
+
+    int y;
+    int cx, cy;
+
+    for (y = r->y1; y <= r->y2; y++) {
+
+        /* find net client offset */
+        cx = r->x1-(win->orgx+win->coffx);
+        cy = y-(win->orgy+win->coffy);
+        fmaskrun(win, cy*win->bufx+cx, r->x2-r->x1+1, v);
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Construct forward bitmask in area
+
+Sets the forward bitmask within the given area, in root terms, then draws 0's in
+it for each window in the Z-order that is in front of it. This forms a mask of
+where drawing on the window is valid. Parts of the mask outside the area are not
+changed. If the area does not intersect the client area, nothing is done.
+
+*******************************************************************************/
+
+static void calcfmaskclp(winptr win, rectangle* cr)
+
+{
+
+    winptr    wp;         /* window structure pointer */
+    rectangle r1, r2, r3; /* window rectangles */
+    rectangle rc;         /* client rectangle */
+
+    /* find the onscreen client rectangle in root terms */
+    setrect(&rc, win->orgx+win->coffx, win->orgy+win->coffy,
+                 win->orgx+win->coffx+win->cmaxx-1,
+                 win->orgy+win->coffy+win->cmaxy-1);
+    if (intersect(&rc, cr)) { /* area touches client */
+
+        intersection(&r1, &rc, cr); /* find the area to rebuild */
+        fmaskrect(win, &r1, TRUE); /* set the area */
+        wp = win->zmin2max; /* index windows in front by Z order */
+        while (wp) { /* tour the (possibly) lapping windows */
+
+            /* set window rectangle in root terms */
+            setrect(&r2, wp->orgx, wp->orgy,
+                        wp->orgx+wp->pmaxx-1, wp->orgy+wp->pmaxy-1);
+            if (intersect(&r1, &r2)) { /* if this window overlaps the area */
+
+                /* find the intersected rectangle */
+                intersection(&r3, &r1, &r2);
+                fmaskrect(win, &r3, FALSE); /* clear into mask */
+
+            }
+            wp = wp->zmin2max; /* next window entry */
+
+        }
+
+    }
+
+}
+
+/** ****************************************************************************
+
 Construct new forward bitmask
 
 Clears the forward bitmask, then draws 0's in it for each window in the Z-order
@@ -1529,43 +1713,18 @@ static void calcfmask(winptr win)
 
 {
 
-    winptr    wp;         /* window structure pointer */
-    rectangle r1, r2, r3; /* window rectangles */
+    rectangle r1; /* client rectangle */
+#ifdef PRTFMASK
     int       x, y;
-    int       cx, cy;
     int       l;
+#endif
 
     memset(win->fmask, 0xff, win->fmasklen); /* set the bitmap */
     /* find the onscreen client rectangle in root terms */
     setrect(&r1, win->orgx+win->coffx, win->orgy+win->coffy,
-                 win->orgx+win->coffx+win->cmaxx-1, 
+                 win->orgx+win->coffx+win->cmaxx-1,
                  win->orgy+win->coffy+win->cmaxy-1);
-    wp = win->zmin2max; /* index windows in front by Z order */
-    while (wp) { /* tour the (possibly) lapping windows */
-
-        /* set window rectangle in root terms */
-        setrect(&r2, wp->orgx, wp->orgy,
-                    wp->orgx+wp->pmaxx-1, wp->orgy+wp->pmaxy-1);
-        if (intersect(&r1, &r2)) { /* if this window overlaps our client area */
-
-            intersection(&r3, &r1, &r2); /* find the intersected rectangle */
-            /* draw into mask */
-            for (y = r3.y1; y <= r3.y2; y++)
-                for (x = r3.x1; x <= r3.x2; x++) {
-
-                /* find net client offset */
-                cx = x-(win->orgx+win->coffx);
-                cy = y-(win->orgy+win->coffy);
-                /* clear the cx/cy bit */
-                l = cy*win->bufx+cx; /* find character location */
-                win->fmask[l/8] &= ~(1<<(l%8)); /* mask off that bit */
-
-            }
-
-        }   
-        wp = wp->zmin2max; /* next window entry */
-
-    }
+    calcfmaskclp(win, &r1); /* construct over whole client */
 
     /* diagnostic: print forward mask */
 #ifdef PRTFMASK
@@ -1598,14 +1757,65 @@ static void calcfmask(winptr win)
 
 /** ****************************************************************************
 
+Update top window map in area
+
+The top window map gives the topmost window in Z order at each location on the
+root, or NULL if no window covers it. This answers hit tests in one lookup, and
+lets redraw find the visible part of each window without touring the Z order.
+
+The map is rebuilt within the given area, in root terms, by painting each
+window that intersects the area from the bottom to the top of the Z order. It
+is updated along with the forward masks, so it follows any change in window
+position, size or Z order.
+
+*******************************************************************************/
+
+static void updtopmap(rectangle* r)
+
+{
+
+    winptr    wp;         /* window structure pointer */
+    rectangle rc, r1, r2; /* rectangles */
+    int       x, y;
+
+    rc = *r; /* copy area */
+    /* clip to root */
+    if (rc.x1 < 1) rc.x1 = 1;
+    if (rc.x2 > dimx) rc.x2 = dimx;
+    if (rc.y1 < 1) rc.y1 = 1;
+    if (rc.y2 > dimy) rc.y2 = dimy;
+    /* clear the area */
+    for (y = rc.y1; y <= rc.y2; y++)
+        for (x = rc.x1; x <= rc.x2; x++) TOPMAP(x, y) = NULL;
+    wp = zmin2max; /* index windows from bottom of Z order */
+    while (wp) { /* paint each window over the last */
+
+        /* set window rectangle in root terms */
+        setrect(&r1, wp->orgx, wp->orgy,
+                     wp->orgx+wp->pmaxx-1, wp->orgy+wp->pmaxy-1);
+        if (intersect(&rc, &r1)) { /* window touches area */
+
+            intersection(&r2, &rc, &r1); /* find part in area */
+            for (y = r2.y1; y <= r2.y2; y++)
+                for (x = r2.x1; x <= r2.x2; x++) TOPMAP(x, y) = wp;
+
+        }
+        wp = wp->zmin2max; /* next window entry */
+
+    }
+
+}
+
+/** ****************************************************************************
+
 Recalculate all window forward masks
 
 Reconstructs the forward mask for all windows. Goes through the windows list and
 recalculates the forward mask. This is used anytime new windows or a change in
 window position, size or Z-order is done.
 
-This could be optimized by checking if the target window lies in the bounding
-box of the change.
+Changes to a window are handled by updfmask(), which only rebuilds in the area
+of the change.
 
 *******************************************************************************/
 
@@ -1614,6 +1824,7 @@ void recalcfmask(void)
 {
 
     winptr    win; /* pointer to windows list */
+    rectangle r;   /* root rectangle */
 
     win = winlst; /* get the master list */
     while (win) { /* traverse the windows list */
@@ -1622,6 +1833,64 @@ void recalcfmask(void)
         win = win->winlst; /* next window */
 
     }
+    setrect(&r, 1, 1, dimx, dimy); /* set whole root */
+    updtopmap(&r); /* rebuild the top window map */
+
+}
+
+/** ****************************************************************************
+
+Update forward masks in area
+
+Rebuilds the forward masks of all windows for the given area, in root terms.
+This is used after a window opens, moves, changes size or changes Z order, with
+the area covering the old and new positions of the window. The masks of windows
+whose client areas don't intersect the area are not touched, and in the others
+only the part in the area is rebuilt. The top window map is rebuilt in the same
+area.
+
+*******************************************************************************/
+
+static void updfmask(rectangle* r)
+
+{
+
+    winptr    win; /* pointer to windows list */
+
+    updtopmap(r); /* rebuild top window map */
+    win = winlst; /* get the master list */
+    while (win) { /* traverse the windows list */
+
+        calcfmaskclp(win, r); /* rebuild in area */
+        win = win->winlst; /* next window */
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Update forward masks for window change
+
+Finds the bounding box of the old and new window rectangles, and updates the
+forward masks of all windows in that box.
+
+*******************************************************************************/
+
+static void updfmaskwin(int x1, int y1, int x2, int y2, /* old rectangle */
+                        winptr win)                    /* window changed */
+
+{
+
+    rectangle r;
+
+    setrect(&r, win->orgx, win->orgy,
+                win->orgx+win->pmaxx-1, win->orgy+win->pmaxy-1);
+    if (x1 < r.x1) r.x1 = x1; /* find bounding box */
+    if (y1 < r.y1) r.y1 = y1;
+    if (x2 > r.x2) r.x2 = x2;
+    if (y2 > r.y2) r.y2 = y2;
+    updfmask(&r);
 
 }
 
@@ -1680,6 +1949,7 @@ static void drwfrm(winptr win, rectangle* cr)
 
     if (win->frame) { /* draw window frame */
 
+        outflush(); /* write pending characters first */
         (*fcolor_vect)(stdout, win->frmcolor);
         if (win->size) { /* draw size bars */
 
@@ -1790,6 +2060,7 @@ static void drwfrm(winptr win, rectangle* cr)
             else wrtextclp(frmchrs[intrgt], cr);
 
         }
+        outflush(); /* write frame before restoring color */
         (*fcolor_vect)(stdout, fcolor);
 
     }
@@ -1873,6 +2144,11 @@ Updates all the buffer and screen parameters from the display screen to the
 terminal into the selected rectangle. Note we assume there exists an
 intersection of the window with the clipping rectangle.
 
+Each line is scanned into runs of characters with the same colors and
+attributes. The colors and attributes are set once for each run, and the run is
+collected in the output buffer, so the output is in proportion to the content
+and not the number of characters.
+
 *******************************************************************************/
 
 static void restoreclp(winptr win,   /* window to restore */
@@ -1884,6 +2160,8 @@ static void restoreclp(winptr win,   /* window to restore */
     scnrec* sc;
     int x, y;
     rectangle r1, r2;
+    pa_color fc, bc; /* colors of run */
+    int at;          /* attributes of run */
 
     if (win->bufmod && win->visible)  { /* buffered mode is on, and visible */
 
@@ -1904,16 +2182,27 @@ static void restoreclp(winptr win,   /* window to restore */
 
                 /* Reset cursor at the start of each line. Note frame offsets. */
                 setcursor(r2.x1, y);
-                /* draw each line */
-                for (x = r2.x1; x <= r2.x2; x++) {
+                /* index line start in screen */
+                scp = &SCNBUF(sc, r2.x1-(win->orgx+win->coffx)+1,
+                                  y-(win->orgy+win->coffy)+1);
+                x = r2.x1;
+                while (x <= r2.x2) { /* draw each run in line */
+
+                    fc = scp->forec; /* set colors and attributes of run */
+                    bc = scp->backc;
+                    at = scp->attr;
+                    setfcolor(fc); /* set colors */
+                    setbcolor(bc);
+                    setattrs(at); /* set attributes */
+                    /* output characters while they match the run */
+                    while (x <= r2.x2 && scp->forec == fc && scp->backc == bc &&
+                           scp->attr == at) {
+
+                        wrtchr(scp->ch); /* output character */
+                        scp++; /* next location */
+                        x++;
 
-                    /* index screen character location */
-                    scp = &SCNBUF(sc, x-(win->orgx+win->coffx)+1,
-                                      y-(win->orgy+win->coffy)+1);
-                    setfcolor(scp->forec); /* set colors */
-                    setbcolor(scp->backc);
-                    setattrs(scp->attr); /* set attributes */
-                    wrtchr(scp->ch); /* output character */
+                    }
 
                 }
 
@@ -1921,6 +2210,7 @@ static void restoreclp(winptr win,   /* window to restore */
 
         }
         setcur(win); /* reenable cursor */
+        outflush(); /* write out restored screen */
 
     }
 
@@ -1952,67 +2242,166 @@ static void restore(winptr win) /* window to restore */
 
 Redraw screen
 
-Given an onscreen rectangle, redraws the "hole" in the screen by touring the
-current windows and redrawing parts of the screen from that.
+Given an onscreen rectangle, redraws the "hole" in the screen from the windows
+that are visible in it.
 
-There are two basic algorithms for redrawing a screen hole, the bottom up and
-top down methods. A bottom up draws each window found from the bottom of the Z
-order to the top. A top down method draws from the top of the Z order to the
-bottom. The difference is that the bottom up method will redundantly redraw
-parts of the window as uppermost Z order elements draw over lower ones. In the
-top down method, we must keep track of already drawn parts of the rectangle,
-which means keeping a list of increasingly fractured rectangles. It does not
-redundantly draw, and thus is more efficient and produces less onscreen
-"sparkle" due to overdraws. The current implementation uses top down.
+The top window map gives the window that shows at each location, so each
+location is drawn once from the window on top, without overdraws. Each line of
+the rectangle is divided into runs with the same top window. Lines with the
+same runs as the line above are gathered, and each run is then drawn as one
+rectangle down all of those lines. Since windows are rectangles, the runs
+change only at window edges, and the number of draws is in proportion to the
+windows showing in the hole, not the number of windows or characters.
 
-The "fractioning" keeps the list on the stack, and tracks the subtrectangles
-by recursion. First the intersection of the draw area and the list window is
-found and redrawn, then that is subtracted from the draw area, yeilding 1 to 4
-subrectangles, then each of these is recursively applied to the next window in
-the max 2 min list given.
+The top window map must be current before redraw is used.
 
 *******************************************************************************/
 
-static void redraw(winptr win, int x1, int y1, int x2, int y2)
+static void redraw(int x1, int y1, int x2, int y2)
 
 {
 
-    rectangle r1, r2, r3, rt, rl, rr, rb;
+    rectangle r, rd; /* update and draw rectangles */
+    runrec*   rp;    /* run list for current line */
+    int       rn;    /* number of runs in current line */
+    int       pn;    /* number of runs in pending lines */
+    int       py;    /* first of pending lines */
+    int       same;  /* current line runs match pending */
+    int       x, y, i;
 
-    if (win) { /* if window exists */
+    setrect(&r, x1, y1, x2, y2); /* set update rectangle */
+    cliproot(&r); /* clip to terminal root window */
+    pn = 0; /* set no lines pending */
+    py = r.y1;
+    for (y = r.y1; y <= r.y2+1; y++) { /* go lines, with one past end */
 
+        rn = 0; /* clear runs */
+        if (y <= r.y2) { /* find runs in line */
 
-        setrect(&r1, x1, y1, x2, y2); /* set update rectangle */
-        cliproot(&r1); /* clip to terminal root window */
-        /* set window rectangle */
-        setrect(&r2, win->orgx, win->orgy,
-                    win->orgx+win->pmaxx-1, win->orgy+win->pmaxy-1);
-        if (intersect(&r1, &r2)) { /* there is an intersection */
-
-            intersection(&r3, &r1, &r2); /* find the intersected rectangle */
-            /* restore that part of the window */
-            restoreclp(win, &r3);
-            if (win->zmax2min) { /* not last window in max 2 min list*/
-
-                /* find rectangle fractions */
-                subrect(&r1, &r3, &rt, &rl, &rr, &rb);
-                /* process down list for each fraction */
-                if (!zerorect(&rt))
-                    redraw(win->zmax2min, rt.x1, rt.y1, rt.x2, rt.y2);
-                if (!zerorect(&rl))
-                    redraw(win->zmax2min, rl.x1, rl.y1, rl.x2, rl.y2);
-                if (!zerorect(&rr))
-                    redraw(win->zmax2min, rr.x1, rr.y1, rr.x2, rr.y2);
-                if (!zerorect(&rb))
-                    redraw(win->zmax2min, rb.x1, rb.y1, rb.x2, rb.y2);
+            x = r.x1;
+            while (x <= r.x2) {
+
+                runcur[rn].x1 = x; /* set start and window of run */
+                runcur[rn].win = TOPMAP(x, y);
+                /* find end of run */
+                while (x <= r.x2 && TOPMAP(x, y) == runcur[rn].win) x++;
+                runcur[rn].x2 = x-1;
+                rn++;
 
             }
 
-        } else
-            /* no intersect this window, go next */
-            redraw(win->zmax2min, x1, y1, x2, y2);
+        }
+        /* compare to pending lines */
+        same = y <= r.y2 && rn == pn;
+        for (i = 0; i < rn && same; i++)
+            same = runcur[i].x1 == runpnd[i].x1 && runcur[i].x2 == runpnd[i].x2 &&
+                   runcur[i].win == runpnd[i].win;
+        if (!same) { /* runs changed, draw pending lines */
+
+            for (i = 0; i < pn; i++) if (runpnd[i].win) {
+
+                setrect(&rd, runpnd[i].x1, py, runpnd[i].x2, y-1);
+                restoreclp(runpnd[i].win, &rd);
+
+            }
+            /* current line becomes pending */
+            rp = runpnd;
+            runpnd = runcur;
+            runcur = rp;
+            pn = rn;
+            py = y;
+
+        }
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Add client damage
+
+Notes that the given area of a window's client, in client terms, has changed in
+the buffer and must be shown. The area is clipped to the onscreen client and
+added to the root damage list, which keeps the span of damage on each line of
+the root since the last composition.
+
+Drawing to the terminal is deferred to compose(), so the characters of a write
+are shown by one pass over the root, and overlapping output from other calls
+made before it is not drawn more than once.
+
+*******************************************************************************/
+
+static void clidmg(winptr win,   /* window damaged */
+                   int x1, int y1, /* area in client terms */
+                   int x2, int y2)
+
+{
+
+    rectangle r1, r2, rc;
+
+    /* find area in root terms */
+    setrect(&r1, x1+win->orgx-1+win->coffx, y1+win->orgy-1+win->coffy,
+                 x2+win->orgx-1+win->coffx, y2+win->orgy-1+win->coffy);
+    /* find the onscreen client rectangle in root terms */
+    setrect(&rc, win->orgx+win->coffx, win->orgy+win->coffy,
+                 win->orgx+win->coffx+win->cmaxx-1,
+                 win->orgy+win->coffy+win->cmaxy-1);
+    if (intersect(&r1, &rc)) { /* damage is onscreen */
+
+        intersection(&r2, &r1, &rc); /* clip to client */
+        pa_dmgadd(&rootdmg, r2.x1, r2.y1, r2.x2, r2.y2); /* add to damage */
+        dmgwin = win; /* set last window damaged */
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Compose root
+
+Shows any pending damage on the terminal. The damaged span of each line is
+redrawn from the window buffers using the top window map, so each location is
+drawn once from the window that is visible there. Lines with the same span are
+redrawn together. The cursor is then returned to the window with focus, or the
+last window damaged. Finally, all output is written.
+
+This is done at the end of each write to a window and each direct string write,
+before waiting for the next event, and on shutdown. Each write is seen when it
+completes, even if the program goes on to compute without waiting for events,
+while the characters within one write are still drawn in one pass.
+
+*******************************************************************************/
+
+static void compose(void)
+
+{
+
+    int y, ly; /* line and last line with same span */
+    int x1, x2; /* span */
+
+    if (pa_dmgact(&rootdmg)) { /* damage is pending */
+
+        y = rootdmg.y1;
+        while (y <= rootdmg.y2) { /* go damaged lines */
+
+            x1 = rootdmg.x1[y-1]; /* get span */
+            x2 = rootdmg.x2[y-1];
+            ly = y; /* find following lines with the same span */
+            while (ly < rootdmg.y2 && rootdmg.x1[ly] == x1 &&
+                   rootdmg.x2[ly] == x2) ly++;
+            if (x1 <= x2) redraw(x1, y, x2, ly); /* redraw if not empty */
+            y = ly+1; /* next line */
+
+        }
+        pa_dmgclr(&rootdmg); /* set no damage pending */
+        /* return cursor to active window */
+        if (curfocus) setcur(curfocus);
+        else if (dmgwin) setcur(dmgwin);
 
     }
+    outflush(); /* write out terminal output */
 
 }
 
@@ -2037,7 +2426,8 @@ static void clrscn(FILE* f)
     win->curx = 1; /* set cursor at home */
     win->cury = 1;
     iniscn(win, sc); /* clear screen buffer */
-    if (indisp(win)) restore(win); /* also process to display */
+    /* also process to display */
+    if (indisp(win)) clidmg(win, 1, 1, win->maxx, win->maxy);
 
 }
 
@@ -2198,7 +2588,8 @@ static void remhover(int x, int y)
 Find Z order top window from point
 
 Given an X-Y point in the root surface, finds the topmost window containing that
-point. If there is no containing window, NULL is returned.
+point. If there is no containing window, NULL is returned. This is a lookup in
+the top window map.
 
 *******************************************************************************/
 
@@ -2206,27 +2597,11 @@ static winptr fndtop(int x, int y)
 
 {
 
-    winptr win; /* pointer to windows list */
     winptr fp;  /* found window pointer */
-    int    z;   /* z order of last found */
 
-    win = winlst; /* get the master list */
     fp = NULL; /* set no window found */
-    z = -1; /* set invalid z order */
-    while (win) { /* traverse the windows list */
-
-        if (win->orgx <= x && x <= win->orgx+win->pmaxx-1 &&
-            win->orgy <= y && y <= win->orgy+win->pmaxy-1 &&
-            win->zorder > z) {
-
-            /* found inclusion, Z order above previous */
-            fp = win; /* set candidate */
-            z = win->zorder;
-
-        }
-        win = win->winlst; /* next window */
-
-    }
+    /* if on root, look up top window */
+    if (1 <= x && x <= dimx && 1 <= y && y <= dimy) fp = TOPMAP(x, y);
 
     return (fp); /* exit wth container */
 
@@ -2417,39 +2792,6 @@ static void remmin2max(winptr win)
 
 /*******************************************************************************
 
-Remove window from max 2 min list
-
-Removes the given window from the max 2 min list.
-
-*******************************************************************************/
-
-static void remmax2min(winptr win)
-
-{
-
-    winptr wp, lp;
-
-    /* remove from min to maxlist */
-    if (zmax2min == win) /* is first entry */
-        zmax2min = zmax2min->zmax2min; /* gap top list */
-    else { /* find in list */
-
-        wp = zmax2min; /* index top of list */
-        while (wp != win) { /* traverse */
-
-            lp = wp; /* set last */
-            wp = wp->zmax2min; /* go next */
-            if (!wp) error("System fault");
-
-        }
-        lp->zmax2min = win->zmax2min; /* gap out of list */
-
-    }
-
-}
-
-/*******************************************************************************
-
 Bring window to front of the Z order
 
 Brings the indicated window to the front of the Z order.
@@ -2481,6 +2823,9 @@ static void intfront(winptr win)
     else zmin2max = win; /* list is empty, set first */
     win->zorder = ztop; /* set our entry as top Z order */
     makzmax2min(); /* remake the max 2 min list */
+    /* update the forward masks under the window */
+    updfmaskwin(win->orgx, win->orgy,
+                win->orgx+win->pmaxx-1, win->orgy+win->pmaxy-1, win);
 
 }
 
@@ -2515,6 +2860,9 @@ static void intback(winptr win)
     zmin2max->zmin2max = win;
     win->zorder = ztop; /* set our entry as bottom Z order */
     makzmax2min(); /* remake the max 2 min list */
+    /* update the forward masks under the window */
+    updfmaskwin(win->orgx, win->orgy,
+                win->orgx+win->pmaxx-1, win->orgy+win->pmaxy-1, win);
 
 }
 
@@ -2670,7 +3018,9 @@ static void opnwin(int fn, int pfn, int wid, int subclient, int root)
 
     iniscn(win, win->screens[0]); /* initalize screen buffer */
     restore(win); /* update to screen */
-    recalcfmask(); /* recalculate the forward masks */
+    /* update the forward masks under the new window */
+    updfmaskwin(win->orgx, win->orgy,
+                win->orgx+win->pmaxx-1, win->orgy+win->pmaxy-1, win);
 
 }
 
@@ -2905,9 +3255,10 @@ all content off the screen, the screen is simply blanked. Otherwise, we find the
 section of the screen that would remain after the scroll, determine its source
 and destination rectangles, and use a move.
 
-In buffered mode, this routine works by scrolling the buffer, then restoring
-it to the current window. In non-buffered mode, the scroll is applied directly
-to the window.
+In buffered mode, this routine works by scrolling the buffer, then marking the
+window client as damaged, so that a series of scrolls is shown by one
+composition. In non-buffered mode, the scroll is applied directly to the
+window.
 
 *******************************************************************************/
 
@@ -2916,12 +3267,8 @@ static void intscroll(winptr win, int x, int y)
 {
 
     int      xi, yi;       /* screen counters */
-    scnptr   scnsav;       /* full screen buffer save */
-    int      lx;           /* last unmatching character index */
-    int      m;            /* match flag */
     scnptr   sc;           /* pointer to current screen */
     scnptr   sp;           /* pointer to screen record */
-    int      curxs, curys; /* cursor position save */
 
     /* when the scroll is arbitrary, we do it by completely refreshing the
        contents of the screen from the buffer */
@@ -2935,20 +3282,10 @@ static void intscroll(winptr win, int x, int y)
     } else { /* scroll */
 
         /* true scroll is done in two steps. first, the contents of the buffer
-           are adjusted to read as after the scroll. then, the contents of the
-           buffer are output to the terminal. before the buffer is changed,
-           we perform a full save of it, which then represents the "current"
-           state of the real terminal. then, the new buffer contents are
-           compared to that while being output. this saves work when most of
-           the screen is spaces anyways */
+           are adjusted to read as after the scroll. then, the client is marked
+           as damaged, and the new buffer contents are output to the terminal
+           at the next composition */
         sc = win->screens[win->curupd-1]; /* index current screen */
-        if (indisp(win)) { /* in display */
-
-            /* save the entire buffer */
-            scnsav = malloc(sizeof(scnrec)*win->maxy*win->maxx);
-            memcpy(scnsav, sc, sizeof(scnrec)*win->maxy*win->maxx);
-
-        }
         if (y > 0) {  /* move text up */
 
             for (yi = 1; yi < win->maxy; yi++) /* move any lines up */
@@ -3033,59 +3370,8 @@ static void intscroll(winptr win, int x, int y)
             }
 
         }
-        if (indisp(win)) { /* in display */
-
-            curxs = curx; /* save cursor position */
-            curys = cury;
-            /* the buffer is adjusted. now just copy the complete buffer to the
-               screen */
-            for (yi = 1; yi <= win->maxy; yi++) { /* lines */
-
-                win->curx = 1; /* set cursor */
-                win->cury = yi;
-                setcur(win);
-                /* find the last unmatching character between real and new buffers.
-                   Then, we only need output the leftmost non-matching characters
-                   on the line. note that it does not really help us that characters
-                   WITHIN the line match, because a character output is as or more
-                   efficient as a cursor movement. if, however, you want to get
-                   SERIOUSLY complex, we could check runs of matching characters,
-                   then check if performing a direct cursor position is less output
-                   characters than just outputting data :) */
-                lx = win->maxx; /* set to end */
-                do { /* check matches */
-
-                    m = 1; /* set match */
-                    /* check all elements match */
-                    if (SCNBUF(sc, lx, yi).ch != SCNBUF(scnsav, lx, yi).ch)
-                        m = 0;
-                    if (SCNBUF(sc, lx, yi).forec !=
-                        SCNBUF(scnsav, lx, yi).forec) m = 0;
-                    if (SCNBUF(sc, lx, yi).backc !=
-                        SCNBUF(scnsav, lx, yi).backc) m = 0;
-                    if (SCNBUF(sc, lx, yi).attr != SCNBUF(scnsav, lx, yi).attr)
-                        m = 0;
-                    if (m) lx--; /* next character */
-
-                } while (m && lx); /* until match or no more */
-                for (xi = 1; xi <= lx; xi++) { /* characters */
-
-                    /* for each new character, we compare the attributes and colors
-                       with what is set. if a new color or attribute is called for,
-                       we set that, and update the saves. this technique cuts down on
-                       the amount of output characters */
-                    sp = &SCNBUF(sc, xi, yi);
-                    setfcolor(sp->forec); /* set the foreground color */
-                    setbcolor(sp->backc); /* set the background color */
-                    setattrs(sp->attr); /* set the attribute */
-                    wrtchr(sp->ch);
-
-                }
-
-            }
-            (*cursor_vect)(stdout, curxs, curys); /* restore cursor position */
-
-        }
+        /* the buffer is adjusted. now mark the client for display */
+        if (indisp(win)) clidmg(win, 1, 1, win->maxx, win->maxy);
 
     }
 
@@ -3131,6 +3417,8 @@ static void intsetsiz(winptr win, int x, int y)
         win->maxy -= win->frame*2+win->size*2;
 
     }
+    /* update the forward masks under the old and new sizes */
+    updfmaskwin(win->orgx, win->orgy, win->orgx+ox-1, win->orgy+oy-1, win);
     if (win->visible) { /* window is onscreen */
 
         /* check old and new overlap */
@@ -3141,36 +3429,19 @@ static void intsetsiz(winptr win, int x, int y)
 
             /* find rectangle fractions */
             subrect(&r1, &r2, &rt, &rl, &rr, &rb);
-            /* process down list for each fraction */
-            if (!zerorect(&rt))
-                redraw(win->zmax2min, rt.x1, rt.y1, rt.x2, rt.y2);
-            if (!zerorect(&rl))
-                redraw(win->zmax2min, rl.x1, rl.y1, rl.x2, rl.y2);
-            if (!zerorect(&rr))
-                redraw(win->zmax2min, rr.x1, rr.y1, rr.x2, rr.y2);
-            if (!zerorect(&rb))
-                redraw(win->zmax2min, rb.x1, rb.y1, rb.x2, rb.y2);
-            /* note we kept the Z order of the repositioned window */
-            makzmax2min(); /* remake the max 2 min list */
-            /* draw the new window position in */
-            redraw(zmax2min, win->orgx, win->orgy,
-                             win->orgx+win->pmaxx-1, win->orgy+win->pmaxy-1);
+            /* redraw each fraction uncovered */
+            if (!zerorect(&rt)) redraw(rt.x1, rt.y1, rt.x2, rt.y2);
+            if (!zerorect(&rl)) redraw(rl.x1, rl.y1, rl.x2, rl.y2);
+            if (!zerorect(&rr)) redraw(rr.x1, rr.y1, rr.x2, rr.y2);
+            if (!zerorect(&rb)) redraw(rb.x1, rb.y1, rb.x2, rb.y2);
 
-        } else {
-
-            remmax2min(win); /* take out of max 2 min list */
-            /* draw the current window position out */
-            redraw(zmax2min, win->orgx, win->orgy, win->orgx+ox-1, win->orgy+oy-1);
-            /* note we kept the Z order of the repositioned window */
-            makzmax2min(); /* remake the max 2 min list */
-            /* draw the new window size in */
-            redraw(zmax2min, win->orgx, win->orgy,
-                             win->orgx+win->pmaxx-1, win->orgy+win->pmaxy-1);
-
-        }
+        } else
+            /* draw the current window size out */
+            redraw(r1.x1, r1.y1, r1.x2, r1.y2);
+        /* draw the new window size in */
+        redraw(r2.x1, r2.y1, r2.x2, r2.y2);
 
     }
-    recalcfmask(); /* recalculate the forward masks */
 
 }
 
@@ -3194,6 +3465,8 @@ static void intsetpos(winptr win, int x, int y)
     oy = win->orgy;
     win->orgx = x; /* set position in parent */
     win->orgy = y;
+    /* update the forward masks under the old and new positions */
+    updfmaskwin(ox, oy, ox+win->pmaxx-1, oy+win->pmaxy-1, win);
     if (win->visible) { /* window is onscreen */
 
         /* check old and new overlap */
@@ -3204,36 +3477,19 @@ static void intsetpos(winptr win, int x, int y)
 
             /* find rectangle fractions */
             subrect(&r1, &r2, &rt, &rl, &rr, &rb);
-            /* process down list for each fraction */
-            if (!zerorect(&rt))
-                redraw(win->zmax2min, rt.x1, rt.y1, rt.x2, rt.y2);
-            if (!zerorect(&rl))
-                redraw(win->zmax2min, rl.x1, rl.y1, rl.x2, rl.y2);
-            if (!zerorect(&rr))
-                redraw(win->zmax2min, rr.x1, rr.y1, rr.x2, rr.y2);
-            if (!zerorect(&rb))
-                redraw(win->zmax2min, rb.x1, rb.y1, rb.x2, rb.y2);
-            /* note we kept the Z order of the repositioned window */
-            makzmax2min(); /* remake the max 2 min list */
-            /* draw the new window position in */
-            redraw(zmax2min, win->orgx, win->orgy,
-                             win->orgx+win->pmaxx-1, win->orgy+win->pmaxy-1);
+            /* redraw each fraction uncovered */
+            if (!zerorect(&rt)) redraw(rt.x1, rt.y1, rt.x2, rt.y2);
+            if (!zerorect(&rl)) redraw(rl.x1, rl.y1, rl.x2, rl.y2);
+            if (!zerorect(&rr)) redraw(rr.x1, rr.y1, rr.x2, rr.y2);
+            if (!zerorect(&rb)) redraw(rb.x1, rb.y1, rb.x2, rb.y2);
 
-        } else {
-
-            remmax2min(win); /* take out of max 2 min list */
-            /* draw the current window position out */
-            redraw(zmax2min, ox, oy, ox+win->pmaxx-1, oy+win->pmaxy-1);
-            /* note we kept the Z order of the repositioned window */
-            makzmax2min(); /* remake the max 2 min list */
-            /* draw the new window position in */
-            redraw(zmax2min, win->orgx, win->orgy,
-                             win->orgx+win->pmaxx-1, win->orgy+win->pmaxy-1);
-
-        }
+        } else
+            /* draw the old window position out */
+            redraw(r1.x1, r1.y1, r1.x2, r1.y2);
+        /* draw the new window position in */
+        redraw(r2.x1, r2.y1, r2.x2, r2.y2);
 
     }
-    recalcfmask(); /* recalculate the forward masks */
 
 }
 
@@ -3985,6 +4241,7 @@ static void intevent(FILE* f)
     int       x, y;
 
     win = NULL; /* set no window active */
+    compose(); /* show pending output before waiting */
     (*event_vect)(stdin, &ev); /* get root event */
 #ifdef PRTROOTEVT
         fprintf(stderr, "Inbound: "); prtevt(&ev); fprintf(stderr, "\n"); fflush(stderr);
@@ -4157,7 +4414,7 @@ static void intevent(FILE* f)
 
                         intfront(win); /* bring to front */
                         /* redraw for order */
-                        redraw(win, win->orgx, win->orgy,
+                        redraw(win->orgx, win->orgy,
                                     win->orgx+win->pmaxx-1,
                                     win->orgy+win->pmaxy-1);
 
@@ -4365,6 +4622,8 @@ static void ievent(FILE* f, pa_evtrec* er)
 
 {
 
+    /* show pending output, an event may already be waiting in the queue */
+    compose();
     do { /* loop handling via event vectors and queuing */
 
         /* check input PA queue */
@@ -5043,6 +5302,7 @@ static void iwrtstrn(FILE* f, char* s, int n)
     scnptr scp; /* screen buffer */
     char*  ss;
     int    ns;
+    int    x;   /* start of string */
 
     win = txt2win(f); /* get window from file */
     if (win->autof) error("Cannot direct write string with auto on");
@@ -5051,6 +5311,7 @@ static void iwrtstrn(FILE* f, char* s, int n)
 
         ss = s; /* save string */
         ns = n;
+        x = win->curx; /* save start of string */
         while (ns && icurbnd(f)) { /* print string */
 
             /* index screen character location */
@@ -5065,9 +5326,11 @@ static void iwrtstrn(FILE* f, char* s, int n)
             ns--; /* count */
 
         }
+        /* mark string for display */
+        if (indisp(win)) clidmg(win, x, win->cury, win->curx-1, win->cury);
+        compose(); /* show the string */
 
-    }
-    if (indisp(win)) { /* do it again for the current screen */
+    } else if (indisp(win)) { /* write directly to the current screen */
 
         /* set root cursor to correct position */
         setcursor(win->curx+win->orgx-1+win->coffx,
@@ -5083,6 +5346,7 @@ static void iwrtstrn(FILE* f, char* s, int n)
             n--; /* count */
 
         }
+        outflush(); /* write out string */
 
     }
 
@@ -5139,7 +5403,7 @@ static void ititlen(FILE* f, char* ts, int n)
     strncpy(win->title, ts, n);
     win->title[n] = 0; /* terminate */
     /* if its the root window, copy down to underlying window */
-    if (win->root) (*titlen_vect)(stdout, ts, n);
+    if (win->root) { outflush(); (*titlen_vect)(stdout, ts, n); }
     else if (win->frame && win->sysbar && win->pmaxy >= 3) {
 
         /* we own the window, the frame and system bar is on, and it is 
@@ -5264,7 +5528,7 @@ static void isizbuf(FILE* f, int x, int y)
         alcfmask(win); /* allocate and clear forward mask */
 
     }
-    recalcfmask(); /* recalculate the forward masks */
+    calcfmask(win); /* recalculate the forward mask, others don't change */
 
 }
 
@@ -5710,13 +5974,20 @@ static void plcchr(FILE* f, char c)
             }
             if (indisp(win)) { /* do it again for the current screen */
 
-                setattrs(win->attr); /* set attributes */
-                setfcolor(win->fcolor); /* set colors */
-                setbcolor(win->bcolor);
-                /* draw character to active screen */
-                setcursor(win->curx+win->orgx-1+win->coffx,
-                          win->cury+win->orgy-1+win->coffy);
-                wrtchr(c); /* output */
+                /* in buffered mode, mark for display */
+                if (win->bufmod)
+                    clidmg(win, win->curx, win->cury, win->curx, win->cury);
+                else { /* draw directly */
+
+                    setattrs(win->attr); /* set attributes */
+                    setfcolor(win->fcolor); /* set colors */
+                    setbcolor(win->bcolor);
+                    /* draw character to active screen */
+                    setcursor(win->curx+win->orgx-1+win->coffx,
+                              win->cury+win->orgy-1+win->coffy);
+                    wrtchr(c); /* output */
+
+                }
 
             }
 
@@ -5862,9 +6133,15 @@ static ssize_t ivwrite(pwrite_t writedc, int fd, const void* buff, size_t count)
         win = opnfil[fd]->win; /* index window */
         /* send data to terminal */
         while (cnt--) plcchr(opnfil[fd]->sfp, *p++);
+        compose(); /* show the write */
         rc = count; /* set return same as count */
 
-    } else rc = (*writedc)(fd, buff, count);
+    } else {
+
+        outflush(); /* keep order with collected output */
+        rc = (*writedc)(fd, buff, count);
+
+    }
 
     return rc;
 
@@ -6042,6 +6319,8 @@ static void init_managerc()
     /* override system calls for basic I/O */
     ovr_read(iread, &ofpread);
     ovr_write(iwrite, &ofpwrite);
+    /* root output goes through the encoder to the next write in the chain */
+    pa_encini(&outenc, ofpwrite, OUTFIL);
     ovr_open(iopen, &ofpopen);
     ovr_close(iclose, &ofpclose);
     ovr_lseek(ilseek, &ofplseek);
@@ -6128,6 +6407,16 @@ static void init_managerc()
     dimx = (*maxx_vect)(stdout);
     dimy = (*maxy_vect)(stdout);
 
+    /* allocate top window map and redraw run lists */
+    topmap = malloc(sizeof(winptr)*dimx*dimy);
+    if (!topmap) error("Out of memory");
+    memset(topmap, 0, sizeof(winptr)*dimx*dimy);
+    runcur = malloc(sizeof(runrec)*dimx);
+    runpnd = malloc(sizeof(runrec)*dimx);
+    if (!runcur || !runpnd) error("Out of memory");
+    /* allocate root damage list */
+    if (!pa_dmgini(&rootdmg, dimy)) error("Out of memory");
+
     /* reset all attributes */
     (*superscript_vect)(stdout, FALSE);
     (*subscript_vect)(stdout, FALSE);
@@ -6264,6 +6553,8 @@ static void deinit_managerc()
     _pa_getwinid_t cppgetwinid;
     _pa_focus_t cppfocus;
 
+    compose(); /* show any pending output */
+
     /* If autohold is active and and a local end was ordered, disable autohold
        in the root. Note the root also could have ordered an exit. */
     if (fautohold && fend) (*autohold_vect)(FALSE);
@@ -0,0 +1,2442 @@
+/** ****************************************************************************
+
+\file
+
+\brief OFFSCREEN GRAPHICS MODULE
+
+Copyright (C) 2023 Scott A. Franco
+
+This is a graphics module for Petit-Ami that needs no display server. It
+implements the text and graphical levels of graphics.h by rendering into
+in-memory 32 bit surfaces, one per screen buffer, with a small built-in software
+rasterizer. The primary use is running graphical programs in CI, benchmarks and
+other headless settings, where the output can be checked against a saved image
+and the timing is not polluted by a display server.
+
+It is portable, meaning that it only relies on the C library, and the stdio
+override calls (ovr_write) that the rest of Petit-Ami uses to capture standard
+output.
+
+The offscreen module differs from a display based module in a few ways:
+
+1. There is a single window, the stdin/stdout window. It is the size of the
+screen buffer. Opening further windows is an error.
+
+2. There is no input. Events are generated against a virtual clock. Timers and
+the frame timer advance that clock instead of sleeping, so a program that runs
+on timers runs as fast as it can draw, and runs the same each time. When there
+are no timers left active, or the event limit is reached, a terminate event is
+returned.
+
+3. There is a single fixed pitch font, built in, with an 8x12 character cell.
+All of the standard font codes select it, and font sizing is ignored.
+
+4. Widgets, menus and dialogs are not rendered. They are present only so that
+programs link, and they halt with an error if used.
+
+The following environment variables control the module:
+
+PA_OFFSCREEN_OUT    - If set, the display surface is written to this file as a
+                      24 bit .bmp image when the program exits.
+
+PA_OFFSCREEN_EVENTS - The number of events delivered before a terminate event
+                      is forced. The default is EVTLIM.
+
+                          BSD LICENSE INFORMATION
+
+Copyright (C) 2019 - Scott A. Franco
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+3. Neither the name of the project nor the names of its contributors may be used
+   to endorse or promote products derived from this software without specific
+   prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE PROJECT AND CONTRIBUTORS ``AS IS'' AND ANY
+EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.  IN NO EVENT SHALL THE PROJECT OR CONTRIBUTORS BE LIABLE FOR ANY
+DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+*******************************************************************************/
+
+/* whitebook definitions */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+/* linux definitions */
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+/* local definitions */
+#include <localdefs.h>
+#include <graphics.h>
+
+/*
+ * Configurable parameters
+ *
+ * Can be overridden from the compile line.
+ */
+#ifndef MAXXD
+#define MAXXD  80   /* default buffer width in characters */
+#endif
+#ifndef MAXYD
+#define MAXYD  25   /* default buffer height in characters */
+#endif
+#ifndef EVTLIM
+#define EVTLIM 10000 /* default limit of events before forced terminate */
+#endif
+
+#define MAXCON 10   /* number of screen buffers */
+#define MAXPIC 50   /* number of loadable pictures */
+#define MAXTAB 50   /* number of tab stops */
+#define MAXSEV 100  /* number of queued sent events */
+#define CHRX   8    /* width of character cell */
+#define CHRY   12   /* height of character cell */
+#define CHRTOP 2    /* offset of glyph from top of character cell */
+#define CHRUL  10   /* offset of underline from top of character cell */
+#define CHRSO  6    /* offset of strikeout from top of character cell */
+#define DPM    3780 /* dots per meter, 96 dpi */
+#define FRMTIM 166  /* frame timer period, 100us units (60 per second) */
+#define OUTFIL 1    /* file handle of the output window */
+
+/* types of system vectors for override calls */
+typedef ssize_t (*pwrite_t)(int, const void*, size_t);
+
+/* system override calls */
+extern void ovr_write(pwrite_t nfp, pwrite_t* ofp);
+
+/* screen text attributes */
+typedef enum {
+
+    sablink,    /* blinking text (foreground) */
+    sarev,      /* reverse video */
+    saundl,     /* underline */
+    sasuper,    /* superscript */
+    sasubs,     /* subscripting */
+    saital,     /* italic text */
+    sabold,     /* bold text */
+    sastkout    /* strikeout text */
+
+} scnatt;
+
+/* foreground/background mix modes */
+typedef enum { mdnorm, mdinvis, mdxor, mdand, mdor } mode;
+
+/* screen context, one per screen buffer */
+typedef struct scncon {
+
+    unsigned* buf;    /* pixel surface, 0x00RRGGBB, top down */
+    int       curxg;  /* graphical cursor x, 1 based pixels */
+    int       curyg;  /* graphical cursor y */
+    unsigned  fcrgb;  /* current foreground color */
+    unsigned  bcrgb;  /* current background color */
+    mode      fmod;   /* foreground mix mode */
+    mode      bmod;   /* background mix mode */
+    int       attr;   /* set of active text attributes */
+    int       autof;  /* state of auto wrap and scroll */
+    int       curv;   /* cursor visible (recorded only) */
+    int       lwidth; /* width of lines */
+    int       tab[MAXTAB]; /* tab stops in pixels, ascending, 0 ends list */
+
+} scncon, *scnptr;
+
+/* saved drawing state */
+typedef struct dstrec {
+
+    struct dstrec* next; /* next (older) entry */
+    scncon         sc;   /* copy of screen context, buffer not used */
+    int            scn;  /* update screen the state was saved from */
+
+} dstrec, *dstptr;
+
+/* loaded picture */
+typedef struct {
+
+    unsigned* buf; /* pixels, 0x00RRGGBB, top down */
+    int       x;   /* width in pixels */
+    int       y;   /* height in pixels */
+
+} pict;
+
+/* timer entry */
+typedef struct {
+
+    int       act; /* timer is active */
+    int       rep; /* timer repeats */
+    long      per; /* period in 100us units */
+    long long due; /* virtual time of next expiry */
+
+} timrec;
+
+/* arc or chord clipping for shape fills */
+typedef struct {
+
+    double cx, cy;  /* center of ellipse */
+    double rx, ry;  /* radii of ellipse */
+    double sa;      /* start angle, radians clockwise from top */
+    double span;    /* sweep from start angle, radians */
+    int    chord;   /* clip to chord instead of sector */
+    double x1, y1;  /* chord start point */
+    double x2, y2;  /* chord end point */
+    double side;    /* sign of side of chord that is kept */
+
+} arcflt;
+
+/*
+ * 8x8 glyphs for ASCII 0x20 to 0x7e. Each byte is a row, top down, and the
+ * least significant bit is the leftmost pixel. Row 7 is the descender.
+ */
+static const unsigned char font8x8[95][8] = {
+
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, /*   */
+    { 0x18, 0x3c, 0x3c, 0x18, 0x18, 0x00, 0x18, 0x00 }, /* ! */
+    { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, /* " */
+    { 0x36, 0x36, 0x7f, 0x36, 0x7f, 0x36, 0x36, 0x00 }, /* # */
+    { 0x0c, 0x3e, 0x03, 0x1e, 0x30, 0x1f, 0x0c, 0x00 }, /* $ */
+    { 0x00, 0x63, 0x33, 0x18, 0x0c, 0x66, 0x63, 0x00 }, /* % */
+    { 0x1c, 0x36, 0x1c, 0x6e, 0x3b, 0x33, 0x6e, 0x00 }, /* & */
+    { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 }, /* ' */
+    { 0x18, 0x0c, 0x06, 0x06, 0x06, 0x0c, 0x18, 0x00 }, /* ( */
+    { 0x06, 0x0c, 0x18, 0x18, 0x18, 0x0c, 0x06, 0x00 }, /* ) */
+    { 0x00, 0x66, 0x3c, 0xff, 0x3c, 0x66, 0x00, 0x00 }, /* * */
+    { 0x00, 0x0c, 0x0c, 0x3f, 0x0c, 0x0c, 0x00, 0x00 }, /* + */
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c, 0x06 }, /* , */
+    { 0x00, 0x00, 0x00, 0x3f, 0x00, 0x00, 0x00, 0x00 }, /* - */
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0c, 0x0c, 0x00 }, /* . */
+    { 0x60, 0x30, 0x18, 0x0c, 0x06, 0x03, 0x01, 0x00 }, /* / */
+    { 0x3e, 0x63, 0x73, 0x7b, 0x6f, 0x67, 0x3e, 0x00 }, /* 0 */
+    { 0x0c, 0x0e, 0x0c, 0x0c, 0x0c, 0x0c, 0x3f, 0x00 }, /* 1 */
+    { 0x1e, 0x33, 0x30, 0x1c, 0x06, 0x33, 0x3f, 0x00 }, /* 2 */
+    { 0x1e, 0x33, 0x30, 0x1c, 0x30, 0x33, 0x1e, 0x00 }, /* 3 */
+    { 0x38, 0x3c, 0x36, 0x33, 0x7f, 0x30, 0x78, 0x00 }, /* 4 */
+    { 0x3f, 0x03, 0x1f, 0x30, 0x30, 0x33, 0x1e, 0x00 }, /* 5 */
+    { 0x1c, 0x06, 0x03, 0x1f, 0x33, 0x33, 0x1e, 0x00 }, /* 6 */
+    { 0x3f, 0x33, 0x30, 0x18, 0x0c, 0x0c, 0x0c, 0x00 }, /* 7 */
+    { 0x1e, 0x33, 0x33, 0x1e, 0x33, 0x33, 0x1e, 0x00 }, /* 8 */
+    { 0x1e, 0x33, 0x33, 0x3e, 0x30, 0x18, 0x0e, 0x00 }, /* 9 */
+    { 0x00, 0x0c, 0x0c, 0x00, 0x00, 0x0c, 0x0c, 0x00 }, /* : */
+    { 0x00, 0x0c, 0x0c, 0x00, 0x00, 0x0c, 0x0c, 0x06 }, /* ; */
+    { 0x18, 0x0c, 0x06, 0x03, 0x06, 0x0c, 0x18, 0x00 }, /* < */
+    { 0x00, 0x00, 0x3f, 0x00, 0x00, 0x3f, 0x00, 0x00 }, /* = */
+    { 0x06, 0x0c, 0x18, 0x30, 0x18, 0x0c, 0x06, 0x00 }, /* > */
+    { 0x1e, 0x33, 0x30, 0x18, 0x0c, 0x00, 0x0c, 0x00 }, /* ? */
+    { 0x3e, 0x63, 0x7b, 0x7b, 0x7b, 0x03, 0x1e, 0x00 }, /* @ */
+    { 0x0c, 0x1e, 0x33, 0x33, 0x3f, 0x33, 0x33, 0x00 }, /* A */
+    { 0x3f, 0x66, 0x66, 0x3e, 0x66, 0x66, 0x3f, 0x00 }, /* B */
+    { 0x3c, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3c, 0x00 }, /* C */
+    { 0x1f, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1f, 0x00 }, /* D */
+    { 0x7f, 0x46, 0x16, 0x1e, 0x16, 0x46, 0x7f, 0x00 }, /* E */
+    { 0x7f, 0x46, 0x16, 0x1e, 0x16, 0x06, 0x0f, 0x00 }, /* F */
+    { 0x3c, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7c, 0x00 }, /* G */
+    { 0x33, 0x33, 0x33, 0x3f, 0x33, 0x33, 0x33, 0x00 }, /* H */
+    { 0x1e, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x1e, 0x00 }, /* I */
+    { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1e, 0x00 }, /* J */
+    { 0x67, 0x66, 0x36, 0x1e, 0x36, 0x66, 0x67, 0x00 }, /* K */
+    { 0x0f, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7f, 0x00 }, /* L */
+    { 0x63, 0x77, 0x7f, 0x7f, 0x6b, 0x63, 0x63, 0x00 }, /* M */
+    { 0x63, 0x67, 0x6f, 0x7b, 0x73, 0x63, 0x63, 0x00 }, /* N */
+    { 0x1c, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1c, 0x00 }, /* O */
+    { 0x3f, 0x66, 0x66, 0x3e, 0x06, 0x06, 0x0f, 0x00 }, /* P */
+    { 0x1e, 0x33, 0x33, 0x33, 0x3b, 0x1e, 0x38, 0x00 }, /* Q */
+    { 0x3f, 0x66, 0x66, 0x3e, 0x36, 0x66, 0x67, 0x00 }, /* R */
+    { 0x1e, 0x33, 0x07, 0x0e, 0x38, 0x33, 0x1e, 0x00 }, /* S */
+    { 0x3f, 0x2d, 0x0c, 0x0c, 0x0c, 0x0c, 0x1e, 0x00 }, /* T */
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3f, 0x00 }, /* U */
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1e, 0x0c, 0x00 }, /* V */
+    { 0x63, 0x63, 0x63, 0x6b, 0x7f, 0x77, 0x63, 0x00 }, /* W */
+    { 0x63, 0x63, 0x36, 0x1c, 0x1c, 0x36, 0x63, 0x00 }, /* X */
+    { 0x33, 0x33, 0x33, 0x1e, 0x0c, 0x0c, 0x1e, 0x00 }, /* Y */
+    { 0x7f, 0x63, 0x31, 0x18, 0x4c, 0x66, 0x7f, 0x00 }, /* Z */
+    { 0x1e, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1e, 0x00 }, /* [ */
+    { 0x03, 0x06, 0x0c, 0x18, 0x30, 0x60, 0x40, 0x00 }, /* \ */
+    { 0x1e, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1e, 0x00 }, /* ] */
+    { 0x08, 0x1c, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 }, /* ^ */
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff }, /* _ */
+    { 0x0c, 0x0c, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 }, /* ` */
+    { 0x00, 0x00, 0x1e, 0x30, 0x3e, 0x33, 0x6e, 0x00 }, /* a */
+    { 0x07, 0x06, 0x06, 0x3e, 0x66, 0x66, 0x3b, 0x00 }, /* b */
+    { 0x00, 0x00, 0x1e, 0x33, 0x03, 0x33, 0x1e, 0x00 }, /* c */
+    { 0x38, 0x30, 0x30, 0x3e, 0x33, 0x33, 0x6e, 0x00 }, /* d */
+    { 0x00, 0x00, 0x1e, 0x33, 0x3f, 0x03, 0x1e, 0x00 }, /* e */
+    { 0x1c, 0x36, 0x06, 0x0f, 0x06, 0x06, 0x0f, 0x00 }, /* f */
+    { 0x00, 0x00, 0x6e, 0x33, 0x33, 0x3e, 0x30, 0x1f }, /* g */
+    { 0x07, 0x06, 0x36, 0x6e, 0x66, 0x66, 0x67, 0x00 }, /* h */
+    { 0x0c, 0x00, 0x0e, 0x0c, 0x0c, 0x0c, 0x1e, 0x00 }, /* i */
+    { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1e }, /* j */
+    { 0x07, 0x06, 0x66, 0x36, 0x1e, 0x36, 0x67, 0x00 }, /* k */
+    { 0x0e, 0x0c, 0x0c, 0x0c, 0x0c, 0x0c, 0x1e, 0x00 }, /* l */
+    { 0x00, 0x00, 0x33, 0x7f, 0x7f, 0x6b, 0x63, 0x00 }, /* m */
+    { 0x00, 0x00, 0x1f, 0x33, 0x33, 0x33, 0x33, 0x00 }, /* n */
+    { 0x00, 0x00, 0x1e, 0x33, 0x33, 0x33, 0x1e, 0x00 }, /* o */
+    { 0x00, 0x00, 0x3b, 0x66, 0x66, 0x3e, 0x06, 0x0f }, /* p */
+    { 0x00, 0x00, 0x6e, 0x33, 0x33, 0x3e, 0x30, 0x78 }, /* q */
+    { 0x00, 0x00, 0x3b, 0x6e, 0x66, 0x06, 0x0f, 0x00 }, /* r */
+    { 0x00, 0x00, 0x3e, 0x03, 0x1e, 0x30, 0x1f, 0x00 }, /* s */
+    { 0x08, 0x0c, 0x3e, 0x0c, 0x0c, 0x2c, 0x18, 0x00 }, /* t */
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6e, 0x00 }, /* u */
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1e, 0x0c, 0x00 }, /* v */
+    { 0x00, 0x00, 0x63, 0x6b, 0x7f, 0x7f, 0x36, 0x00 }, /* w */
+    { 0x00, 0x00, 0x63, 0x36, 0x1c, 0x36, 0x63, 0x00 }, /* x */
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3e, 0x30, 0x1f }, /* y */
+    { 0x00, 0x00, 0x3f, 0x19, 0x0c, 0x26, 0x3f, 0x00 }, /* z */
+    { 0x38, 0x0c, 0x0c, 0x07, 0x0c, 0x0c, 0x38, 0x00 }, /* { */
+    { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 }, /* | */
+    { 0x07, 0x0c, 0x0c, 0x38, 0x0c, 0x0c, 0x07, 0x00 }, /* } */
+    { 0x6e, 0x3b, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }  /* ~ */
+
+};
+
+/* names of the standard fonts, all of which map to the built-in font */
+static const char* fntnam[] = { "term", "book", "sign", "tech" };
+
+static pwrite_t ofpwrite; /* saved write vector */
+
+static scnptr    screens[MAXCON];  /* screen buffers */
+static int       curupd;           /* current update screen */
+static int       curdsp;           /* current display screen */
+static int       maxxg;            /* width of buffers in pixels */
+static int       maxyg;            /* height of buffers in pixels */
+static int       charw;            /* width of character cell with spacing */
+static int       charh;            /* height of character cell with spacing */
+static int       bufmod;           /* buffered mode */
+static int       txtpth;           /* text path angle (recorded only) */
+static pict      pictbl[MAXPIC];   /* loaded pictures */
+static timrec    timtbl[PA_MAXTIM];/* timers */
+static timrec    frmtim;           /* frame timer */
+static long long vclk;             /* virtual clock, 100us units */
+static long      evtcnt;           /* number of events delivered */
+static long      evtlim;           /* events before forced terminate */
+static int       redraw;           /* initial redraw is pending */
+static int       winids;           /* next logical window id */
+static pa_evtrec sevque[MAXSEV];   /* queue of sent events */
+static int       sevin, sevout;    /* queue indexes */
+static int       sevcnt;           /* queue count */
+static pa_pevthan evthan[pa_ettabbar+1]; /* array of event handler routines */
+static pa_pevthan evtshan;         /* single master event handler routine */
+static dstptr    dstlst;           /* saved drawing states stack */
+
+/** ****************************************************************************
+
+Process library error
+
+Outputs an error message, then halts.
+
+*******************************************************************************/
+
+static void error(char* s)
+
+{
+
+    fprintf(stderr, "\nError: Graphics: %s\n", s);
+
+    exit(1);
+
+}
+
+/** ****************************************************************************
+
+Get memory
+
+Allocates memory, halting on failure.
+
+*******************************************************************************/
+
+static void* imalloc(size_t n)
+
+{
+
+    void* p;
+
+    p = malloc(n);
+    if (!p) error("Out of memory");
+
+    return p;
+
+}
+
+/** ****************************************************************************
+
+Translate colors code
+
+Translates an independent to a 24 bit RGB color value.
+
+*******************************************************************************/
+
+static unsigned colnum(pa_color c)
+
+{
+
+    unsigned n;
+
+    switch (c) { /* color */
+
+        case pa_black:     n = 0x000000; break;
+        case pa_white:     n = 0xffffff; break;
+        case pa_red:       n = 0xff0000; break;
+        case pa_green:     n = 0x00ff00; break;
+        case pa_blue:      n = 0x0000ff; break;
+        case pa_cyan:      n = 0x00ffff; break;
+        case pa_yellow:    n = 0xffff00; break;
+        case pa_magenta:   n = 0xff00ff; break;
+        case pa_backcolor: n = 0xf7f7f7; break;
+        default:           n = 0x000000; break;
+
+    }
+
+    return n;
+
+}
+
+/** ****************************************************************************
+
+Translate rgb to surface color
+
+Translates a ratioed INT_MAX graph color to a 24 bit RGB value.
+
+*******************************************************************************/
+
+static unsigned rgb2pix(int r, int g, int b)
+
+{
+
+    return (r/8388608)*65536+(g/8388608)*256+b/8388608;
+
+}
+
+/** ****************************************************************************
+
+Get update screen
+
+Returns the current update screen.
+
+*******************************************************************************/
+
+static scnptr updscn(void)
+
+{
+
+    return screens[curupd-1];
+
+}
+
+/** ****************************************************************************
+
+Fill span
+
+Fills a horizontal run of pixels on the given screen with the given color and
+mix mode. Coordinates are 1 based and inclusive, and are clipped to the buffer.
+
+*******************************************************************************/
+
+static void hspan(scnptr sc, int y, int x1, int x2, unsigned c, mode m)
+
+{
+
+    unsigned* p;
+    int       n;
+
+    if (m == mdinvis || y < 1 || y > maxyg) return;
+    if (x1 < 1) x1 = 1;
+    if (x2 > maxxg) x2 = maxxg;
+    if (x1 > x2) return;
+    p = &sc->buf[(y-1)*maxxg+x1-1];
+    n = x2-x1+1;
+    switch (m) {
+
+        case mdnorm: while (n--) *p++ = c; break;
+        case mdxor:  while (n--) *p++ ^= c; break;
+        case mdand:  while (n--) *p++ &= c; break;
+        case mdor:   while (n--) *p++ |= c; break;
+        default:     break;
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Set pixel
+
+Sets a single pixel with the given color and mix mode, clipped.
+
+*******************************************************************************/
+
+static void putpix(scnptr sc, int x, int y, unsigned c, mode m)
+
+{
+
+    unsigned* p;
+
+    if (m == mdinvis || x < 1 || y < 1 || x > maxxg || y > maxyg) return;
+    p = &sc->buf[(y-1)*maxxg+x-1];
+    switch (m) {
+
+        case mdnorm: *p = c; break;
+        case mdxor:  *p ^= c; break;
+        case mdand:  *p &= c; break;
+        case mdor:   *p |= c; break;
+        default:     break;
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Clear screen
+
+Clears the given screen to its background color, and homes the cursor.
+
+*******************************************************************************/
+
+static void iclear(scnptr sc)
+
+{
+
+    int y;
+
+    for (y = 1; y <= maxyg; y++) hspan(sc, y, 1, maxxg, sc->bcrgb, mdnorm);
+    sc->curxg = 1;
+    sc->curyg = 1;
+
+}
+
+/** ****************************************************************************
+
+Initialize screen
+
+Sets up a new screen context with default attributes, allocates and clears its
+surface.
+
+*******************************************************************************/
+
+static void iniscn(scnptr sc)
+
+{
+
+    int i;
+
+    sc->buf = imalloc((size_t)maxxg*maxyg*sizeof(unsigned));
+    sc->fcrgb = colnum(pa_black);
+    sc->bcrgb = colnum(pa_white);
+    sc->fmod = mdnorm;
+    sc->bmod = mdnorm;
+    sc->attr = 0;
+    sc->autof = TRUE;
+    sc->curv = TRUE;
+    sc->lwidth = 1;
+    /* set default tabs every 8 characters */
+    for (i = 0; i < MAXTAB; i++) sc->tab[i] = 0;
+    for (i = 0; i < MAXTAB && (i+1)*8*charw+1 <= maxxg; i++)
+        sc->tab[i] = (i+1)*8*charw+1;
+    iclear(sc);
+
+}
+
+/** ****************************************************************************
+
+Resize buffers
+
+Sets a new buffer size in pixels, and reallocates all of the existing screens
+at that size. Screen contents are cleared.
+
+*******************************************************************************/
+
+static void isizbufg(int x, int y)
+
+{
+
+    int si;
+
+    if (x < 1 || y < 1) error("Invalid buffer size");
+    maxxg = x;
+    maxyg = y;
+    for (si = 0; si < MAXCON; si++) if (screens[si]) {
+
+        free(screens[si]->buf);
+        screens[si]->buf = imalloc((size_t)maxxg*maxyg*sizeof(unsigned));
+        iclear(screens[si]);
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Scroll screen
+
+Scrolls the screen by pixel deltas. Positive y moves the content up, positive x
+moves it left. The vacated areas are filled with the background color.
+
+*******************************************************************************/
+
+static void iscrollg(scnptr sc, int x, int y)
+
+{
+
+    int r;  /* row index */
+    int w;  /* width of kept band */
+    int sx; /* source column */
+    int dx; /* destination column */
+
+    if (abs(x) >= maxxg || abs(y) >= maxyg) { /* everything leaves */
+
+        for (r = 1; r <= maxyg; r++) hspan(sc, r, 1, maxxg, sc->bcrgb, mdnorm);
+        return;
+
+    }
+    w = maxxg-abs(x);
+    sx = x > 0 ? x : 0;
+    dx = x > 0 ? 0 : -x;
+    /* move rows in the direction that does not overwrite the source */
+    if (y >= 0) for (r = 0; r < maxyg-y; r++)
+        memmove(&sc->buf[r*maxxg+dx], &sc->buf[(r+y)*maxxg+sx],
+                w*sizeof(unsigned));
+    else for (r = maxyg-1; r >= -y; r--)
+        memmove(&sc->buf[r*maxxg+dx], &sc->buf[(r+y)*maxxg+sx],
+                w*sizeof(unsigned));
+    /* fill vacated rows and columns */
+    if (y > 0) for (r = maxyg-y+1; r <= maxyg; r++)
+        hspan(sc, r, 1, maxxg, sc->bcrgb, mdnorm);
+    else if (y < 0) for (r = 1; r <= -y; r++)
+        hspan(sc, r, 1, maxxg, sc->bcrgb, mdnorm);
+    if (x > 0) for (r = 1; r <= maxyg; r++)
+        hspan(sc, r, maxxg-x+1, maxxg, sc->bcrgb, mdnorm);
+    else if (x < 0) for (r = 1; r <= maxyg; r++)
+        hspan(sc, r, 1, -x, sc->bcrgb, mdnorm);
+
+}
+
+/** ****************************************************************************
+
+Cursor movement
+
+Moves the cursor by one character cell, handling wrap and scroll when auto is
+enabled.
+
+*******************************************************************************/
+
+static void iup(scnptr sc)
+
+{
+
+    if (sc->autof && sc->curyg-charh < 1) iscrollg(sc, 0, -charh);
+    else sc->curyg -= charh;
+
+}
+
+static void idown(scnptr sc)
+
+{
+
+    if (sc->autof && sc->curyg+charh*2-1 > maxyg) iscrollg(sc, 0, charh);
+    else sc->curyg += charh;
+
+}
+
+static void ileft(scnptr sc)
+
+{
+
+    if (sc->autof && sc->curxg-charw < 1) {
+
+        sc->curxg = (maxxg/charw-1)*charw+1;
+        iup(sc);
+
+    } else sc->curxg -= charw;
+
+}
+
+static void iright(scnptr sc)
+
+{
+
+    if (sc->autof && sc->curxg+charw*2-1 > maxxg) {
+
+        sc->curxg = 1;
+        idown(sc);
+
+    } else sc->curxg += charw;
+
+}
+
+/** ****************************************************************************
+
+Tab
+
+Moves the cursor to the next tab stop, if there is one.
+
+*******************************************************************************/
+
+static void itab(scnptr sc)
+
+{
+
+    int i;
+
+    for (i = 0; i < MAXTAB && sc->tab[i]; i++)
+        if (sc->tab[i] > sc->curxg) { sc->curxg = sc->tab[i]; break; }
+
+}
+
+/** ****************************************************************************
+
+Draw character
+
+Draws a character cell at the cursor with the current colors, modes and
+attributes. The cursor is not moved.
+
+*******************************************************************************/
+
+static void drwchr(scnptr sc, unsigned char c)
+
+{
+
+    const unsigned char* g; /* glyph */
+    unsigned fc, bc;        /* colors */
+    unsigned t;
+    int      r, i;
+    int      bits;
+    int      yo;            /* glyph offset in cell */
+    int      sh;            /* italic shear */
+    int      x, y;
+
+    fc = sc->fcrgb;
+    bc = sc->bcrgb;
+    if (sc->attr & BIT(sarev)) { t = fc; fc = bc; bc = t; }
+    x = sc->curxg;
+    y = sc->curyg;
+    for (r = 0; r < charh; r++) hspan(sc, y+r, x, x+charw-1, bc, sc->bmod);
+    if (sc->fmod == mdinvis) return;
+    if (c < ' ' || c > '~') c = '?'; /* no glyph */
+    g = font8x8[c-' '];
+    yo = CHRTOP;
+    if (sc->attr & BIT(sasuper)) yo -= 2;
+    if (sc->attr & BIT(sasubs)) yo += 2;
+    for (r = 0; r < 8; r++) {
+
+        bits = g[r];
+        if (sc->attr & BIT(sabold)) bits |= bits << 1;
+        sh = sc->attr & BIT(saital) ? (7-r)/3 : 0;
+        for (i = 0; i < 9 && i+sh < charw; i++)
+            if (bits & 1 << i) putpix(sc, x+i+sh, y+yo+r, fc, sc->fmod);
+
+    }
+    if (sc->attr & BIT(saundl))
+        hspan(sc, y+CHRUL, x, x+charw-1, fc, sc->fmod);
+    if (sc->attr & BIT(sastkout))
+        hspan(sc, y+CHRSO, x, x+charw-1, fc, sc->fmod);
+
+}
+
+/** ****************************************************************************
+
+Place character
+
+Processes a single output character, either a control or a printable
+character.
+
+UTF-8 continuation bytes are dropped, and lead bytes are shown as a single
+unknown character, since the built-in font is ASCII only.
+
+*******************************************************************************/
+
+static void plcchr(scnptr sc, unsigned char c)
+
+{
+
+    if (c == '\r') sc->curxg = 1;
+    else if (c == '\n') { sc->curxg = 1; idown(sc); }
+    else if (c == '\b') ileft(sc);
+    else if (c == '\f') iclear(sc);
+    else if (c == '\t') itab(sc);
+    else if (c >= 0x80 && c < 0xc0) ; /* UTF-8 continuation */
+    else if (c >= ' ' && c != 0x7f) {
+
+        drwchr(sc, c);
+        iright(sc);
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Write
+
+Output to the window file handle is rendered, all other files pass through.
+
+*******************************************************************************/
+
+static ssize_t iwrite(int fd, const void* buff, size_t count)
+
+{
+
+    const unsigned char* p = buff;
+    size_t cnt = count;
+    scnptr sc;
+
+    if (fd != OUTFIL) return (*ofpwrite)(fd, buff, count);
+    sc = updscn();
+    while (cnt--) plcchr(sc, *p++);
+
+    return count;
+
+}
+
+/** ****************************************************************************
+
+Draw line with brush
+
+Draws a line with Bresenham's algorithm, placing a square brush of the current
+line width at each point.
+
+*******************************************************************************/
+
+static void brush(scnptr sc, int x, int y)
+
+{
+
+    int r;
+    int o;
+
+    if (sc->lwidth <= 1) putpix(sc, x, y, sc->fcrgb, sc->fmod);
+    else {
+
+        o = (sc->lwidth-1)/2;
+        for (r = y-o; r < y-o+sc->lwidth; r++)
+            hspan(sc, r, x-o, x-o+sc->lwidth-1, sc->fcrgb, sc->fmod);
+
+    }
+
+}
+
+static void iline(scnptr sc, int x1, int y1, int x2, int y2)
+
+{
+
+    int dx, dy, sx, sy, err, e2;
+
+    dx = abs(x2-x1);
+    sx = x1 < x2 ? 1 : -1;
+    dy = -abs(y2-y1);
+    sy = y1 < y2 ? 1 : -1;
+    err = dx+dy;
+    for (;;) {
+
+        brush(sc, x1, y1);
+        if (x1 == x2 && y1 == y2) break;
+        e2 = 2*err;
+        if (e2 >= dy) { err += dy; x1 += sx; }
+        if (e2 <= dx) { err += dx; y1 += sy; }
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Find rounded rectangle span
+
+Finds the span of pixels on row y that lie inside a rounded rectangle given by
+its edges and corner radii. Pixel centers are on integers, so a rectangle
+covering pixels x1..x2 has edges x1-0.5 and x2+0.5. A rectangle has zero radii,
+and an ellipse has radii of half its size. Returns false if the row has no
+pixels inside.
+
+*******************************************************************************/
+
+static int rrspan(double l, double t, double r, double b, double rx, double ry,
+                  int y, int* xs, int* xe)
+
+{
+
+    double d;  /* distance into corner */
+    double in; /* inset at this row */
+
+    if (y <= t || y >= b || l >= r) return FALSE;
+    d = 0.0;
+    if (y < t+ry) d = t+ry-y;
+    else if (y > b-ry) d = y-(b-ry);
+    in = 0.0;
+    if (d > 0.0 && ry > 0.0) {
+
+        d /= ry;
+        in = d >= 1.0 ? rx : rx-rx*sqrt(1.0-d*d);
+
+    }
+    *xs = (int)floor(l+in)+1;
+    *xe = (int)ceil(r-in)-1;
+
+    return *xs <= *xe;
+
+}
+
+/** ****************************************************************************
+
+Check pixel in arc
+
+Checks if a pixel lies within the sector or chord described by an arc filter.
+Angles run clockwise from the top, as with the Petit-Ami arc calls.
+
+*******************************************************************************/
+
+static int inarc(arcflt* af, int x, int y)
+
+{
+
+    double a;
+
+    if (af->chord)
+        return ((af->x2-af->x1)*(y-af->y1)-(af->y2-af->y1)*(x-af->x1))*
+               af->side >= 0.0;
+    a = atan2((x-af->cx)/af->rx, -(y-af->cy)/af->ry)-af->sa;
+    while (a < 0.0) a += 2*M_PI;
+
+    return a <= af->span;
+
+}
+
+/** ****************************************************************************
+
+Fill span through arc filter
+
+Fills a span in the foreground color and mode. If an arc filter is given, only
+the pixels inside it are set.
+
+*******************************************************************************/
+
+static void fltspan(scnptr sc, int y, int x1, int x2, arcflt* af)
+
+{
+
+    int x;
+
+    if (!af) hspan(sc, y, x1, x2, sc->fcrgb, sc->fmod);
+    else for (x = x1; x <= x2; x++)
+        if (inarc(af, x, y)) putpix(sc, x, y, sc->fcrgb, sc->fmod);
+
+}
+
+/** ****************************************************************************
+
+Draw shape
+
+Draws a rounded rectangle, either filled or as an outline of the current line
+width. Rectangles and ellipses are both drawn this way. The outline is the
+shape less the same shape inset by the line width.
+
+*******************************************************************************/
+
+static void drwshape(scnptr sc, int x1, int y1, int x2, int y2, double rx,
+                     double ry, int fill, arcflt* af)
+
+{
+
+    double l, t, r, b, lw;
+    int    y, t1, xs, xe, is, ie;
+
+    if (x1 > x2) { t1 = x1; x1 = x2; x2 = t1; }
+    if (y1 > y2) { t1 = y1; y1 = y2; y2 = t1; }
+    l = x1-0.5;
+    t = y1-0.5;
+    r = x2+0.5;
+    b = y2+0.5;
+    if (rx > (r-l)/2) rx = (r-l)/2;
+    if (ry > (b-t)/2) ry = (b-t)/2;
+    if (rx < 0.0) rx = 0.0;
+    if (ry < 0.0) ry = 0.0;
+    lw = sc->lwidth;
+    for (y = y1 < 1 ? 1 : y1; y <= y2 && y <= maxyg; y++)
+        if (rrspan(l, t, r, b, rx, ry, y, &xs, &xe)) {
+
+        if (!fill && rrspan(l+lw, t+lw, r-lw, b-lw, rx-lw > 0 ? rx-lw : 0,
+                            ry-lw > 0 ? ry-lw : 0, y, &is, &ie)) {
+
+            fltspan(sc, y, xs, is-1, af);
+            fltspan(sc, y, ie+1, xe, af);
+
+        } else fltspan(sc, y, xs, xe, af);
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Set up arc filter
+
+Fills out an arc filter for the ellipse in the given bounding box and the
+Petit-Ami start and end angles.
+
+*******************************************************************************/
+
+static void setarc(arcflt* af, int x1, int y1, int x2, int y2, int sa, int ea,
+                   int chord)
+
+{
+
+    double a;
+
+    af->cx = (x1+x2)/2.0;
+    af->cy = (y1+y2)/2.0;
+    af->rx = (abs(x2-x1)+1)/2.0;
+    af->ry = (abs(y2-y1)+1)/2.0;
+    af->sa = sa*2*M_PI/INT_MAX;
+    af->span = ea*2*M_PI/INT_MAX-af->sa;
+    if (af->span < 0.0) af->span += 2*M_PI;
+    af->chord = chord;
+    if (chord) {
+
+        af->x1 = af->cx+af->rx*sin(af->sa);
+        af->y1 = af->cy-af->ry*cos(af->sa);
+        af->x2 = af->cx+af->rx*sin(af->sa+af->span);
+        af->y2 = af->cy-af->ry*cos(af->sa+af->span);
+        /* keep the side the arc midpoint lies on */
+        a = af->sa+af->span/2;
+        af->side = (af->x2-af->x1)*(af->cy-af->ry*cos(a)-af->y1)-
+                   (af->y2-af->y1)*(af->cx+af->rx*sin(a)-af->x1);
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Fill triangle
+
+Fills a triangle by finding, for each row, the extent of the edges that cross
+that row.
+
+*******************************************************************************/
+
+static void itriangle(scnptr sc, int x1, int y1, int x2, int y2, int x3, int y3)
+
+{
+
+    int    px[3], py[3];
+    int    y, ymin, ymax, i, j;
+    double x, xmin, xmax;
+
+    px[0] = x1; py[0] = y1;
+    px[1] = x2; py[1] = y2;
+    px[2] = x3; py[2] = y3;
+    ymin = y1; ymax = y1;
+    for (i = 1; i < 3; i++) {
+
+        if (py[i] < ymin) ymin = py[i];
+        if (py[i] > ymax) ymax = py[i];
+
+    }
+    if (ymin < 1) ymin = 1;
+    if (ymax > maxyg) ymax = maxyg;
+    for (y = ymin; y <= ymax; y++) {
+
+        xmin = INT_MAX;
+        xmax = INT_MIN;
+        for (i = 0; i < 3; i++) {
+
+            j = (i+1)%3;
+            if ((py[i] <= y && y <= py[j]) || (py[j] <= y && y <= py[i])) {
+
+                if (py[i] == py[j]) { /* horizontal edge */
+
+                    if (px[i] < xmin) xmin = px[i];
+                    if (px[j] < xmin) xmin = px[j];
+                    if (px[i] > xmax) xmax = px[i];
+                    if (px[j] > xmax) xmax = px[j];
+
+                } else {
+
+                    x = px[i]+(double)(y-py[i])*(px[j]-px[i])/(py[j]-py[i]);
+                    if (x < xmin) xmin = x;
+                    if (x > xmax) xmax = x;
+
+                }
+
+            }
+
+        }
+        if (xmin <= xmax)
+            hspan(sc, y, (int)floor(xmin+0.5), (int)floor(xmax+0.5), sc->fcrgb,
+                  sc->fmod);
+
+    }
+
+}
+
+/** ****************************************************************************
+
+Load .bmp file
+
+Loads an uncompressed 24 or 32 bit .bmp file into a picture. Both bottom up and
+top down files are accepted.
+
+*******************************************************************************/
+
+static unsigned getle(unsigned char* b, int n)
+
+{
+
+    unsigned v = 0;
+
+    while (n--) v = v << 8 | b[n];
+
+    return v;
+
+}
+
+static void loadbmp(pict* pp, char* fn)
+
+{
+
+    FILE*          fp;
+    unsigned char  hdr[54];
+    unsigned char* row;
+    int            off, w, h, bpp, td, bpr;
+    int            x, y, ry;
+
+    fp = fopen(fn, "rb");
+    if (!fp) error("Cannot open picture file");
+    if (fread(hdr, 1, sizeof(hdr), fp) != sizeof(hdr) || hdr[0] != 'B' ||
+        hdr[1] != 'M') error("Picture file is not .bmp format");
+    off = getle(&hdr[10], 4);
+    w = (int)getle(&hdr[18], 4);
+    h = (int)getle(&hdr[22], 4);
+    bpp = getle(&hdr[28], 2);
+    if ((bpp != 24 && bpp != 32) || getle(&hdr[30], 4) != 0)
+        error("Picture file format not supported");
+    td = h < 0; /* top down */
+    if (td) h = -h;
+    if (w < 1 || h < 1) error("Picture file is invalid");
+    bpr = (w*(bpp/8)+3)&~3; /* bytes per row, padded */
+    row = imalloc(bpr);
+    pp->buf = imalloc((size_t)w*h*sizeof(unsigned));
+    pp->x = w;
+    pp->y = h;
+    if (fseek(fp, off, SEEK_SET)) error("Picture file is invalid");
+    for (y = 0; y < h; y++) {
+
+        if (fread(row, 1, bpr, fp) != (size_t)bpr)
+            error("Picture file is invalid");
+        ry = td ? y : h-1-y;
+        for (x = 0; x < w; x++)
+            pp->buf[ry*w+x] = getle(&row[x*(bpp/8)], 3);
+
+    }
+    free(row);
+    fclose(fp);
+
+}
+
+/** ****************************************************************************
+
+Write .bmp file
+
+Writes a screen surface out as a 24 bit bottom up .bmp file.
+
+*******************************************************************************/
+
+static void putle(unsigned char* b, unsigned v, int n)
+
+{
+
+    while (n--) { *b++ = v & 0xff; v >>= 8; }
+
+}
+
+static void savebmp(scnptr sc, char* fn)
+
+{
+
+    FILE*          fp;
+    unsigned char  hdr[54];
+    unsigned char* row;
+    int            bpr, x, y;
+    unsigned       p;
+
+    fp = fopen(fn, "wb");
+    if (!fp) error("Cannot write display picture file");
+    bpr = (maxxg*3+3)&~3;
+    memset(hdr, 0, sizeof(hdr));
+    hdr[0] = 'B';
+    hdr[1] = 'M';
+    putle(&hdr[2], sizeof(hdr)+bpr*maxyg, 4); /* file size */
+    putle(&hdr[10], sizeof(hdr), 4); /* offset to pixels */
+    putle(&hdr[14], 40, 4); /* info header size */
+    putle(&hdr[18], maxxg, 4);
+    putle(&hdr[22], maxyg, 4);
+    putle(&hdr[26], 1, 2); /* planes */
+    putle(&hdr[28], 24, 2); /* bits per pixel */
+    putle(&hdr[34], bpr*maxyg, 4); /* image size */
+    putle(&hdr[38], DPM, 4);
+    putle(&hdr[42], DPM, 4);
+    fwrite(hdr, 1, sizeof(hdr), fp);
+    row = imalloc(bpr);
+    memset(row, 0, bpr);
+    for (y = maxyg-1; y >= 0; y--) {
+
+        for (x = 0; x < maxxg; x++) {
+
+            p = sc->buf[y*maxxg+x];
+            putle(&row[x*3], p, 3);
+
+        }
+        fwrite(row, 1, bpr, fp);
+
+    }
+    free(row);
+    fclose(fp);
+
+}
+
+/** ****************************************************************************
+
+Default event handler
+
+If we reach this event handler, it means none of the overriders has handled the
+event, but rather passed it down. We flag the event was not handled and return,
+which will cause the event to return to the event() caller.
+
+*******************************************************************************/
+
+static void defaultevent(pa_evtrec* ev)
+
+{
+
+    /* set not handled and exit */
+    ev->handled = 0;
+
+}
+
+/** ****************************************************************************
+
+Get next event
+
+Finds the next event. Sent events come first, then an initial redraw of the
+window, then the earliest timer on the virtual clock. With nothing left to
+deliver, or when the event limit is reached, the program is told to terminate.
+
+*******************************************************************************/
+
+static void ievent(pa_evtrec* er)
+
+{
+
+    timrec* tp; /* earliest timer */
+    int     ti; /* index of earliest timer */
+    int     i;
+
+    if (sevcnt) { /* sent event pending */
+
+        *er = sevque[sevout];
+        sevout = (sevout+1)%MAXSEV;
+        sevcnt--;
+        return;
+
+    }
+    memset(er, 0, sizeof(pa_evtrec));
+    er->winid = 1;
+    if (evtcnt >= evtlim) { er->etype = pa_etterm; return; }
+    evtcnt++;
+    if (redraw) { /* window has just been shown */
+
+        redraw = FALSE;
+        er->etype = pa_etredraw;
+        er->rsx = 1;
+        er->rsy = 1;
+        er->rex = maxxg;
+        er->rey = maxyg;
+        return;
+
+    }
+    tp = NULL;
+    ti = 0;
+    for (i = 0; i < PA_MAXTIM; i++)
+        if (timtbl[i].act && (!tp || timtbl[i].due < tp->due))
+            { tp = &timtbl[i]; ti = i+1; }
+    if (frmtim.act && (!tp || frmtim.due < tp->due)) { tp = &frmtim; ti = 0; }
+    if (!tp) { er->etype = pa_etterm; return; }
+    vclk = tp->due; /* advance virtual time */
+    if (tp->rep) tp->due += tp->per;
+    else tp->act = FALSE;
+    if (ti) { er->etype = pa_ettim; er->timnum = ti; }
+    else er->etype = pa_etframe;
+
+}
+
+/*******************************************************************************
+
+Text level
+
+*******************************************************************************/
+
+/** ****************************************************************************
+
+Scroll screen
+
+Scrolls the screen by deltas in any given direction, in characters or pixels.
+
+*******************************************************************************/
+
+void pa_scrollg(FILE* f, int x, int y)
+
+{
+
+    iscrollg(updscn(), x, y);
+
+}
+
+void pa_scroll(FILE* f, int x, int y)
+
+{
+
+    iscrollg(updscn(), x*charw, y*charh);
+
+}
+
+/** ****************************************************************************
+
+Position cursor
+
+Moves the cursor to the specified x and y location, in characters or pixels.
+
+*******************************************************************************/
+
+void pa_cursor(FILE* f, int x, int y)
+
+{
+
+    scnptr sc = updscn();
+
+    sc->curxg = (x-1)*charw+1;
+    sc->curyg = (y-1)*charh+1;
+
+}
+
+void pa_cursorg(FILE* f, int x, int y)
+
+{
+
+    scnptr sc = updscn();
+
+    sc->curxg = x;
+    sc->curyg = y;
+
+}
+
+/** ****************************************************************************
+
+Find character baseline
+
+Returns the offset, from the top of the character cell, to the font baseline.
+
+*******************************************************************************/
+
+int pa_baseline(FILE* f)
+
+{
+
+    return CHRTOP+7;
+
+}
+
+/** ****************************************************************************
+
+Return maximum x and y dimensions
+
+Returns the size of the buffer in characters or pixels.
+
+*******************************************************************************/
+
+int pa_maxx(FILE* f) { return maxxg/charw; }
+int pa_maxy(FILE* f) { return maxyg/charh; }
+int pa_maxxg(FILE* f) { return maxxg; }
+int pa_maxyg(FILE* f) { return maxyg; }
+
+/** ****************************************************************************
+
+Cursor movement
+
+Home, up, down, left and right cursor movements, with scrolling when auto is
+on. Delete moves left and erases the character there.
+
+*******************************************************************************/
+
+void pa_home(FILE* f) { updscn()->curxg = 1; updscn()->curyg = 1; }
+void pa_up(FILE* f) { iup(updscn()); }
+void pa_down(FILE* f) { idown(updscn()); }
+void pa_left(FILE* f) { ileft(updscn()); }
+void pa_right(FILE* f) { iright(updscn()); }
+
+void pa_del(FILE* f)
+
+{
+
+    scnptr sc = updscn();
+
+    ileft(sc);
+    drwchr(sc, ' ');
+
+}
+
+/** ****************************************************************************
+
+Text attributes
+
+Turns text attributes on and off. Blink has no meaning on a still image and is
+ignored. Standout is the same as reverse.
+
+*******************************************************************************/
+
+static void setatt(scnatt a, int e)
+
+{
+
+    scnptr sc = updscn();
+
+    if (e) sc->attr |= BIT(a);
+    else sc->attr &= ~BIT(a);
+
+}
+
+void pa_blink(FILE* f, int e) { }
+void pa_reverse(FILE* f, int e) { setatt(sarev, e); }
+void pa_underline(FILE* f, int e) { setatt(saundl, e); }
+void pa_strikeout(FILE* f, int e) { setatt(sastkout, e); }
+void pa_italic(FILE* f, int e) { setatt(saital, e); }
+void pa_bold(FILE* f, int e) { setatt(sabold, e); }
+void pa_standout(FILE* f, int e) { setatt(sarev, e); }
+
+void pa_superscript(FILE* f, int e)
+
+{
+
+    setatt(sasuper, e);
+    if (e) setatt(sasubs, FALSE);
+
+}
+
+void pa_subscript(FILE* f, int e)
+
+{
+
+    setatt(sasubs, e);
+    if (e) setatt(sasuper, FALSE);
+
+}
+
+/** ****************************************************************************
+
+Set colors
+
+Sets the foreground or background color, by color code or by INT_MAX ratioed
+RGB. There is no palette, so the closest color is the color itself.
+
+*******************************************************************************/
+
+void pa_fcolor(FILE* f, pa_color c) { updscn()->fcrgb = colnum(c); }
+void pa_bcolor(FILE* f, pa_color c) { updscn()->bcrgb = colnum(c); }
+
+void pa_fcolorg(FILE* f, int r, int g, int b)
+
+{
+
+    updscn()->fcrgb = rgb2pix(r, g, b);
+
+}
+
+void pa_fcolorc(FILE* f, int r, int g, int b) { pa_fcolorg(f, r, g, b); }
+
+void pa_bcolorg(FILE* f, int r, int g, int b)
+
+{
+
+    updscn()->bcrgb = rgb2pix(r, g, b);
+
+}
+
+void pa_bcolorc(FILE* f, int r, int g, int b) { pa_bcolorg(f, r, g, b); }
+
+/** ****************************************************************************
+
+Auto, cursor visible and cursor position
+
+*******************************************************************************/
+
+void pa_auto(FILE* f, int e) { updscn()->autof = !!e; }
+void pa_curvis(FILE* f, int e) { updscn()->curv = !!e; }
+int pa_curx(FILE* f) { return (updscn()->curxg-1)/charw+1; }
+int pa_cury(FILE* f) { return (updscn()->curyg-1)/charh+1; }
+int pa_curxg(FILE* f) { return updscn()->curxg; }
+int pa_curyg(FILE* f) { return updscn()->curyg; }
+
+int pa_curbnd(FILE* f)
+
+{
+
+    scnptr sc = updscn();
+
+    return sc->curxg >= 1 && sc->curxg+charw-1 <= maxxg &&
+           sc->curyg >= 1 && sc->curyg+charh-1 <= maxyg;
+
+}
+
+/** ****************************************************************************
+
+Select current screen
+
+Selects the update and display screens. New screens are created on first use.
+Since nothing is shown, the display screen matters only for which surface is
+saved at exit.
+
+*******************************************************************************/
+
+void pa_select(FILE* f, int u, int d)
+
+{
+
+    if (u < 1 || u > MAXCON || d < 1 || d > MAXCON)
+        error("Invalid screen number");
+    if (!screens[u-1]) {
+
+        screens[u-1] = imalloc(sizeof(scncon));
+        iniscn(screens[u-1]);
+
+    }
+    if (!screens[d-1]) {
+
+        screens[d-1] = imalloc(sizeof(scncon));
+        iniscn(screens[d-1]);
+
+    }
+    curupd = u;
+    curdsp = d;
+
+}
+
+/** ****************************************************************************
+
+Events
+
+pa_event returns the next event from the virtual clock. Handlers installed with
+pa_eventover or pa_eventsover see each event first, as with the display
+modules.
+
+*******************************************************************************/
+
+void pa_event(FILE* f, pa_evtrec* er)
+
+{
+
+    do { /* loop handling via event vectors */
+
+        ievent(er);
+        er->handled = 1; /* set event is handled by default */
+        (evtshan)(er); /* call master event handler */
+        if (!er->handled && er->etype <= pa_ettabbar) { /* send it to fanout */
+
+            er->handled = 1; /* set event is handled by default */
+            (*evthan[er->etype])(er); /* call event handler first */
+
+        }
+
+    } while (er->handled && er->etype != pa_etterm);
+
+}
+
+void pa_eventover(pa_evtcod e, pa_pevthan eh, pa_pevthan* oeh)
+
+{
+
+    if (e < pa_etchar || e > pa_ettabbar) error("Invalid event code");
+    *oeh = evthan[e]; /* save existing event handler */
+    evthan[e] = eh; /* place new event handler */
+
+}
+
+void pa_eventsover(pa_pevthan eh, pa_pevthan* oeh)
+
+{
+
+    *oeh = evtshan; /* save existing event handler */
+    evtshan = eh; /* place new event handler */
+
+}
+
+void pa_sendevent(FILE* f, pa_evtrec* er)
+
+{
+
+    if (sevcnt >= MAXSEV) error("Event queue full");
+    sevque[sevin] = *er;
+    sevque[sevin].winid = 1;
+    sevin = (sevin+1)%MAXSEV;
+    sevcnt++;
+
+}
+
+/** ****************************************************************************
+
+Save and restore drawing state
+
+The whole screen context except the pixel surface is saved and restored. The
+state goes back to the screen it was saved from, even if the update screen was
+changed since.
+
+*******************************************************************************/
+
+void pa_pushstate(FILE* f)
+
+{
+
+    dstptr dp;
+
+    dp = imalloc(sizeof(dstrec));
+    dp->sc = *updscn();
+    dp->scn = curupd;
+    dp->next = dstlst;
+    dstlst = dp;
+
+}
+
+void pa_popstate(FILE* f)
+
+{
+
+    dstptr    dp;
+    unsigned* buf;
+
+    if (!dstlst) error("No saved drawing state");
+    dp = dstlst;
+    dstlst = dp->next;
+    buf = screens[dp->scn-1]->buf; /* keep the surface */
+    *screens[dp->scn-1] = dp->sc;
+    screens[dp->scn-1]->buf = buf;
+    free(dp);
+
+}
+
+/** ****************************************************************************
+
+Find window id
+
+There is only the one window.
+
+*******************************************************************************/
+
+int pa_winid(FILE* f) { return 1; }
+
+/** ****************************************************************************
+
+Timers
+
+Timers run on the virtual clock, in 100us units. The frame timer fires 60 times
+a second of virtual time.
+
+*******************************************************************************/
+
+void pa_timer(FILE* f, int i, long t, int r)
+
+{
+
+    if (i < 1 || i > PA_MAXTIM) error("Invalid timer number");
+    if (t < 1) t = 1;
+    timtbl[i-1].act = TRUE;
+    timtbl[i-1].rep = r;
+    timtbl[i-1].per = t;
+    timtbl[i-1].due = vclk+t;
+
+}
+
+void pa_killtimer(FILE* f, int i)
+
+{
+
+    if (i < 1 || i > PA_MAXTIM) error("Invalid timer number");
+    timtbl[i-1].act = FALSE;
+
+}
+
+void pa_frametimer(FILE* f, int e)
+
+{
+
+    if (e && !frmtim.act) frmtim.due = vclk+FRMTIM;
+    frmtim.act = !!e;
+
+}
+
+void pa_autohold(int e) { }
+
+/** ****************************************************************************
+
+Input devices
+
+There are no mice, joysticks or function keys offscreen.
+
+*******************************************************************************/
+
+int pa_mouse(FILE* f) { return 0; }
+int pa_mousebutton(FILE* f, int m) { return 0; }
+int pa_joystick(FILE* f) { return 0; }
+int pa_joybutton(FILE* f, int j) { return 0; }
+int pa_joyaxis(FILE* f, int j) { return 0; }
+int pa_funkey(FILE* f) { return 0; }
+
+/** ****************************************************************************
+
+Tabs
+
+Sets, resets and clears tab stops, in characters or pixels.
+
+*******************************************************************************/
+
+void pa_settabg(FILE* f, int t)
+
+{
+
+    scnptr sc = updscn();
+    int    i, j;
+
+    if (t < 1 || t > maxxg) error("Invalid tab position");
+    for (i = 0; i < MAXTAB && sc->tab[i] && sc->tab[i] < t; i++);
+    if (i < MAXTAB && sc->tab[i] == t) return; /* already set */
+    if (sc->tab[MAXTAB-1]) error("Tab table full");
+    for (j = MAXTAB-1; j > i; j--) sc->tab[j] = sc->tab[j-1];
+    sc->tab[i] = t;
+
+}
+
+void pa_restabg(FILE* f, int t)
+
+{
+
+    scnptr sc = updscn();
+    int    i;
+
+    for (i = 0; i < MAXTAB && sc->tab[i] && sc->tab[i] != t; i++);
+    if (i < MAXTAB && sc->tab[i] == t) {
+
+        for (; i < MAXTAB-1; i++) sc->tab[i] = sc->tab[i+1];
+        sc->tab[MAXTAB-1] = 0;
+
+    }
+
+}
+
+void pa_settab(FILE* f, int t) { pa_settabg(f, (t-1)*charw+1); }
+void pa_restab(FILE* f, int t) { pa_restabg(f, (t-1)*charw+1); }
+
+void pa_clrtab(FILE* f)
+
+{
+
+    int i;
+
+    for (i = 0; i < MAXTAB; i++) updscn()->tab[i] = 0;
+
+}
+
+/** ****************************************************************************
+
+Write string
+
+Writes a string, or a counted string, to the window.
+
+*******************************************************************************/
+
+void pa_wrtstr(FILE* f, char* s)
+
+{
+
+    scnptr sc = updscn();
+
+    while (*s) plcchr(sc, *s++);
+
+}
+
+void pa_wrtstrn(FILE* f, char* s, int n)
+
+{
+
+    scnptr sc = updscn();
+
+    while (n-- > 0) plcchr(sc, *s++);
+
+}
+
+/** ****************************************************************************
+
+Size buffer
+
+Sets the size of the screen buffers, in characters or pixels.
+
+*******************************************************************************/
+
+void pa_sizbuf(FILE* f, int x, int y) { isizbufg(x*charw, y*charh); }
+void pa_sizbufg(FILE* f, int x, int y) { isizbufg(x, y); }
+
+/*******************************************************************************
+
+Graphical level
+
+*******************************************************************************/
+
+/** ****************************************************************************
+
+Lines and figures
+
+Draws lines, outlines and filled figures in the foreground color and mode.
+
+*******************************************************************************/
+
+void pa_line(FILE* f, int x1, int y1, int x2, int y2)
+
+{
+
+    iline(updscn(), x1, y1, x2, y2);
+
+}
+
+void pa_linewidth(FILE* f, int w)
+
+{
+
+    if (w < 1) error("Invalid line width");
+    updscn()->lwidth = w;
+
+}
+
+void pa_rect(FILE* f, int x1, int y1, int x2, int y2)
+
+{
+
+    drwshape(updscn(), x1, y1, x2, y2, 0.0, 0.0, FALSE, NULL);
+
+}
+
+void pa_frect(FILE* f, int x1, int y1, int x2, int y2)
+
+{
+
+    drwshape(updscn(), x1, y1, x2, y2, 0.0, 0.0, TRUE, NULL);
+
+}
+
+void pa_rrect(FILE* f, int x1, int y1, int x2, int y2, int xs, int ys)
+
+{
+
+    drwshape(updscn(), x1, y1, x2, y2, xs/2.0, ys/2.0, FALSE, NULL);
+
+}
+
+void pa_frrect(FILE* f, int x1, int y1, int x2, int y2, int xs, int ys)
+
+{
+
+    drwshape(updscn(), x1, y1, x2, y2, xs/2.0, ys/2.0, TRUE, NULL);
+
+}
+
+void pa_ellipse(FILE* f, int x1, int y1, int x2, int y2)
+
+{
+
+    drwshape(updscn(), x1, y1, x2, y2, INT_MAX, INT_MAX, FALSE, NULL);
+
+}
+
+void pa_fellipse(FILE* f, int x1, int y1, int x2, int y2)
+
+{
+
+    drwshape(updscn(), x1, y1, x2, y2, INT_MAX, INT_MAX, TRUE, NULL);
+
+}
+
+void pa_arc(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
+
+{
+
+    arcflt af;
+
+    setarc(&af, x1, y1, x2, y2, sa, ea, FALSE);
+    drwshape(updscn(), x1, y1, x2, y2, INT_MAX, INT_MAX, FALSE, &af);
+
+}
+
+void pa_farc(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
+
+{
+
+    arcflt af;
+
+    setarc(&af, x1, y1, x2, y2, sa, ea, FALSE);
+    drwshape(updscn(), x1, y1, x2, y2, INT_MAX, INT_MAX, TRUE, &af);
+
+}
+
+void pa_fchord(FILE* f, int x1, int y1, int x2, int y2, int sa, int ea)
+
+{
+
+    arcflt af;
+
+    setarc(&af, x1, y1, x2, y2, sa, ea, TRUE);
+    drwshape(updscn(), x1, y1, x2, y2, INT_MAX, INT_MAX, TRUE, &af);
+
+}
+
+void pa_ftriangle(FILE* f, int x1, int y1, int x2, int y2, int x3, int y3)
+
+{
+
+    itriangle(updscn(), x1, y1, x2, y2, x3, y3);
+
+}
+
+void pa_setpixel(FILE* f, int x, int y)
+
+{
+
+    scnptr sc = updscn();
+
+    putpix(sc, x, y, sc->fcrgb, sc->fmod);
+
+}
+
+/** ****************************************************************************
+
+Mix modes
+
+Sets the foreground and background mix modes.
+
+*******************************************************************************/
+
+void pa_fover(FILE* f) { updscn()->fmod = mdnorm; }
+void pa_bover(FILE* f) { updscn()->bmod = mdnorm; }
+void pa_finvis(FILE* f) { updscn()->fmod = mdinvis; }
+void pa_binvis(FILE* f) { updscn()->bmod = mdinvis; }
+void pa_fxor(FILE* f) { updscn()->fmod = mdxor; }
+void pa_bxor(FILE* f) { updscn()->bmod = mdxor; }
+void pa_fand(FILE* f) { updscn()->fmod = mdand; }
+void pa_band(FILE* f) { updscn()->bmod = mdand; }
+void pa_for(FILE* f) { updscn()->fmod = mdor; }
+void pa_bor(FILE* f) { updscn()->bmod = mdor; }
+
+/** ****************************************************************************
+
+Fonts
+
+There is one built-in font. The standard font codes all select it, and size
+changes are ignored. Character spacing is applied to the character cell.
+
+*******************************************************************************/
+
+int pa_chrsizx(FILE* f) { return charw; }
+int pa_chrsizy(FILE* f) { return charh; }
+int pa_fonts(FILE* f) { return 4; }
+void pa_fontsiz(FILE* f, int s) { }
+int pa_dpmx(FILE* f) { return DPM; }
+int pa_dpmy(FILE* f) { return DPM; }
+
+void pa_font(FILE* f, int fc)
+
+{
+
+    if (fc < 1 || fc > 4) error("Invalid font code");
+
+}
+
+void pa_fontnam(FILE* f, int fc, char* fns, int fnsl)
+
+{
+
+    if (fc < 1 || fc > 4) error("Invalid font code");
+    if ((int)strlen(fntnam[fc-1]) >= fnsl) error("String too large");
+    strcpy(fns, fntnam[fc-1]);
+
+}
+
+void pa_chrspcx(FILE* f, int s)
+
+{
+
+    if (s < 0) error("Invalid character spacing");
+    charw = CHRX+s;
+
+}
+
+void pa_chrspcy(FILE* f, int s)
+
+{
+
+    if (s < 0) error("Invalid character spacing");
+    charh = CHRY+s;
+
+}
+
+/** ****************************************************************************
+
+Font effects
+
+The effects without a fixed font equivalent are accepted and ignored.
+
+*******************************************************************************/
+
+void pa_condensed(FILE* f, int e) { }
+void pa_extended(FILE* f, int e) { }
+void pa_xlight(FILE* f, int e) { }
+void pa_light(FILE* f, int e) { }
+void pa_xbold(FILE* f, int e) { setatt(sabold, e); }
+void pa_hollow(FILE* f, int e) { }
+void pa_raised(FILE* f, int e) { }
+
+/** ****************************************************************************
+
+String sizes and justified text
+
+Since the font is fixed pitch, the size of a string is its length times the
+character width. Justified text spreads the extra space over the spaces in the
+string.
+
+*******************************************************************************/
+
+int pa_strsiz(FILE* f, const char* s) { return strlen(s)*charw; }
+
+int pa_chrpos(FILE* f, const char* s, int p)
+
+{
+
+    if (p < 0 || p >= (int)strlen(s)) error("Invalid string index");
+
+    return p*charw;
+
+}
+
+int pa_justpos(FILE* f, const char* s, int p, int n)
+
+{
+
+    int l, sp, ex, i, x;
+
+    l = strlen(s);
+    if (p < 0 || p >= l) error("Invalid string index");
+    ex = n-l*charw; /* extra space */
+    for (sp = 0, i = 0; i < l; i++) if (s[i] == ' ') sp++;
+    if (ex <= 0 || !sp) return p*charw;
+    x = 0;
+    for (i = 0, l = 0; i < p; i++) {
+
+        x += charw;
+        if (s[i] == ' ') { x += ex/sp+(l < ex%sp); l++; }
+
+    }
+
+    return x;
+
+}
+
+void pa_writejust(FILE* f, const char* s, int n)
+
+{
+
+    scnptr sc = updscn();
+    int    l, i, x;
+
+    l = strlen(s);
+    x = sc->curxg; /* start of string */
+    for (i = 0; i < l; i++) {
+
+        sc->curxg = x+pa_justpos(f, s, i, n);
+        drwchr(sc, s[i]);
+
+    }
+    sc->curxg = x+(n > l*charw ? n : l*charw);
+
+}
+
+/** ****************************************************************************
+
+Text path
+
+Only left to right text is drawn. The path is recorded.
+
+*******************************************************************************/
+
+void pa_path(FILE* f, int a) { txtpth = a; }
+
+/** ****************************************************************************
+
+Pictures
+
+Loads .bmp pictures, and draws them scaled to fit a rectangle using the
+foreground mix mode.
+
+*******************************************************************************/
+
+void pa_loadpict(FILE* f, int p, char* fn)
+
+{
+
+    char fnh[PATH_MAX];
+
+    if (p < 1 || p > MAXPIC) error("Invalid picture number");
+    if (pictbl[p-1].buf) pa_delpict(f, p);
+    if (strlen(fn) >= PATH_MAX-4) error("Filename too large");
+    strcpy(fnh, fn);
+    if (!strchr(strrchr(fnh, '/') ? strrchr(fnh, '/') : fnh, '.'))
+        strcat(fnh, ".bmp");
+    loadbmp(&pictbl[p-1], fnh);
+
+}
+
+int pa_pictsizx(FILE* f, int p)
+
+{
+
+    if (p < 1 || p > MAXPIC || !pictbl[p-1].buf)
+        error("Invalid picture number");
+
+    return pictbl[p-1].x;
+
+}
+
+int pa_pictsizy(FILE* f, int p)
+
+{
+
+    if (p < 1 || p > MAXPIC || !pictbl[p-1].buf)
+        error("Invalid picture number");
+
+    return pictbl[p-1].y;
+
+}
+
+void pa_picture(FILE* f, int p, int x1, int y1, int x2, int y2)
+
+{
+
+    scnptr sc = updscn();
+    pict*  pp;
+    int    x, y, t, w, h;
+
+    if (p < 1 || p > MAXPIC || !pictbl[p-1].buf)
+        error("Invalid picture number");
+    pp = &pictbl[p-1];
+    if (x1 > x2) { t = x1; x1 = x2; x2 = t; }
+    if (y1 > y2) { t = y1; y1 = y2; y2 = t; }
+    w = x2-x1+1;
+    h = y2-y1+1;
+    for (y = y1 < 1 ? 1 : y1; y <= y2 && y <= maxyg; y++)
+        for (x = x1 < 1 ? 1 : x1; x <= x2 && x <= maxxg; x++)
+            putpix(sc, x, y, pp->buf[(long)(y-y1)*pp->y/h*pp->x+
+                                     (long)(x-x1)*pp->x/w], sc->fmod);
+
+}
+
+void pa_delpict(FILE* f, int p)
+
+{
+
+    if (p < 1 || p > MAXPIC || !pictbl[p-1].buf)
+        error("Invalid picture number");
+    free(pictbl[p-1].buf);
+    pictbl[p-1].buf = NULL;
+
+}
+
+/*******************************************************************************
+
+Window management
+
+There is only the one window, the size of the buffer, with no frame. Calls that
+only affect how the window appears on a desktop are accepted and ignored.
+
+*******************************************************************************/
+
+void pa_openwin(FILE** infile, FILE** outfile, FILE* parent, int wid)
+
+{
+
+    error("pa_openwin: Only one window is available offscreen");
+
+}
+
+void pa_buffer(FILE* f, int e) { bufmod = !!e; }
+void pa_title(FILE* f, char* ts) { }
+void pa_setpos(FILE* f, int x, int y) { }
+void pa_setposg(FILE* f, int x, int y) { }
+void pa_front(FILE* f) { }
+void pa_back(FILE* f) { }
+void pa_frame(FILE* f, int e) { }
+void pa_sizable(FILE* f, int e) { }
+void pa_sysbar(FILE* f, int e) { }
+void pa_focus(FILE* f) { }
+int pa_getwinid(void) { return winids++; }
+
+void pa_getsiz(FILE* f, int* x, int* y) { *x = maxxg/charw; *y = maxyg/charh; }
+void pa_getsizg(FILE* f, int* x, int* y) { *x = maxxg; *y = maxyg; }
+void pa_setsiz(FILE* f, int x, int y) { isizbufg(x*charw, y*charh); }
+void pa_setsizg(FILE* f, int x, int y) { isizbufg(x, y); }
+void pa_scnsiz(FILE* f, int* x, int* y) { pa_getsiz(f, x, y); }
+void pa_scnsizg(FILE* f, int* x, int* y) { pa_getsizg(f, x, y); }
+
+void pa_scncen(FILE* f, int* x, int* y)
+
+{
+
+    *x = maxxg/charw/2;
+    *y = maxyg/charh/2;
+
+}
+
+void pa_scnceng(FILE* f, int* x, int* y)
+
+{
+
+    *x = maxxg/2;
+    *y = maxyg/2;
+
+}
+
+void pa_winclient(FILE* f, int cx, int cy, int* wx, int* wy, pa_winmodset ms)
+
+{
+
+    *wx = cx;
+    *wy = cy;
+
+}
+
+void pa_winclientg(FILE* f, int cx, int cy, int* wx, int* wy, pa_winmodset ms)
+
+{
+
+    *wx = cx;
+    *wy = cy;
+
+}
+
+/*******************************************************************************
+
+Menus, widgets and dialogs
+
+None of these are rendered offscreen. Menus are accepted and ignored, since
+they can never be selected. The rest are errors.
+
+*******************************************************************************/
+
+#define NOTOFF(n) error(n ": Is not available offscreen")
+
+void pa_menu(FILE* f, pa_menuptr m) { }
+void pa_menuena(FILE* f, int id, int onoff) { }
+void pa_menusel(FILE* f, int id, int select) { }
+void pa_stdmenu(pa_stdmenusel sms, pa_menuptr* sm, pa_menuptr pm) { NOTOFF("pa_stdmenu"); }
+int pa_getwigid(FILE* f) { NOTOFF("pa_getwigid"); return 0; }
+void pa_killwidget(FILE* f, int id) { NOTOFF("pa_killwidget"); }
+void pa_selectwidget(FILE* f, int id, int e) { NOTOFF("pa_selectwidget"); }
+void pa_enablewidget(FILE* f, int id, int e) { NOTOFF("pa_enablewidget"); }
+void pa_getwidgettext(FILE* f, int id, char* s, int sl) { NOTOFF("pa_getwidgettext"); }
+void pa_putwidgettext(FILE* f, int id, char* s) { NOTOFF("pa_putwidgettext"); }
+void pa_sizwidget(FILE* f, int id, int x, int y) { NOTOFF("pa_sizwidget"); }
+void pa_sizwidgetg(FILE* f, int id, int x, int y) { NOTOFF("pa_sizwidgetg"); }
+void pa_poswidget(FILE* f, int id, int x, int y) { NOTOFF("pa_poswidget"); }
+void pa_poswidgetg(FILE* f, int id, int x, int y) { NOTOFF("pa_poswidgetg"); }
+void pa_backwidget(FILE* f, int id) { NOTOFF("pa_backwidget"); }
+void pa_frontwidget(FILE* f, int id) { NOTOFF("pa_frontwidget"); }
+void pa_focuswidget(FILE* f, int id) { NOTOFF("pa_focuswidget"); }
+void pa_buttonsiz(FILE* f, char* s, int* w, int* h) { NOTOFF("pa_buttonsiz"); }
+void pa_buttonsizg(FILE* f, char* s, int* w, int* h) { NOTOFF("pa_buttonsizg"); }
+void pa_button(FILE* f, int x1, int y1, int x2, int y2, char* s, int id) { NOTOFF("pa_button"); }
+void pa_buttong(FILE* f, int x1, int y1, int x2, int y2, char* s, int id) { NOTOFF("pa_buttong"); }
+void pa_checkboxsiz(FILE* f, char* s, int* w, int* h) { NOTOFF("pa_checkboxsiz"); }
+void pa_checkboxsizg(FILE* f, char* s, int* w, int* h) { NOTOFF("pa_checkboxsizg"); }
+void pa_checkbox(FILE* f, int x1, int y1, int x2, int y2, char* s, int id) { NOTOFF("pa_checkbox"); }
+void pa_checkboxg(FILE* f, int x1, int y1, int x2, int y2, char* s, int id) { NOTOFF("pa_checkboxg"); }
+void pa_radiobuttonsiz(FILE* f, char* s, int* w, int* h) { NOTOFF("pa_radiobuttonsiz"); }
+void pa_radiobuttonsizg(FILE* f, char* s, int* w, int* h) { NOTOFF("pa_radiobuttonsizg"); }
+void pa_radiobutton(FILE* f, int x1, int y1, int x2, int y2, char* s, int id) { NOTOFF("pa_radiobutton"); }
+void pa_radiobuttong(FILE* f, int x1, int y1, int x2, int y2, char* s, int id) { NOTOFF("pa_radiobuttong"); }
+void pa_groupsizg(FILE* f, char* s, int cw, int ch, int* w, int* h, int* ox, int* oy) { NOTOFF("pa_groupsizg"); }
+void pa_groupsiz(FILE* f, char* s, int cw, int ch, int* w, int* h, int* ox, int* oy) { NOTOFF("pa_groupsiz"); }
+void pa_group(FILE* f, int x1, int y1, int x2, int y2, char* s, int id) { NOTOFF("pa_group"); }
+void pa_groupg(FILE* f, int x1, int y1, int x2, int y2, char* s, int id) { NOTOFF("pa_groupg"); }
+void pa_background(FILE* f, int x1, int y1, int x2, int y2, int id) { NOTOFF("pa_background"); }
+void pa_backgroundg(FILE* f, int x1, int y1, int x2, int y2, int id) { NOTOFF("pa_backgroundg"); }
+void pa_scrollvertsizg(FILE* f, int* w, int* h) { NOTOFF("pa_scrollvertsizg"); }
+void pa_scrollvertsiz(FILE* f, int* w, int* h) { NOTOFF("pa_scrollvertsiz"); }
+void pa_scrollvert(FILE* f, int x1, int y1, int x2, int y2, int id) { NOTOFF("pa_scrollvert"); }
+void pa_scrollvertg(FILE* f, int x1, int y1, int x2, int y2, int id) { NOTOFF("pa_scrollvertg"); }
+void pa_scrollhorizsizg(FILE* f, int* w, int* h) { NOTOFF("pa_scrollhorizsizg"); }
+void pa_scrollhorizsiz(FILE* f, int* w, int* h) { NOTOFF("pa_scrollhorizsiz"); }
+void pa_scrollhoriz(FILE* f, int x1, int y1, int x2, int y2, int id) { NOTOFF("pa_scrollhoriz"); }
+void pa_scrollhorizg(FILE* f, int x1, int y1, int x2, int y2, int id) { NOTOFF("pa_scrollhorizg"); }
+void pa_scrollpos(FILE* f, int id, int r) { NOTOFF("pa_scrollpos"); }
+void pa_scrollsiz(FILE* f, int id, int r) { NOTOFF("pa_scrollsiz"); }
+void pa_numselboxsizg(FILE* f, int l, int u, int* w, int* h) { NOTOFF("pa_numselboxsizg"); }
+void pa_numselboxsiz(FILE* f, int l, int u, int* w, int* h) { NOTOFF("pa_numselboxsiz"); }
+void pa_numselbox(FILE* f, int x1, int y1, int x2, int y2, int l, int u, int id) { NOTOFF("pa_numselbox"); }
+void pa_numselboxg(FILE* f, int x1, int y1, int x2, int y2, int l, int u, int id) { NOTOFF("pa_numselboxg"); }
+void pa_editboxsizg(FILE* f, char* s, int* w, int* h) { NOTOFF("pa_editboxsizg"); }
+void pa_editboxsiz(FILE* f, char* s, int* w, int* h) { NOTOFF("pa_editboxsiz"); }
+void pa_editbox(FILE* f, int x1, int y1, int x2, int y2, int id) { NOTOFF("pa_editbox"); }
+void pa_editboxg(FILE* f, int x1, int y1, int x2, int y2, int id) { NOTOFF("pa_editboxg"); }
+void pa_progbarsizg(FILE* f, int* w, int* h) { NOTOFF("pa_progbarsizg"); }
+void pa_progbarsiz(FILE* f, int* w, int* h) { NOTOFF("pa_progbarsiz"); }
+void pa_progbar(FILE* f, int x1, int y1, int x2, int y2, int id) { NOTOFF("pa_progbar"); }
+void pa_progbarg(FILE* f, int x1, int y1, int x2, int y2, int id) { NOTOFF("pa_progbarg"); }
+void pa_progbarpos(FILE* f, int id, int pos) { NOTOFF("pa_progbarpos"); }
+void pa_listboxsizg(FILE* f, pa_strptr sp, int* w, int* h) { NOTOFF("pa_listboxsizg"); }
+void pa_listboxsiz(FILE* f, pa_strptr sp, int* w, int* h) { NOTOFF("pa_listboxsiz"); }
+void pa_listbox(FILE* f, int x1, int y1, int x2, int y2, pa_strptr sp, int id) { NOTOFF("pa_listbox"); }
+void pa_listboxg(FILE* f, int x1, int y1, int x2, int y2, pa_strptr sp, int id) { NOTOFF("pa_listboxg"); }
+void pa_dropboxsizg(FILE* f, pa_strptr sp, int* cw, int* ch, int* ow, int* oh) { NOTOFF("pa_dropboxsizg"); }
+void pa_dropboxsiz(FILE* f, pa_strptr sp, int* cw, int* ch, int* ow, int* oh) { NOTOFF("pa_dropboxsiz"); }
+void pa_dropbox(FILE* f, int x1, int y1, int x2, int y2, pa_strptr sp, int id) { NOTOFF("pa_dropbox"); }
+void pa_dropboxg(FILE* f, int x1, int y1, int x2, int y2, pa_strptr sp, int id) { NOTOFF("pa_dropboxg"); }
+void pa_dropeditboxsizg(FILE* f, pa_strptr sp, int* cw, int* ch, int* ow, int* oh) { NOTOFF("pa_dropeditboxsizg"); }
+void pa_dropeditboxsiz(FILE* f, pa_strptr sp, int* cw, int* ch, int* ow, int* oh) { NOTOFF("pa_dropeditboxsiz"); }
+void pa_dropeditbox(FILE* f, int x1, int y1, int x2, int y2, pa_strptr sp, int id) { NOTOFF("pa_dropeditbox"); }
+void pa_dropeditboxg(FILE* f, int x1, int y1, int x2, int y2, pa_strptr sp, int id) { NOTOFF("pa_dropeditboxg"); }
+void pa_slidehorizsizg(FILE* f, int* w, int* h) { NOTOFF("pa_slidehorizsizg"); }
+void pa_slidehorizsiz(FILE* f, int* w, int* h) { NOTOFF("pa_slidehorizsiz"); }
+void pa_slidehoriz(FILE* f, int x1, int y1, int x2, int y2, int mark, int id) { NOTOFF("pa_slidehoriz"); }
+void pa_slidehorizg(FILE* f, int x1, int y1, int x2, int y2, int mark, int id) { NOTOFF("pa_slidehorizg"); }
+void pa_slidevertsizg(FILE* f, int* w, int* h) { NOTOFF("pa_slidevertsizg"); }
+void pa_slidevertsiz(FILE* f, int* w, int* h) { NOTOFF("pa_slidevertsiz"); }
+void pa_slidevert(FILE* f, int x1, int y1, int x2, int y2, int mark, int id) { NOTOFF("pa_slidevert"); }
+void pa_slidevertg(FILE* f, int x1, int y1, int x2, int y2, int mark, int id) { NOTOFF("pa_slidevertg"); }
+void pa_tabbarsizg(FILE* f, pa_tabori tor, int cw, int ch, int* w, int* h, int* ox, int* oy) { NOTOFF("pa_tabbarsizg"); }
+void pa_tabbarsiz(FILE* f, pa_tabori tor, int cw, int ch, int* w, int* h, int* ox, int* oy) { NOTOFF("pa_tabbarsiz"); }
+void pa_tabbarclientg(FILE* f, pa_tabori tor, int w, int h, int* cw, int* ch, int* ox, int* oy) { NOTOFF("pa_tabbarclientg"); }
+void pa_tabbarclient(FILE* f, pa_tabori tor, int w, int h, int* cw, int* ch, int* ox, int* oy) { NOTOFF("pa_tabbarclient"); }
+void pa_tabbar(FILE* f, int x1, int y1, int x2, int y2, pa_strptr sp, pa_tabori tor, int id) { NOTOFF("pa_tabbar"); }
+void pa_tabbarg(FILE* f, int x1, int y1, int x2, int y2, pa_strptr sp, pa_tabori tor, int id) { NOTOFF("pa_tabbarg"); }
+void pa_tabsel(FILE* f, int id, int tn) { NOTOFF("pa_tabsel"); }
+void pa_alert(char* title, char* message) { NOTOFF("pa_alert"); }
+void pa_querycolor(int* r, int* g, int* b) { NOTOFF("pa_querycolor"); }
+void pa_queryopen(char* s, int sl) { NOTOFF("pa_queryopen"); }
+void pa_querysave(char* s, int sl) { NOTOFF("pa_querysave"); }
+void pa_queryfind(char* s, int sl, pa_qfnopts* opt) { NOTOFF("pa_queryfind"); }
+void pa_queryfindrep(char* s, int sl, char* r, int rl, pa_qfropts* opt) { NOTOFF("pa_queryfindrep"); }
+void pa_queryfont(FILE* f, int* fc, int* s, int* fr, int* fg, int* fb, int* br, int* bg, int* bb, pa_qfteffects* effect) { NOTOFF("pa_queryfont"); }
+
+/*******************************************************************************
+
+Statistics
+
+There is no server to measure offscreen, so no statistics are kept.
+
+*******************************************************************************/
+
+unsigned long long pa_getstat(FILE* f, const char* n) { return 0; }
+void pa_prtstats(FILE* fp) { }
+
+/** ****************************************************************************
+
+Offscreen startup
+
+Sets up the first screen at the default size, and takes over standard output.
+
+*******************************************************************************/
+
+static void pa_init_offscreen(void) __attribute__((constructor (102)));
+static void pa_init_offscreen()
+
+{
+
+    char* s;
+    int   e;
+
+    charw = CHRX;
+    charh = CHRY;
+    maxxg = MAXXD*CHRX;
+    maxyg = MAXYD*CHRY;
+    bufmod = TRUE;
+    txtpth = 0;
+    vclk = 0;
+    evtcnt = 0;
+    redraw = TRUE;
+    winids = 2; /* stdin/stdout window is 1 */
+    sevin = 0;
+    sevout = 0;
+    sevcnt = 0;
+    evtlim = EVTLIM;
+    s = getenv("PA_OFFSCREEN_EVENTS");
+    if (s && atol(s) > 0) evtlim = atol(s);
+    for (e = 0; e < MAXCON; e++) screens[e] = NULL;
+    for (e = 0; e < MAXPIC; e++) pictbl[e].buf = NULL;
+    for (e = 0; e < PA_MAXTIM; e++) timtbl[e].act = FALSE;
+    frmtim.act = FALSE;
+    frmtim.rep = TRUE;
+    frmtim.per = FRMTIM;
+    evtshan = defaultevent;
+    for (e = pa_etchar; e <= pa_ettabbar; e++) evthan[e] = defaultevent;
+    screens[0] = imalloc(sizeof(scncon));
+    iniscn(screens[0]);
+    curupd = 1;
+    curdsp = 1;
+
+    /* turn off output buffering so text reaches the surface in order */
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    /* override system calls for basic I/O */
+    ovr_write(iwrite, &ofpwrite);
+
+}
+
+/** ****************************************************************************
+
+Offscreen shutdown
+
+Saves the display screen if requested, and releases everything.
+
+*******************************************************************************/
+
+static void pa_deinit_offscreen(void) __attribute__((destructor (102)));
+static void pa_deinit_offscreen()
+
+{
+
+    pwrite_t cppwrite;
+    char*    s;
+    int      i;
+
+    s = getenv("PA_OFFSCREEN_OUT");
+    if (s && *s) savebmp(screens[curdsp-1], s);
+
+    /* swap old vector for existing vector */
+    ovr_write(ofpwrite, &cppwrite);
+    /* if we don't see our own vector flag an error */
+    if (cppwrite != iwrite) error("System fault");
+
+    for (i = 0; i < MAXCON; i++) if (screens[i]) {
+
+        free(screens[i]->buf);
+        free(screens[i]);
+        screens[i] = NULL;
+
+    }
+    for (i = 0; i < MAXPIC; i++) if (pictbl[i].buf) free(pictbl[i].buf);
+
+}
@@ -3525,3 +3525,113 @@ void pa_queryfont(FILE* f, int* fc, int* s, int* fr, int* fg, int* fb,
     error("pa_queryfont: Is not implemented");
 
 }
+
+/*******************************************************************************
+
+Save drawing state
+
+Saves the drawing state of the current update screen on a stack for the window.
+It is restored by pa_popstate().
+
+*******************************************************************************/
+
+void _pa_pushstate_ovr(pa_pushstate_t nfp, pa_pushstate_t* ofp)
+
+{
+
+    error("_pa_pushstate_ovr: Is not implemented");
+
+}
+
+void pa_pushstate(FILE* f)
+
+{
+
+    error("pa_pushstate: Is not implemented");
+
+}
+
+/*******************************************************************************
+
+Restore drawing state
+
+Restores the last drawing state saved by pa_pushstate(), and removes it from
+the stack.
+
+*******************************************************************************/
+
+void _pa_popstate_ovr(pa_popstate_t nfp, pa_popstate_t* ofp)
+
+{
+
+    error("_pa_popstate_ovr: Is not implemented");
+
+}
+
+void pa_popstate(FILE* f)
+
+{
+
+    error("pa_popstate: Is not implemented");
+
+}
+
+/*******************************************************************************
+
+Find window id
+
+Returns the logical window id of the window attached to the given file.
+
+*******************************************************************************/
+
+void _pa_winid_ovr(pa_winid_t nfp, pa_winid_t* ofp)
+
+{
+
+    error("_pa_winid_ovr: Is not implemented");
+
+}
+
+int pa_winid(FILE* f)
+
+{
+
+    error("pa_winid: Is not implemented");
+
+    return (1); /* this just shuts up compiler */
+
+}
+
+/*******************************************************************************
+
+Get statistic
+
+Returns the value of a statistic by name.
+
+*******************************************************************************/
+
+unsigned long long pa_getstat(FILE* f, const char* n)
+
+{
+
+    error("pa_getstat: Is not implemented");
+
+    return (1); /* this just shuts up compiler */
+
+}
+
+/*******************************************************************************
+
+Print statistics
+
+Prints all of the statistics to the given file.
+
+*******************************************************************************/
+
+void pa_prtstats(FILE* fp)
+
+{
+
+    error("pa_prtstats: Is not implemented");
+
+}
@@ -1421,6 +1421,23 @@ void pa_wrsynth(int p, pa_seqptr sp)
 
 /*******************************************************************************
 
+Write synthesizer port list
+
+Writes a list of sequencer instruction entries, linked by their next fields, to
+the given output port.
+
+*******************************************************************************/
+
+void pa_wrsynthlst(int p, pa_seqptr sp)
+
+{
+
+    error("pa_wrsynthlst: Is not implemented");
+
+}
+
+/*******************************************************************************
+
 Read synthesizer port
 
 Reads and parses a midi instruction record from the given input port. ALSA midi
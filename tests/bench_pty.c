@@ -0,0 +1,194 @@
+/*******************************************************************************
+
+Terminal benchmark pseudo terminal sink
+
+Runs the terminal rendering benchmark, bench_term, on a pseudo terminal of fixed
+size, and prints its report. The output of the benchmark is read and thrown
+away as fast as it arrives, so the results measure the terminal library and not
+the terminal emulator that would otherwise be displaying it.
+
+Format:
+
+bench_pty [--x=<n>|--y=<n>] <program> [<option>...]
+
+The options are:
+
+--x=<n>
+
+Set the width of the pseudo terminal in characters (default 80).
+
+--y=<n>
+
+Set the height of the pseudo terminal in lines (default 25).
+
+The program is run with the pseudo terminal as its controlling terminal and
+standard input, output and error. The options following the program are passed
+to it, with a --report option added that gives the file the report is to be
+written to. The total number of bytes read from the pseudo terminal is printed
+after the report.
+
+The exit code is that of the benchmark, or 1 if it could not be run.
+
+*******************************************************************************/
+
+#define _XOPEN_SOURCE 600
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <localdefs.h>
+#include <option.h>
+
+#define MAXARG 100  /* maximum arguments to the benchmark */
+#define SNKBUF 65536 /* size of sink buffer */
+
+int dimx = 80; /* size of pseudo terminal */
+int dimy = 25;
+
+pa_optrec opttbl[] = {
+
+    { "x", NULL, &dimx, NULL, NULL },
+    { "y", NULL, &dimy, NULL, NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+
+};
+
+static char snkbuf[SNKBUF]; /* sink for terminal output */
+
+int main(int argc, char **argv)
+
+{
+
+    int            argi = 1;
+    int            mfd;  /* pseudo terminal master */
+    int            sfd;  /* pseudo terminal slave */
+    int            rfd[2]; /* report pipe */
+    struct winsize ws;
+    pid_t          pid;
+    char*          args[MAXARG+2];
+    char           repopt[40];
+    int            i;
+    struct pollfd  pfd[2];
+    ssize_t        l;
+    long           total; /* total bytes from terminal */
+    int            rdone; /* report has ended */
+    int            status;
+
+    /* parse user options */
+    if (pa_options(&argi, &argc, argv, opttbl, TRUE) || argc < 2 ||
+        argc > MAXARG || dimx < 1 || dimy < 1) {
+
+        fprintf(stderr,
+            "Usage: bench_pty [--x=<n>|--y=<n>] <program> [<option>...]\n");
+
+        exit(1);
+
+    }
+
+    /* open pseudo terminal and set its size */
+    mfd = posix_openpt(O_RDWR|O_NOCTTY);
+    if (mfd < 0 || grantpt(mfd) || unlockpt(mfd)) {
+
+        fprintf(stderr, "bench_pty: Cannot open pseudo terminal\n");
+        exit(1);
+
+    }
+    memset(&ws, 0, sizeof(ws));
+    ws.ws_col = dimx;
+    ws.ws_row = dimy;
+    ioctl(mfd, TIOCSWINSZ, &ws);
+    if (pipe(rfd)) {
+
+        fprintf(stderr, "bench_pty: Cannot open report pipe\n");
+        exit(1);
+
+    }
+
+    /* form argument list for the benchmark */
+    for (i = 0; i < argc-1; i++) args[i] = argv[argi+i];
+    sprintf(repopt, "--report=%d", rfd[1]);
+    args[i++] = repopt;
+    args[i] = NULL;
+
+    pid = fork();
+    if (pid < 0) {
+
+        fprintf(stderr, "bench_pty: Cannot start process\n");
+        exit(1);
+
+    }
+    if (!pid) { /* child, run benchmark on the slave */
+
+        setsid(); /* make pseudo terminal the controlling terminal */
+        sfd = open(ptsname(mfd), O_RDWR);
+        if (sfd < 0) _exit(1);
+        ioctl(sfd, TIOCSCTTY, 0);
+        dup2(sfd, 0);
+        dup2(sfd, 1);
+        dup2(sfd, 2);
+        if (sfd > 2) close(sfd);
+        close(mfd);
+        close(rfd[0]);
+        execvp(args[0], args);
+        _exit(1);
+
+    }
+    close(rfd[1]);
+
+    /* drain the terminal and copy the report until the report ends */
+    total = 0;
+    rdone = FALSE;
+    while (!rdone) {
+
+        pfd[0].fd = mfd;
+        pfd[0].events = POLLIN;
+        pfd[1].fd = rfd[0];
+        pfd[1].events = POLLIN;
+        if (poll(pfd, 2, -1) < 0) {
+
+            if (errno == EINTR) continue;
+            break;
+
+        }
+        if (pfd[0].revents & POLLIN) {
+
+            l = read(mfd, snkbuf, SNKBUF);
+            if (l > 0) total += l;
+
+        }
+        if (pfd[1].revents & (POLLIN|POLLHUP)) {
+
+            l = read(rfd[0], snkbuf, SNKBUF);
+            if (l > 0) fwrite(snkbuf, 1, l, stdout);
+            else rdone = TRUE; /* benchmark closed report */
+
+        }
+
+    }
+    fflush(stdout);
+
+    /* drain anything left until the benchmark exits */
+    fcntl(mfd, F_SETFL, fcntl(mfd, F_GETFL)|O_NONBLOCK);
+    while (waitpid(pid, &status, WNOHANG) == 0) {
+
+        l = read(mfd, snkbuf, SNKBUF);
+        if (l > 0) total += l;
+        else usleep(1000);
+
+    }
+    while ((l = read(mfd, snkbuf, SNKBUF)) > 0) total += l;
+    printf("terminal bytes %ld\n", total);
+    if (!WIFEXITED(status) || WEXITSTATUS(status))
+        fprintf(stderr, "bench_pty: Benchmark did not complete\n");
+
+    return (WIFEXITED(status) ? WEXITSTATUS(status) : 1);
+
+}
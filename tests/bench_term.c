@@ -0,0 +1,499 @@
+/*******************************************************************************
+
+Terminal rendering benchmark
+
+Runs a series of timed rendering loads against the terminal API, and reports
+for each the number of bytes and write calls sent to the terminal, the CPU time
+used, and the median and 99th percentile time taken per iteration.
+
+This program does the drawing only. It is normally started by bench_pty, which
+runs it on a pseudo terminal of fixed size, drains the output, and collects the
+report. Run that way, the results do not depend on the speed of a real terminal
+emulator, and can be compared between builds.
+
+Format:
+
+bench_term [--iterations=<n>|--i=<n>|--scroll=<n>|--s=<n>|--windows=<n>|--w=<n>|
+            --managed|--m|--report=<fd>|--r=<fd>]
+
+The options are:
+
+--iterations=<n> or --i=<n>
+
+Set the number of timed iterations of each load (default 200).
+
+--scroll=<n> or --s=<n>
+
+Set the number of lines to scroll by in the scroll load (default 1).
+
+--windows=<n> or --w=<n>
+
+Set the number of overlapping windows in the window drag load (default 4).
+
+--managed or --m
+
+The terminal library was built with the character window manager. This enables
+the window drag load, and causes each iteration to end with an event cycle, which
+is where the manager draws to the terminal.
+
+--report=<fd> or --r=<fd>
+
+Set the file number the report is written to. The default is the standard
+error.
+
+The loads are:
+
+repaint   Write every character on the screen.
+scroll    Scroll the screen up by N lines.
+random    Write 256 characters in random colors at random locations.
+color     Write every character on the screen, changing the colors every 8
+          characters.
+select    Flip the display between two screen buffers.
+drag      Move the top of K overlapping windows one character (managed only).
+
+Bytes and write calls are taken from /proc/self/io, and are given as -1 if that
+is not available. A fixed random seed is used, so that each run is the same.
+
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <terminal.h>
+#include <option.h>
+
+#define MAXITR  100000 /* maximum iterations */
+#define MAXWIN  16     /* maximum windows to drag */
+#define RNDCELL 256    /* cells written per random iteration */
+#define COLRUN  8      /* characters per color run */
+#define WINX    30     /* size of drag windows */
+#define WINY    10
+
+int iterations = 200;    /* number of iterations */
+int scrolln = 1;         /* lines to scroll by */
+int windows = 4;         /* number of windows to drag */
+int managed = FALSE;     /* window manager is present */
+int repfd = 2;           /* report file number */
+
+pa_optrec opttbl[] = {
+
+    { "iterations", NULL,     &iterations, NULL, NULL },
+    { "i",          NULL,     &iterations, NULL, NULL },
+    { "scroll",     NULL,     &scrolln,    NULL, NULL },
+    { "s",          NULL,     &scrolln,    NULL, NULL },
+    { "windows",    NULL,     &windows,    NULL, NULL },
+    { "w",          NULL,     &windows,    NULL, NULL },
+    { "managed",    &managed, NULL,        NULL, NULL },
+    { "m",          &managed, NULL,        NULL, NULL },
+    { "report",     NULL,     &repfd,      NULL, NULL },
+    { "r",          NULL,     &repfd,      NULL, NULL },
+    { NULL,         NULL,     NULL,        NULL, NULL }
+
+};
+
+/* process I/O counts */
+typedef struct {
+
+    long wchar; /* bytes written */
+    long syscw; /* write calls */
+
+} iorec;
+
+/* load to run, with iteration number */
+typedef void (*load_t)(int i);
+
+static double lat[MAXITR]; /* iteration times in microseconds */
+static unsigned long rndseed = 1; /* random number seed */
+static FILE* win[MAXWIN]; /* drag windows */
+static int winx, winy; /* position of top window */
+static int windx; /* direction of drag */
+
+/*******************************************************************************
+
+Find random number
+
+Returns a random number from 0 to n-1. A local generator is used, so that the
+sequence is the same on every system.
+
+*******************************************************************************/
+
+static int rnd(int n)
+
+{
+
+    rndseed = rndseed*1103515245+12345;
+
+    return ((rndseed/65536)%n);
+
+}
+
+/*******************************************************************************
+
+Get time
+
+Returns the monotonic time in microseconds.
+
+*******************************************************************************/
+
+static double gettime(void)
+
+{
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (ts.tv_sec*1000000.0+ts.tv_nsec/1000.0);
+
+}
+
+/*******************************************************************************
+
+Get CPU time
+
+Returns the user and system time used by the process in microseconds.
+
+*******************************************************************************/
+
+static double getcpu(void)
+
+{
+
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+
+    return (ru.ru_utime.tv_sec*1000000.0+ru.ru_utime.tv_usec+
+            ru.ru_stime.tv_sec*1000000.0+ru.ru_stime.tv_usec);
+
+}
+
+/*******************************************************************************
+
+Get I/O counts
+
+Reads the bytes written and write calls for the process. Both are set to -1 if
+the counts are not available.
+
+*******************************************************************************/
+
+static void getio(iorec* io)
+
+{
+
+    int   fd;
+    char  buf[1000];
+    int   l;
+    char* p;
+
+    io->wchar = -1;
+    io->syscw = -1;
+    fd = open("/proc/self/io", O_RDONLY);
+    if (fd >= 0) {
+
+        l = read(fd, buf, sizeof(buf)-1);
+        if (l > 0) {
+
+            buf[l] = 0; /* terminate */
+            p = strstr(buf, "wchar:");
+            if (p) io->wchar = strtol(p+6, NULL, 10);
+            p = strstr(buf, "syscw:");
+            if (p) io->syscw = strtol(p+6, NULL, 10);
+
+        }
+        close(fd);
+
+    }
+
+}
+
+/*******************************************************************************
+
+Compare times
+
+Compare routine for sorting iteration times.
+
+*******************************************************************************/
+
+static int cmptim(const void* a, const void* b)
+
+{
+
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+
+    return ((da > db)-(da < db));
+
+}
+
+/*******************************************************************************
+
+End frame
+
+Makes sure that all output for an iteration has been sent to the terminal. The
+standard output is flushed, and if the window manager is present, an event is
+sent and read back, which lets the manager draw what has changed.
+
+*******************************************************************************/
+
+static void endfrm(void)
+
+{
+
+    pa_evtrec er;
+
+    fflush(stdout);
+    if (managed) {
+
+        er.etype = pa_etuser; /* send ourselves an event */
+        pa_sendevent(stdout, &er);
+        do { pa_event(stdin, &er); } while (er.etype != pa_etuser);
+
+    }
+
+}
+
+/*******************************************************************************
+
+Run load
+
+Runs the given load for the set number of iterations, and writes a line with
+the results to the report file. Setup is not included in the results.
+
+*******************************************************************************/
+
+static void run(char* name, load_t load)
+
+{
+
+    iorec  io1, io2;
+    double cpu;
+    double t;
+    int    i;
+    char   buf[200];
+    int    l;
+
+    getio(&io1);
+    cpu = getcpu();
+    for (i = 0; i < iterations; i++) {
+
+        t = gettime();
+        load(i);
+        endfrm();
+        lat[i] = gettime()-t;
+
+    }
+    cpu = getcpu()-cpu;
+    getio(&io2);
+    qsort(lat, iterations, sizeof(double), cmptim);
+    l = sprintf(buf, "%-8s %8d %12ld %8ld %10.0f %10.1f %10.1f\n",
+                name, iterations,
+                io1.wchar < 0 ? -1L : io2.wchar-io1.wchar,
+                io1.syscw < 0 ? -1L : io2.syscw-io1.syscw,
+                cpu, lat[iterations/2], lat[iterations*99/100]);
+    write(repfd, buf, l);
+
+}
+
+/*******************************************************************************
+
+Fill screen
+
+Writes every character on the screen with the given character.
+
+*******************************************************************************/
+
+static void fill(char c)
+
+{
+
+    int x, y;
+
+    for (y = 1; y <= pa_maxy(stdout); y++) {
+
+        pa_cursor(stdout, 1, y);
+        for (x = 1; x <= pa_maxx(stdout); x++) putchar(c);
+
+    }
+
+}
+
+/*******************************************************************************
+
+Loads
+
+*******************************************************************************/
+
+static void ldrepaint(int i)
+
+{
+
+    fill('a'+i%26);
+
+}
+
+static void ldscroll(int i)
+
+{
+
+    pa_scroll(stdout, 0, scrolln);
+    pa_cursor(stdout, 1, pa_maxy(stdout));
+    printf("line %d", i);
+
+}
+
+static void ldrandom(int i)
+
+{
+
+    int c;
+
+    for (c = 0; c < RNDCELL; c++) {
+
+        pa_cursor(stdout, rnd(pa_maxx(stdout))+1, rnd(pa_maxy(stdout))+1);
+        pa_fcolor(stdout, (pa_color)rnd(8));
+        putchar('a'+rnd(26));
+
+    }
+
+}
+
+static void ldcolor(int i)
+
+{
+
+    int x, y;
+
+    for (y = 1; y <= pa_maxy(stdout); y++) {
+
+        pa_cursor(stdout, 1, y);
+        for (x = 1; x <= pa_maxx(stdout); x++) {
+
+            if ((x-1)%COLRUN == 0) {
+
+                pa_fcolor(stdout, (pa_color)((x/COLRUN+y+i)%8));
+                pa_bcolor(stdout, (pa_color)((x/COLRUN+y+i+4)%8));
+
+            }
+            putchar('a'+(x+y+i)%26);
+
+        }
+
+    }
+
+}
+
+static void ldselect(int i)
+
+{
+
+    pa_select(stdout, 1, i%2+1);
+
+}
+
+static void lddrag(int i)
+
+{
+
+    /* reverse at the sides of the screen */
+    if (winx+windx < 1 || winx+windx+WINX-1 > pa_maxx(stdout))
+        windx = -windx;
+    winx += windx;
+    pa_setpos(win[windows-1], winx, winy);
+
+}
+
+int main(int argc, char **argv)
+
+{
+
+    int  argi = 1;
+    int  i;
+    char buf[100];
+    int  l;
+
+    /* parse user options */
+    pa_options(&argi, &argc, argv, opttbl, TRUE);
+
+    if (argc != 1 || iterations < 1 || iterations > MAXITR || windows < 1 ||
+        windows > MAXWIN) {
+
+        fprintf(stderr,
+            "Usage: bench_term [--iterations=<n>|--i=<n>|--scroll=<n>|--s=<n>|\n");
+        fprintf(stderr,
+            "                   --windows=<n>|--w=<n>|--managed|--m|--report=<fd>|--r=<fd>]\n");
+
+        exit(1);
+
+    }
+
+    pa_autohold(FALSE); /* exit without waiting */
+    pa_auto(stdout, FALSE);
+    pa_curvis(stdout, FALSE);
+    l = sprintf(buf, "screen %dx%d, %d iterations\n",
+                pa_maxx(stdout), pa_maxy(stdout), iterations);
+    write(repfd, buf, l);
+    l = sprintf(buf, "%-8s %8s %12s %8s %10s %10s %10s\n",
+                "load", "iter", "bytes", "writes", "cpu us", "p50 us",
+                "p99 us");
+    write(repfd, buf, l);
+
+    run("repaint", ldrepaint);
+
+    fill('s');
+    endfrm();
+    run("scroll", ldscroll);
+
+    putchar('\f');
+    endfrm();
+    run("random", ldrandom);
+    pa_fcolor(stdout, pa_black);
+
+    run("color", ldcolor);
+    pa_fcolor(stdout, pa_black);
+    pa_bcolor(stdout, pa_white);
+
+    /* set up a different screen in each buffer */
+    pa_select(stdout, 2, 2);
+    pa_auto(stdout, FALSE);
+    fill('2');
+    pa_select(stdout, 1, 1);
+    fill('1');
+    endfrm();
+    run("select", ldselect);
+    pa_select(stdout, 1, 1);
+
+    if (managed) {
+
+        /* stack windows, each offset from the last */
+        fill('.');
+        for (i = 0; i < windows; i++) {
+
+            pa_openwin(&stdin, &win[i], stdout, i+2);
+            pa_curvis(win[i], FALSE);
+            pa_setpos(win[i], i*2+1, i+1);
+            pa_sizbuf(win[i], WINX, WINY);
+            pa_setsiz(win[i], WINX, WINY);
+            pa_bcolor(win[i], (pa_color)(pa_cyan+i%3));
+            putc('\f', win[i]);
+            fprintf(win[i], "Window %d\n", i+1);
+
+        }
+        winx = (windows-1)*2+1;
+        winy = windows;
+        windx = 1;
+        endfrm();
+        run("drag", lddrag);
+        for (i = 0; i < windows; i++) fclose(win[i]);
+
+    }
+
+    return (0);
+
+}
@@ -0,0 +1,458 @@
+/**//***************************************************************************
+
+Terminal damage tracking and output encoder
+
+Common support for the character screen modules. See termenc.h for the
+description.
+
+The encoder buffer is not locked. Callers that write from more than one thread
+must serialize access to it, the same as they must for the terminal itself.
+
+*******************************************************************************/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include <localdefs.h>
+
+#include <termenc.h>
+
+/**//***************************************************************************
+
+Initialize damage list
+
+Sets up a damage list for the given number of lines, and clears it. Returns
+FALSE if the list cannot be allocated.
+
+*******************************************************************************/
+
+int pa_dmgini(pa_dmgptr d, int rows)
+
+{
+
+    d->rows = rows; /* set number of lines */
+    d->x1 = malloc(sizeof(int)*rows);
+    d->x2 = malloc(sizeof(int)*rows);
+    if (!d->x1 || !d->x2) return (FALSE); /* no memory */
+    d->y1 = 1; /* set no lines damaged */
+    d->y2 = 0;
+
+    return (TRUE); /* exit with success */
+
+}
+
+/**//***************************************************************************
+
+Free damage list
+
+Releases the storage for a damage list.
+
+*******************************************************************************/
+
+void pa_dmgfre(pa_dmgptr d)
+
+{
+
+    free(d->x1);
+    free(d->x2);
+    d->x1 = NULL;
+    d->x2 = NULL;
+    d->rows = 0;
+
+}
+
+/**//***************************************************************************
+
+Clear damage list
+
+Clears all damage. The line spans are reset as lines are damaged again.
+
+*******************************************************************************/
+
+void pa_dmgclr(pa_dmgptr d)
+
+{
+
+    d->y1 = 1; /* set no lines damaged */
+    d->y2 = 0;
+
+}
+
+/**//***************************************************************************
+
+Add damage
+
+Adds a rectangle, in 1 based terms, to the damage list. Each line keeps the
+span that covers all of the damage to that line. The rectangle is clipped to
+the lines of the list.
+
+*******************************************************************************/
+
+void pa_dmgadd(pa_dmgptr d, int x1, int y1, int x2, int y2)
+
+{
+
+    int y;
+
+    if (y1 < 1) y1 = 1; /* clip to lines */
+    if (y2 > d->rows) y2 = d->rows;
+    if (x1 <= x2 && y1 <= y2) { /* not empty */
+
+        /* lines newly in the damaged range start empty */
+        if (d->y1 > d->y2) { /* no lines damaged */
+
+            for (y = y1; y <= y2; y++) { d->x1[y-1] = 1; d->x2[y-1] = 0; }
+            d->y1 = y1;
+            d->y2 = y2;
+
+        } else {
+
+            for (y = y1; y < d->y1; y++) { d->x1[y-1] = 1; d->x2[y-1] = 0; }
+            for (y = d->y2+1; y <= y2; y++) { d->x1[y-1] = 1; d->x2[y-1] = 0; }
+            if (y1 < d->y1) d->y1 = y1;
+            if (y2 > d->y2) d->y2 = y2;
+
+        }
+        for (y = y1; y <= y2; y++) { /* add to the span of each line */
+
+            if (d->x1[y-1] > d->x2[y-1]) { /* line is empty */
+
+                d->x1[y-1] = x1;
+                d->x2[y-1] = x2;
+
+            } else {
+
+                if (x1 < d->x1[y-1]) d->x1[y-1] = x1;
+                if (x2 > d->x2[y-1]) d->x2[y-1] = x2;
+
+            }
+
+        }
+
+    }
+
+}
+
+/**//***************************************************************************
+
+Check damage active
+
+Returns TRUE if there is any damage in the list.
+
+*******************************************************************************/
+
+int pa_dmgact(pa_dmgptr d)
+
+{
+
+    return (d->y1 <= d->y2);
+
+}
+
+/**//***************************************************************************
+
+Initialize encoder
+
+Sets up an encoder to write to the given file with the given write function.
+The write function is normally the next write() in the override chain.
+
+*******************************************************************************/
+
+void pa_encini(pa_encptr e, pa_encwrt_t wrt, int fd)
+
+{
+
+    e->wrt = wrt; /* set write function */
+    e->fd = fd; /* set file */
+    e->len = 0; /* set buffer empty */
+    e->sgr = -1; /* set no SGR in buffer */
+    e->sgrn = 0;
+
+}
+
+/**//***************************************************************************
+
+Flush encoder
+
+Writes out the contents of the encoder buffer. Returns FALSE if the write
+fails. The buffer is emptied in either case.
+
+*******************************************************************************/
+
+int pa_encflush(pa_encptr e)
+
+{
+
+    int     i;  /* index for buffer */
+    ssize_t rc; /* return code */
+    int     r;  /* result */
+
+    i = 0; /* set start of buffer */
+    r = TRUE; /* set success */
+    while (i < e->len && r) { /* write until done or error */
+
+        rc = (*e->wrt)(e->fd, &e->buf[i], e->len-i);
+        if (rc <= 0) r = FALSE; /* flag error */
+        else i += rc; /* advance past written */
+
+    }
+    e->len = 0; /* set buffer empty */
+    e->sgr = -1; /* set no SGR in buffer */
+
+    return (r); /* exit with result */
+
+}
+
+/**//***************************************************************************
+
+Place character to encoder
+
+Places a single character in the encoder buffer, writing out the buffer first
+if it is full. Returns FALSE if a write failed.
+
+*******************************************************************************/
+
+int pa_encchr(pa_encptr e, unsigned char c)
+
+{
+
+    int r; /* result */
+
+    r = TRUE; /* set success */
+    if (e->len >= PA_ENCBUF) r = pa_encflush(e); /* full, write out */
+    e->buf[e->len++] = c; /* place character */
+
+    return (r); /* exit with result */
+
+}
+
+/**//***************************************************************************
+
+Place string to encoder
+
+Places a zero terminated string in the encoder buffer. Returns FALSE if a write
+failed.
+
+*******************************************************************************/
+
+int pa_encstr(pa_encptr e, char* s)
+
+{
+
+    int r; /* result */
+
+    r = TRUE; /* set success */
+    while (*s) if (!pa_encchr(e, *s++)) r = FALSE;
+
+    return (r); /* exit with result */
+
+}
+
+/**//***************************************************************************
+
+Place integer to encoder
+
+Places a positive integer in decimal, without leading zeros, in the encoder
+buffer. Returns FALSE if a write failed.
+
+*******************************************************************************/
+
+int pa_encint(pa_encptr e, int i)
+
+{
+
+    char d[20]; /* digits, reversed */
+    int  n;     /* number of digits */
+    int  r;     /* result */
+
+    n = 0; /* set no digits */
+    do { d[n++] = i%10+'0'; i /= 10; } while (i > 0);
+    r = TRUE; /* set success */
+    while (n) if (!pa_encchr(e, d[--n])) r = FALSE;
+
+    return (r); /* exit with result */
+
+}
+
+/**//***************************************************************************
+
+Place SGR sequence to encoder
+
+Places a set graphic rendition sequence with the given parameters. If the last
+thing in the buffer was also an SGR sequence, the parameters are joined on to
+that one, so that a series of color and attribute changes goes out as a single
+sequence. SGR parameters are processed in order, so this does not change the
+result. Returns FALSE if a write failed.
+
+*******************************************************************************/
+
+int pa_encsgr(pa_encptr e, int n, int p[])
+
+{
+
+    int i;
+    int r; /* result */
+
+    r = TRUE; /* set success */
+    if (e->sgr == e->len && e->sgr > 0 && e->sgrn+n <= PA_ENCSGR) {
+
+        /* join to last sequence, replace its end with a separator */
+        e->buf[e->len-1] = ';';
+        e->sgrn += n;
+
+    } else { /* start new sequence */
+
+        if (!pa_encstr(e, "\33[")) r = FALSE;
+        e->sgrn = n;
+
+    }
+    for (i = 0; i < n; i++) { /* place parameters */
+
+        if (i) if (!pa_encchr(e, ';')) r = FALSE;
+        if (!pa_encint(e, p[i])) r = FALSE;
+
+    }
+    if (!pa_encchr(e, 'm')) r = FALSE; /* terminate */
+    e->sgr = e->len; /* mark end of sequence */
+
+    return (r); /* exit with result */
+
+}
+
+/**//***************************************************************************
+
+Find digits in number
+
+Returns the number of decimal digits in a positive number.
+
+*******************************************************************************/
+
+static int digits(int i)
+
+{
+
+    int n;
+
+    n = 1;
+    while (i >= 10) { i /= 10; n++; }
+
+    return (n);
+
+}
+
+/**//***************************************************************************
+
+Find cost of relative move
+
+Returns the number of characters it takes to move the cursor by the given
+amount in one direction. A count of 1 is left off the sequence.
+
+*******************************************************************************/
+
+static int movcst(int n)
+
+{
+
+    if (n < 0) n = -n;
+    if (!n) return (0); /* no move */
+    if (n == 1) return (3); /* ESC [ c */
+
+    return (3+digits(n)); /* ESC [ n c */
+
+}
+
+/**//***************************************************************************
+
+Place relative move to encoder
+
+Places a cursor move of the given amount, with the code for the positive and
+negative directions.
+
+*******************************************************************************/
+
+static int encmov(pa_encptr e, int n, char pc, char nc)
+
+{
+
+    int  r; /* result */
+    char c; /* direction code */
+
+    r = TRUE; /* set success */
+    if (n) { /* there is a move */
+
+        c = pc; /* set direction */
+        if (n < 0) { c = nc; n = -n; }
+        if (!pa_encstr(e, "\33[")) r = FALSE;
+        if (n != 1) if (!pa_encint(e, n)) r = FALSE;
+        if (!pa_encchr(e, c)) r = FALSE;
+
+    }
+
+    return (r); /* exit with result */
+
+}
+
+/**//***************************************************************************
+
+Place cursor motion to encoder
+
+Moves the cursor from the old position to the new position, 1 based, using the
+shortest sequence. The choices are an absolute position, a relative move up or
+down and left or right, or a carriage return followed by a relative move. If
+the old position is not known, it is given as 0, and the absolute position is
+used. Line feeds are not used, since they may scroll or be translated by the
+terminal driver. Returns FALSE if a write failed.
+
+*******************************************************************************/
+
+int pa_enccur(pa_encptr e, int ox, int oy, int nx, int ny)
+
+{
+
+    int abscst; /* cost of absolute position */
+    int relcst; /* cost of relative move */
+    int crcst;  /* cost of carriage return and relative move */
+    int r;      /* result */
+
+    /* find absolute cost, a home or a column of 1 can be left off */
+    if (nx == 1 && ny == 1) abscst = 3; /* ESC [ H */
+    else if (nx == 1) abscst = 3+digits(ny); /* ESC [ y H */
+    else abscst = 4+digits(ny)+digits(nx); /* ESC [ y ; x H */
+    relcst = abscst+1; /* set relative moves not better */
+    crcst = abscst+1;
+    if (ox >= 1 && oy >= 1) { /* old position is valid */
+
+        relcst = movcst(ny-oy)+movcst(nx-ox);
+        crcst = 1+movcst(ny-oy)+movcst(nx-1);
+
+    }
+    r = TRUE; /* set success */
+    if (relcst <= crcst && relcst < abscst) { /* relative move */
+
+        if (!encmov(e, ny-oy, 'B', 'A')) r = FALSE;
+        if (!encmov(e, nx-ox, 'C', 'D')) r = FALSE;
+
+    } else if (crcst < abscst) { /* carriage return and move */
+
+        if (!pa_encchr(e, '\r')) r = FALSE;
+        if (!encmov(e, ny-oy, 'B', 'A')) r = FALSE;
+        if (!encmov(e, nx-1, 'C', 'D')) r = FALSE;
+
+    } else { /* absolute position */
+
+        if (!pa_encstr(e, "\33[")) r = FALSE;
+        if (ny != 1 || nx != 1) if (!pa_encint(e, ny)) r = FALSE;
+        if (nx != 1) {
+
+            if (!pa_encchr(e, ';')) r = FALSE;
+            if (!pa_encint(e, nx)) r = FALSE;
+
+        }
+        if (!pa_encchr(e, 'H')) r = FALSE;
+
+    }
+
+    return (r); /* exit with result */
+
+}
@@ -634,6 +634,13 @@ static popen_t   ofpopen;
 static pclose_t  ofpclose;
 static plseek_t  ofplseek;
 
+/*
+ * Override vectors for drawing state and window id calls
+ */
+static pa_pushstate_t pushstate_vect;
+static pa_popstate_t  popstate_vect;
+static pa_winid_t     winid_vect;
+
 static filptr opnfil[MAXFIL]; /* open files table */
 static int xltwin[MAXFIL]; /* window equivalence table */
 static int filwin[MAXFIL]; /* file to window equivalence table */
@@ -15029,6 +15036,115 @@ void pa_queryfont(FILE* f, int* fc, int* s, int* fr, int* fg, int* fb,
 
 /*******************************************************************************
 
+Save drawing state
+
+Saves the drawing state of the current update screen on a stack for the window.
+It is restored by pa_popstate().
+
+Not implemented yet. The state is left as is.
+
+*******************************************************************************/
+
+void _pa_pushstate_ovr(pa_pushstate_t nfp, pa_pushstate_t* ofp)
+    { *ofp = pushstate_vect; pushstate_vect = nfp; }
+void pa_pushstate(FILE* f) { (*pushstate_vect)(f); }
+
+static void pushstate_ivf(FILE* f)
+
+{
+
+   /* not implemented */
+
+}
+
+/*******************************************************************************
+
+Restore drawing state
+
+Restores the last drawing state saved by pa_pushstate(), and removes it from
+the stack.
+
+Not implemented yet. The state is left as is.
+
+*******************************************************************************/
+
+void _pa_popstate_ovr(pa_popstate_t nfp, pa_popstate_t* ofp)
+    { *ofp = popstate_vect; popstate_vect = nfp; }
+void pa_popstate(FILE* f) { (*popstate_vect)(f); }
+
+static void popstate_ivf(FILE* f)
+
+{
+
+   /* not implemented */
+
+}
+
+/*******************************************************************************
+
+Find window id
+
+Returns the logical window id of the window attached to the given file. This is
+the id that events for the window carry.
+
+*******************************************************************************/
+
+void _pa_winid_ovr(pa_winid_t nfp, pa_winid_t* ofp)
+    { *ofp = winid_vect; winid_vect = nfp; }
+int pa_winid(FILE* f) { return ((*winid_vect)(f)); }
+
+static int winid_ivf(FILE* f)
+
+{
+
+    int wid; /* window id */
+
+    lockmain(); /* start exclusive access */
+    txt2win(f); /* check file is a window */
+    wid = filwin[fileno(f)]; /* get window id */
+    unlockmain(); /* end exclusive access */
+
+    return (wid);
+
+}
+
+/*******************************************************************************
+
+Get statistic
+
+Returns the value of a statistic by name. This module does not collect
+statistics, so all values read zero.
+
+*******************************************************************************/
+
+unsigned long long pa_getstat(FILE* f, const char* n)
+
+{
+
+    return (0);
+
+}
+
+/*******************************************************************************
+
+Print statistics
+
+Prints all of the statistics to the given file. This module does not collect
+statistics, so only says so.
+
+*******************************************************************************/
+
+void pa_prtstats(FILE* fp)
+
+{
+
+    fprintf(fp, "\nGraphics statistics: not collected\n");
+    fflush(fp);
+
+}
+
+/*******************************************************************************
+
 Window procedure for display thread
 
 This is the window handler callback for all display windows.
@@ -15994,6 +16110,11 @@ static void pa_init_graph()
     char*     errstr;
     pa_evtcod e;
 
+    /* set override vectors */
+    pushstate_vect = pushstate_ivf;
+    popstate_vect = popstate_ivf;
+    winid_vect = winid_ivf;
+
     /* override system calls for basic I/O */
     ovr_read(iread, &ofpread);
     ovr_write(iwrite, &ofpwrite);
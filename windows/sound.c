@@ -3800,6 +3800,28 @@ void pa_wrsynth(int p, pa_seqptr sp)
 
 /*******************************************************************************
 
+Write synthesizer port list
+
+Writes a list of sequencer instruction entries, linked by their next fields, to
+the given output port. Each entry is treated as by pa_wrsynth().
+
+*******************************************************************************/
+
+void pa_wrsynthlst(int p, pa_seqptr sp)
+
+{
+
+    while (sp) { /* traverse list */
+
+        pa_wrsynth(p, sp); /* write entry */
+        sp = sp->next; /* next entry */
+
+    }
+
+}
+
+/*******************************************************************************
+
 Parse sequencer entry
 
 Parses a MIDI sequencer entry from the 1 to 3 bytes given in a Windows packed